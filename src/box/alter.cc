@@ -214,6 +214,18 @@ index_opts_decode(struct index_opts *opts, const char *map,
 			  "'euclid' or 'manhattan'");
 		return -1;
 	}
+	if (opts->hint == hint_layout_MAX) {
+		diag_set(ClientError, ER_WRONG_INDEX_OPTIONS,
+			 BOX_INDEX_FIELD_OPTS, "hint must be either "\
+			  "'first_part' or 'multipart'");
+		return -1;
+	}
+	if (opts->hash_func == tuple_hash_func_MAX) {
+		diag_set(ClientError, ER_WRONG_INDEX_OPTIONS,
+			 BOX_INDEX_FIELD_OPTS, "hash_func must be either "\
+			  "'murmur' or 'mum64'");
+		return -1;
+	}
 	if (opts->page_size <= 0 || (opts->range_size > 0 &&
 				     opts->page_size > opts->range_size)) {
 		diag_set(ClientError, ER_WRONG_INDEX_OPTIONS,
@@ -563,6 +575,37 @@ space_format_decode(const char *data, uint32_t *out_count,
 	return 0;
 }
 
+/**
+ * Check that the expire field of a space definition is a
+ * numeric field of the format of a memtx space.
+ */
+static int
+space_def_check_expire_field(struct space_def *def, uint32_t errcode)
+{
+	if (strcmp(def->engine_name, "memtx") != 0) {
+		diag_set(ClientError, errcode, def->name,
+			 "expire_field is supported by memtx engine only");
+		return -1;
+	}
+	uint32_t fieldno = def->opts.expire_field;
+	if (fieldno >= def->field_count) {
+		diag_set(ClientError, errcode, def->name,
+			 "expire_field must be defined in the space format");
+		return -1;
+	}
+	switch (def->fields[fieldno].type) {
+	case FIELD_TYPE_UNSIGNED:
+	case FIELD_TYPE_INTEGER:
+	case FIELD_TYPE_NUMBER:
+	case FIELD_TYPE_DOUBLE:
+		return 0;
+	default:
+		diag_set(ClientError, errcode, def->name,
+			 "expire_field must be a numeric field");
+		return -1;
+	}
+}
+
 /**
  * Fill space_def structure from struct tuple.
  */
@@ -668,6 +711,9 @@ space_def_new_from_tuple(struct tuple *tuple, uint32_t errcode,
 	if (def == NULL)
 		return NULL;
 	auto def_guard = make_scoped_guard([=] { space_def_delete(def); });
+	if (def->opts.expire_field != SPACE_EXPIRE_FIELD_NONE &&
+	    space_def_check_expire_field(def, errcode) != 0)
+		return NULL;
 	struct engine *engine = engine_find(def->engine_name);
 	if (engine == NULL)
 		return NULL;
@@ -2871,6 +2917,9 @@ on_replace_dd_truncate(struct trigger * /* trigger */, void *event)
 	if (access_check_space(old_space, PRIV_W) != 0)
 		return -1;
 
+	if (space_prepare_truncate(old_space) != 0)
+		return -1;
+
 	struct alter_space *alter = alter_space_new(old_space);
 	if (alter == NULL)
 		return -1;
@@ -31,10 +31,13 @@
 #include "applier.h"
 
 #include <msgpuck.h>
+#include <dirent.h>
 
 #include "xlog.h"
 #include "fiber.h"
+#include "coio_file.h"
 #include "fiber_cond.h"
+#include "cbus.h"
 #include "coio.h"
 #include "coio_buf.h"
 #include "wal.h"
@@ -44,6 +47,7 @@
 #include "version.h"
 #include "trigger.h"
 #include "xrow_io.h"
+#include "tt_static.h"
 #include "error.h"
 #include "session.h"
 #include "cfg.h"
@@ -202,13 +206,10 @@ applier_writer_f(va_list ap)
 }
 
 static int
-apply_snapshot_row(struct xrow_header *row)
+apply_snapshot_request(struct request *request)
 {
 	int rc;
-	struct request request;
-	if (xrow_decode_dml(row, &request, dml_request_key_map(row->type)) != 0)
-		return -1;
-	struct space *space = space_cache_find(request.space_id);
+	struct space *space = space_cache_find(request->space_id);
 	if (space == NULL)
 		return -1;
 	struct txn *txn = txn_begin();
@@ -218,9 +219,9 @@ apply_snapshot_row(struct xrow_header *row)
 		goto rollback;
 	/* no access checks here - applier always works with admin privs */
 	struct tuple *unused;
-	if (space_execute_dml(space, txn, &request, &unused) != 0)
+	if (space_execute_dml(space, txn, request, &unused) != 0)
 		goto rollback_stmt;
-	if (txn_commit_stmt(txn, &request))
+	if (txn_commit_stmt(txn, request))
 		goto rollback;
 	rc = txn_commit(txn);
 	fiber_gc();
@@ -233,6 +234,15 @@ rollback:
 	return -1;
 }
 
+static int
+apply_snapshot_row(struct xrow_header *row)
+{
+	struct request request;
+	if (xrow_decode_dml(row, &request, dml_request_key_map(row->type)) != 0)
+		return -1;
+	return apply_snapshot_request(&request);
+}
+
 /**
  * Process a no-op request.
  *
@@ -250,23 +260,29 @@ process_nop(struct request *request)
 }
 
 static int
-apply_row(struct xrow_header *row)
+apply_request(struct request *request)
 {
-	struct request request;
-	if (xrow_decode_dml(row, &request, dml_request_key_map(row->type)) != 0)
-		return -1;
-	if (request.type == IPROTO_NOP)
-		return process_nop(&request);
-	struct space *space = space_cache_find(request.space_id);
+	if (request->type == IPROTO_NOP)
+		return process_nop(request);
+	struct space *space = space_cache_find(request->space_id);
 	if (space == NULL)
 		return -1;
-	if (box_process_rw(&request, space, NULL) != 0) {
-		say_error("error applying row: %s", request_str(&request));
+	if (box_process_rw(request, space, NULL) != 0) {
+		say_error("error applying row: %s", request_str(request));
 		return -1;
 	}
 	return 0;
 }
 
+static int
+apply_row(struct xrow_header *row)
+{
+	struct request request;
+	if (xrow_decode_dml(row, &request, dml_request_key_map(row->type)) != 0)
+		return -1;
+	return apply_request(&request);
+}
+
 static int
 apply_final_join_row(struct xrow_header *row)
 {
@@ -388,6 +404,232 @@ done:
 	applier_set_state(applier, APPLIER_READY);
 }
 
+/* {{{ Parallel initial join */
+
+/** An extra data stream of a parallel initial join. */
+struct applier_join_stream {
+	/** The join the stream belongs to. */
+	struct applier_join *join;
+	/** Id of the stream, sent in JOIN_STREAM request. */
+	uint32_t id;
+	/** Fiber receiving the stream data. */
+	struct fiber *fiber;
+	/** Number of rows received over the stream. */
+	uint64_t row_count;
+	/**
+	 * Number of rows the master has sent over the stream,
+	 * reported over the JOIN connection, or -1 if unknown.
+	 */
+	int64_t sent_row_count;
+	/** Set once the master has acknowledged the attach. */
+	bool is_attached;
+};
+
+/**
+ * Initial join receiving data over several connections.
+ * The data of the extra streams is applied only after the
+ * whole schema has been received over the JOIN connection.
+ */
+struct applier_join {
+	struct applier *applier;
+	/** Set once all system spaces have been applied. */
+	bool is_schema_ready;
+	/** Signalled when the schema is ready. */
+	struct fiber_cond cond;
+	/** Extra streams, stream 0 is the JOIN connection. */
+	struct applier_join_stream streams[REPLICATION_JOIN_STREAMS_MAX];
+	uint32_t stream_count;
+};
+
+static void
+applier_join_set_schema_ready(struct applier_join *join)
+{
+	join->is_schema_ready = true;
+	fiber_cond_broadcast(&join->cond);
+}
+
+/**
+ * Open a connection for an extra join stream to the master
+ * the applier is joining from and authenticate it.
+ */
+static void
+applier_join_stream_connect(struct applier *applier, struct ev_io *io,
+			    struct ibuf *ibuf)
+{
+	char greetingbuf[IPROTO_GREETING_SIZE];
+	struct xrow_header row;
+	struct uri *uri = &applier->uri;
+
+	coio_connect(io, uri, NULL, NULL);
+	coio_readn(io, greetingbuf, IPROTO_GREETING_SIZE);
+	struct greeting greeting;
+	if (greeting_decode(greetingbuf, &greeting) != 0)
+		tnt_raise(LoggedError, ER_PROTOCOL, "Invalid greeting");
+	if (!tt_uuid_is_equal(&greeting.uuid, &applier->uuid)) {
+		tnt_raise(LoggedError, ER_PROTOCOL,
+			  "Join stream connected to another instance");
+	}
+	if (!uri->login)
+		return;
+	xrow_encode_auth_xc(&row, greeting.salt, greeting.salt_len, uri->login,
+			    uri->login_len,
+			    uri->password != NULL ? uri->password : "",
+			    uri->password_len);
+	coio_write_xrow(io, &row);
+	coio_read_xrow(io, ibuf, &row);
+	if (row.type != IPROTO_OK)
+		xrow_decode_error_xc(&row); /* auth failed */
+}
+
+static void
+applier_join_stream_recv(struct applier_join_stream *stream)
+{
+	struct applier_join *join = stream->join;
+	struct applier *applier = join->applier;
+	struct ev_io io;
+	coio_create(&io, -1);
+	struct ibuf ibuf;
+	ibuf_create(&ibuf, &cord()->slabc, 1024);
+	auto guard = make_scoped_guard([&] {
+		coio_close_io(loop(), &io);
+		ibuf_destroy(&ibuf);
+	});
+	applier_join_stream_connect(applier, &io, &ibuf);
+
+	struct xrow_header row;
+	xrow_encode_join_stream_xc(&row, &INSTANCE_UUID, stream->id);
+	coio_write_xrow(&io, &row);
+
+	while (true) {
+		coio_read_xrow(&io, &ibuf, &row);
+		applier->last_row_time = ev_monotonic_now(loop());
+		if (row.type == IPROTO_JOIN_STREAM) {
+			/* The master is going to send the stream data. */
+			stream->is_attached = true;
+		} else if (iproto_type_is_dml(row.type)) {
+			if (!stream->is_attached) {
+				tnt_raise(ClientError, ER_PROTOCOL,
+					  "Join stream data before attach");
+			}
+			/* User spaces can't be applied before the schema. */
+			while (!join->is_schema_ready) {
+				fiber_testcancel();
+				fiber_cond_wait(&join->cond);
+			}
+			fiber_testcancel();
+			if (apply_snapshot_row(&row) != 0)
+				diag_raise();
+			stream->row_count++;
+		} else if (row.type == IPROTO_OK) {
+			break; /* end of stream */
+		} else if (iproto_type_is_error(row.type)) {
+			xrow_decode_error_xc(&row);  /* rethrow error */
+		} else {
+			tnt_raise(ClientError, ER_UNKNOWN_REQUEST_TYPE,
+				  (uint32_t) row.type);
+		}
+	}
+}
+
+static int
+applier_join_stream_f(va_list ap)
+{
+	struct applier_join_stream *stream =
+		va_arg(ap, struct applier_join_stream *);
+	try {
+		applier_join_stream_recv(stream);
+	} catch (FiberIsCancelled *e) {
+		return -1;
+	} catch (Exception *e) {
+		if (stream->is_attached)
+			return -1;
+		/*
+		 * The master sends the data of a stream it hasn't
+		 * acknowledged over the JOIN connection. If the ack
+		 * was lost, the row counts the master reports over
+		 * the JOIN connection don't match and the join fails.
+		 */
+		e->log();
+		say_warn("failed to attach to join stream %u, "
+			 "it will be received over the main connection",
+			 (unsigned)stream->id);
+		diag_clear(diag_get());
+	}
+	return 0;
+}
+
+/** Start fibers receiving the extra streams of a join. */
+static void
+applier_join_start(struct applier_join *join)
+{
+	for (uint32_t i = 1; i < join->stream_count; i++) {
+		struct applier_join_stream *stream = &join->streams[i];
+		stream->join = join;
+		stream->id = i;
+		stream->row_count = 0;
+		stream->sent_row_count = -1;
+		stream->is_attached = false;
+		stream->fiber = fiber_new_xc(tt_sprintf("join_stream/%u",
+							(unsigned)i),
+					     applier_join_stream_f);
+		fiber_set_joinable(stream->fiber, true);
+		fiber_start(stream->fiber, stream);
+	}
+}
+
+/**
+ * Wait for all extra streams of a join to be received.
+ * Returns the number of rows received or -1 with the error
+ * of a failed stream set in the diagnostics area.
+ */
+static int64_t
+applier_join_wait(struct applier_join *join)
+{
+	int64_t row_count = 0;
+	for (uint32_t i = 1; i < join->stream_count; i++) {
+		struct applier_join_stream *stream = &join->streams[i];
+		if (stream->fiber == NULL)
+			continue;
+		if (fiber_join(stream->fiber) != 0)
+			row_count = -1;
+		stream->fiber = NULL;
+		if (row_count < 0)
+			continue;
+		if (stream->sent_row_count >= 0 &&
+		    (uint64_t)stream->sent_row_count != stream->row_count) {
+			diag_set(ClientError, ER_PROTOCOL,
+				 tt_sprintf("Join stream %u: %lld rows sent, "
+					    "%llu received", (unsigned)i,
+					    (long long)stream->sent_row_count,
+					    (unsigned long long)
+					    stream->row_count));
+			row_count = -1;
+			continue;
+		}
+		row_count += stream->row_count;
+	}
+	return row_count;
+}
+
+/** Stop the extra streams of a failed join. */
+static void
+applier_join_cancel(struct applier_join *join)
+{
+	/* Keep the error the join failed with. */
+	struct diag diag;
+	diag_create(&diag);
+	diag_move(diag_get(), &diag);
+	for (uint32_t i = 1; i < join->stream_count; i++) {
+		struct fiber *f = join->streams[i].fiber;
+		if (f != NULL)
+			fiber_cancel(f);
+	}
+	applier_join_wait(join);
+	diag_move(&diag, diag_get());
+}
+
+/* }}} */
+
 static uint64_t
 applier_wait_snapshot(struct applier *applier)
 {
@@ -395,6 +637,16 @@ applier_wait_snapshot(struct applier *applier)
 	struct ibuf *ibuf = &applier->ibuf;
 	struct xrow_header row;
 
+	struct applier_join join;
+	memset(&join, 0, sizeof(join));
+	join.applier = applier;
+	join.stream_count = 1;
+	fiber_cond_create(&join.cond);
+	auto join_guard = make_scoped_guard([&] {
+		applier_join_cancel(&join);
+		fiber_cond_destroy(&join.cond);
+	});
+
 	/**
 	 * Tarantool < 1.7.0: if JOIN is successful, there is no "OK"
 	 * response, but a stream of rows from checkpoint.
@@ -414,7 +666,19 @@ applier_wait_snapshot(struct applier *applier)
 		 * Used to initialize the replica's initial
 		 * vclock in bootstrap_from_master()
 		 */
-		xrow_decode_vclock_xc(&row, &replicaset.vclock);
+		uint32_t stream_count;
+		xrow_decode_join_response_xc(&row, &replicaset.vclock,
+					     &stream_count);
+		if (stream_count > (uint32_t)REPLICATION_JOIN_STREAMS_MAX) {
+			tnt_raise(ClientError, ER_PROTOCOL,
+				  "Invalid number of join streams");
+		}
+		join.stream_count = stream_count;
+		if (join.stream_count > 1) {
+			say_info("receiving initial data over %u streams",
+				 (unsigned)join.stream_count);
+			applier_join_start(&join);
+		}
 	}
 
 	/*
@@ -425,10 +689,40 @@ applier_wait_snapshot(struct applier *applier)
 		coio_read_xrow(coio, ibuf, &row);
 		applier->last_row_time = ev_monotonic_now(loop());
 		if (iproto_type_is_dml(row.type)) {
-			if (apply_snapshot_row(&row) != 0)
+			struct request request;
+			if (xrow_decode_dml(&row, &request,
+					    dml_request_key_map(row.type)) != 0 ||
+			    apply_snapshot_request(&request) != 0)
 				diag_raise();
+			/*
+			 * System spaces are sent first, so the first
+			 * row of a user space means that the schema
+			 * is complete.
+			 */
+			if (!join.is_schema_ready &&
+			    !space_is_system(space_by_id(request.space_id)))
+				applier_join_set_schema_ready(&join);
 			if (++row_count % 100000 == 0)
 				say_info("%.1fM rows received", row_count / 1e6);
+		} else if (row.type == IPROTO_JOIN_STREAM) {
+			uint32_t stream_id;
+			uint64_t sent_row_count;
+			xrow_decode_join_stream_rows_xc(&row, &stream_id,
+							&sent_row_count);
+			if (stream_id == 0) {
+				/*
+				 * All data of the JOIN connection
+				 * but OK is sent.
+				 */
+				applier_join_set_schema_ready(&join);
+			} else if (stream_id < join.stream_count) {
+				/* Checked once the stream is received. */
+				join.streams[stream_id].sent_row_count =
+					sent_row_count;
+			} else {
+				tnt_raise(ClientError, ER_PROTOCOL,
+					  "Invalid join stream id");
+			}
 		} else if (row.type == IPROTO_OK) {
 			if (applier->version_id < version_id(1, 7, 0)) {
 				/*
@@ -449,6 +743,10 @@ applier_wait_snapshot(struct applier *applier)
 		}
 	}
 
+	int64_t stream_row_count = applier_join_wait(&join);
+	if (stream_row_count < 0)
+		diag_raise();
+	row_count += stream_row_count;
 	return row_count;
 }
 
@@ -526,7 +824,8 @@ applier_register(struct applier *applier)
 	 * Send this instance's current vclock together
 	 * with REGISTER request.
 	 */
-	xrow_encode_register(&row, &INSTANCE_UUID, box_vclock);
+	xrow_encode_register(&row, &INSTANCE_UUID, box_vclock,
+			     applier->is_from_checkpoint);
 	row.type = IPROTO_REGISTER;
 	coio_write_xrow(coio, &row);
 
@@ -547,7 +846,8 @@ applier_join(struct applier *applier)
 	struct xrow_header row;
 	uint64_t row_count;
 
-	xrow_encode_join_xc(&row, &INSTANCE_UUID);
+	xrow_encode_join_xc(&row, &INSTANCE_UUID,
+			    cfg_geti("replication_join_streams"));
 	coio_write_xrow(coio, &row);
 
 	applier_set_state(applier, APPLIER_INITIAL_JOIN);
@@ -581,62 +881,306 @@ struct applier_tx_row {
 	struct stailq_entry next;
 	/* xrow_header struct for the current transaction row. */
 	struct xrow_header row;
+	/* DML request decoded from the row by the I/O thread. */
+	struct request req;
+};
+
+/* {{{ Applier I/O thread */
+
+enum {
+	/** Size of row bodies after which a batch is sent to tx. */
+	APPLIER_BATCH_SIZE = 1024 * 1024,
+	/** Max number of batches sent to tx and not applied yet. */
+	APPLIER_BATCH_MAX = 8,
 };
 
-static struct applier_tx_row *
-applier_read_tx_row(struct applier *applier)
+/**
+ * A batch of transactions read by the applier I/O thread.
+ * Sent to tx over cbus and sent back once applied.
+ */
+struct applier_batch {
+	/** cbus message. */
+	struct cmsg base;
+	/** The I/O thread the batch was read by. */
+	struct applier_io *io;
+	/** Link in applier_io::batches. */
+	struct stailq_entry in_io;
+	/** Rows of complete transactions in the order read. */
+	struct applier_tx_row *rows;
+	int row_count;
+	int row_capacity;
+	/** Copy of the row bodies. */
+	char *data;
+	/** Size of @a data and the used part of it. */
+	size_t data_size;
+	size_t data_used;
+	/** Lag at the time the last row of the batch was read. */
+	double lag;
+};
+
+/**
+ * The applier I/O thread reads the stream of rows sent by the
+ * master in reply to SUBSCRIBE, groups the rows into
+ * transactions and decodes their DML requests, so that only
+ * applying them is left to the tx thread.
+ */
+struct applier_io {
+	/** The I/O thread. */
+	struct cord cord;
+	/** Endpoint of the I/O thread. */
+	struct cbus_endpoint endpoint;
+	/** Pipe from the I/O thread to tx. */
+	struct cpipe tx_pipe;
+	/** Pipe from tx to the I/O thread. */
+	struct cpipe io_pipe;
+	/** Sent by the I/O thread after the last batch. */
+	struct cmsg done_msg;
+	/** Sent by tx to stop the I/O thread. */
+	struct cmsg stop_msg;
+	/** Applier socket. */
+	int fd;
+	/** Remote version, see applier::version_id. */
+	uint32_t version_id;
+	/** Input received by tx, but not parsed. */
+	const char *input;
+	size_t input_size;
+	/** Error the I/O thread stopped at. */
+	struct diag diag;
+	/** Set when tx asks the I/O thread to stop. */
+	bool is_stopped;
+	/** Number of batches sent to tx and not returned yet. */
+	int batch_count;
+	/** Signalled when a batch is returned by tx. */
+	struct fiber_cond batch_cond;
+	/** Set in tx when the pipes are created. */
+	bool is_paired;
+	/** Set in tx when the last batch is received. */
+	bool is_done;
+	/** Batches received by tx and not applied yet. */
+	struct stailq batches;
+	/** Signalled in tx when a batch is received. */
+	struct fiber_cond cond;
+};
+
+static struct applier_batch *
+applier_batch_new(struct applier_io *io)
 {
-	struct ev_io *coio = &applier->io;
-	struct ibuf *ibuf = &applier->ibuf;
+	struct applier_batch *batch =
+		(struct applier_batch *)calloc(1, sizeof(*batch));
+	if (batch == NULL) {
+		diag_set(OutOfMemory, sizeof(*batch), "calloc",
+			 "struct applier_batch");
+		return NULL;
+	}
+	batch->io = io;
+	return batch;
+}
 
-	struct applier_tx_row *tx_row = (struct applier_tx_row *)
-		region_alloc(&fiber()->gc, sizeof(struct applier_tx_row));
+static void
+applier_batch_delete(struct applier_batch *batch)
+{
+	free(batch->rows);
+	free(batch->data);
+	free(batch);
+}
 
-	if (tx_row == NULL)
-		tnt_raise(OutOfMemory, sizeof(struct applier_tx_row),
-			  "region", "struct applier_tx_row");
+/**
+ * Append a row to a batch. The row body is copied and its
+ * offset in the batch data is stored instead of the pointer
+ * until the batch is complete, see applier_batch_finish().
+ */
+static int
+applier_batch_add(struct applier_batch *batch, struct xrow_header *row)
+{
+	if (batch->row_count == batch->row_capacity) {
+		int new_capacity = MAX(batch->row_capacity * 2, 16);
+		size_t size = new_capacity * sizeof(*batch->rows);
+		struct applier_tx_row *rows = (struct applier_tx_row *)
+			realloc(batch->rows, size);
+		if (rows == NULL) {
+			diag_set(OutOfMemory, size, "realloc",
+				 "applier batch rows");
+			return -1;
+		}
+		batch->rows = rows;
+		batch->row_capacity = new_capacity;
+	}
+	assert(row->bodycnt <= 1);
+	size_t size = row->bodycnt > 0 ? row->body[0].iov_len : 0;
+	if (batch->data_used + size > batch->data_size) {
+		size_t new_size = MAX(batch->data_size * 2,
+				      batch->data_used + size);
+		char *data = (char *)realloc(batch->data, new_size);
+		if (data == NULL) {
+			diag_set(OutOfMemory, new_size, "realloc",
+				 "applier batch data");
+			return -1;
+		}
+		batch->data = data;
+		batch->data_size = new_size;
+	}
+	struct xrow_header *copy = &batch->rows[batch->row_count++].row;
+	*copy = *row;
+	if (row->bodycnt > 0) {
+		copy->body[0].iov_base = (void *)(uintptr_t)batch->data_used;
+		memcpy(batch->data + batch->data_used, row->body[0].iov_base,
+		       size);
+		batch->data_used += size;
+	}
+	return 0;
+}
 
-	struct xrow_header *row = &tx_row->row;
+/**
+ * Set the row body pointers of a complete batch and decode DML
+ * requests. On failure the batch is truncated before the
+ * transaction the bad row belongs to.
+ */
+static int
+applier_batch_finish(struct applier_batch *batch)
+{
+	int tx_start = 0;
+	for (int i = 0; i < batch->row_count; i++) {
+		struct applier_tx_row *tx_row = &batch->rows[i];
+		struct xrow_header *row = &tx_row->row;
+		if (row->bodycnt > 0) {
+			row->body[0].iov_base = batch->data +
+				(uintptr_t)row->body[0].iov_base;
+		}
+		if (i > 0 && batch->rows[i - 1].row.is_commit)
+			tx_start = i;
+		/* Heartbeats have no body to decode. */
+		if (row->lsn == 0)
+			continue;
+		if (xrow_decode_dml(row, &tx_row->req,
+				    dml_request_key_map(row->type)) != 0) {
+			batch->row_count = tx_start;
+			return -1;
+		}
+	}
+	return 0;
+}
 
-	double timeout = replication_disconnect_timeout();
-	/*
-	 * Tarantool < 1.7.7 does not send periodic heartbeat
-	 * messages so we can't assume that if we haven't heard
-	 * from the master for quite a while the connection is
-	 * broken - the master might just be idle.
-	 */
-	if (applier->version_id < version_id(1, 7, 7))
-		coio_read_xrow(coio, ibuf, row);
-	else
-		coio_read_xrow_timeout_xc(coio, ibuf, row, timeout);
+/** Append a batch received from the I/O thread. Tx thread. */
+static void
+applier_io_deliver(struct cmsg *msg)
+{
+	struct applier_batch *batch = (struct applier_batch *)msg;
+	struct applier_io *io = batch->io;
+	stailq_add_tail_entry(&io->batches, batch, in_io);
+	fiber_cond_signal(&io->cond);
+}
 
-	applier->lag = ev_now(loop()) - row->tm;
-	applier->last_row_time = ev_monotonic_now(loop());
-	return tx_row;
+/** Send a complete batch to tx. I/O thread. */
+static void
+applier_io_send(struct applier_io *io, struct applier_batch *batch)
+{
+	static const struct cmsg_hop route[] = {
+		{applier_io_deliver, NULL},
+	};
+	cmsg_init(&batch->base, route);
+	cpipe_push(&io->tx_pipe, &batch->base);
+	io->batch_count++;
+}
+
+/** Free a batch applied by tx. I/O thread. */
+static void
+applier_io_release(struct cmsg *msg)
+{
+	struct applier_batch *batch = (struct applier_batch *)msg;
+	struct applier_io *io = batch->io;
+	applier_batch_delete(batch);
+	io->batch_count--;
+	fiber_cond_signal(&io->batch_cond);
+}
+
+/** Return an applied batch to the I/O thread. Tx thread. */
+static void
+applier_io_ack(struct applier_io *io, struct applier_batch *batch)
+{
+	static const struct cmsg_hop route[] = {
+		{applier_io_release, NULL},
+	};
+	cmsg_init(&batch->base, route);
+	cpipe_push(&io->io_pipe, &batch->base);
+}
+
+/** Note that the I/O thread won't send batches any more. Tx thread. */
+static void
+applier_io_complete(struct cmsg *msg)
+{
+	struct applier_io *io = container_of(msg, struct applier_io,
+					     done_msg);
+	io->is_done = true;
+	fiber_cond_signal(&io->cond);
+}
+
+/** Stop reading. I/O thread. */
+static void
+applier_io_stop_f(struct cmsg *msg)
+{
+	struct applier_io *io = container_of(msg, struct applier_io,
+					     stop_msg);
+	io->is_stopped = true;
+}
+
+/** Note that the pipes are created. Tx thread. */
+static void
+applier_io_pair_cb(void *arg)
+{
+	struct applier_io *io = (struct applier_io *)arg;
+	io->is_paired = true;
+	fiber_cond_signal(&io->cond);
 }
 
 /**
- * Read one transaction from network using applier's input buffer.
- * Transaction rows are placed onto fiber gc region.
- * We could not use applier input buffer to store rows because
- * rpos is adjusted as xrow is decoded and the corresponding
- * network input space is reused for the next xrow.
+ * Check if the next row has been received completely, so that
+ * it can be read without waiting for the network.
+ */
+static bool
+applier_io_has_row(struct ibuf *ibuf)
+{
+	const char *pos = ibuf->rpos;
+	if (pos == ibuf->wpos)
+		return false;
+	/* Let the reader raise the error. */
+	if (mp_typeof(*pos) != MP_UINT)
+		return true;
+	if (mp_check_uint(pos, ibuf->wpos) > 0)
+		return false;
+	uint64_t len = mp_decode_uint(&pos);
+	return (uint64_t)(ibuf->wpos - pos) >= len;
+}
+
+/**
+ * Read one transaction from network and append its rows to
+ * a batch.
  */
 static void
-applier_read_tx(struct applier *applier, struct stailq *rows)
+applier_io_read_tx(struct applier_io *io, struct ev_io *coio,
+		   struct ibuf *ibuf, struct applier_batch *batch)
 {
 	int64_t tsn = 0;
-
-	stailq_create(rows);
+	struct xrow_header row;
 	do {
-		struct applier_tx_row *tx_row = applier_read_tx_row(applier);
-		struct xrow_header *row = &tx_row->row;
+		double timeout = replication_disconnect_timeout();
+		/*
+		 * Tarantool < 1.7.7 does not send periodic heartbeat
+		 * messages so we can't assume that if we haven't heard
+		 * from the master for quite a while the connection is
+		 * broken - the master might just be idle.
+		 */
+		if (io->version_id < version_id(1, 7, 7))
+			coio_read_xrow(coio, ibuf, &row);
+		else
+			coio_read_xrow_timeout_xc(coio, ibuf, &row, timeout);
 
-		if (iproto_type_is_error(row->type))
-			xrow_decode_error_xc(row);
+		batch->lag = ev_now(loop()) - row.tm;
+
+		if (iproto_type_is_error(row.type))
+			xrow_decode_error_xc(&row);
 
 		/* Replication request. */
-		if (row->replica_id >= VCLOCK_MAX) {
+		if (row.replica_id >= VCLOCK_MAX) {
 			/*
 			 * A safety net, this can only occur
 			 * if we're fed a strangely broken xlog.
@@ -644,7 +1188,7 @@ applier_read_tx(struct applier *applier, struct stailq *rows)
 			 * heartbeats from an anonymous instance.
 			 */
 			tnt_raise(ClientError, ER_UNKNOWN_REPLICA,
-				  int2str(row->replica_id),
+				  int2str(row.replica_id),
 				  tt_uuid_str(&REPLICASET_UUID));
 		}
 		if (tsn == 0) {
@@ -652,43 +1196,206 @@ applier_read_tx(struct applier *applier, struct stailq *rows)
 			 * Transaction id must be derived from the log sequence
 			 * number of the first row in the transaction.
 			 */
-			tsn = row->tsn;
-			if (row->lsn != tsn)
+			tsn = row.tsn;
+			if (row.lsn != tsn)
 				tnt_raise(ClientError, ER_PROTOCOL,
 					  "Transaction id must be equal to "
 					  "LSN of the first row in the "
 					  "transaction.");
 		}
-		if (tsn != row->tsn)
+		if (tsn != row.tsn)
 			tnt_raise(ClientError, ER_UNSUPPORTED,
 				  "replication",
 				  "interleaving transactions");
 
-		assert(row->bodycnt <= 1);
-		if (row->bodycnt == 1 && !row->is_commit) {
-			/*
-			 * Save row body to gc region.
-			 * Not done for single-statement
-			 * transactions knowing that the input
-			 * buffer will not be used while the
-			 * transaction is applied.
-			 */
-			void *new_base = region_alloc(&fiber()->gc,
-						      row->body->iov_len);
-			if (new_base == NULL)
-				tnt_raise(OutOfMemory, row->body->iov_len,
-					  "region", "xrow body");
-			memcpy(new_base, row->body->iov_base,
-			       row->body->iov_len);
-			/* Adjust row body pointers. */
-			row->body->iov_base = new_base;
+		if (applier_batch_add(batch, &row) != 0)
+			diag_raise();
+	} while (!row.is_commit);
+}
+
+/**
+ * Read transactions and send them to tx in batches. A batch is
+ * sent as soon as the next row isn't in the input buffer yet,
+ * so batching doesn't add to the replication lag.
+ */
+static int
+applier_io_reader_f(va_list ap)
+{
+	struct applier_io *io = va_arg(ap, struct applier_io *);
+	struct ev_io coio;
+	coio_create(&coio, io->fd);
+	struct ibuf ibuf;
+	ibuf_create(&ibuf, &cord()->slabc, 1024);
+	struct applier_batch *batch = NULL;
+	int row_count = 0;
+	size_t data_used = 0;
+	try {
+		if (io->input_size > 0) {
+			void *input = ibuf_alloc(&ibuf, io->input_size);
+			if (input == NULL)
+				tnt_raise(OutOfMemory, io->input_size,
+					  "ibuf_alloc", "applier input");
+			memcpy(input, io->input, io->input_size);
+		}
+		while (true) {
+			if (batch == NULL &&
+			    (batch = applier_batch_new(io)) == NULL)
+				diag_raise();
+			row_count = batch->row_count;
+			data_used = batch->data_used;
+			applier_io_read_tx(io, &coio, &ibuf, batch);
+			if (ibuf_used(&ibuf) == 0)
+				ibuf_reset(&ibuf);
+			if (batch->data_used < APPLIER_BATCH_SIZE &&
+			    applier_io_has_row(&ibuf))
+				continue;
+			int rc = applier_batch_finish(batch);
+			applier_io_send(io, batch);
+			batch = NULL;
+			if (rc != 0)
+				diag_raise();
+			while (io->batch_count >= APPLIER_BATCH_MAX) {
+				fiber_testcancel();
+				fiber_cond_wait(&io->batch_cond);
+			}
+		}
+	} catch (Exception *e) {
+		/*
+		 * Send the transactions read completely before
+		 * the error. If one of them fails to decode, the
+		 * decoding error is reported instead.
+		 */
+		if (batch != NULL) {
+			batch->row_count = row_count;
+			batch->data_used = data_used;
+			if (batch->row_count > 0) {
+				applier_batch_finish(batch);
+				applier_io_send(io, batch);
+			} else {
+				applier_batch_delete(batch);
+			}
 		}
-		stailq_add_tail(rows, &tx_row->next);
+		diag_move(diag_get(), &io->diag);
+	}
+	ibuf_destroy(&ibuf);
+	static const struct cmsg_hop route[] = {
+		{applier_io_complete, NULL},
+	};
+	cmsg_init(&io->done_msg, route);
+	cpipe_push(&io->tx_pipe, &io->done_msg);
+	return 0;
+}
 
-	} while (!stailq_last_entry(rows, struct applier_tx_row,
-				    next)->row.is_commit);
+static int
+applier_io_f(va_list ap)
+{
+	struct applier_io *io = va_arg(ap, struct applier_io *);
+	cbus_endpoint_create(&io->endpoint, tt_sprintf("applier_io_%p", io),
+			     fiber_schedule_cb, fiber());
+	cbus_pair("tx", io->endpoint.name, &io->tx_pipe, &io->io_pipe,
+		  applier_io_pair_cb, io, cbus_process);
+	fiber_cond_create(&io->batch_cond);
+
+	struct fiber *reader = fiber_new("reader", applier_io_reader_f);
+	if (reader != NULL) {
+		fiber_set_joinable(reader, true);
+		fiber_start(reader, io);
+	} else {
+		diag_move(diag_get(), &io->diag);
+		static const struct cmsg_hop route[] = {
+			{applier_io_complete, NULL},
+		};
+		cmsg_init(&io->done_msg, route);
+		cpipe_push(&io->tx_pipe, &io->done_msg);
+	}
+	/* Return applied batches until tx stops the thread. */
+	while (true) {
+		cbus_process(&io->endpoint);
+		if (io->is_stopped)
+			break;
+		fiber_yield();
+	}
+	if (reader != NULL) {
+		fiber_cancel(reader);
+		fiber_join(reader);
+	}
+	fiber_cond_destroy(&io->batch_cond);
+	cbus_unpair(&io->tx_pipe, &io->io_pipe, NULL, NULL, cbus_process);
+	cbus_endpoint_destroy(&io->endpoint, cbus_process);
+	return 0;
 }
 
+/**
+ * Start the I/O thread reading rows from the applier socket.
+ * Input already received by tx is passed to the thread.
+ */
+static void
+applier_io_start(struct applier_io *io, struct applier *applier)
+{
+	io->fd = applier->io.fd;
+	io->version_id = applier->version_id;
+	io->input = applier->ibuf.rpos;
+	io->input_size = ibuf_used(&applier->ibuf);
+	diag_create(&io->diag);
+	io->is_stopped = false;
+	io->batch_count = 0;
+	io->is_paired = false;
+	io->is_done = false;
+	stailq_create(&io->batches);
+	fiber_cond_create(&io->cond);
+	if (cord_costart(&io->cord, "applier_io", applier_io_f, io) != 0) {
+		fiber_cond_destroy(&io->cond);
+		diag_destroy(&io->diag);
+		diag_raise();
+	}
+	/*
+	 * Wait for the pipe to the I/O thread, it's needed to
+	 * stop the thread. Don't stop waiting on cancel.
+	 */
+	while (!io->is_paired)
+		fiber_cond_wait(&io->cond);
+}
+
+/**
+ * Stop the I/O thread and free the batches it has sent.
+ */
+static void
+applier_io_stop(struct applier_io *io)
+{
+	static const struct cmsg_hop route[] = {
+		{applier_io_stop_f, NULL},
+	};
+	cmsg_init(&io->stop_msg, route);
+	cpipe_push(&io->io_pipe, &io->stop_msg);
+	cord_cojoin(&io->cord);
+	struct applier_batch *batch, *tmp;
+	stailq_foreach_entry_safe(batch, tmp, &io->batches, in_io)
+		applier_batch_delete(batch);
+	fiber_cond_destroy(&io->cond);
+	diag_destroy(&io->diag);
+}
+
+/**
+ * Take the next batch sent by the I/O thread, waiting for it
+ * if necessary. Raises the error the I/O thread stopped at
+ * once all batches sent before it are taken.
+ */
+static struct applier_batch *
+applier_io_next(struct applier_io *io)
+{
+	while (stailq_empty(&io->batches)) {
+		if (io->is_done) {
+			diag_move(&io->diag, diag_get());
+			diag_raise();
+		}
+		fiber_testcancel();
+		fiber_cond_wait(&io->cond);
+	}
+	return stailq_shift_entry(&io->batches, struct applier_batch, in_io);
+}
+
+/* }}} */
+
 static int
 applier_txn_rollback_cb(struct trigger *trigger, void *event)
 {
@@ -768,7 +1475,7 @@ applier_apply_tx(struct stailq *rows)
 	}
 	stailq_foreach_entry(item, rows, next) {
 		struct xrow_header *row = &item->row;
-		int res = apply_row(row);
+		int res = apply_request(&item->req);
 		if (res != 0) {
 			struct error *e = diag_last_error(diag_get());
 			/*
@@ -878,6 +1585,22 @@ applier_on_rollback(struct trigger *trigger, void *event)
 	return 0;
 }
 
+/**
+ * Finish bootstrap of an instance which has received its
+ * replica id during "subscribe" stage, see applier_subscribe().
+ */
+static void
+applier_check_final_join(struct applier *applier)
+{
+	if (applier->state == APPLIER_FINAL_JOIN &&
+	    instance_id != REPLICA_ID_NIL) {
+		say_info("final data received");
+		applier_set_state(applier, APPLIER_JOINED);
+		applier_set_state(applier, APPLIER_READY);
+		applier_set_state(applier, APPLIER_FOLLOW);
+	}
+}
+
 /**
  * Execute and process SUBSCRIBE request (follow updates from a master).
  */
@@ -1000,34 +1723,49 @@ applier_subscribe(struct applier *applier)
 	});
 
 	/*
-	 * Process a stream of rows from the binary log.
+	 * Process a stream of rows from the binary log. The rows
+	 * are read and decoded by the I/O thread, only applied
+	 * here.
 	 */
+	struct applier_io io;
+	applier_io_start(&io, applier);
+	auto io_guard = make_scoped_guard([&] {
+		applier_io_stop(&io);
+	});
 	while (true) {
-		if (applier->state == APPLIER_FINAL_JOIN &&
-		    instance_id != REPLICA_ID_NIL) {
-			say_info("final data received");
-			applier_set_state(applier, APPLIER_JOINED);
-			applier_set_state(applier, APPLIER_READY);
-			applier_set_state(applier, APPLIER_FOLLOW);
+		applier_check_final_join(applier);
+
+		struct applier_batch *batch = applier_io_next(&io);
+		auto batch_guard = make_scoped_guard([&] {
+			applier_io_ack(&io, batch);
+		});
+		if (batch->row_count > 0) {
+			applier->lag = batch->lag;
+			applier->last_row_time = ev_monotonic_now(loop());
 		}
 
-		struct stailq rows;
-		applier_read_tx(applier, &rows);
-
-		applier->last_row_time = ev_monotonic_now(loop());
-		/*
-		 * In case of an heartbeat message wake a writer up
-		 * and check applier state.
-		 */
-		if (stailq_first_entry(&rows, struct applier_tx_row,
-				       next)->row.lsn == 0)
-			fiber_cond_signal(&applier->writer_cond);
-		else if (applier_apply_tx(&rows) != 0)
-			diag_raise();
-
-		if (ibuf_used(ibuf) == 0)
-			ibuf_reset(ibuf);
-		fiber_gc();
+		int i = 0;
+		while (i < batch->row_count) {
+			if (i > 0)
+				applier_check_final_join(applier);
+
+			struct stailq rows;
+			stailq_create(&rows);
+			do {
+				stailq_add_tail_entry(&rows, &batch->rows[i],
+						      next);
+			} while (!batch->rows[i++].row.is_commit);
+			/*
+			 * In case of an heartbeat message wake a writer up
+			 * and check applier state.
+			 */
+			if (stailq_first_entry(&rows, struct applier_tx_row,
+					       next)->row.lsn == 0)
+				fiber_cond_signal(&applier->writer_cond);
+			else if (applier_apply_tx(&rows) != 0)
+				diag_raise();
+			fiber_gc();
+		}
 	}
 }
 
@@ -1047,6 +1785,490 @@ applier_disconnect(struct applier *applier, enum applier_state state)
 	fiber_gc();
 }
 
+/** A file of a checkpoint fetched from the master. */
+struct applier_checkpoint_file {
+	/** Name relative to the engine directory. */
+	char *name;
+	/** File size. */
+	uint64_t size;
+};
+
+/** A checkpoint fetched from the master. */
+struct applier_checkpoint {
+	/** Vclock of the checkpoint, not set until the list is fetched. */
+	struct vclock vclock;
+	/** Checkpoint files. */
+	struct applier_checkpoint_file *files;
+	/** Number of checkpoint files. */
+	uint32_t file_count;
+	/** Directory to store the snapshot in. */
+	const char *snap_dir;
+	/** Directory to store vinyl files in. */
+	const char *vinyl_dir;
+};
+
+/**
+ * Format the local path of a checkpoint file. Snapshots go to
+ * the memtx directory, all other files belong to vinyl.
+ */
+static void
+applier_checkpoint_file_path(struct applier_checkpoint *checkpoint,
+			     struct applier_checkpoint_file *file,
+			     bool in_progress, char *buf, size_t size)
+{
+	const char *ext = strrchr(file->name, '.');
+	const char *dir = ext != NULL && strcmp(ext, ".snap") == 0 ?
+			  checkpoint->snap_dir : checkpoint->vinyl_dir;
+	snprintf(buf, size, "%s/%s%s", dir, file->name,
+		 in_progress ? inprogress_suffix : "");
+}
+
+/** Remove partially fetched files and forget the checkpoint. */
+static void
+applier_checkpoint_reset(struct applier_checkpoint *checkpoint)
+{
+	char path[PATH_MAX];
+	for (uint32_t i = 0; i < checkpoint->file_count; i++) {
+		struct applier_checkpoint_file *file = &checkpoint->files[i];
+		applier_checkpoint_file_path(checkpoint, file, true,
+					     path, sizeof(path));
+		coio_unlink(path);
+		free(file->name);
+	}
+	free(checkpoint->files);
+	checkpoint->files = NULL;
+	checkpoint->file_count = 0;
+	vclock_clear(&checkpoint->vclock);
+}
+
+/**
+ * Check if @a name, relative to the engine directory, is a file
+ * of @a checkpoint, i.e. its download may be resumed.
+ */
+static bool
+applier_checkpoint_has_file(struct applier_checkpoint *checkpoint,
+			    const char *name, size_t len)
+{
+	for (uint32_t i = 0; i < checkpoint->file_count; i++) {
+		const char *file_name = checkpoint->files[i].name;
+		if (strlen(file_name) == len &&
+		    memcmp(file_name, name, len) == 0)
+			return true;
+	}
+	return false;
+}
+
+/**
+ * Remove in-progress files left in @a dir by an interrupted
+ * download unless they belong to @a checkpoint. Snapshots are
+ * looked for in the memtx directory, all other files in the
+ * vinyl one, where run files are stored in subdirectories
+ * <space_id>/<index_id>; @a depth is the number of levels of
+ * such subdirectories to descend into.
+ */
+static void
+applier_checkpoint_collect_inprogress(struct applier_checkpoint *checkpoint,
+				      const char *dir, const char *subdir,
+				      bool is_snap_dir, int depth)
+{
+	char path[PATH_MAX];
+	snprintf(path, sizeof(path), "%s%s", dir, subdir);
+	DIR *dh = opendir(path);
+	if (dh == NULL) {
+		if (errno != ENOENT && errno != ENOTDIR)
+			say_syserror("error reading directory '%s'", path);
+		return;
+	}
+	struct dirent *dent;
+	while ((dent = readdir(dh)) != NULL) {
+		const char *name = dent->d_name;
+		if (depth > 0 && name[0] != '\0' &&
+		    strspn(name, "0123456789") == strlen(name)) {
+			char next[PATH_MAX];
+			snprintf(next, sizeof(next), "%s/%s", subdir, name);
+			applier_checkpoint_collect_inprogress(checkpoint, dir,
+					next, is_snap_dir, depth - 1);
+			continue;
+		}
+		const char *suffix = strrchr(name, '.');
+		if (suffix == NULL || suffix == name ||
+		    strcmp(suffix, inprogress_suffix) != 0)
+			continue;
+		/* Skip files that are not checkpoint files. */
+		const char *ext = (const char *)memrchr(name, '.',
+							suffix - name);
+		if (ext == NULL)
+			continue;
+		size_t ext_len = suffix - ext;
+		bool is_snap = ext_len == strlen(".snap") &&
+			       memcmp(ext, ".snap", ext_len) == 0;
+		bool is_vinyl = (ext_len == strlen(".vylog") &&
+				 memcmp(ext, ".vylog", ext_len) == 0) ||
+				(ext_len == strlen(".run") &&
+				 memcmp(ext, ".run", ext_len) == 0) ||
+				(ext_len == strlen(".index") &&
+				 memcmp(ext, ".index", ext_len) == 0);
+		if (is_snap_dir ? !is_snap : !is_vinyl)
+			continue;
+		char file_name[PATH_MAX];
+		int len = snprintf(file_name, sizeof(file_name), "%s%s%.*s",
+				   subdir[0] != '\0' ? subdir + 1 : "",
+				   subdir[0] != '\0' ? "/" : "",
+				   (int)(suffix - name), name);
+		if (applier_checkpoint_has_file(checkpoint, file_name, len))
+			continue;
+		snprintf(path, sizeof(path), "%s%s/%s", dir, subdir, name);
+		if (unlink(path) < 0)
+			say_syserror("error while removing %s", path);
+		else
+			say_info("removed %s", path);
+	}
+	closedir(dh);
+}
+
+/**
+ * Remove files left by an interrupted download, which would
+ * otherwise be never removed, except files of @a checkpoint.
+ */
+static void
+applier_checkpoint_collect_garbage(struct applier_checkpoint *checkpoint)
+{
+	applier_checkpoint_collect_inprogress(checkpoint, checkpoint->snap_dir,
+					      "", true, 0);
+	applier_checkpoint_collect_inprogress(checkpoint,
+					      checkpoint->vinyl_dir,
+					      "", false, 2);
+}
+
+/**
+ * Check that a file name sent by the master doesn't point
+ * outside the engine directory.
+ */
+static bool
+applier_checkpoint_file_name_is_valid(const char *name, uint32_t len)
+{
+	if (len == 0 || name[0] == '/')
+		return false;
+	const char *end = name + len;
+	for (const char *p = name; p < end; ) {
+		const char *sep = (const char *)memchr(p, '/', end - p);
+		if (sep == NULL)
+			sep = end;
+		if (sep - p == 2 && p[0] == '.' && p[1] == '.')
+			return false;
+		p = sep + 1;
+	}
+	return memchr(name, '\0', len) == NULL;
+}
+
+/**
+ * Fetch the vclock and the file list of the last checkpoint
+ * of the master. The master keeps the checkpoint and the xlogs
+ * written after it for @a instance_uuid until it registers.
+ */
+static void
+applier_fetch_checkpoint_list(struct applier *applier,
+			      struct applier_checkpoint *checkpoint,
+			      const struct tt_uuid *instance_uuid)
+{
+	struct ev_io *coio = &applier->io;
+	struct ibuf *ibuf = &applier->ibuf;
+	struct xrow_header row;
+
+	xrow_encode_fetch_checkpoint_xc(&row, instance_uuid, NULL, NULL, 0);
+	coio_write_xrow(coio, &row);
+	coio_read_xrow(coio, ibuf, &row);
+	if (iproto_type_is_error(row.type)) {
+		xrow_decode_error_xc(&row); /* re-throw error */
+	} else if (row.type != IPROTO_OK) {
+		tnt_raise(ClientError, ER_UNKNOWN_REQUEST_TYPE,
+			  (uint32_t) row.type);
+	}
+	if (row.bodycnt == 0)
+		goto err;
+	{
+	const char *data = (const char *)row.body[0].iov_base;
+	const char *end = data + row.body[0].iov_len;
+	const char *d = data;
+	if (mp_check(&d, end) != 0 || mp_typeof(*data) != MP_MAP)
+		goto err;
+	const char *files = NULL;
+	d = data;
+	uint32_t map_size = mp_decode_map(&d);
+	for (uint32_t i = 0; i < map_size; i++) {
+		if (mp_typeof(*d) != MP_UINT) {
+			mp_next(&d); /* key */
+			mp_next(&d); /* value */
+			continue;
+		}
+		if (mp_decode_uint(&d) == IPROTO_DATA &&
+		    mp_typeof(*d) == MP_ARRAY)
+			files = d;
+		mp_next(&d); /* value */
+	}
+	if (files == NULL)
+		goto err;
+	/* Checkpoint vclock. */
+	xrow_decode_vclock_xc(&row, &checkpoint->vclock);
+	if (!vclock_is_set(&checkpoint->vclock))
+		goto err;
+	uint32_t file_count = mp_decode_array(&files);
+	size_t size = file_count * sizeof(*checkpoint->files);
+	if (file_count == 0)
+		goto err;
+	checkpoint->files = (struct applier_checkpoint_file *)malloc(size);
+	if (checkpoint->files == NULL)
+		tnt_raise(OutOfMemory, size, "malloc", "checkpoint files");
+	for (uint32_t i = 0; i < file_count; i++) {
+		if (mp_typeof(*files) != MP_ARRAY ||
+		    mp_decode_array(&files) != 2 ||
+		    mp_typeof(*files) != MP_STR)
+			goto err;
+		uint32_t len;
+		const char *name = mp_decode_str(&files, &len);
+		if (!applier_checkpoint_file_name_is_valid(name, len) ||
+		    mp_typeof(*files) != MP_UINT)
+			goto err;
+		struct applier_checkpoint_file *file =
+			&checkpoint->files[checkpoint->file_count];
+		file->name = strndup(name, len);
+		if (file->name == NULL) {
+			tnt_raise(OutOfMemory, len + 1, "strndup",
+				  "checkpoint file name");
+		}
+		file->size = mp_decode_uint(&files);
+		checkpoint->file_count++;
+	}
+	say_info("fetching checkpoint %s, %u files",
+		 vclock_to_string(&checkpoint->vclock),
+		 (unsigned)checkpoint->file_count);
+	/*
+	 * Files of another checkpoint left after a restart
+	 * can't be resumed.
+	 */
+	applier_checkpoint_collect_garbage(checkpoint);
+	return;
+	}
+err:
+	applier_checkpoint_reset(checkpoint);
+	tnt_raise(ClientError, ER_PROTOCOL,
+		  "invalid checkpoint file list");
+}
+
+/** Create all missing parent directories of @a path. */
+static void
+applier_mkdir_parents(const char *path)
+{
+	char buf[PATH_MAX];
+	snprintf(buf, sizeof(buf), "%s", path);
+	char *sep = buf;
+	while (*sep == '/')
+		++sep;
+	while ((sep = strchr(sep, '/')) != NULL) {
+		*sep = '\0';
+		if (coio_mkdir(buf, 0777) != 0 && errno != EEXIST) {
+			tnt_raise(SystemError,
+				  "failed to create directory '%s'", buf);
+		}
+		*sep++ = '/';
+	}
+}
+
+/**
+ * Fetch a checkpoint file, continuing from what has been
+ * fetched so far. The file is stored with the in-progress
+ * suffix until the whole checkpoint has been fetched.
+ */
+static void
+applier_fetch_checkpoint_file(struct applier *applier,
+			      struct applier_checkpoint *checkpoint,
+			      struct applier_checkpoint_file *file)
+{
+	struct ev_io *coio = &applier->io;
+	struct ibuf *ibuf = &applier->ibuf;
+	char path[PATH_MAX];
+	applier_checkpoint_file_path(checkpoint, file, false,
+				     path, sizeof(path));
+	struct stat st;
+	if (coio_stat(path, &st) == 0)
+		return; /* installed before restart */
+	applier_checkpoint_file_path(checkpoint, file, true,
+				     path, sizeof(path));
+	applier_mkdir_parents(path);
+	int fd = coio_file_open(path, O_WRONLY | O_CREAT, 0644);
+	if (fd < 0)
+		tnt_raise(SystemError, "failed to open file '%s'", path);
+	auto fd_guard = make_scoped_guard([=] { coio_file_close(fd); });
+	if (coio_fstat(fd, &st) != 0)
+		tnt_raise(SystemError, "failed to stat file '%s'", path);
+	uint64_t offset = st.st_size;
+	if (offset > file->size) {
+		/* The file was changed on the master, start over. */
+		if (coio_ftruncate(fd, 0) != 0) {
+			tnt_raise(SystemError,
+				  "failed to truncate file '%s'", path);
+		}
+		offset = 0;
+	}
+	if (offset == file->size)
+		return;
+
+	struct xrow_header row;
+	xrow_encode_fetch_checkpoint_xc(&row, NULL, &checkpoint->vclock,
+					file->name, offset);
+	coio_write_xrow(coio, &row);
+	while (true) {
+		coio_read_xrow(coio, ibuf, &row);
+		applier->last_row_time = ev_monotonic_now(loop());
+		if (iproto_type_is_error(row.type)) {
+			xrow_decode_error_xc(&row); /* re-throw error */
+		} else if (row.type != IPROTO_OK) {
+			tnt_raise(ClientError, ER_UNKNOWN_REQUEST_TYPE,
+				  (uint32_t) row.type);
+		}
+		uint64_t chunk_offset;
+		const char *data;
+		uint32_t size;
+		xrow_decode_file_chunk_xc(&row, &chunk_offset, &data, &size);
+		if (chunk_offset != offset) {
+			tnt_raise(ClientError, ER_PROTOCOL,
+				  "unexpected checkpoint file chunk offset");
+		}
+		if (size == 0)
+			break; /* end of file */
+		if (coio_pwrite(fd, data, size, offset) != (ssize_t)size)
+			tnt_raise(SystemError, "failed to write file '%s'",
+				  path);
+		offset += size;
+		fiber_gc();
+	}
+	if (offset != file->size) {
+		tnt_raise(ClientError, ER_PROTOCOL,
+			  tt_sprintf("checkpoint file %s size mismatch",
+				     file->name));
+	}
+	if (coio_fsync(fd) != 0)
+		tnt_raise(SystemError, "failed to sync file '%s'", path);
+	say_info("fetched checkpoint file %s", file->name);
+}
+
+/**
+ * Install fetched checkpoint files: stamp them with the
+ * instance UUID and remove the in-progress suffix. The memtx
+ * snapshot is installed last so that a restart before it is
+ * done makes the instance resume the download.
+ */
+static void
+applier_install_checkpoint(struct applier_checkpoint *checkpoint,
+			   const struct tt_uuid *instance_uuid)
+{
+	for (int pass = 0; pass < 2; pass++) {
+		for (uint32_t i = 0; i < checkpoint->file_count; i++) {
+			struct applier_checkpoint_file *file =
+				&checkpoint->files[i];
+			const char *ext = strrchr(file->name, '.');
+			bool is_snap = ext != NULL &&
+				       strcmp(ext, ".snap") == 0 &&
+				       strchr(file->name, '/') == NULL;
+			if (is_snap != (pass == 1))
+				continue;
+			char path[PATH_MAX];
+			char new_path[PATH_MAX];
+			applier_checkpoint_file_path(checkpoint, file, true,
+						     path, sizeof(path));
+			applier_checkpoint_file_path(checkpoint, file, false,
+						     new_path,
+						     sizeof(new_path));
+			struct stat st;
+			if (coio_stat(new_path, &st) == 0)
+				continue; /* installed before restart */
+			if (xlog_meta_rewrite_instance_uuid(path,
+							    instance_uuid) != 0)
+				diag_raise();
+			if (coio_rename(path, new_path) != 0) {
+				tnt_raise(SystemError,
+					  "failed to rename '%s' to '%s'",
+					  path, new_path);
+			}
+		}
+	}
+}
+
+void
+applier_fetch_checkpoint(struct applier *applier, const char *snap_dir,
+			 const char *vinyl_dir,
+			 const struct tt_uuid *instance_uuid)
+{
+	assert(applier->reader == NULL);
+	struct applier_checkpoint checkpoint;
+	memset(&checkpoint, 0, sizeof(checkpoint));
+	vclock_clear(&checkpoint.vclock);
+	checkpoint.snap_dir = snap_dir;
+	checkpoint.vinyl_dir = vinyl_dir;
+	auto guard = make_scoped_guard([&] {
+		for (uint32_t i = 0; i < checkpoint.file_count; i++)
+			free(checkpoint.files[i].name);
+		free(checkpoint.files);
+	});
+
+	char uri[APPLIER_SOURCE_MAXLEN];
+	uri_format(uri, sizeof(uri), &applier->uri, false);
+	say_info("fetching checkpoint files from %s", uri);
+	while (true) {
+		try {
+			applier_connect(applier);
+			if (!vclock_is_set(&checkpoint.vclock)) {
+				applier_fetch_checkpoint_list(applier,
+							      &checkpoint,
+							      instance_uuid);
+			}
+			for (uint32_t i = 0; i < checkpoint.file_count; i++) {
+				applier_fetch_checkpoint_file(applier,
+					&checkpoint, &checkpoint.files[i]);
+			}
+			break;
+		} catch (ClientError *e) {
+			applier_log_error(applier, e);
+			switch (e->errcode()) {
+			case ER_MISSING_SNAPSHOT:
+				/*
+				 * The checkpoint has been removed on
+				 * the master, fetch a newer one.
+				 */
+				applier_checkpoint_reset(&checkpoint);
+				break;
+			case ER_LOADING:
+			case ER_SYSTEM:
+			case ER_PROTOCOL:
+				break;
+			default:
+				applier_disconnect(applier, APPLIER_STOPPED);
+				e->raise();
+			}
+		} catch (SocketError *e) {
+			applier_log_error(applier, e);
+		}
+		/* Resume the download after reconnect. */
+		applier_disconnect(applier, APPLIER_DISCONNECTED);
+		fiber_sleep(replication_reconnect_interval());
+	}
+	applier_disconnect(applier, APPLIER_OFF);
+	applier_install_checkpoint(&checkpoint, instance_uuid);
+	say_info("checkpoint %s fetched",
+		 vclock_to_string(&checkpoint.vclock));
+}
+
+void
+applier_collect_checkpoint_garbage(const char *snap_dir,
+				   const char *vinyl_dir)
+{
+	struct applier_checkpoint checkpoint;
+	memset(&checkpoint, 0, sizeof(checkpoint));
+	checkpoint.snap_dir = snap_dir;
+	checkpoint.vinyl_dir = vinyl_dir;
+	applier_checkpoint_collect_garbage(&checkpoint);
+}
+
 static int
 applier_f(va_list ap)
 {
@@ -122,6 +122,11 @@ struct applier {
 	struct diag diag;
 	/* Master's vclock at the time of SUBSCRIBE. */
 	struct vclock remote_vclock_at_subscribe;
+	/**
+	 * Set if the instance registers after it has been
+	 * bootstrapped from checkpoint files of the master.
+	 */
+	bool is_from_checkpoint;
 };
 
 /**
@@ -162,6 +167,30 @@ applier_new(const char *uri);
 void
 applier_delete(struct applier *applier);
 
+/**
+ * Download the last checkpoint of the master the applier is
+ * configured for: the snapshot goes to @a snap_dir, vinyl files
+ * to @a vinyl_dir. The download is resumed after a disconnect.
+ * Files are installed only when all of them have been fetched,
+ * the snapshot being the last, and stamped with
+ * @a instance_uuid.
+ *
+ * The applier must not be started.
+ * @error   throws an exception on unrecoverable error.
+ */
+void
+applier_fetch_checkpoint(struct applier *applier, const char *snap_dir,
+			 const char *vinyl_dir,
+			 const struct tt_uuid *instance_uuid);
+
+/**
+ * Remove in-progress files left in @a snap_dir and @a vinyl_dir
+ * by an interrupted applier_fetch_checkpoint().
+ */
+void
+applier_collect_checkpoint_garbage(const char *snap_dir,
+				   const char *vinyl_dir);
+
 /*
  * Resume execution of applier until \a state.
  */
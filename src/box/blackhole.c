@@ -126,6 +126,7 @@ static const struct space_vtab blackhole_space_vtab = {
 	/* .build_index = */ generic_space_build_index,
 	/* .swap_index = */ generic_space_swap_index,
 	/* .prepare_alter = */ generic_space_prepare_alter,
+	/* .prepare_truncate = */ generic_space_prepare_truncate,
 	/* .invalidate = */ generic_space_invalidate,
 };
 
@@ -177,6 +178,8 @@ static const struct engine_vtab blackhole_engine_vtab = {
 	/* .create_space = */ blackhole_engine_create_space,
 	/* .prepare_join = */ generic_engine_prepare_join,
 	/* .join = */ generic_engine_join,
+	/* .split_join = */ generic_engine_split_join,
+	/* .join_stream = */ generic_engine_join_stream,
 	/* .complete_join = */ generic_engine_complete_join,
 	/* .begin = */ generic_engine_begin,
 	/* .begin_statement = */ generic_engine_begin_statement,
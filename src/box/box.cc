@@ -53,6 +53,7 @@
 #include "memtx_engine.h"
 #include "sysview.h"
 #include "blackhole.h"
+#include "column_engine.h"
 #include "service_engine.h"
 #include "vinyl.h"
 #include "space.h"
@@ -62,6 +63,7 @@
 #include "user.h"
 #include "cfg.h"
 #include "coio.h"
+#include "coio_file.h"
 #include "replication.h" /* replica */
 #include "title.h"
 #include "xrow.h"
@@ -77,6 +79,7 @@
 #include "sequence.h"
 #include "sql_stmt_cache.h"
 #include "msgpack.h"
+#include "loader.h"
 
 static char status[64] = "unknown";
 
@@ -405,6 +408,16 @@ box_check_say()
 		tnt_raise(ClientError, ER_CFG, "log_nonblock",
 			  "the option is incompatible with file/stderr logger");
 	}
+	if (cfg_getb("log_async") == 1 && type == SAY_LOGGER_SYSLOG) {
+		tnt_raise(ClientError, ER_CFG, "log_async",
+			  "the option is incompatible with syslog logger");
+	}
+	const char *overflow = cfg_gets("log_async_overflow");
+	if (overflow != NULL &&
+	    say_async_overflow_by_name(overflow) == say_async_overflow_MAX) {
+		tnt_raise(ClientError, ER_CFG, "log_async_overflow",
+			  "expected 'block', 'drop' or 'counter'");
+	}
 }
 
 static void
@@ -487,6 +500,18 @@ box_check_replication_sync_timeout(void)
 	return timeout;
 }
 
+static int
+box_check_replication_join_streams(void)
+{
+	int count = cfg_geti("replication_join_streams");
+	if (count < 1 || count > REPLICATION_JOIN_STREAMS_MAX) {
+		tnt_raise(ClientError, ER_CFG, "replication_join_streams",
+			  tt_sprintf("the value must be between 1 and %d",
+				     REPLICATION_JOIN_STREAMS_MAX));
+	}
+	return count;
+}
+
 static inline void
 box_check_uuid(struct tt_uuid *uuid, const char *name)
 {
@@ -659,6 +684,7 @@ box_check_config()
 	box_check_replication_connect_quorum();
 	box_check_replication_sync_lag();
 	box_check_replication_sync_timeout();
+	box_check_replication_join_streams();
 	box_check_readahead(cfg_geti("readahead"));
 	box_check_checkpoint_count(cfg_geti("checkpoint_count"));
 	box_check_wal_max_size(cfg_geti64("wal_max_size"));
@@ -789,6 +815,34 @@ box_set_replication_skip_conflict(void)
 	replication_skip_conflict = cfg_geti("replication_skip_conflict");
 }
 
+/**
+ * Register this instance in _cluster on the replica set leader
+ * and wait until the registration is applied locally.
+ * @a from_checkpoint is set if the instance has been bootstrapped
+ * from checkpoint files of the master rather than followed it
+ * as an anonymous replica.
+ */
+static void
+box_register(bool from_checkpoint)
+{
+	/*
+	 * Wait until the master has registered this
+	 * instance.
+	 */
+	struct replica *master = replicaset_leader();
+	if (master == NULL || master->applier == NULL ||
+	    master->applier->state != APPLIER_CONNECTED) {
+		tnt_raise(ClientError, ER_CANNOT_REGISTER);
+	}
+	struct applier *master_applier = master->applier;
+	master_applier->is_from_checkpoint = from_checkpoint;
+
+	applier_resume_to_state(master_applier, APPLIER_REGISTERED,
+				TIMEOUT_INFINITY);
+	applier_resume_to_state(master_applier, APPLIER_READY,
+				TIMEOUT_INFINITY);
+}
+
 void
 box_set_replication_anon(void)
 {
@@ -809,21 +863,7 @@ box_set_replication_anon(void)
 		 * non-anonymous subscribe.
 		 */
 		box_sync_replication(false);
-		/*
-		 * Wait until the master has registered this
-		 * instance.
-		 */
-		struct replica *master = replicaset_leader();
-		if (master == NULL || master->applier == NULL ||
-		    master->applier->state != APPLIER_CONNECTED) {
-			tnt_raise(ClientError, ER_CANNOT_REGISTER);
-		}
-		struct applier *master_applier = master->applier;
-
-		applier_resume_to_state(master_applier, APPLIER_REGISTERED,
-					TIMEOUT_INFINITY);
-		applier_resume_to_state(master_applier, APPLIER_READY,
-					TIMEOUT_INFINITY);
+		box_register(false);
 		/**
 		 * Resume other appliers to
 		 * resend non-anonymous subscribe.
@@ -1073,12 +1113,20 @@ boxk(int type, uint32_t space_id, const char *format, ...)
 API_EXPORT int
 box_return_tuple(box_function_ctx_t *ctx, box_tuple_t *tuple)
 {
+	if (ctx->offload != NULL) {
+		/* Tuples can't be referenced outside TX. */
+		const char *data = tuple_data(tuple);
+		return func_offload_result_add(ctx->offload, data,
+					       data + tuple_bsize(tuple));
+	}
 	return port_c_add_tuple(ctx->port, tuple);
 }
 
 API_EXPORT int
 box_return_mp(box_function_ctx_t *ctx, const char *mp, const char *mp_end)
 {
+	if (ctx->offload != NULL)
+		return func_offload_result_add(ctx->offload, mp, mp_end);
 	return port_c_add_mp(ctx->port, mp, mp_end);
 }
 
@@ -1555,7 +1603,7 @@ box_process_fetch_snapshot(struct ev_io *io, struct xrow_header *header)
 
 	/* Send the snapshot data to the instance. */
 	struct vclock start_vclock;
-	relay_initial_join(io->fd, header->sync, &start_vclock);
+	relay_initial_join(io->fd, header->sync, &start_vclock, NULL, 1);
 	say_info("read-view sent.");
 
 	/* Remember master's vclock after the last request */
@@ -1569,6 +1617,308 @@ box_process_fetch_snapshot(struct ev_io *io, struct xrow_header *header)
 	coio_write_xrow(io, &row);
 }
 
+/** A checkpoint file sent in reply to FETCH CHECKPOINT. */
+struct checkpoint_file {
+	/** Path to the file. */
+	const char *path;
+	/** Name sent to the replica, relative to the engine dir. */
+	const char *name;
+	/** File size. */
+	uint64_t size;
+	/** Link in checkpoint_file_list::files. */
+	struct stailq_entry in_list;
+};
+
+/** List of files of a checkpoint, see engine_backup(). */
+struct checkpoint_file_list {
+	/** List of checkpoint_file objects. */
+	struct stailq files;
+	/** Number of files in the list. */
+	uint32_t count;
+};
+
+static int
+checkpoint_file_list_add(const char *path, void *arg)
+{
+	struct checkpoint_file_list *list =
+		(struct checkpoint_file_list *)arg;
+	/*
+	 * Snapshots are stored in memtx_dir, all other files
+	 * belong to vinyl. The replica puts a file to its own
+	 * directory of the same kind.
+	 */
+	const char *ext = strrchr(path, '.');
+	const char *dir = ext != NULL && strcmp(ext, ".snap") == 0 ?
+			  cfg_gets("memtx_dir") : cfg_gets("vinyl_dir");
+	size_t dir_len = strlen(dir);
+	if (strncmp(path, dir, dir_len) != 0 || path[dir_len] != '/') {
+		diag_set(ClientError, ER_PROTOCOL,
+			 tt_sprintf("unexpected checkpoint file %s", path));
+		return -1;
+	}
+	struct stat st;
+	if (coio_stat(path, &st) != 0) {
+		diag_set(SystemError, "failed to stat file '%s'", path);
+		return -1;
+	}
+	struct region *region = &fiber()->gc;
+	size_t path_len = strlen(path);
+	struct checkpoint_file *file = (struct checkpoint_file *)
+		region_alloc(region, sizeof(*file) + path_len + 1);
+	if (file == NULL) {
+		diag_set(OutOfMemory, sizeof(*file) + path_len + 1,
+			 "region", "struct checkpoint_file");
+		return -1;
+	}
+	char *file_path = (char *)(file + 1);
+	memcpy(file_path, path, path_len + 1);
+	file->path = file_path;
+	file->name = file_path + dir_len + 1;
+	file->size = st.st_size;
+	stailq_add_tail_entry(&list->files, file, in_list);
+	list->count++;
+	return 0;
+}
+
+/**
+ * Send the list of checkpoint files along with the checkpoint
+ * vclock: {VCLOCK: vclock, DATA: [[name, size], ...]}.
+ */
+static void
+checkpoint_send_file_list(struct ev_io *io, uint64_t sync,
+			  const struct vclock *vclock,
+			  struct checkpoint_file_list *list)
+{
+	size_t size = mp_sizeof_array(list->count);
+	struct checkpoint_file *file;
+	stailq_foreach_entry(file, &list->files, in_list) {
+		size += mp_sizeof_array(2) +
+			mp_sizeof_str(strlen(file->name)) +
+			mp_sizeof_uint(file->size);
+	}
+	char *buf = (char *)region_alloc(&fiber()->gc, size);
+	if (buf == NULL)
+		tnt_raise(OutOfMemory, size, "region", "checkpoint files");
+	char *data = buf;
+	data = mp_encode_array(data, list->count);
+	stailq_foreach_entry(file, &list->files, in_list) {
+		data = mp_encode_array(data, 2);
+		data = mp_encode_str(data, file->name, strlen(file->name));
+		data = mp_encode_uint(data, file->size);
+	}
+	assert(data == buf + size);
+
+	struct xrow_header row;
+	xrow_encode_checkpoint_files_xc(&row, vclock, buf, size);
+	row.sync = sync;
+	coio_write_xrow(io, &row);
+}
+
+enum {
+	/** Size of a chunk a checkpoint file is sent in. */
+	CHECKPOINT_FILE_CHUNK_SIZE = 1024 * 1024,
+};
+
+/**
+ * Send a checkpoint file starting from @a offset, chunk by
+ * chunk, each with its own checksum. An empty chunk marks
+ * the end of the file.
+ */
+static void
+checkpoint_send_file(struct ev_io *io, uint64_t sync,
+		     struct checkpoint_file *file, uint64_t offset)
+{
+	int fd = coio_file_open(file->path, O_RDONLY, 0);
+	if (fd < 0) {
+		tnt_raise(SystemError, "failed to open file '%s'",
+			  file->path);
+	}
+	char *buf = (char *)malloc(CHECKPOINT_FILE_CHUNK_SIZE);
+	if (buf == NULL) {
+		coio_file_close(fd);
+		tnt_raise(OutOfMemory, CHECKPOINT_FILE_CHUNK_SIZE,
+			  "malloc", "buf");
+	}
+	auto guard = make_scoped_guard([=] {
+		free(buf);
+		coio_file_close(fd);
+	});
+	while (true) {
+		ssize_t n = coio_pread(fd, buf, CHECKPOINT_FILE_CHUNK_SIZE,
+				       offset);
+		if (n < 0) {
+			tnt_raise(SystemError, "failed to read file '%s'",
+				  file->path);
+		}
+		struct xrow_header row;
+		xrow_encode_file_chunk_xc(&row, offset, buf, n);
+		row.sync = sync;
+		coio_write_xrow(io, &row);
+		fiber_gc();
+		if (n == 0)
+			break;
+		offset += n;
+	}
+}
+
+/**
+ * A checkpoint a replica bootstraps from. The checkpoint and
+ * the xlogs written after it are kept until the replica
+ * registers, so that neither the download nor the rows the
+ * replica gets on REGISTER are lost if it takes long.
+ */
+struct checkpoint_fetch {
+	/** UUID of the replica. */
+	struct tt_uuid instance_uuid;
+	/** Reference keeping the checkpoint files. */
+	struct gc_checkpoint_ref ref;
+	/** Consumer keeping the xlogs written after the checkpoint. */
+	struct gc_consumer *gc;
+	/** Link in checkpoint_fetches. */
+	struct rlist in_fetches;
+};
+
+/** Checkpoints being fetched by replicas. */
+static RLIST_HEAD(checkpoint_fetches);
+
+static struct checkpoint_fetch *
+checkpoint_fetch_find(const struct tt_uuid *instance_uuid)
+{
+	struct checkpoint_fetch *fetch;
+	rlist_foreach_entry(fetch, &checkpoint_fetches, in_fetches) {
+		if (tt_uuid_is_equal(&fetch->instance_uuid, instance_uuid))
+			return fetch;
+	}
+	return NULL;
+}
+
+static void
+checkpoint_fetch_delete(struct checkpoint_fetch *fetch)
+{
+	rlist_del_entry(fetch, in_fetches);
+	gc_consumer_unregister(fetch->gc);
+	gc_unref_checkpoint(&fetch->ref);
+	free(fetch);
+}
+
+/**
+ * Keep @a checkpoint for the replica with @a instance_uuid until
+ * it registers, releasing the checkpoint it fetched before.
+ */
+static void
+checkpoint_fetch_pin(const struct tt_uuid *instance_uuid,
+		     struct gc_checkpoint *checkpoint)
+{
+	struct checkpoint_fetch *fetch = checkpoint_fetch_find(instance_uuid);
+	if (fetch != NULL)
+		checkpoint_fetch_delete(fetch);
+	fetch = (struct checkpoint_fetch *)malloc(sizeof(*fetch));
+	if (fetch == NULL) {
+		tnt_raise(OutOfMemory, sizeof(*fetch), "malloc",
+			  "struct checkpoint_fetch");
+	}
+	fetch->gc = gc_consumer_register(&checkpoint->vclock,
+					 "replica %s checkpoint fetch",
+					 tt_uuid_str(instance_uuid));
+	if (fetch->gc == NULL) {
+		free(fetch);
+		diag_raise();
+	}
+	gc_ref_checkpoint(checkpoint, &fetch->ref, "replica %s",
+			  tt_uuid_str(instance_uuid));
+	fetch->instance_uuid = *instance_uuid;
+	rlist_add_tail_entry(&checkpoint_fetches, fetch, in_fetches);
+}
+
+void
+box_process_fetch_checkpoint(struct ev_io *io, struct xrow_header *header)
+{
+	assert(header->type == IPROTO_FETCH_CHECKPOINT);
+
+	/* Check that bootstrap has been finished */
+	if (!is_box_configured)
+		tnt_raise(ClientError, ER_LOADING);
+
+	/* Check permissions */
+	access_check_universe_xc(PRIV_R);
+
+	struct tt_uuid instance_uuid;
+	struct vclock vclock;
+	vclock_clear(&vclock);
+	const char *name;
+	uint32_t name_len;
+	uint64_t offset;
+	xrow_decode_fetch_checkpoint_xc(header, &instance_uuid, &vclock,
+					&name, &name_len, &offset);
+	/*
+	 * The replica names the checkpoint it has started to
+	 * fetch, so that it can resume the download after
+	 * a disconnect. If the checkpoint has been removed
+	 * since then, the replica starts over.
+	 */
+	struct gc_checkpoint *checkpoint = NULL;
+	if (vclock_is_set(&vclock)) {
+		struct gc_checkpoint *c;
+		gc_foreach_checkpoint(c) {
+			if (vclock_compare(&c->vclock, &vclock) == 0)
+				checkpoint = c;
+		}
+	} else {
+		checkpoint = gc_last_checkpoint();
+	}
+	if (checkpoint == NULL)
+		tnt_raise(ClientError, ER_MISSING_SNAPSHOT);
+
+	/* Pin the checkpoint so that it isn't removed while we send it. */
+	struct gc_checkpoint_ref gc;
+	gc_ref_checkpoint(checkpoint, &gc, "replica at %s",
+			  sio_socketname(io->fd));
+	auto gc_guard = make_scoped_guard([&] {
+		gc_unref_checkpoint(&gc);
+	});
+
+	size_t region_svp = region_used(&fiber()->gc);
+	auto region_guard = make_scoped_guard([&] {
+		region_truncate(&fiber()->gc, region_svp);
+	});
+	struct checkpoint_file_list list;
+	stailq_create(&list.files);
+	list.count = 0;
+	if (engine_backup(&checkpoint->vclock, checkpoint_file_list_add,
+			  &list) != 0)
+		diag_raise();
+
+	if (name == NULL) {
+		say_info("sending checkpoint %s file list to replica at %s",
+			 vclock_to_string(&checkpoint->vclock),
+			 sio_socketname(io->fd));
+		/*
+		 * A single request pins the checkpoint only while
+		 * it's being served, which is not enough for the
+		 * whole download and recovery of the replica.
+		 */
+		if (!tt_uuid_is_nil(&instance_uuid))
+			checkpoint_fetch_pin(&instance_uuid, checkpoint);
+		checkpoint_send_file_list(io, header->sync,
+					  &checkpoint->vclock, &list);
+		return;
+	}
+	/* Only files of the checkpoint may be fetched. */
+	struct checkpoint_file *file, *found = NULL;
+	stailq_foreach_entry(file, &list.files, in_list) {
+		if (strlen(file->name) == name_len &&
+		    memcmp(file->name, name, name_len) == 0)
+			found = file;
+	}
+	if (found == NULL) {
+		tnt_raise(ClientError, ER_ILLEGAL_PARAMS,
+			  "unknown checkpoint file");
+	}
+	say_info("sending checkpoint file %s to replica at %s",
+		 found->path, sio_socketname(io->fd));
+	checkpoint_send_file(io, header->sync, found, offset);
+}
+
 void
 box_process_register(struct ev_io *io, struct xrow_header *header)
 {
@@ -1576,7 +1926,10 @@ box_process_register(struct ev_io *io, struct xrow_header *header)
 
 	struct tt_uuid instance_uuid = uuid_nil;
 	struct vclock vclock;
-	xrow_decode_register_xc(header, &instance_uuid, &vclock);
+	vclock_create(&vclock);
+	bool from_checkpoint;
+	xrow_decode_register_xc(header, &instance_uuid, &vclock,
+				&from_checkpoint);
 
 	if (!is_box_configured)
 		tnt_raise(ClientError, ER_LOADING);
@@ -1602,7 +1955,43 @@ box_process_register(struct ev_io *io, struct xrow_header *header)
 			  "wal_mode = 'none'");
 	}
 
-	struct gc_consumer *gc = gc_consumer_register(&replicaset.vclock,
+	/*
+	 * Feed the replica with the rows it lacks, starting from
+	 * its own vclock. A replica bootstrapped from checkpoint
+	 * files has only the rows of the checkpoint.
+	 */
+	struct vclock start_vclock;
+	vclock_copy(&start_vclock, &replicaset.vclock);
+	struct vclock_iterator it;
+	vclock_iterator_init(&it, &replicaset.vclock);
+	vclock_foreach(&it, r) {
+		/* Local rows are never relayed. */
+		if (r.id == 0)
+			continue;
+		int64_t lsn = vclock_get(&vclock, r.id);
+		if (lsn < r.lsn)
+			vclock_reset(&start_vclock, r.id, lsn);
+	}
+	/*
+	 * If the xlogs the replica lacks have already been
+	 * collected, feed an anonymous replica that has been
+	 * following us from the current vclock as before, so
+	 * that it rejoins instead of failing to register.
+	 * A replica bootstrapped from checkpoint files has
+	 * nothing but the checkpoint, skipping rows would lose
+	 * them, so it has to fetch a checkpoint again.
+	 */
+	vclock_iterator_init(&it, &gc.vclock);
+	vclock_foreach(&it, r) {
+		if (r.id == 0 || vclock_get(&start_vclock, r.id) >= r.lsn)
+			continue;
+		if (from_checkpoint)
+			tnt_raise(XlogGapError, &start_vclock, &gc.vclock);
+		vclock_copy(&start_vclock, &replicaset.vclock);
+		break;
+	}
+
+	struct gc_consumer *gc = gc_consumer_register(&start_vclock,
 				"replica %s", tt_uuid_str(&instance_uuid));
 	if (gc == NULL)
 		diag_raise();
@@ -1611,9 +2000,6 @@ box_process_register(struct ev_io *io, struct xrow_header *header)
 	say_info("registering replica %s at %s",
 		 tt_uuid_str(&instance_uuid), sio_socketname(io->fd));
 
-	struct vclock start_vclock;
-	vclock_copy(&start_vclock, &replicaset.vclock);
-
 	/**
 	 * Call the server-side hook which stores the replica uuid
 	 * in _cluster space.
@@ -1651,6 +2037,11 @@ box_process_register(struct ev_io *io, struct xrow_header *header)
 		gc_consumer_unregister(replica->gc);
 	replica->gc = gc;
 	gc_guard.is_active = false;
+
+	/* The replica doesn't need the fetched checkpoint anymore. */
+	struct checkpoint_fetch *fetch = checkpoint_fetch_find(&instance_uuid);
+	if (fetch != NULL)
+		checkpoint_fetch_delete(fetch);
 }
 
 void
@@ -1662,10 +2053,14 @@ box_process_join(struct ev_io *io, struct xrow_header *header)
 	 *
 	 * Replica => Master
 	 *
-	 * => JOIN { INSTANCE_UUID: replica_uuid }
-	 * <= OK { VCLOCK: start_vclock }
+	 * => JOIN { INSTANCE_UUID: replica_uuid, JOIN_STREAMS: n }
+	 * <= OK { VCLOCK: start_vclock, JOIN_STREAMS: m }
 	 *    Replica has enough permissions and master is ready for JOIN.
 	 *     - start_vclock - master's vclock at the time of join.
+	 *     - n - number of data streams the replica asks for,
+	 *       1 if omitted.
+	 *     - m - number of data streams the master is going to
+	 *       use, at most n, 1 if omitted.
 	 *
 	 * <= INSERT
 	 *    ...
@@ -1675,6 +2070,34 @@ box_process_join(struct ev_io *io, struct xrow_header *header)
 	 *    for internal purposes.
 	 *    ...
 	 * <= INSERT
+	 * <= JOIN_STREAM { INSTANCE_UUID: replica_uuid, JOIN_STREAM_ID: 0 }
+	 *    Only if m > 1: the data sent over this connection, which
+	 *    includes all system spaces, is over. The replica may
+	 *    apply the data received from the other streams.
+	 *
+	 *    For each stream id from 1 to m - 1 the replica opens
+	 *    a new connection:
+	 *    => JOIN_STREAM { INSTANCE_UUID: replica_uuid,
+	 *                     JOIN_STREAM_ID: id }
+	 *    <= JOIN_STREAM { INSTANCE_UUID: replica_uuid,
+	 *                     JOIN_STREAM_ID: id }
+	 *       The master is going to send the stream data over
+	 *       this connection. Omitted if the stream has already
+	 *       been sent.
+	 *    <= INSERT
+	 *       ...
+	 *    <= OK - end of the stream data.
+	 *    A stream the master hasn't acknowledged in time is sent
+	 *    over the JOIN connection before the end of initial JOIN
+	 *    stage.
+	 *
+	 * <= JOIN_STREAM { INSTANCE_UUID: replica_uuid, JOIN_STREAM_ID: id,
+	 *                  JOIN_STREAM_ROWS: count }
+	 *    Only if m > 1, for each stream id from 1 to m - 1:
+	 *    the number of rows sent over the stream's own
+	 *    connection. The join fails if the replica has
+	 *    received a different number of rows.
+	 *
 	 * <= OK { VCLOCK: stop_vclock } - end of initial JOIN stage.
 	 *     - `stop_vclock` - master's vclock when it's done
 	 *     done sending rows from the snapshot (i.e. vclock
@@ -1702,7 +2125,8 @@ box_process_join(struct ev_io *io, struct xrow_header *header)
 
 	/* Decode JOIN request */
 	struct tt_uuid instance_uuid = uuid_nil;
-	xrow_decode_join_xc(header, &instance_uuid);
+	uint32_t stream_count;
+	xrow_decode_join_xc(header, &instance_uuid, &stream_count);
 
 	/* Check that bootstrap has been finished */
 	if (!is_box_configured)
@@ -1751,7 +2175,8 @@ box_process_join(struct ev_io *io, struct xrow_header *header)
 	 * Initial stream: feed replica with dirty data from engines.
 	 */
 	struct vclock start_vclock;
-	relay_initial_join(io->fd, header->sync, &start_vclock);
+	relay_initial_join(io->fd, header->sync, &start_vclock,
+			   &instance_uuid, stream_count);
 	say_info("initial data sent.");
 
 	/**
@@ -1798,6 +2223,32 @@ box_process_join(struct ev_io *io, struct xrow_header *header)
 	gc_guard.is_active = false;
 }
 
+void
+box_process_join_stream(struct ev_io *io, struct xrow_header *header)
+{
+	assert(header->type == IPROTO_JOIN_STREAM);
+
+	/* Decode JOIN_STREAM request */
+	struct tt_uuid instance_uuid = uuid_nil;
+	uint32_t stream_id;
+	xrow_decode_join_stream_xc(header, &instance_uuid, &stream_id);
+
+	/* Check that bootstrap has been finished */
+	if (!is_box_configured)
+		tnt_raise(ClientError, ER_LOADING);
+
+	/* Check permissions */
+	access_check_universe_xc(PRIV_R);
+
+	say_info("sending join stream %u to replica %s at %s",
+		 (unsigned)stream_id, tt_uuid_str(&instance_uuid),
+		 sio_socketname(io->fd));
+
+	relay_initial_join_stream(io->fd, header->sync, &instance_uuid,
+				  stream_id);
+	say_info("join stream %u sent.", (unsigned)stream_id);
+}
+
 void
 box_process_subscribe(struct ev_io *io, struct xrow_header *header)
 {
@@ -2005,6 +2456,10 @@ engine_init()
 	struct engine *blackhole = blackhole_engine_new_xc();
 	engine_register(blackhole);
 
+	struct engine *column = column_engine_new_xc(cfg_gets("memtx_dir"),
+						     cfg_geti("force_recovery"));
+	engine_register(column);
+
 	struct engine *vinyl;
 	vinyl = vinyl_engine_new_xc(cfg_gets("vinyl_dir"),
 				    cfg_geti64("vinyl_memory"),
@@ -2274,6 +2729,7 @@ local_recovery(const struct tt_uuid *instance_uuid,
 	memtx_engine_recover_snapshot_xc(memtx, checkpoint_vclock);
 
 	engine_begin_final_recovery_xc();
+	recovery->read_ahead = true;
 	recover_remaining_wals(recovery, &wal_stream.base, NULL, false);
 	engine_end_recovery_xc();
 	/*
@@ -2373,6 +2829,79 @@ box_is_configured(void)
 	return is_box_configured;
 }
 
+/**
+ * Make a checkpoint on graceful shutdown if
+ * box.cfg.checkpoint_on_shutdown is set, so that the next
+ * start loads the data from the checkpoint without replaying
+ * the WAL written since the last one.
+ */
+static int
+box_checkpoint_on_shutdown(struct trigger *trigger, void *event)
+{
+	(void)trigger;
+	(void)event;
+	if (!cfg_geti("checkpoint_on_shutdown"))
+		return 0;
+	struct gc_checkpoint *checkpoint = gc_last_checkpoint();
+	if (checkpoint != NULL &&
+	    vclock_compare(&checkpoint->vclock, &replicaset.vclock) == 0)
+		return 0; /* nothing to checkpoint */
+	say_info("making a checkpoint on shutdown");
+	if (box_checkpoint() != 0)
+		diag_log();
+	return 0;
+}
+
+static struct trigger checkpoint_on_shutdown_trigger;
+
+/**
+ * Bootstrap the instance from checkpoint files of the master
+ * if box.cfg.replication_fetch_checkpoint is set and there is
+ * no local checkpoint yet. The files are fetched from the first
+ * configured master before engines scan their directories, so
+ * that the instance then recovers from them as if they were
+ * written locally. If there is a local checkpoint, files left
+ * by an interrupted download are removed.
+ */
+static void
+box_fetch_checkpoint(void)
+{
+	if (!cfg_geti("replication_fetch_checkpoint") ||
+	    cfg_getarr_size("replication") == 0)
+		return;
+
+	struct xdir dir;
+	xdir_create(&dir, cfg_gets("memtx_dir"), SNAP, &uuid_nil,
+		    &xlog_opts_default);
+	auto guard = make_scoped_guard([&] { xdir_destroy(&dir); });
+	if (xdir_scan(&dir) != 0)
+		diag_raise();
+	if (vclockset_first(&dir.index) != NULL) {
+		/*
+		 * The instance has been bootstrapped, e.g. with
+		 * JOIN after the download was interrupted.
+		 */
+		applier_collect_checkpoint_garbage(cfg_gets("memtx_dir"),
+						   cfg_gets("vinyl_dir"));
+		return;
+	}
+
+	struct tt_uuid instance_uuid;
+	box_check_instance_uuid(&instance_uuid);
+	if (tt_uuid_is_nil(&instance_uuid))
+		tt_uuid_create(&instance_uuid);
+
+	struct applier *applier =
+		applier_new(cfg_getarr_elem("replication", 0));
+	if (applier == NULL)
+		diag_raise();
+	auto applier_guard = make_scoped_guard([=] {
+		applier_delete(applier);
+	});
+	applier_fetch_checkpoint(applier, cfg_gets("memtx_dir"),
+				 cfg_gets("vinyl_dir"), &instance_uuid);
+}
+
 static inline void
 box_cfg_xc(void)
 {
@@ -2386,6 +2915,8 @@ box_cfg_xc(void)
 	rmean_box = rmean_new(iproto_type_strs, IPROTO_TYPE_STAT_MAX);
 	rmean_error = rmean_new(rmean_error_strings, RMEAN_ERROR_LAST);
 
+	box_fetch_checkpoint();
+
 	gc_init();
 	engine_init();
 	schema_init();
@@ -2457,6 +2988,16 @@ box_cfg_xc(void)
 	 */
 	struct replica *self = replica_by_uuid(&INSTANCE_UUID);
 	if (!replication_anon) {
+		if ((self == NULL || self->id == REPLICA_ID_NIL) &&
+		    cfg_geti("replication_fetch_checkpoint")) {
+			/*
+			 * The instance was bootstrapped from
+			 * checkpoint files of the master, which
+			 * don't know about it yet.
+			 */
+			box_register(true);
+			self = replica_by_uuid(&INSTANCE_UUID);
+		}
 		if (self == NULL || self->id == REPLICA_ID_NIL) {
 			tnt_raise(ClientError, ER_UNKNOWN_REPLICA,
 				  tt_uuid_str(&INSTANCE_UUID),
@@ -2474,6 +3015,10 @@ box_cfg_xc(void)
 	fiber_gc();
 	is_box_configured = true;
 
+	trigger_create(&checkpoint_on_shutdown_trigger,
+		       box_checkpoint_on_shutdown, NULL, NULL);
+	trigger_add(&box_on_shutdown, &checkpoint_on_shutdown_trigger);
+
 	title("running");
 	say_info("ready to accept requests");
 
@@ -2528,6 +3073,23 @@ box_checkpoint()
 	return gc_checkpoint();
 }
 
+ssize_t
+box_load(uint32_t space_id, const char *path, const struct load_opts *opts)
+{
+	if (!is_box_configured) {
+		diag_set(ClientError, ER_LOADING);
+		return -1;
+	}
+	if (box_check_writable() != 0)
+		return -1;
+	ssize_t count = load_file(space_id, path, opts);
+	if (count < 0)
+		return -1;
+	if (opts->checkpoint && box_checkpoint() != 0)
+		return -1;
+	return count;
+}
+
 int
 box_backup_start(int checkpoint_idx, box_backup_cb cb, void *cb_arg)
 {
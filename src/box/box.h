@@ -143,6 +143,15 @@ box_do_set_orphan(bool orphan);
  */
 int box_checkpoint(void);
 
+struct load_opts;
+
+/**
+ * Load a file into an empty memtx space bypassing WAL, see
+ * load_file(), and make a checkpoint if requested.
+ */
+ssize_t
+box_load(uint32_t space_id, const char *path, const struct load_opts *opts);
+
 typedef int (*box_backup_cb)(const char *path, void *arg);
 
 /**
@@ -186,6 +195,10 @@ box_process_auth(struct auth_request *request, const char *salt);
 void
 box_process_fetch_snapshot(struct ev_io *io, struct xrow_header *header);
 
+/** Send checkpoint files to the replica. */
+void
+box_process_fetch_checkpoint(struct ev_io *io, struct xrow_header *header);
+
 /** Register a replica */
 void
 box_process_register(struct ev_io *io, struct xrow_header *header);
@@ -201,6 +214,16 @@ box_process_register(struct ev_io *io, struct xrow_header *header);
 void
 box_process_join(struct ev_io *io, struct xrow_header *header);
 
+/**
+ * Feed a joining replica with an extra data stream of
+ * a parallel join.
+ *
+ * \param io coio watcher (initialized with coio_create())
+ * \param JOIN_STREAM packet header
+ */
+void
+box_process_join_stream(struct ev_io *io, struct xrow_header *header);
+
 /**
  * Subscribe a replica.
  *
@@ -274,6 +297,8 @@ typedef struct box_function_ctx box_function_ctx_t;
  * Return a tuple from stored C procedure.
  *
  * Returned tuple is automatically reference counted by Tarantool.
+ * A function executed in a worker thread (is_threadsafe) returns
+ * a copy of the tuple data instead.
  *
  * \param ctx an opaque structure passed to the stored C procedure by
  * Tarantool
@@ -0,0 +1,926 @@
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "column_engine.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <small/rlist.h>
+
+#include "coio_file.h"
+#include "diag.h"
+#include "engine.h"
+#include "errcode.h"
+#include "fiber.h"
+#include "iproto_constants.h"
+#include "replication.h"
+#include "schema.h"
+#include "space.h"
+#include "tt_static.h"
+#include "tuple.h"
+#include "txn.h"
+#include "xlog.h"
+#include "xrow.h"
+#include "xstream.h"
+
+/* sync checkpoint every 16MB */
+#define COLUMN_SYNC_INTERVAL	(1 << 24)
+
+struct column_checkpoint;
+
+struct column_engine {
+	struct engine base;
+	/** Directory with checkpoint files. */
+	struct xdir dir;
+	/** Set if the directory exists. */
+	bool dir_exists;
+	bool force_recovery;
+	/**
+	 * Vclock of the checkpoint local recovery starts from,
+	 * nil if the instance is bootstrapped or joined.
+	 */
+	struct vclock recovery_vclock;
+	bool is_local_recovery;
+	/** Checkpoint in progress or NULL. */
+	struct column_checkpoint *checkpoint;
+};
+
+struct column_space {
+	struct space base;
+	/** Data of the space, shared with the space on alter. */
+	struct column_table *table;
+};
+
+static const struct space_vtab column_space_vtab;
+
+static inline struct column_table *
+column_space_table(struct space *space)
+{
+	assert(space->vtab == &column_space_vtab);
+	return ((struct column_space *)space)->table;
+}
+
+/* {{{ Space */
+
+static void
+column_space_destroy(struct space *space)
+{
+	column_table_unref(column_space_table(space));
+	free(space);
+}
+
+static size_t
+column_space_bsize(struct space *space)
+{
+	return column_space_table(space)->bsize;
+}
+
+/**
+ * There are no keys so replace() is the same as insert():
+ * the row is appended. The number of the row is saved in the
+ * statement so as to delete the row on rollback.
+ */
+static int
+column_space_execute_replace(struct space *space, struct txn *txn,
+			     struct request *request, struct tuple **result)
+{
+	struct txn_stmt *stmt = txn_current_stmt(txn);
+	stmt->new_tuple = tuple_new(space->format, request->tuple,
+				    request->tuple_end);
+	if (stmt->new_tuple == NULL)
+		return -1;
+	tuple_ref(stmt->new_tuple);
+	uint64_t *rowid = region_alloc_object(&txn->region, uint64_t);
+	if (rowid == NULL) {
+		diag_set(OutOfMemory, sizeof(*rowid), "region", "rowid");
+		return -1;
+	}
+	if (column_table_append(column_space_table(space), request->tuple,
+				request->tuple_end, rowid) != 0)
+		return -1;
+	stmt->engine_savepoint = rowid;
+	*result = stmt->new_tuple;
+	return 0;
+}
+
+static int
+column_space_execute_delete(struct space *space, struct txn *txn,
+			    struct request *request, struct tuple **result)
+{
+	(void)space;
+	(void)txn;
+	(void)request;
+	(void)result;
+	diag_set(ClientError, ER_UNSUPPORTED, "Column", "delete()");
+	return -1;
+}
+
+static int
+column_space_execute_update(struct space *space, struct txn *txn,
+			    struct request *request, struct tuple **result)
+{
+	(void)space;
+	(void)txn;
+	(void)request;
+	(void)result;
+	diag_set(ClientError, ER_UNSUPPORTED, "Column", "update()");
+	return -1;
+}
+
+static int
+column_space_execute_upsert(struct space *space, struct txn *txn,
+			    struct request *request)
+{
+	(void)space;
+	(void)txn;
+	(void)request;
+	diag_set(ClientError, ER_UNSUPPORTED, "Column", "upsert()");
+	return -1;
+}
+
+static struct index *
+column_space_create_index(struct space *space, struct index_def *def)
+{
+	(void)space;
+	(void)def;
+	/* See column_engine_create_space(). */
+	unreachable();
+	return NULL;
+}
+
+/**
+ * The new space takes over the data of the old one. Columns
+ * of a space that has rows can't be changed.
+ */
+static int
+column_space_prepare_alter(struct space *old_space, struct space *new_space)
+{
+	struct column_space *old_cs = (struct column_space *)old_space;
+	struct column_space *new_cs = (struct column_space *)new_space;
+	if (old_cs->table->row_count == 0)
+		return 0;
+	if (!column_table_has_same_columns(old_cs->table, new_cs->table)) {
+		diag_set(ClientError, ER_ALTER_SPACE, space_name(old_space),
+			 "can not change field types of a non-empty "
+			 "column space");
+		return -1;
+	}
+	column_table_unref(new_cs->table);
+	new_cs->table = old_cs->table;
+	column_table_ref(new_cs->table);
+	return 0;
+}
+
+/**
+ * Truncation recreates indexes, so rows of a column space,
+ * which are stored outside of indexes, would survive it.
+ */
+static int
+column_space_prepare_truncate(struct space *space)
+{
+	struct column_space *cs = (struct column_space *)space;
+	if (cs->table->row_count == 0)
+		return 0;
+	diag_set(ClientError, ER_UNSUPPORTED, space->engine->name,
+		 "truncate()");
+	return -1;
+}
+
+static const struct space_vtab column_space_vtab = {
+	/* .destroy = */ column_space_destroy,
+	/* .bsize = */ column_space_bsize,
+	/* .execute_replace = */ column_space_execute_replace,
+	/* .execute_delete = */ column_space_execute_delete,
+	/* .execute_update = */ column_space_execute_update,
+	/* .execute_upsert = */ column_space_execute_upsert,
+	/* .ephemeral_replace = */ generic_space_ephemeral_replace,
+	/* .ephemeral_delete = */ generic_space_ephemeral_delete,
+	/* .ephemeral_rowid_next = */ generic_space_ephemeral_rowid_next,
+	/* .init_system_space = */ generic_init_system_space,
+	/* .init_ephemeral_space = */ generic_init_ephemeral_space,
+	/* .check_index_def = */ generic_space_check_index_def,
+	/* .create_index = */ column_space_create_index,
+	/* .add_primary_key = */ generic_space_add_primary_key,
+	/* .drop_primary_key = */ generic_space_drop_primary_key,
+	/* .check_format = */ generic_space_check_format,
+	/* .build_index = */ generic_space_build_index,
+	/* .swap_index = */ generic_space_swap_index,
+	/* .prepare_alter = */ column_space_prepare_alter,
+	/* .prepare_truncate = */ column_space_prepare_truncate,
+	/* .invalidate = */ generic_space_invalidate,
+};
+
+int
+column_space_aggregate(struct space *space, uint32_t fieldno,
+		       enum column_aggregate_op op,
+		       struct column_value *result)
+{
+	if (space->vtab != &column_space_vtab) {
+		diag_set(ClientError, ER_UNSUPPORTED,
+			 space->engine->name, "aggregate()");
+		return -1;
+	}
+	struct column_table *table = column_space_table(space);
+	if (fieldno >= table->column_count) {
+		diag_set(ClientError, ER_NO_SUCH_FIELD_NO,
+			 fieldno + TUPLE_INDEX_BASE);
+		return -1;
+	}
+	return column_table_aggregate(table, fieldno, op, result);
+}
+
+/* }}} */
+
+/* {{{ Checkpoint and join */
+
+/** A space to write to a checkpoint or send to a replica. */
+struct column_dump_entry {
+	uint32_t space_id;
+	uint32_t group_id;
+	struct column_view view;
+	struct rlist in_list;
+};
+
+static void
+column_dump_list_delete(struct rlist *list)
+{
+	struct column_dump_entry *entry, *tmp;
+	rlist_foreach_entry_safe(entry, list, in_list, tmp) {
+		column_view_destroy(&entry->view);
+		free(entry);
+	}
+}
+
+/** Argument of column_dump_list_add(). */
+struct column_dump_list_arg {
+	struct engine *engine;
+	struct rlist *list;
+	/** Skip spaces that are not replicated. */
+	bool is_join;
+};
+
+static int
+column_dump_list_add(struct space *space, void *data)
+{
+	struct column_dump_list_arg *arg = data;
+	if (space->engine != arg->engine || space_is_temporary(space))
+		return 0;
+	if (arg->is_join && space_group_id(space) == GROUP_LOCAL)
+		return 0;
+	if (column_table_size(column_space_table(space)) == 0)
+		return 0;
+	struct column_dump_entry *entry = malloc(sizeof(*entry));
+	if (entry == NULL) {
+		diag_set(OutOfMemory, sizeof(*entry), "malloc",
+			 "struct column_dump_entry");
+		return -1;
+	}
+	if (column_view_create(&entry->view,
+			       column_space_table(space)) != 0) {
+		free(entry);
+		return -1;
+	}
+	entry->space_id = space_id(space);
+	entry->group_id = space_group_id(space);
+	rlist_add_tail_entry(arg->list, entry, in_list);
+	return 0;
+}
+
+/** Create read views of all column spaces. */
+static int
+column_dump_list_create(struct engine *engine, struct rlist *list,
+			bool is_join)
+{
+	rlist_create(list);
+	struct column_dump_list_arg arg = { engine, list, is_join };
+	if (space_foreach(column_dump_list_add, &arg) != 0) {
+		column_dump_list_delete(list);
+		return -1;
+	}
+	return 0;
+}
+
+/** Make an INSERT row of a space row. */
+static void
+column_dump_row_create(struct xrow_header *row,
+		       struct request_replace_body *body,
+		       const struct column_dump_entry *entry,
+		       const char *data, uint32_t size)
+{
+	request_replace_body_create(body, entry->space_id);
+	memset(row, 0, sizeof(*row));
+	row->type = IPROTO_INSERT;
+	row->group_id = entry->group_id;
+	row->bodycnt = 2;
+	row->body[0].iov_base = body;
+	row->body[0].iov_len = sizeof(*body);
+	row->body[1].iov_base = (char *)data;
+	row->body[1].iov_len = size;
+}
+
+struct column_checkpoint {
+	/** Spaces to write, with read views. */
+	struct rlist entries;
+	struct cord cord;
+	bool waiting_for_thread;
+	/** The vclock of the checkpoint file. */
+	struct vclock vclock;
+	struct xdir dir;
+	/** Don't write, touch the existing checkpoint file. */
+	bool touch;
+};
+
+static void
+column_checkpoint_delete(struct column_checkpoint *ckpt)
+{
+	column_dump_list_delete(&ckpt->entries);
+	xdir_destroy(&ckpt->dir);
+	free(ckpt);
+}
+
+static int
+column_checkpoint_f(va_list ap)
+{
+	struct column_checkpoint *ckpt = va_arg(ap, struct column_checkpoint *);
+
+	if (ckpt->touch) {
+		if (xdir_touch_xlog(&ckpt->dir, &ckpt->vclock) == 0)
+			return 0;
+		ckpt->touch = false;
+	}
+
+	struct xlog xlog;
+	if (xdir_create_xlog(&ckpt->dir, &xlog, &ckpt->vclock) != 0)
+		return -1;
+
+	say_info("saving column checkpoint `%s'", xlog.filename);
+	struct column_dump_entry *entry;
+	rlist_foreach_entry(entry, &ckpt->entries, in_list) {
+		int rc;
+		const char *data;
+		uint32_t size;
+		while ((rc = column_view_next(&entry->view, &data,
+					      &size)) == 0 && data != NULL) {
+			struct xrow_header row;
+			struct request_replace_body body;
+			column_dump_row_create(&row, &body, entry, data, size);
+			/* Rows are numbered from 1. */
+			row.lsn = xlog.rows + xlog.tx_rows + 1;
+			if (xlog_write_row(&xlog, &row) < 0)
+				goto fail;
+			fiber_gc();
+		}
+		if (rc != 0)
+			goto fail;
+	}
+	if (xlog_flush(&xlog) < 0)
+		goto fail;
+	xlog_close(&xlog, false);
+	say_info("done");
+	return 0;
+fail:
+	xlog_close(&xlog, false);
+	return -1;
+}
+
+static int
+column_engine_begin_checkpoint(struct engine *engine)
+{
+	struct column_engine *column = (struct column_engine *)engine;
+	assert(column->checkpoint == NULL);
+	struct column_checkpoint *ckpt = calloc(1, sizeof(*ckpt));
+	if (ckpt == NULL) {
+		diag_set(OutOfMemory, sizeof(*ckpt), "calloc",
+			 "struct column_checkpoint");
+		return -1;
+	}
+	if (column_dump_list_create(engine, &ckpt->entries, false) != 0) {
+		free(ckpt);
+		return -1;
+	}
+	struct xlog_opts opts = xlog_opts_default;
+	opts.sync_interval = COLUMN_SYNC_INTERVAL;
+	opts.free_cache = true;
+	xdir_create(&ckpt->dir, column->dir.dirname, SNAP,
+		    &INSTANCE_UUID, &opts);
+	vclock_create(&ckpt->vclock);
+	column->checkpoint = ckpt;
+	return 0;
+}
+
+static int
+column_engine_wait_checkpoint(struct engine *engine,
+			      const struct vclock *vclock)
+{
+	struct column_engine *column = (struct column_engine *)engine;
+	struct column_checkpoint *ckpt = column->checkpoint;
+	assert(ckpt != NULL);
+	vclock_copy(&ckpt->vclock, vclock);
+	/*
+	 * Without non-empty column spaces there is nothing to
+	 * write, and nothing to load on recovery from this
+	 * checkpoint.
+	 */
+	if (rlist_empty(&ckpt->entries))
+		return 0;
+	if (!column->dir_exists) {
+		if (mkdir(column->dir.dirname, 0777) != 0 &&
+		    errno != EEXIST) {
+			diag_set(SystemError, "failed to create directory "
+				 "'%s'", column->dir.dirname);
+			return -1;
+		}
+		column->dir_exists = true;
+	}
+	struct vclock last;
+	if (xdir_last_vclock(&column->dir, &last) >= 0 &&
+	    vclock_compare(&last, vclock) == 0)
+		ckpt->touch = true;
+
+	if (cord_costart(&ckpt->cord, "column_snapshot",
+			 column_checkpoint_f, ckpt) != 0)
+		return -1;
+	ckpt->waiting_for_thread = true;
+	int rc = cord_cojoin(&ckpt->cord);
+	ckpt->waiting_for_thread = false;
+	if (rc != 0)
+		diag_log();
+	return rc;
+}
+
+static void
+column_engine_commit_checkpoint(struct engine *engine,
+				const struct vclock *vclock)
+{
+	struct column_engine *column = (struct column_engine *)engine;
+	struct column_checkpoint *ckpt = column->checkpoint;
+	assert(ckpt != NULL);
+	assert(!ckpt->waiting_for_thread);
+	if (!rlist_empty(&ckpt->entries)) {
+		if (!ckpt->touch) {
+			struct xdir *dir = &ckpt->dir;
+			int64_t signature = vclock_sum(&ckpt->vclock);
+			char to[PATH_MAX];
+			snprintf(to, sizeof(to), "%s",
+				 xdir_format_filename(dir, signature, NONE));
+			const char *from = xdir_format_filename(dir, signature,
+								INPROGRESS);
+			if (coio_rename(from, to) != 0)
+				panic("can't rename column checkpoint");
+		}
+		struct vclock last;
+		if (xdir_last_vclock(&column->dir, &last) < 0 ||
+		    vclock_compare(&last, vclock) != 0)
+			xdir_add_vclock(&column->dir, &ckpt->vclock);
+	}
+	column_checkpoint_delete(ckpt);
+	column->checkpoint = NULL;
+}
+
+static void
+column_engine_abort_checkpoint(struct engine *engine)
+{
+	struct column_engine *column = (struct column_engine *)engine;
+	struct column_checkpoint *ckpt = column->checkpoint;
+	if (ckpt->waiting_for_thread) {
+		if (cord_cojoin(&ckpt->cord) != 0)
+			diag_log();
+		ckpt->waiting_for_thread = false;
+	}
+	const char *filename =
+		xdir_format_filename(&ckpt->dir, vclock_sum(&ckpt->vclock),
+				     INPROGRESS);
+	(void)coio_unlink(filename);
+	column_checkpoint_delete(ckpt);
+	column->checkpoint = NULL;
+}
+
+static void
+column_engine_collect_garbage(struct engine *engine,
+			      const struct vclock *vclock)
+{
+	struct column_engine *column = (struct column_engine *)engine;
+	if (!column->dir_exists)
+		return;
+	xdir_collect_garbage(&column->dir, vclock_sum(vclock), XDIR_GC_ASYNC);
+	xdir_collect_inprogress(&column->dir);
+}
+
+static int
+column_engine_backup(struct engine *engine, const struct vclock *vclock,
+		     engine_backup_cb cb, void *cb_arg)
+{
+	struct column_engine *column = (struct column_engine *)engine;
+	/* No file if all column spaces were empty. */
+	if (vclockset_search(&column->dir.index,
+			     (struct vclock *)vclock) == NULL)
+		return 0;
+	const char *filename = xdir_format_filename(&column->dir,
+						    vclock_sum(vclock), NONE);
+	return cb(filename, cb_arg);
+}
+
+/** Context of an initial join. */
+struct column_join_ctx {
+	struct rlist entries;
+	struct xstream *stream;
+};
+
+static int
+column_engine_prepare_join(struct engine *engine, void **arg)
+{
+	struct column_join_ctx *ctx = malloc(sizeof(*ctx));
+	if (ctx == NULL) {
+		diag_set(OutOfMemory, sizeof(*ctx), "malloc",
+			 "struct column_join_ctx");
+		return -1;
+	}
+	if (column_dump_list_create(engine, &ctx->entries, true) != 0) {
+		free(ctx);
+		return -1;
+	}
+	*arg = ctx;
+	return 0;
+}
+
+static int
+column_join_f(va_list ap)
+{
+	struct column_join_ctx *ctx = va_arg(ap, struct column_join_ctx *);
+	struct column_dump_entry *entry;
+	rlist_foreach_entry(entry, &ctx->entries, in_list) {
+		int rc;
+		const char *data;
+		uint32_t size;
+		while ((rc = column_view_next(&entry->view, &data,
+					      &size)) == 0 && data != NULL) {
+			struct xrow_header row;
+			struct request_replace_body body;
+			column_dump_row_create(&row, &body, entry, data, size);
+			if (xstream_write(ctx->stream, &row) != 0)
+				return -1;
+		}
+		if (rc != 0)
+			return -1;
+	}
+	return 0;
+}
+
+static int
+column_engine_join(struct engine *engine, void *arg, struct xstream *stream)
+{
+	(void)engine;
+	struct column_join_ctx *ctx = arg;
+	ctx->stream = stream;
+	/*
+	 * Read views are safe to scan from another thread, so
+	 * do it there, like memtx does, to spare tx cpu time.
+	 */
+	struct cord cord;
+	if (cord_costart(&cord, "column_join", column_join_f, ctx) != 0)
+		return -1;
+	return cord_cojoin(&cord);
+}
+
+static void
+column_engine_complete_join(struct engine *engine, void *arg)
+{
+	(void)engine;
+	struct column_join_ctx *ctx = arg;
+	column_dump_list_delete(&ctx->entries);
+	free(ctx);
+}
+
+/* }}} */
+
+/* {{{ Recovery */
+
+static int
+column_engine_recover_row(struct column_engine *column,
+			  struct xrow_header *row)
+{
+	if (row->type != IPROTO_INSERT) {
+		diag_set(ClientError, ER_UNKNOWN_REQUEST_TYPE,
+			 (uint32_t)row->type);
+		return -1;
+	}
+	struct request request;
+	if (xrow_decode_dml(row, &request, dml_request_key_map(row->type)) != 0)
+		return -1;
+	struct space *space = space_cache_find(request.space_id);
+	if (space == NULL)
+		return -1;
+	if (space->engine != &column->base) {
+		diag_set(ClientError, ER_CROSS_ENGINE_TRANSACTION);
+		return -1;
+	}
+	uint64_t rowid;
+	return column_table_append(column_space_table(space), request.tuple,
+				   request.tuple_end, &rowid);
+}
+
+/**
+ * Load the checkpoint local recovery starts from. The rows are
+ * appended directly, there is nothing to undo.
+ */
+static int
+column_engine_recover_checkpoint(struct column_engine *column)
+{
+	if (vclockset_search(&column->dir.index,
+			     &column->recovery_vclock) == NULL)
+		return 0;
+	const char *filename =
+		xdir_format_filename(&column->dir,
+				     vclock_sum(&column->recovery_vclock),
+				     NONE);
+	say_info("recovering from `%s'", filename);
+	struct xlog_cursor cursor;
+	if (xlog_cursor_open(&cursor, filename) < 0)
+		return -1;
+	int rc;
+	struct xrow_header row;
+	uint64_t row_count = 0;
+	while ((rc = xlog_cursor_next(&cursor, &row,
+				      column->force_recovery)) == 0) {
+		rc = column_engine_recover_row(column, &row);
+		if (rc < 0) {
+			if (!column->force_recovery)
+				break;
+			say_error("can't apply row: ");
+			diag_log();
+			rc = 0;
+		}
+		if (++row_count % 100000 == 0) {
+			say_info("%.1fM rows processed",
+				 row_count / 1000000.);
+			fiber_yield_timeout(0);
+		}
+	}
+	xlog_cursor_close(&cursor, false);
+	if (rc < 0)
+		return -1;
+	if (!xlog_cursor_is_eof(&cursor))
+		panic("column checkpoint `%s' has no EOF marker", filename);
+	return 0;
+}
+
+static int
+column_engine_begin_initial_recovery(struct engine *engine,
+				     const struct vclock *vclock)
+{
+	struct column_engine *column = (struct column_engine *)engine;
+	column->is_local_recovery = vclock != NULL;
+	if (vclock != NULL)
+		vclock_copy(&column->recovery_vclock, vclock);
+	return 0;
+}
+
+/**
+ * Called after memtx has recovered its snapshot, so that the
+ * column spaces exist, but before the WAL is replayed on top
+ * of the checkpoint.
+ */
+static int
+column_engine_begin_final_recovery(struct engine *engine)
+{
+	struct column_engine *column = (struct column_engine *)engine;
+	if (!column->is_local_recovery)
+		return 0;
+	return column_engine_recover_checkpoint(column);
+}
+
+/* }}} */
+
+/* {{{ Engine */
+
+static void
+column_engine_shutdown(struct engine *engine)
+{
+	struct column_engine *column = (struct column_engine *)engine;
+	if (column->checkpoint != NULL) {
+		struct column_checkpoint *ckpt = column->checkpoint;
+		if (ckpt->waiting_for_thread) {
+			tt_pthread_cancel(ckpt->cord.id);
+			tt_pthread_join(ckpt->cord.id, NULL);
+		}
+		column_checkpoint_delete(ckpt);
+	}
+	xdir_destroy(&column->dir);
+	free(column);
+}
+
+static struct space *
+column_engine_create_space(struct engine *engine, struct space_def *def,
+			   struct rlist *key_list)
+{
+	if (!rlist_empty(key_list)) {
+		diag_set(ClientError, ER_UNSUPPORTED, "Column", "indexes");
+		return NULL;
+	}
+	struct column_space *cs = calloc(1, sizeof(*cs));
+	enum column_type *types = malloc(def->field_count * sizeof(*types));
+	if (cs == NULL || types == NULL) {
+		diag_set(OutOfMemory, sizeof(*cs), "malloc",
+			 "struct column_space");
+		free(types);
+		free(cs);
+		return NULL;
+	}
+	for (uint32_t i = 0; i < def->field_count; i++)
+		types[i] = column_type_by_field_type(def->fields[i].type);
+	cs->table = column_table_new(types, def->field_count);
+	free(types);
+	if (cs->table == NULL) {
+		free(cs);
+		return NULL;
+	}
+	/* Tuples are only made for triggers and results. */
+	struct tuple_format *format;
+	format = tuple_format_new(&tuple_format_runtime->vtab, NULL, NULL, 0,
+				  def->fields, def->field_count,
+				  def->exact_field_count, def->dict, false,
+				  false);
+	if (format == NULL)
+		goto fail;
+	tuple_format_ref(format);
+	if (space_create(&cs->base, engine, &column_space_vtab,
+			 def, key_list, format) != 0) {
+		tuple_format_unref(format);
+		goto fail;
+	}
+	return &cs->base;
+fail:
+	column_table_unref(cs->table);
+	free(cs);
+	return NULL;
+}
+
+/**
+ * A column space must have a format of non-nullable fields of
+ * the types that can be stored in columns.
+ */
+static int
+column_engine_check_space_def(struct space_def *def)
+{
+	if (def->field_count == 0) {
+		diag_set(ClientError, ER_ALTER_SPACE, def->name,
+			 "column engine requires a space format");
+		return -1;
+	}
+	for (uint32_t i = 0; i < def->field_count; i++) {
+		struct field_def *field = &def->fields[i];
+		if (column_type_by_field_type(field->type) ==
+		    column_type_MAX) {
+			diag_set(ClientError, ER_ALTER_SPACE, def->name,
+				 tt_sprintf("column engine does not support "
+					    "field type '%s'",
+					    field_type_strs[field->type]));
+			return -1;
+		}
+		if (field->is_nullable) {
+			diag_set(ClientError, ER_ALTER_SPACE, def->name,
+				 "column engine does not support nullable "
+				 "fields");
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * Appended rows are visible to read views right away, so a
+ * transaction must not yield between statements, or a
+ * checkpoint could capture rows that are rolled back later or
+ * committed after the checkpoint vclock.
+ */
+static int
+column_engine_begin(struct engine *engine, struct txn *txn)
+{
+	(void)engine;
+	txn_can_yield(txn, false);
+	return 0;
+}
+
+static void
+column_engine_rollback_statement(struct engine *engine, struct txn *txn,
+				 struct txn_stmt *stmt)
+{
+	(void)engine;
+	(void)txn;
+	/* Only roll back the row if it was appended. */
+	if (stmt->engine_savepoint == NULL)
+		return;
+	uint64_t *rowid = stmt->engine_savepoint;
+	column_table_delete(column_space_table(stmt->space), *rowid);
+}
+
+static int
+column_engine_memory_stat_cb(struct space *space, void *data)
+{
+	if (space->vtab != &column_space_vtab)
+		return 0;
+	struct engine_memory_stat *stat = data;
+	stat->data += column_space_table(space)->bsize;
+	return 0;
+}
+
+static void
+column_engine_memory_stat(struct engine *engine,
+			  struct engine_memory_stat *stat)
+{
+	(void)engine;
+	space_foreach(column_engine_memory_stat_cb, stat);
+}
+
+static const struct engine_vtab column_engine_vtab = {
+	/* .shutdown = */ column_engine_shutdown,
+	/* .create_space = */ column_engine_create_space,
+	/* .prepare_join = */ column_engine_prepare_join,
+	/* .join = */ column_engine_join,
+	/* .split_join = */ generic_engine_split_join,
+	/* .join_stream = */ generic_engine_join_stream,
+	/* .complete_join = */ column_engine_complete_join,
+	/* .begin = */ column_engine_begin,
+	/* .begin_statement = */ generic_engine_begin_statement,
+	/* .prepare = */ generic_engine_prepare,
+	/* .commit = */ generic_engine_commit,
+	/* .rollback_statement = */ column_engine_rollback_statement,
+	/* .rollback = */ generic_engine_rollback,
+	/* .switch_to_ro = */ generic_engine_switch_to_ro,
+	/* .bootstrap = */ generic_engine_bootstrap,
+	/* .begin_initial_recovery = */ column_engine_begin_initial_recovery,
+	/* .begin_final_recovery = */ column_engine_begin_final_recovery,
+	/* .end_recovery = */ generic_engine_end_recovery,
+	/* .begin_checkpoint = */ column_engine_begin_checkpoint,
+	/* .wait_checkpoint = */ column_engine_wait_checkpoint,
+	/* .commit_checkpoint = */ column_engine_commit_checkpoint,
+	/* .abort_checkpoint = */ column_engine_abort_checkpoint,
+	/* .collect_garbage = */ column_engine_collect_garbage,
+	/* .backup = */ column_engine_backup,
+	/* .memory_stat = */ column_engine_memory_stat,
+	/* .reset_stat = */ generic_engine_reset_stat,
+	/* .check_space_def = */ column_engine_check_space_def,
+};
+
+struct engine *
+column_engine_new(const char *memtx_dirname, bool force_recovery)
+{
+	struct column_engine *column = calloc(1, sizeof(*column));
+	if (column == NULL) {
+		diag_set(OutOfMemory, sizeof(*column),
+			 "calloc", "struct column_engine");
+		return NULL;
+	}
+	char dirname[PATH_MAX];
+	snprintf(dirname, sizeof(dirname), "%s/column", memtx_dirname);
+	xdir_create(&column->dir, dirname, SNAP, &INSTANCE_UUID,
+		    &xlog_opts_default);
+	column->dir.force_recovery = force_recovery;
+	column->force_recovery = force_recovery;
+	/* The directory is created with the first checkpoint. */
+	struct stat st;
+	column->dir_exists = stat(dirname, &st) == 0;
+	if (column->dir_exists && xdir_scan(&column->dir) != 0) {
+		xdir_destroy(&column->dir);
+		free(column);
+		return NULL;
+	}
+	vclock_create(&column->recovery_vclock);
+
+	column->base.vtab = &column_engine_vtab;
+	column->base.name = "column";
+	return &column->base;
+}
+
+/* }}} */
@@ -0,0 +1,84 @@
+#ifndef TARANTOOL_BOX_COLUMN_ENGINE_H_INCLUDED
+#define TARANTOOL_BOX_COLUMN_ENGINE_H_INCLUDED
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "column_store.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+/**
+ * Column engine stores spaces with a fixed format column-wise,
+ * see column_store.h. Spaces are append-only and have no
+ * indexes, they are meant for analytical scans rather than
+ * lookups. Data is persisted in checkpoint files of its own,
+ * kept in the "column" subdirectory of memtx_dir.
+ */
+
+struct engine;
+struct space;
+
+struct engine *
+column_engine_new(const char *memtx_dirname, bool force_recovery);
+
+/**
+ * Compute an aggregate function over a field of a column
+ * space, @a fieldno is 0-based.
+ * @retval 0 success
+ * @retval -1 error, check diag
+ */
+int
+column_space_aggregate(struct space *space, uint32_t fieldno,
+		       enum column_aggregate_op op,
+		       struct column_value *result);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+
+#include "diag.h"
+
+static inline struct engine *
+column_engine_new_xc(const char *memtx_dirname, bool force_recovery)
+{
+	struct engine *engine = column_engine_new(memtx_dirname,
+						  force_recovery);
+	if (engine == NULL)
+		diag_raise();
+	return engine;
+}
+
+#endif /* defined(__plusplus) */
+
+#endif /* TARANTOOL_BOX_COLUMN_ENGINE_H_INCLUDED */
@@ -0,0 +1,1199 @@
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "column_store.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include <msgpuck.h>
+
+#include "assoc.h"
+#include "bit/bit.h"
+#include "bit/int96.h"
+#include "diag.h"
+#include "errcode.h"
+#include "tt_static.h"
+#include "tuple_format.h"
+#include "trivia/util.h"
+
+const char *column_type_strs[] = {
+	/* [COLUMN_UNSIGNED] = */ "unsigned",
+	/* [COLUMN_INTEGER]  = */ "integer",
+	/* [COLUMN_DOUBLE]   = */ "double",
+	/* [COLUMN_STRING]   = */ "string",
+	/* [COLUMN_BOOLEAN]  = */ "boolean",
+	/* [column_type_MAX] = */ NULL,
+};
+
+const char *column_aggregate_op_strs[] = {
+	/* [COLUMN_AGGREGATE_COUNT] = */ "count",
+	/* [COLUMN_AGGREGATE_SUM]   = */ "sum",
+	/* [COLUMN_AGGREGATE_MIN]   = */ "min",
+	/* [COLUMN_AGGREGATE_MAX]   = */ "max",
+	/* [column_aggregate_op_MAX] = */ NULL,
+};
+
+/** Size of a value stored in a chunk, by column type. */
+static const uint32_t column_type_size[] = {
+	/* [COLUMN_UNSIGNED] = */ sizeof(uint64_t),
+	/* [COLUMN_INTEGER]  = */ sizeof(int64_t),
+	/* [COLUMN_DOUBLE]   = */ sizeof(double),
+	/* [COLUMN_STRING]   = */ sizeof(uint32_t),
+	/* [COLUMN_BOOLEAN]  = */ sizeof(uint8_t),
+};
+
+enum column_type
+column_type_by_field_type(enum field_type type)
+{
+	switch (type) {
+	case FIELD_TYPE_UNSIGNED:
+		return COLUMN_UNSIGNED;
+	case FIELD_TYPE_INTEGER:
+		return COLUMN_INTEGER;
+	case FIELD_TYPE_DOUBLE:
+		return COLUMN_DOUBLE;
+	case FIELD_TYPE_STRING:
+		return COLUMN_STRING;
+	case FIELD_TYPE_BOOLEAN:
+		return COLUMN_BOOLEAN;
+	default:
+		return column_type_MAX;
+	}
+}
+
+/** Read the i-th value of an array of the given type. */
+static inline uint64_t
+column_value_get(const void *values, enum column_type type, uint32_t i)
+{
+	switch (column_type_size[type]) {
+	case sizeof(uint64_t):
+		return ((const uint64_t *)values)[i];
+	case sizeof(uint32_t):
+		return ((const uint32_t *)values)[i];
+	default:
+		return ((const uint8_t *)values)[i];
+	}
+}
+
+/** Write the i-th value of an array of the given type. */
+static inline void
+column_value_set(void *values, enum column_type type, uint32_t i,
+		 uint64_t value)
+{
+	switch (column_type_size[type]) {
+	case sizeof(uint64_t):
+		((uint64_t *)values)[i] = value;
+		break;
+	case sizeof(uint32_t):
+		((uint32_t *)values)[i] = (uint32_t)value;
+		break;
+	default:
+		((uint8_t *)values)[i] = (uint8_t)value;
+		break;
+	}
+}
+
+/**
+ * Expand a run-length encoded chunk of @a count values into
+ * @a buf, return the buffer.
+ */
+static const void *
+column_chunk_decode(const struct column_chunk *chunk, enum column_type type,
+		    uint32_t count, void *buf)
+{
+	assert(chunk->run_count > 0);
+	uint32_t begin = 0;
+	for (uint32_t r = 0; r < chunk->run_count; r++) {
+		uint64_t value = column_value_get(chunk->values, type, r);
+		uint32_t end = MIN(chunk->run_ends[r], count);
+		for (uint32_t i = begin; i < end; i++)
+			column_value_set(buf, type, i, value);
+		begin = end;
+	}
+	return buf;
+}
+
+/**
+ * Run-length encode a chunk of a full group unless it doesn't
+ * save at least a half of memory. Return the change of the
+ * chunk size, in bytes.
+ */
+static ssize_t
+column_chunk_encode(struct column_chunk *chunk, enum column_type type,
+		    uint32_t count)
+{
+	assert(chunk->run_count == 0);
+	/* Runs of equal doubles are rare, don't bother. */
+	if (type == COLUMN_DOUBLE || count == 0 || chunk->big != NULL)
+		return 0;
+	uint32_t run_count = 1;
+	for (uint32_t i = 1; i < count; i++) {
+		run_count += column_value_get(chunk->values, type, i) !=
+			     column_value_get(chunk->values, type, i - 1);
+	}
+	size_t size = column_type_size[type];
+	size_t plain_size = count * size;
+	size_t encoded_size = run_count * (size + sizeof(uint32_t));
+	if (encoded_size * 2 > plain_size)
+		return 0;
+	void *run_values = malloc(run_count * size);
+	uint32_t *run_ends = malloc(run_count * sizeof(uint32_t));
+	if (run_values == NULL || run_ends == NULL) {
+		/* Not a problem, the chunk stays plain. */
+		free(run_values);
+		free(run_ends);
+		return 0;
+	}
+	uint32_t r = 0;
+	uint64_t value = column_value_get(chunk->values, type, 0);
+	for (uint32_t i = 1; i < count; i++) {
+		uint64_t next = column_value_get(chunk->values, type, i);
+		if (next == value)
+			continue;
+		column_value_set(run_values, type, r, value);
+		run_ends[r++] = i;
+		value = next;
+	}
+	column_value_set(run_values, type, r, value);
+	run_ends[r++] = count;
+	assert(r == run_count);
+	free(chunk->values);
+	chunk->values = run_values;
+	chunk->run_ends = run_ends;
+	chunk->run_count = run_count;
+	return (ssize_t)encoded_size - (ssize_t)plain_size;
+}
+
+static void
+column_group_delete(struct column_group *group, uint32_t column_count)
+{
+	for (uint32_t i = 0; i < column_count; i++) {
+		free(group->chunks[i].values);
+		free(group->chunks[i].run_ends);
+		free(group->chunks[i].big);
+	}
+	free(group);
+}
+
+static struct column_group *
+column_group_new(const enum column_type *types, uint32_t column_count)
+{
+	size_t size = sizeof(struct column_group) +
+		      column_count * sizeof(struct column_chunk);
+	struct column_group *group = calloc(1, size);
+	if (group == NULL) {
+		diag_set(OutOfMemory, size, "calloc", "struct column_group");
+		return NULL;
+	}
+	for (uint32_t i = 0; i < column_count; i++) {
+		size = COLUMN_GROUP_SIZE * column_type_size[types[i]];
+		group->chunks[i].values = malloc(size);
+		if (group->chunks[i].values == NULL) {
+			diag_set(OutOfMemory, size, "malloc", "column chunk");
+			column_group_delete(group, column_count);
+			return NULL;
+		}
+	}
+	return group;
+}
+
+static int
+column_dict_create(struct column_dict *dict)
+{
+	memset(dict, 0, sizeof(*dict));
+	dict->hash = mh_strnptr_new();
+	if (dict->hash == NULL) {
+		diag_set(OutOfMemory, sizeof(*dict->hash), "malloc",
+			 "column dictionary");
+		return -1;
+	}
+	return 0;
+}
+
+static void
+column_dict_destroy(struct column_dict *dict)
+{
+	for (uint32_t i = 0; i < dict->count; i++)
+		free(dict->strings[i]);
+	free(dict->strings);
+	if (dict->hash != NULL)
+		mh_strnptr_delete(dict->hash);
+}
+
+/**
+ * Find the code of a string, add the string to the dictionary
+ * if it isn't there yet. Account the memory taken by a new
+ * string in @a bsize.
+ */
+static int
+column_dict_intern(struct column_dict *dict, const char *str, uint32_t len,
+		   uint32_t *code, size_t *bsize)
+{
+	uint32_t hash = mh_strn_hash(str, len);
+	struct mh_strnptr_key_t key = {str, len, hash};
+	mh_int_t pos = mh_strnptr_find(dict->hash, &key, NULL);
+	if (pos != mh_end(dict->hash)) {
+		*code = (uint32_t)(uintptr_t)
+			mh_strnptr_node(dict->hash, pos)->val;
+		return 0;
+	}
+	if (dict->count == UINT32_MAX) {
+		diag_set(ClientError, ER_UNSUPPORTED, "Column",
+			 "more than 4294967295 distinct strings in a column");
+		return -1;
+	}
+	if (dict->count == dict->capacity) {
+		uint32_t capacity = MAX(dict->capacity * 2, 16U);
+		struct column_string **strings =
+			realloc(dict->strings, capacity * sizeof(*strings));
+		if (strings == NULL) {
+			diag_set(OutOfMemory, capacity * sizeof(*strings),
+				 "realloc", "column dictionary");
+			return -1;
+		}
+		dict->strings = strings;
+		dict->capacity = capacity;
+	}
+	size_t size = sizeof(struct column_string) + len;
+	struct column_string *string = malloc(size);
+	if (string == NULL) {
+		diag_set(OutOfMemory, size, "malloc", "struct column_string");
+		return -1;
+	}
+	string->len = len;
+	memcpy(string->data, str, len);
+	struct mh_strnptr_node_t node = {
+		string->data, len, hash, (void *)(uintptr_t)dict->count
+	};
+	if (mh_strnptr_put(dict->hash, &node, NULL, NULL) ==
+	    mh_end(dict->hash)) {
+		diag_set(OutOfMemory, sizeof(node), "malloc",
+			 "column dictionary");
+		free(string);
+		return -1;
+	}
+	dict->strings[dict->count] = string;
+	*code = dict->count++;
+	*bsize += size;
+	return 0;
+}
+
+static int
+column_string_cmp(const struct column_string *a,
+		  const struct column_string *b)
+{
+	int rc = memcmp(a->data, b->data, MIN(a->len, b->len));
+	return rc != 0 ? rc : (a->len > b->len) - (a->len < b->len);
+}
+
+struct column_table *
+column_table_new(const enum column_type *types, uint32_t column_count)
+{
+	struct column_table *table = calloc(1, sizeof(*table));
+	if (table == NULL) {
+		diag_set(OutOfMemory, sizeof(*table), "calloc",
+			 "struct column_table");
+		return NULL;
+	}
+	table->refs = 1;
+	table->column_count = column_count;
+	table->types = malloc(column_count * sizeof(*types));
+	table->dicts = calloc(column_count, sizeof(*table->dicts));
+	table->row = malloc(column_count * sizeof(*table->row));
+	table->row_is_big = malloc(column_count *
+				   sizeof(*table->row_is_big));
+	if (table->types == NULL || table->dicts == NULL ||
+	    table->row == NULL || table->row_is_big == NULL) {
+		diag_set(OutOfMemory, column_count * sizeof(*table->dicts),
+			 "malloc", "struct column_table");
+		goto fail;
+	}
+	memcpy(table->types, types, column_count * sizeof(*types));
+	for (uint32_t i = 0; i < column_count; i++) {
+		if (types[i] == COLUMN_STRING &&
+		    column_dict_create(&table->dicts[i]) != 0)
+			goto fail;
+	}
+	return table;
+fail:
+	column_table_unref(table);
+	return NULL;
+}
+
+void
+column_table_unref(struct column_table *table)
+{
+	assert(table->refs > 0);
+	if (--table->refs > 0)
+		return;
+	assert(table->view_count == 0);
+	for (uint32_t i = 0; i < table->group_count; i++)
+		column_group_delete(table->groups[i], table->column_count);
+	free(table->groups);
+	if (table->dicts != NULL) {
+		for (uint32_t i = 0; i < table->column_count; i++)
+			column_dict_destroy(&table->dicts[i]);
+	}
+	free(table->dicts);
+	free(table->types);
+	free(table->row);
+	free(table->row_is_big);
+	free(table);
+}
+
+bool
+column_table_has_same_columns(const struct column_table *a,
+			      const struct column_table *b)
+{
+	return a->column_count == b->column_count &&
+	       memcmp(a->types, b->types,
+		      a->column_count * sizeof(*a->types)) == 0;
+}
+
+/** Seal the groups that are full unless there are read views. */
+static void
+column_table_seal(struct column_table *table)
+{
+	while (table->view_count == 0 &&
+	       table->sealed_count < table->group_count) {
+		struct column_group *group = table->groups[table->sealed_count];
+		if (group->count < COLUMN_GROUP_SIZE)
+			break;
+		for (uint32_t i = 0; i < table->column_count; i++) {
+			table->bsize += column_chunk_encode(&group->chunks[i],
+							    table->types[i],
+							    group->count);
+		}
+		group->is_sealed = true;
+		table->sealed_count++;
+	}
+}
+
+static int
+column_table_add_group(struct column_table *table)
+{
+	if (table->group_count == table->group_capacity) {
+		uint32_t capacity = MAX(table->group_capacity * 2, 8U);
+		struct column_group **groups =
+			realloc(table->groups, capacity * sizeof(*groups));
+		if (groups == NULL) {
+			diag_set(OutOfMemory, capacity * sizeof(*groups),
+				 "realloc", "column groups");
+			return -1;
+		}
+		table->groups = groups;
+		table->group_capacity = capacity;
+	}
+	struct column_group *group = column_group_new(table->types,
+						      table->column_count);
+	if (group == NULL)
+		return -1;
+	table->groups[table->group_count++] = group;
+	return 0;
+}
+
+/**
+ * Decode a value of the given column, return its raw 64-bit
+ * representation stored in a chunk. Set @a is_big if it is an
+ * integer above INT64_MAX.
+ */
+static int
+column_table_decode(struct column_table *table, uint32_t column,
+		    const char **data, uint64_t *value, bool *is_big)
+{
+	*is_big = false;
+	enum column_type type = table->types[column];
+	enum mp_type mp_type = mp_typeof(**data);
+	switch (type) {
+	case COLUMN_UNSIGNED:
+		if (mp_type != MP_UINT)
+			break;
+		*value = mp_decode_uint(data);
+		return 0;
+	case COLUMN_INTEGER:
+		if (mp_type == MP_INT) {
+			*value = (uint64_t)mp_decode_int(data);
+			return 0;
+		}
+		if (mp_type != MP_UINT)
+			break;
+		*value = mp_decode_uint(data);
+		*is_big = *value > INT64_MAX;
+		return 0;
+	case COLUMN_DOUBLE: {
+		if (mp_type != MP_DOUBLE && mp_type != MP_FLOAT)
+			break;
+		double d;
+		if (mp_read_double(data, &d) != 0)
+			break;
+		memcpy(value, &d, sizeof(d));
+		return 0;
+	}
+	case COLUMN_STRING: {
+		if (mp_type != MP_STR)
+			break;
+		uint32_t len, code;
+		const char *str = mp_decode_str(data, &len);
+		if (column_dict_intern(&table->dicts[column], str, len,
+				       &code, &table->bsize) != 0)
+			return -1;
+		*value = code;
+		return 0;
+	}
+	case COLUMN_BOOLEAN:
+		if (mp_type != MP_BOOL)
+			break;
+		*value = mp_decode_bool(data);
+		return 0;
+	default:
+		unreachable();
+	}
+	diag_set(ClientError, ER_FIELD_TYPE,
+		 int2str(column + TUPLE_INDEX_BASE), column_type_strs[type]);
+	return -1;
+}
+
+int
+column_table_append(struct column_table *table, const char *data,
+		    const char *data_end, uint64_t *rowid)
+{
+	(void)data_end;
+	if (mp_typeof(*data) != MP_ARRAY) {
+		diag_set(ClientError, ER_TUPLE_NOT_ARRAY);
+		return -1;
+	}
+	uint32_t field_count = mp_decode_array(&data);
+	if (field_count != table->column_count) {
+		diag_set(ClientError, ER_EXACT_FIELD_COUNT,
+			 field_count, table->column_count);
+		return -1;
+	}
+	/*
+	 * Decode the whole row before storing anything so that
+	 * a bad field doesn't leave the columns misaligned.
+	 */
+	bool has_big = false;
+	for (uint32_t i = 0; i < field_count; i++) {
+		if (column_table_decode(table, i, &data, &table->row[i],
+					&table->row_is_big[i]) != 0)
+			return -1;
+		has_big |= table->row_is_big[i];
+	}
+	assert(data == data_end);
+	if (table->row_count == (uint64_t)table->group_count *
+				COLUMN_GROUP_SIZE &&
+	    column_table_add_group(table) != 0)
+		return -1;
+	struct column_group *group = table->groups[table->group_count - 1];
+	assert(group->count < COLUMN_GROUP_SIZE);
+	for (uint32_t i = 0; has_big && i < field_count; i++) {
+		struct column_chunk *chunk = &group->chunks[i];
+		if (!table->row_is_big[i] || chunk->big != NULL)
+			continue;
+		size_t size = sizeof(uint64_t[COLUMN_BITMAP_WORDS]);
+		chunk->big = calloc(1, size);
+		if (chunk->big == NULL) {
+			diag_set(OutOfMemory, size, "calloc", "column bitmap");
+			return -1;
+		}
+		table->bsize += size;
+	}
+	for (uint32_t i = 0; i < field_count; i++) {
+		enum column_type type = table->types[i];
+		column_value_set(group->chunks[i].values, type, group->count,
+				 table->row[i]);
+		if (table->row_is_big[i])
+			bit_set(group->chunks[i].big, group->count);
+		table->bsize += column_type_size[type];
+	}
+	group->count++;
+	*rowid = table->row_count++;
+	if (group->count == COLUMN_GROUP_SIZE)
+		column_table_seal(table);
+	return 0;
+}
+
+void
+column_table_delete(struct column_table *table, uint64_t rowid)
+{
+	assert(rowid < table->row_count);
+	struct column_group *group = table->groups[rowid / COLUMN_GROUP_SIZE];
+	if (bit_set(group->deleted, rowid % COLUMN_GROUP_SIZE))
+		return;
+	group->deleted_count++;
+	table->deleted_count++;
+}
+
+/*
+ * Aggregation loops. They are kept simple and branch-free
+ * where possible, so that the compiler vectorizes them.
+ * Sums of integers are accumulated separately for the low
+ * and high 32-bit halves of values, which can't overflow a
+ * 64-bit accumulator within a group, and are then folded
+ * into a 96-bit total.
+ */
+
+enum { COLUMN_LOW32_MASK = 0xFFFFFFFFu };
+
+static void
+column_sum_u64(const uint64_t *v, uint32_t n, const uint64_t *deleted,
+	       struct int96_num *sum)
+{
+	uint64_t lo = 0, hi = 0;
+	if (deleted == NULL) {
+		for (uint32_t i = 0; i < n; i++) {
+			lo += v[i] & COLUMN_LOW32_MASK;
+			hi += v[i] >> 32;
+		}
+	} else {
+		for (uint32_t i = 0; i < n; i++) {
+			uint64_t keep = (uint64_t)bit_test(deleted, i) - 1;
+			lo += v[i] & COLUMN_LOW32_MASK & keep;
+			hi += (v[i] >> 32) & keep;
+		}
+	}
+	struct int96_num part;
+	part.high64 = hi + (lo >> 32);
+	part.low32 = lo & COLUMN_LOW32_MASK;
+	int96_add(sum, &part);
+}
+
+static void
+column_sum_i64(const int64_t *v, uint32_t n, const uint64_t *deleted,
+	       struct int96_num *sum)
+{
+	uint64_t lo = 0;
+	int64_t hi = 0;
+	if (deleted == NULL) {
+		for (uint32_t i = 0; i < n; i++) {
+			lo += (uint64_t)v[i] & COLUMN_LOW32_MASK;
+			hi += v[i] >> 32;
+		}
+	} else {
+		for (uint32_t i = 0; i < n; i++) {
+			uint64_t keep = (uint64_t)bit_test(deleted, i) - 1;
+			lo += (uint64_t)v[i] & COLUMN_LOW32_MASK & keep;
+			hi += (v[i] >> 32) & (int64_t)keep;
+		}
+	}
+	struct int96_num part;
+	part.high64 = (uint64_t)hi + (lo >> 32);
+	part.low32 = lo & COLUMN_LOW32_MASK;
+	int96_add(sum, &part);
+}
+
+static double
+column_sum_double(const double *v, uint32_t n, const uint64_t *deleted)
+{
+	double acc[4] = {0, 0, 0, 0};
+	uint32_t i = 0;
+	if (deleted == NULL) {
+		for (; i + 4 <= n; i += 4) {
+			acc[0] += v[i];
+			acc[1] += v[i + 1];
+			acc[2] += v[i + 2];
+			acc[3] += v[i + 3];
+		}
+	}
+	for (; i < n; i++) {
+		if (deleted == NULL || !bit_test(deleted, i))
+			acc[0] += v[i];
+	}
+	return (acc[0] + acc[1]) + (acc[2] + acc[3]);
+}
+
+static void
+column_sum_runs(const void *values, const uint32_t *ends, uint32_t run_count,
+		enum column_type type, struct int96_num *sum, double *dsum)
+{
+	uint32_t begin = 0;
+	if (type == COLUMN_DOUBLE) {
+		const double *v = values;
+		for (uint32_t r = 0; r < run_count; r++) {
+			*dsum += v[r] * (ends[r] - begin);
+			begin = ends[r];
+		}
+		return;
+	}
+	uint64_t lo = 0, hi = 0;
+	const uint64_t *v = values;
+	for (uint32_t r = 0; r < run_count; r++) {
+		uint64_t len = ends[r] - begin;
+		begin = ends[r];
+		lo += (v[r] & COLUMN_LOW32_MASK) * len;
+		if (type == COLUMN_INTEGER)
+			hi += (uint64_t)(((int64_t)v[r] >> 32) * (int64_t)len);
+		else
+			hi += (v[r] >> 32) * len;
+	}
+	struct int96_num part;
+	part.high64 = hi + (lo >> 32);
+	part.low32 = lo & COLUMN_LOW32_MASK;
+	int96_add(sum, &part);
+}
+
+#define COLUMN_MINMAX(suffix, T)					\
+static void								\
+column_minmax_##suffix(const T *v, uint32_t n, const uint64_t *deleted,	\
+		       T *min, T *max)					\
+{									\
+	T lo = *min, hi = *max;						\
+	if (deleted == NULL) {						\
+		for (uint32_t i = 0; i < n; i++) {			\
+			lo = v[i] < lo ? v[i] : lo;			\
+			hi = v[i] > hi ? v[i] : hi;			\
+		}							\
+	} else {							\
+		for (uint32_t i = 0; i < n; i++) {			\
+			if (bit_test(deleted, i))			\
+				continue;				\
+			lo = v[i] < lo ? v[i] : lo;			\
+			hi = v[i] > hi ? v[i] : hi;			\
+		}							\
+	}								\
+	*min = lo;							\
+	*max = hi;							\
+}
+
+COLUMN_MINMAX(u64, uint64_t)
+COLUMN_MINMAX(i64, int64_t)
+COLUMN_MINMAX(double, double)
+COLUMN_MINMAX(u8, uint8_t)
+
+#undef COLUMN_MINMAX
+
+/** State of aggregation over a numeric or boolean column. */
+struct column_acc {
+	enum column_type type;
+	enum column_aggregate_op op;
+	struct int96_num sum;
+	double dsum;
+	/**
+	 * Min and max of an unsigned column or of the values
+	 * of an integer column that are above INT64_MAX.
+	 */
+	uint64_t umin, umax;
+	/** Number of values above INT64_MAX, not deleted. */
+	uint64_t big_count;
+	int64_t imin, imax;
+	double dmin, dmax;
+	uint8_t bmin, bmax;
+};
+
+static void
+column_acc_create(struct column_acc *acc, enum column_type type,
+		  enum column_aggregate_op op)
+{
+	acc->type = type;
+	acc->op = op;
+	int96_set_unsigned(&acc->sum, 0);
+	acc->dsum = 0;
+	acc->umin = UINT64_MAX;
+	acc->umax = 0;
+	acc->big_count = 0;
+	acc->imin = INT64_MAX;
+	acc->imax = INT64_MIN;
+	acc->dmin = HUGE_VAL;
+	acc->dmax = -HUGE_VAL;
+	acc->bmin = 1;
+	acc->bmax = 0;
+}
+
+/** Add @a n plain values, except deleted ones, to the state. */
+static void
+column_acc_add(struct column_acc *acc, const void *values, uint32_t n,
+	       const uint64_t *deleted)
+{
+	if (acc->op == COLUMN_AGGREGATE_SUM) {
+		switch (acc->type) {
+		case COLUMN_UNSIGNED:
+			column_sum_u64(values, n, deleted, &acc->sum);
+			break;
+		case COLUMN_INTEGER:
+			column_sum_i64(values, n, deleted, &acc->sum);
+			break;
+		case COLUMN_DOUBLE:
+			acc->dsum += column_sum_double(values, n, deleted);
+			break;
+		default:
+			unreachable();
+		}
+		return;
+	}
+	switch (acc->type) {
+	case COLUMN_UNSIGNED:
+		column_minmax_u64(values, n, deleted, &acc->umin, &acc->umax);
+		break;
+	case COLUMN_INTEGER:
+		column_minmax_i64(values, n, deleted, &acc->imin, &acc->imax);
+		break;
+	case COLUMN_DOUBLE:
+		column_minmax_double(values, n, deleted,
+				     &acc->dmin, &acc->dmax);
+		break;
+	case COLUMN_BOOLEAN:
+		column_minmax_u8(values, n, deleted, &acc->bmin, &acc->bmax);
+		break;
+	default:
+		unreachable();
+	}
+}
+
+/** Add an encoded chunk without deleted rows to the state. */
+static void
+column_acc_add_runs(struct column_acc *acc, const struct column_chunk *chunk)
+{
+	if (acc->op == COLUMN_AGGREGATE_SUM) {
+		column_sum_runs(chunk->values, chunk->run_ends,
+				chunk->run_count, acc->type,
+				&acc->sum, &acc->dsum);
+		return;
+	}
+	/* Min and max of runs are those of the values. */
+	column_acc_add(acc, chunk->values, chunk->run_count, NULL);
+}
+
+/**
+ * Add @a n values of an integer chunk that has values above
+ * INT64_MAX, marked in @a big, except deleted ones, to the
+ * state. It is rare, so a plain loop will do.
+ */
+static void
+column_acc_add_big(struct column_acc *acc, const int64_t *values,
+		   uint32_t n, const uint64_t *deleted, const uint64_t *big)
+{
+	assert(acc->type == COLUMN_INTEGER);
+	uint64_t big_count = 0;
+	for (uint32_t i = 0; i < n; i++) {
+		if (deleted != NULL && bit_test(deleted, i))
+			continue;
+		if (!bit_test(big, i)) {
+			acc->imin = MIN(acc->imin, values[i]);
+			acc->imax = MAX(acc->imax, values[i]);
+			continue;
+		}
+		uint64_t value = (uint64_t)values[i];
+		acc->umin = MIN(acc->umin, value);
+		acc->umax = MAX(acc->umax, value);
+		big_count++;
+	}
+	acc->big_count += big_count;
+	if (acc->op != COLUMN_AGGREGATE_SUM)
+		return;
+	column_sum_i64(values, n, deleted, &acc->sum);
+	/* A big value was summed as itself minus 2^64. */
+	struct int96_num part;
+	part.high64 = big_count << 32;
+	part.low32 = 0;
+	int96_add(&acc->sum, &part);
+}
+
+static void
+column_acc_result(const struct column_acc *acc, uint64_t count,
+		  struct column_value *result)
+{
+	result->type = acc->type;
+	result->is_null = false;
+	if (acc->op == COLUMN_AGGREGATE_SUM) {
+		if (acc->type == COLUMN_DOUBLE) {
+			result->d = acc->dsum;
+		} else if (int96_is_uint64(&acc->sum)) {
+			result->type = COLUMN_UNSIGNED;
+			result->u = int96_extract_uint64(&acc->sum);
+		} else if (int96_is_neg_int64(&acc->sum)) {
+			result->type = COLUMN_INTEGER;
+			result->i = int96_extract_neg_int64(&acc->sum);
+		} else {
+			/* Out of the 64-bit range, approximate. */
+			result->type = COLUMN_DOUBLE;
+			result->d = (double)(int64_t)acc->sum.high64 *
+				    ((double)COLUMN_LOW32_MASK + 1) +
+				    (double)acc->sum.low32;
+		}
+		return;
+	}
+	if (count == 0) {
+		result->is_null = true;
+		return;
+	}
+	bool is_min = acc->op == COLUMN_AGGREGATE_MIN;
+	switch (acc->type) {
+	case COLUMN_UNSIGNED:
+		result->u = is_min ? acc->umin : acc->umax;
+		break;
+	case COLUMN_INTEGER:
+		/* Values above INT64_MAX are greater than others. */
+		if (is_min ? acc->big_count == count : acc->big_count > 0) {
+			result->type = COLUMN_UNSIGNED;
+			result->u = is_min ? acc->umin : acc->umax;
+		} else {
+			result->i = is_min ? acc->imin : acc->imax;
+		}
+		break;
+	case COLUMN_DOUBLE:
+		result->d = is_min ? acc->dmin : acc->dmax;
+		break;
+	case COLUMN_BOOLEAN:
+		result->b = is_min ? acc->bmin : acc->bmax;
+		break;
+	default:
+		unreachable();
+	}
+}
+
+/** Buffer for decoding an encoded chunk on aggregation. */
+static uint64_t column_decode_buf[COLUMN_GROUP_SIZE];
+
+/** min() and max() of a string column. */
+static void
+column_table_minmax_string(struct column_table *table, uint32_t column,
+			   enum column_aggregate_op op,
+			   struct column_value *result)
+{
+	struct column_string **strings = table->dicts[column].strings;
+	const struct column_string *best = NULL;
+	uint32_t best_code = UINT32_MAX;
+	int sign = op == COLUMN_AGGREGATE_MIN ? -1 : 1;
+	for (uint32_t g = 0; g < table->group_count; g++) {
+		struct column_group *group = table->groups[g];
+		if (group->deleted_count == group->count)
+			continue;
+		const struct column_chunk *chunk = &group->chunks[column];
+		const uint64_t *deleted = group->deleted_count > 0 ?
+					  group->deleted : NULL;
+		const uint32_t *codes = chunk->values;
+		uint32_t n = group->count;
+		if (chunk->run_count > 0 && deleted == NULL) {
+			n = chunk->run_count;
+		} else if (chunk->run_count > 0) {
+			codes = column_chunk_decode(chunk, COLUMN_STRING, n,
+						    column_decode_buf);
+		}
+		for (uint32_t i = 0; i < n; i++) {
+			if (codes[i] == best_code ||
+			    (deleted != NULL && bit_test(deleted, i)))
+				continue;
+			const struct column_string *s = strings[codes[i]];
+			if (best == NULL ||
+			    column_string_cmp(s, best) * sign > 0) {
+				best = s;
+				best_code = codes[i];
+			}
+		}
+	}
+	result->type = COLUMN_STRING;
+	result->is_null = best == NULL;
+	if (best != NULL) {
+		result->str.data = best->data;
+		result->str.len = best->len;
+	}
+}
+
+int
+column_table_aggregate(struct column_table *table, uint32_t column,
+		       enum column_aggregate_op op,
+		       struct column_value *result)
+{
+	assert(column < table->column_count);
+	enum column_type type = table->types[column];
+	if (op == COLUMN_AGGREGATE_COUNT) {
+		result->type = COLUMN_UNSIGNED;
+		result->is_null = false;
+		result->u = column_table_size(table);
+		return 0;
+	}
+	if (op == COLUMN_AGGREGATE_SUM &&
+	    (type == COLUMN_STRING || type == COLUMN_BOOLEAN)) {
+		diag_set(ClientError, ER_UNSUPPORTED, "sum()",
+			 tt_sprintf("%s columns", column_type_strs[type]));
+		return -1;
+	}
+	if (type == COLUMN_STRING) {
+		column_table_minmax_string(table, column, op, result);
+		return 0;
+	}
+	struct column_acc acc;
+	column_acc_create(&acc, type, op);
+	for (uint32_t g = 0; g < table->group_count; g++) {
+		struct column_group *group = table->groups[g];
+		if (group->deleted_count == group->count)
+			continue;
+		const struct column_chunk *chunk = &group->chunks[column];
+		const uint64_t *deleted = group->deleted_count > 0 ?
+					  group->deleted : NULL;
+		if (chunk->run_count > 0 && deleted == NULL) {
+			column_acc_add_runs(&acc, chunk);
+			continue;
+		}
+		if (chunk->big != NULL) {
+			column_acc_add_big(&acc, chunk->values, group->count,
+					   deleted, chunk->big);
+			continue;
+		}
+		const void *values = chunk->values;
+		if (chunk->run_count > 0) {
+			values = column_chunk_decode(chunk, type, group->count,
+						     column_decode_buf);
+		}
+		column_acc_add(&acc, values, group->count, deleted);
+	}
+	column_acc_result(&acc, column_table_size(table), result);
+	return 0;
+}
+
+int
+column_view_create(struct column_view *view, struct column_table *table)
+{
+	memset(view, 0, sizeof(*view));
+	uint32_t column_count = table->column_count;
+	view->column_count = column_count;
+	view->groups = malloc(MAX(table->group_count, 1U) *
+			      sizeof(*view->groups));
+	view->deleted = malloc(MAX(table->group_count, 1U) *
+			       sizeof(*view->deleted));
+	view->strings = calloc(column_count, sizeof(*view->strings));
+	view->values = calloc(column_count, sizeof(*view->values));
+	view->decoded = calloc(column_count, sizeof(*view->decoded));
+	if (view->groups == NULL || view->deleted == NULL ||
+	    view->strings == NULL || view->values == NULL ||
+	    view->decoded == NULL) {
+		diag_set(OutOfMemory, column_count * sizeof(void *),
+			 "malloc", "struct column_view");
+		goto fail;
+	}
+	for (uint32_t i = 0; i < column_count; i++) {
+		enum column_type type = table->types[i];
+		size_t size = COLUMN_GROUP_SIZE * column_type_size[type];
+		view->decoded[i] = malloc(size);
+		if (view->decoded[i] == NULL) {
+			diag_set(OutOfMemory, size, "malloc", "column chunk");
+			goto fail;
+		}
+		if (type != COLUMN_STRING)
+			continue;
+		struct column_dict *dict = &table->dicts[i];
+		size = MAX(dict->count, 1U) * sizeof(*dict->strings);
+		view->strings[i] = malloc(size);
+		if (view->strings[i] == NULL) {
+			diag_set(OutOfMemory, size, "malloc",
+				 "column dictionary");
+			goto fail;
+		}
+		memcpy(view->strings[i], dict->strings,
+		       dict->count * sizeof(*dict->strings));
+	}
+	/*
+	 * Rows of any group can be deleted on rollback, and big
+	 * values can be added to the last group, so the bitmaps
+	 * are copied rather than read while they are written.
+	 */
+	struct column_group *last = table->group_count == 0 ? NULL :
+				    table->groups[table->group_count - 1];
+	for (uint32_t i = 0; last != NULL && i < column_count; i++) {
+		const uint64_t *big = last->chunks[i].big;
+		if (big == NULL)
+			continue;
+		if (view->last_big == NULL) {
+			view->last_big = calloc(column_count,
+						sizeof(*view->last_big));
+			if (view->last_big == NULL) {
+				diag_set(OutOfMemory, column_count *
+					 sizeof(*view->last_big), "calloc",
+					 "column bitmap");
+				goto fail;
+			}
+		}
+		memcpy(view->last_big[i], big, sizeof(view->last_big[i]));
+	}
+	for (uint32_t g = 0; g < table->group_count; g++) {
+		memcpy(view->deleted[g], table->groups[g]->deleted,
+		       sizeof(view->deleted[g]));
+	}
+	memcpy(view->groups, table->groups,
+	       table->group_count * sizeof(*view->groups));
+	view->group_count = table->group_count;
+	view->row_count = table->row_count;
+	view->table = table;
+	column_table_ref(table);
+	table->view_count++;
+	return 0;
+fail:
+	column_view_destroy(view);
+	return -1;
+}
+
+void
+column_view_destroy(struct column_view *view)
+{
+	for (uint32_t i = 0; i < view->column_count; i++) {
+		if (view->strings != NULL)
+			free(view->strings[i]);
+		if (view->decoded != NULL)
+			free(view->decoded[i]);
+	}
+	free(view->strings);
+	free(view->values);
+	free(view->decoded);
+	free(view->groups);
+	free(view->deleted);
+	free(view->last_big);
+	free(view->buf);
+	struct column_table *table = view->table;
+	if (table != NULL) {
+		assert(table->view_count > 0);
+		table->view_count--;
+		column_table_seal(table);
+		column_table_unref(table);
+	}
+	memset(view, 0, sizeof(*view));
+}
+
+/** Set up pointers to the values of the current group. */
+static void
+column_view_load_group(struct column_view *view, uint32_t count)
+{
+	struct column_table *table = view->table;
+	struct column_group *group = view->groups[view->group_no];
+	for (uint32_t i = 0; i < table->column_count; i++) {
+		struct column_chunk *chunk = &group->chunks[i];
+		if (chunk->run_count == 0) {
+			view->values[i] = chunk->values;
+			continue;
+		}
+		view->values[i] = column_chunk_decode(chunk, table->types[i],
+						      count, view->decoded[i]);
+	}
+}
+
+/**
+ * Return true if a row of the current group stores a value
+ * above INT64_MAX in an integer column.
+ */
+static bool
+column_view_is_big(const struct column_view *view, uint32_t column,
+		   uint32_t row_no)
+{
+	if (view->group_no + 1 < view->group_count) {
+		const uint64_t *big =
+			view->groups[view->group_no]->chunks[column].big;
+		return big != NULL && bit_test(big, row_no);
+	}
+	return view->last_big != NULL &&
+	       bit_test(view->last_big[column], row_no);
+}
+
+int
+column_view_next(struct column_view *view, const char **data,
+		 uint32_t *size)
+{
+	struct column_table *table = view->table;
+	uint32_t row_no = 0;
+	while (true) {
+		uint64_t begin = (uint64_t)view->group_no * COLUMN_GROUP_SIZE;
+		if (begin >= view->row_count) {
+			*data = NULL;
+			*size = 0;
+			return 0;
+		}
+		uint32_t count = MIN(view->row_count - begin,
+				     (uint64_t)COLUMN_GROUP_SIZE);
+		if (view->row_no == 0)
+			column_view_load_group(view, count);
+		if (view->row_no == count) {
+			view->group_no++;
+			view->row_no = 0;
+			continue;
+		}
+		row_no = view->row_no++;
+		if (!bit_test(view->deleted[view->group_no], row_no))
+			break;
+	}
+	size_t bsize = mp_sizeof_array(table->column_count);
+	for (uint32_t i = 0; i < table->column_count; i++) {
+		if (table->types[i] != COLUMN_STRING) {
+			bsize += 9;
+			continue;
+		}
+		uint32_t code = ((const uint32_t *)view->values[i])[row_no];
+		bsize += mp_sizeof_str(view->strings[i][code]->len);
+	}
+	if (bsize > view->buf_size) {
+		char *buf = realloc(view->buf, bsize);
+		if (buf == NULL) {
+			diag_set(OutOfMemory, bsize, "realloc",
+				 "column row");
+			return -1;
+		}
+		view->buf = buf;
+		view->buf_size = bsize;
+	}
+	char *pos = mp_encode_array(view->buf, table->column_count);
+	for (uint32_t i = 0; i < table->column_count; i++) {
+		enum column_type type = table->types[i];
+		uint64_t value = column_value_get(view->values[i], type,
+						  row_no);
+		switch (type) {
+		case COLUMN_UNSIGNED:
+			pos = mp_encode_uint(pos, value);
+			break;
+		case COLUMN_INTEGER:
+			if ((int64_t)value < 0 &&
+			    !column_view_is_big(view, i, row_no))
+				pos = mp_encode_int(pos, (int64_t)value);
+			else
+				pos = mp_encode_uint(pos, value);
+			break;
+		case COLUMN_DOUBLE: {
+			double d;
+			memcpy(&d, &value, sizeof(d));
+			pos = mp_encode_double(pos, d);
+			break;
+		}
+		case COLUMN_STRING: {
+			const struct column_string *s =
+				view->strings[i][value];
+			pos = mp_encode_str(pos, s->data, s->len);
+			break;
+		}
+		case COLUMN_BOOLEAN:
+			pos = mp_encode_bool(pos, value != 0);
+			break;
+		default:
+			unreachable();
+		}
+	}
+	assert((size_t)(pos - view->buf) <= bsize);
+	*data = view->buf;
+	*size = pos - view->buf;
+	return 0;
+}
@@ -0,0 +1,329 @@
+#ifndef TARANTOOL_BOX_COLUMN_STORE_H_INCLUDED
+#define TARANTOOL_BOX_COLUMN_STORE_H_INCLUDED
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "field_def.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+/**
+ * Column-wise storage of an append-only table.
+ *
+ * Rows are split into groups of COLUMN_GROUP_SIZE. Each group
+ * keeps one typed array (chunk) per column, so that a scan over
+ * a column walks contiguous memory and aggregation loops can be
+ * vectorized by the compiler. Strings are dictionary encoded:
+ * a chunk stores 32-bit codes, the strings themselves are kept
+ * once per column. When a group fills up it is sealed: chunks
+ * that have long runs of equal values are run-length encoded.
+ *
+ * Rows are never updated. A row can only be marked deleted in
+ * the group bitmap, which is how rolled back inserts are undone.
+ *
+ * Integer values are stored as int64_t. Values above INT64_MAX
+ * are stored as is and marked in a bitmap of the chunk, which
+ * is only allocated if the chunk has such values.
+ *
+ * A read view freezes the table for a consistent scan from
+ * another thread: it copies the group and dictionary arrays and
+ * the bitmaps that can still change, and defers sealing, which
+ * is the only operation that frees data of an existing group,
+ * until the view is destroyed.
+ */
+
+enum {
+	/** Number of rows in a row group. */
+	COLUMN_GROUP_SIZE = 4096,
+	/** Number of words in a bitmap of rows of a group. */
+	COLUMN_BITMAP_WORDS = COLUMN_GROUP_SIZE / 64,
+};
+
+/** Physical type of a column. */
+enum column_type {
+	COLUMN_UNSIGNED,
+	COLUMN_INTEGER,
+	COLUMN_DOUBLE,
+	COLUMN_STRING,
+	COLUMN_BOOLEAN,
+	column_type_MAX,
+};
+
+extern const char *column_type_strs[];
+
+/**
+ * Return the column type used to store a field of the given
+ * type or column_type_MAX if the field type is not supported.
+ */
+enum column_type
+column_type_by_field_type(enum field_type type);
+
+/** Aggregate function. */
+enum column_aggregate_op {
+	COLUMN_AGGREGATE_COUNT,
+	COLUMN_AGGREGATE_SUM,
+	COLUMN_AGGREGATE_MIN,
+	COLUMN_AGGREGATE_MAX,
+	column_aggregate_op_MAX,
+};
+
+extern const char *column_aggregate_op_strs[];
+
+/** Result of an aggregate function. */
+struct column_value {
+	/**
+	 * Type of the value. COLUMN_DOUBLE for a sum that does
+	 * not fit in 64 bits.
+	 */
+	enum column_type type;
+	/** Set if there is no value, e.g. min() of no rows. */
+	bool is_null;
+	union {
+		uint64_t u;
+		int64_t i;
+		double d;
+		bool b;
+		struct {
+			const char *data;
+			uint32_t len;
+		} str;
+	};
+};
+
+/** A string stored in a column dictionary. */
+struct column_string {
+	uint32_t len;
+	char data[0];
+};
+
+/** A column of a row group. */
+struct column_chunk {
+	/**
+	 * Array of values if the chunk is plain or of run
+	 * values if it is run-length encoded.
+	 */
+	void *values;
+	/** Number of runs, 0 unless the chunk is encoded. */
+	uint32_t run_count;
+	/** Exclusive ends of runs, NULL unless encoded. */
+	uint32_t *run_ends;
+	/**
+	 * Bitmap of rows of an integer chunk that store values
+	 * above INT64_MAX, NULL if there are no such rows. A
+	 * chunk with such values is never encoded.
+	 */
+	uint64_t *big;
+};
+
+/** A group of rows. */
+struct column_group {
+	/** Number of rows, including deleted ones. */
+	uint32_t count;
+	/** Number of rows marked deleted. */
+	uint32_t deleted_count;
+	/** Set once the group is full and encoded. */
+	bool is_sealed;
+	/** Bitmap of deleted rows. */
+	uint64_t deleted[COLUMN_BITMAP_WORDS];
+	/** Chunks, one per column. */
+	struct column_chunk chunks[0];
+};
+
+/** Dictionary of a string column. */
+struct column_dict {
+	/** Strings, indexed by code. */
+	struct column_string **strings;
+	uint32_t count;
+	uint32_t capacity;
+	/** String -> code map. */
+	struct mh_strnptr_t *hash;
+};
+
+/** Column-wise table. */
+struct column_table {
+	/** Reference counter, the table is shared with views. */
+	int refs;
+	/** Number of read views open on the table. */
+	int view_count;
+	/** Number of columns. */
+	uint32_t column_count;
+	/** Column types. */
+	enum column_type *types;
+	/** Dictionaries, allocated for string columns only. */
+	struct column_dict *dicts;
+	/** Row groups. */
+	struct column_group **groups;
+	uint32_t group_count;
+	uint32_t group_capacity;
+	/** Number of leading groups that are sealed. */
+	uint32_t sealed_count;
+	/** Number of rows, including deleted ones. */
+	uint64_t row_count;
+	/** Number of rows marked deleted. */
+	uint64_t deleted_count;
+	/** Size of data, in bytes. */
+	size_t bsize;
+	/** Scratch space for decoding a row, a slot per column. */
+	uint64_t *row;
+	/** Set for the decoded values above INT64_MAX. */
+	bool *row_is_big;
+};
+
+/**
+ * Create a table with the given column types.
+ * The table is returned referenced.
+ * @retval NULL memory error, check diag
+ */
+struct column_table *
+column_table_new(const enum column_type *types, uint32_t column_count);
+
+static inline void
+column_table_ref(struct column_table *table)
+{
+	table->refs++;
+}
+
+void
+column_table_unref(struct column_table *table);
+
+/** Return true if both tables have the same columns. */
+bool
+column_table_has_same_columns(const struct column_table *a,
+			      const struct column_table *b);
+
+/**
+ * Append a row given as a MsgPack array with exactly one
+ * field per column, store its number in @a rowid.
+ * @retval 0 success
+ * @retval -1 the row doesn't match the columns or memory
+ *            error, check diag
+ */
+int
+column_table_append(struct column_table *table, const char *data,
+		    const char *data_end, uint64_t *rowid);
+
+/** Mark a row deleted. Doesn't fail. */
+void
+column_table_delete(struct column_table *table, uint64_t rowid);
+
+/** Return the number of rows that are not deleted. */
+static inline uint64_t
+column_table_size(const struct column_table *table)
+{
+	return table->row_count - table->deleted_count;
+}
+
+/**
+ * Compute an aggregate function over a column, skipping
+ * deleted rows. The string returned by min() and max()
+ * points into the table dictionary.
+ * @retval 0 success
+ * @retval -1 the function is not applicable to the column
+ *            type, check diag
+ */
+int
+column_table_aggregate(struct column_table *table, uint32_t column,
+		       enum column_aggregate_op op,
+		       struct column_value *result);
+
+/**
+ * Frozen state of a table that can be scanned row by row from
+ * any thread, while the table is being appended to.
+ */
+struct column_view {
+	struct column_table *table;
+	/** Number of columns, same as in the table. */
+	uint32_t column_count;
+	/** Number of rows visible in the view. */
+	uint64_t row_count;
+	/** Copy of the group array. */
+	struct column_group **groups;
+	uint32_t group_count;
+	/** Copy of the deleted row bitmaps, per group. */
+	uint64_t (*deleted)[COLUMN_BITMAP_WORDS];
+	/**
+	 * Copy of the big value bitmaps of the last group, which
+	 * is still appended to, per column. NULL if the group has
+	 * no big values.
+	 */
+	uint64_t (*last_big)[COLUMN_BITMAP_WORDS];
+	/** Copy of the dictionaries, per column. */
+	struct column_string ***strings;
+	/** Position of the scan. */
+	uint32_t group_no;
+	uint32_t row_no;
+	/** Values of the current group, per column. */
+	const void **values;
+	/** Buffers for decoding encoded chunks, per column. */
+	void **decoded;
+	/** Buffer for the row returned by next(). */
+	char *buf;
+	size_t buf_size;
+};
+
+/**
+ * Create a read view of a table.
+ * Must be called from the thread owning the table.
+ * @retval 0 success
+ * @retval -1 memory error, check diag
+ */
+int
+column_view_create(struct column_view *view, struct column_table *table);
+
+/**
+ * Destroy a read view, seal the groups that filled up while
+ * the view was open. Must be called from the thread owning
+ * the table.
+ */
+void
+column_view_destroy(struct column_view *view);
+
+/**
+ * Return the next row of a view that isn't deleted, encoded
+ * as a MsgPack array. The data stays valid until the next
+ * call. Sets @a data to NULL at the end of the view.
+ * @retval 0 success
+ * @retval -1 memory error, check diag
+ */
+int
+column_view_next(struct column_view *view, const char **data,
+		 uint32_t *size);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_BOX_COLUMN_STORE_H_INCLUDED */
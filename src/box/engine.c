@@ -216,6 +216,35 @@ engine_join(struct engine_join_ctx *ctx, struct xstream *stream)
 	return 0;
 }
 
+int
+engine_split_join(struct engine_join_ctx *ctx, int stream_count)
+{
+	int i = 0;
+	struct engine *engine;
+	engine_foreach(engine) {
+		if (engine->vtab->split_join(engine, ctx->array[i],
+					     stream_count) != 0)
+			return -1;
+		i++;
+	}
+	return 0;
+}
+
+int
+engine_join_stream(struct engine_join_ctx *ctx, int stream_id,
+		   struct xstream *stream)
+{
+	int i = 0;
+	struct engine *engine;
+	engine_foreach(engine) {
+		if (engine->vtab->join_stream(engine, ctx->array[i],
+					      stream_id, stream) != 0)
+			return -1;
+		i++;
+	}
+	return 0;
+}
+
 void
 engine_complete_join(struct engine_join_ctx *ctx)
 {
@@ -265,6 +294,26 @@ generic_engine_join(struct engine *engine, void *ctx, struct xstream *stream)
 	return 0;
 }
 
+int
+generic_engine_split_join(struct engine *engine, void *ctx, int stream_count)
+{
+	(void)engine;
+	(void)ctx;
+	(void)stream_count;
+	return 0;
+}
+
+int
+generic_engine_join_stream(struct engine *engine, void *ctx, int stream_id,
+			   struct xstream *stream)
+{
+	(void)engine;
+	(void)ctx;
+	(void)stream_id;
+	(void)stream;
+	return 0;
+}
+
 void
 generic_engine_complete_join(struct engine *engine, void *ctx)
 {
@@ -84,6 +84,21 @@ struct engine_vtab {
 	 * the given stream.
 	 */
 	int (*join)(struct engine *engine, void *ctx, struct xstream *stream);
+	/**
+	 * Distribute the data of the read view among the given
+	 * number of streams so that it can be sent to the replica
+	 * over several connections in parallel. Stream 0 is fed
+	 * by join(), the others by join_stream(). The data an
+	 * engine doesn't assign to any stream other than 0 is
+	 * sent by join().
+	 */
+	int (*split_join)(struct engine *engine, void *ctx, int stream_count);
+	/**
+	 * Feed the part of the read view assigned to the given
+	 * stream by split_join() to the given xstream.
+	 */
+	int (*join_stream)(struct engine *engine, void *ctx, int stream_id,
+			   struct xstream *stream);
 	/**
 	 * Release the read view and free the context prepared
 	 * on the first step.
@@ -350,6 +365,21 @@ engine_prepare_join(struct engine_join_ctx *ctx);
 int
 engine_join(struct engine_join_ctx *ctx, struct xstream *stream);
 
+/**
+ * Split the data of a read view prepared for an initial join
+ * among the given number of streams.
+ */
+int
+engine_split_join(struct engine_join_ctx *ctx, int stream_count);
+
+/**
+ * Feed the part of a read view assigned to the given stream
+ * by engine_split_join() to the given xstream.
+ */
+int
+engine_join_stream(struct engine_join_ctx *ctx, int stream_id,
+		   struct xstream *stream);
+
 void
 engine_complete_join(struct engine_join_ctx *ctx);
 
@@ -382,6 +412,8 @@ engine_reset_stat(void);
  */
 int generic_engine_prepare_join(struct engine *, void **);
 int generic_engine_join(struct engine *, void *, struct xstream *);
+int generic_engine_split_join(struct engine *, void *, int);
+int generic_engine_join_stream(struct engine *, void *, int, struct xstream *);
 void generic_engine_complete_join(struct engine *, void *);
 int generic_engine_begin(struct engine *, struct txn *);
 int generic_engine_begin_statement(struct engine *, struct txn *);
@@ -499,6 +531,21 @@ engine_join_xc(struct engine_join_ctx *ctx, struct xstream *stream)
 		diag_raise();
 }
 
+static inline void
+engine_split_join_xc(struct engine_join_ctx *ctx, int stream_count)
+{
+	if (engine_split_join(ctx, stream_count) != 0)
+		diag_raise();
+}
+
+static inline void
+engine_join_stream_xc(struct engine_join_ctx *ctx, int stream_id,
+		      struct xstream *stream)
+{
+	if (engine_join_stream(ctx, stream_id, stream) != 0)
+		diag_raise();
+}
+
 #endif /* defined(__cplusplus) */
 
 #endif /* TARANTOOL_BOX_ENGINE_H_INCLUDED */
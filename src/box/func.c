@@ -40,6 +40,9 @@
 #include "port.h"
 #include "schema.h"
 #include "session.h"
+#include "txn.h"
+#include "coio_task.h"
+#include "msgpuck.h"
 #include <dlfcn.h>
 
 /**
@@ -505,6 +508,146 @@ func_c_load(struct func_c *func)
 	return 0;
 }
 
+/**
+ * Results of a C function executed in a worker thread. The
+ * port_c entry pool belongs to TX, so values are gathered in
+ * a malloc()ed buffer one after another and moved to the port
+ * when the function is finished.
+ */
+struct func_offload_result {
+	/** Returned values, encoded in msgpack. */
+	char *data;
+	/** Size of the encoded values. */
+	size_t size;
+	/** Size of the allocated buffer. */
+	size_t capacity;
+	/** Number of values. */
+	uint32_t count;
+};
+
+int
+func_offload_result_add(struct func_offload_result *result,
+			const char *mp, const char *mp_end)
+{
+	size_t size = mp_end - mp;
+	if (result->size + size > result->capacity) {
+		size_t capacity = MAX(result->capacity * 2, 256);
+		while (capacity < result->size + size)
+			capacity *= 2;
+		char *data = (char *)realloc(result->data, capacity);
+		if (data == NULL) {
+			diag_set(OutOfMemory, capacity, "realloc",
+				 "result->data");
+			return -1;
+		}
+		result->data = data;
+		result->capacity = capacity;
+	}
+	memcpy(result->data + result->size, mp, size);
+	result->size += size;
+	result->count++;
+	return 0;
+}
+
+/** A call of a C function executed in a worker thread. */
+struct func_c_task {
+	struct coio_task base;
+	/** The function to call. */
+	box_function_f func;
+	/** The module is pinned until the task is deleted. */
+	struct module *module;
+	/** Copy of the call arguments. */
+	const char *args;
+	const char *args_end;
+	/** Values returned by the function. */
+	struct func_offload_result result;
+};
+
+/** Runs in a worker thread. */
+static int
+func_c_task_f(struct coio_task *base)
+{
+	struct func_c_task *task = (struct func_c_task *)base;
+	struct region *region = &fiber()->gc;
+	size_t region_svp = region_used(region);
+	box_function_ctx_t ctx = { NULL, &task->result };
+	int rc = task->func(&ctx, task->args, task->args_end);
+	region_truncate(region, region_svp);
+	if (rc != 0 && diag_is_empty(diag_get())) {
+		/* Stored procedure forget to set diag  */
+		diag_set(ClientError, ER_PROC_C, "unknown error");
+	}
+	return rc;
+}
+
+static void
+func_c_task_delete(struct func_c_task *task)
+{
+	struct module *module = task->module;
+	--module->calls;
+	module_gc(module);
+	free(task->result.data);
+	coio_task_destroy(&task->base);
+	free(task);
+}
+
+/**
+ * Called in TX when the task is finished after the calling
+ * fiber gave up on it.
+ */
+static int
+func_c_task_on_timeout(struct coio_task *base)
+{
+	func_c_task_delete((struct func_c_task *)base);
+	return 0;
+}
+
+/**
+ * Execute a C function in the coio thread pool, yielding the
+ * current fiber until it is finished, and put its results to
+ * @a ret. Arguments and results are copied, since the caller
+ * may be cancelled and leave the task running.
+ */
+static int
+func_c_offload(struct func_c *func, const char *args, const char *args_end,
+	       struct port *ret)
+{
+	size_t args_size = args_end - args;
+	size_t size = sizeof(struct func_c_task) + args_size;
+	struct func_c_task *task = (struct func_c_task *)malloc(size);
+	if (task == NULL) {
+		diag_set(OutOfMemory, size, "malloc", "task");
+		return -1;
+	}
+	coio_task_create(&task->base, func_c_task_f, func_c_task_on_timeout);
+	task->func = func->func;
+	task->module = func->module;
+	char *args_copy = (char *)(task + 1);
+	memcpy(args_copy, args, args_size);
+	task->args = args_copy;
+	task->args_end = args_copy + args_size;
+	memset(&task->result, 0, sizeof(task->result));
+	++task->module->calls;
+	if (coio_task_execute(&task->base, TIMEOUT_INFINITY) != 0) {
+		/* Cancelled, freed by func_c_task_on_timeout(). */
+		return -1;
+	}
+	int rc = 0;
+	if (task->base.base.result != 0) {
+		diag_move(&task->base.diag, diag_get());
+		rc = -1;
+	}
+	const char *data = task->result.data;
+	for (uint32_t i = 0; rc == 0 && i < task->result.count; i++) {
+		const char *end = data;
+		mp_next(&end);
+		rc = port_c_add_mp(ret, data, end);
+		data = end;
+	}
+	func_c_task_delete(task);
+	return rc;
+}
+
 int
 func_c_call(struct func *base, struct port *args, struct port *ret)
 {
@@ -524,15 +667,23 @@ func_c_call(struct func *base, struct port *args, struct port *ret)
 		return -1;
 
 	port_c_create(ret);
-	box_function_ctx_t ctx = { ret };
-
-	/* Module can be changed after function reload. */
-	struct module *module = func->module;
-	assert(module != NULL);
-	++module->calls;
-	int rc = func->func(&ctx, data, data + data_sz);
-	--module->calls;
-	module_gc(module);
+	int rc;
+	/*
+	 * A yield would abort an active memtx transaction, so
+	 * functions called in one are always executed in TX.
+	 */
+	if (base->def->opts.is_threadsafe && in_txn() == NULL) {
+		rc = func_c_offload(func, data, data + data_sz, ret);
+	} else {
+		box_function_ctx_t ctx = { ret, NULL };
+		/* Module can be changed after function reload. */
+		struct module *module = func->module;
+		assert(module != NULL);
+		++module->calls;
+		rc = func->func(&ctx, data, data + data_sz);
+		--module->calls;
+		module_gc(module);
+	}
 	region_truncate(region, region_svp);
 	if (rc != 0) {
 		if (diag_last_error(&fiber()->diag) == NULL) {
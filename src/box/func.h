@@ -108,6 +108,20 @@ func_delete(struct func *func);
 int
 func_call(struct func *func, struct port *args, struct port *ret);
 
+/**
+ * Append a value to results of a C function executed in
+ * a worker thread (see func_opts::is_threadsafe).
+ *
+ * @param result results of the function.
+ * @param mp a single msgpack value.
+ * @param mp_end end of @a mp.
+ * @retval -1 on memory error, diag is set.
+ * @retval 0 on success.
+ */
+int
+func_offload_result_add(struct func_offload_result *result,
+			const char *mp, const char *mp_end);
+
 /**
  * Reload dynamically loadable module.
  *
@@ -68,6 +68,11 @@ struct func_opts {
 	 * packed in array.
 	 */
 	bool is_multikey;
+	/**
+	 * True when a C function doesn't touch box and may be
+	 * executed in a worker thread so as not to block TX.
+	 */
+	bool is_threadsafe;
 };
 
 extern const struct func_opts func_opts_default;
@@ -173,9 +178,15 @@ func_def_check(struct func_def *def);
  */
 
 struct port;
+struct func_offload_result;
 
 struct box_function_ctx {
 	struct port *port;
+	/**
+	 * Results of a function executed in a worker thread,
+	 * NULL when the function is executed in TX.
+	 */
+	struct func_offload_result *offload;
 };
 
 typedef struct box_function_ctx box_function_ctx_t;
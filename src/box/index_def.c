@@ -51,6 +51,8 @@ const struct index_opts index_opts_default = {
 	/* .lsn                 = */ 0,
 	/* .stat                = */ NULL,
 	/* .func                = */ 0,
+	/* .hint                = */ HINT_LAYOUT_FIRST_PART,
+	/* .hash_func           = */ TUPLE_HASH_MURMUR,
 };
 
 const struct opt_def index_opts_reg[] = {
@@ -65,6 +67,9 @@ const struct opt_def index_opts_reg[] = {
 	OPT_DEF("bloom_fpr", OPT_FLOAT, struct index_opts, bloom_fpr),
 	OPT_DEF("lsn", OPT_INT64, struct index_opts, lsn),
 	OPT_DEF("func", OPT_UINT32, struct index_opts, func_id),
+	OPT_DEF_ENUM("hint", hint_layout, struct index_opts, hint, NULL),
+	OPT_DEF_ENUM("hash_func", tuple_hash_func, struct index_opts,
+		     hash_func, NULL),
 	OPT_DEF_LEGACY("sql"),
 	OPT_END,
 };
@@ -109,6 +114,10 @@ index_def_new(uint32_t space_id, uint32_t iid, const char *name,
 		index_def_delete(def);
 		return NULL;
 	}
+	key_def_set_hint_layout(def->key_def, opts->hint);
+	key_def_set_hint_layout(def->cmp_def, opts->hint);
+	key_def_use_hash_func(def->key_def, opts->hash_func);
+	key_def_use_hash_func(def->cmp_def, opts->hash_func);
 	def->type = type;
 	def->space_id = space_id;
 	def->iid = iid;
@@ -303,6 +312,20 @@ index_def_is_valid(struct index_def *index_def, const char *space_name)
 			space_name, "primary key can not use a function");
 		return false;
 	}
+	if (index_def->type != TREE &&
+	    index_def->opts.hint != HINT_LAYOUT_FIRST_PART) {
+		diag_set(ClientError, ER_MODIFY_INDEX, index_def->name,
+			 space_name, "hint layout is supported only by "
+			 "TREE index");
+		return false;
+	}
+	if ((index_def->type == RTREE || index_def->type == BITSET) &&
+	    index_def->opts.hash_func != TUPLE_HASH_MURMUR) {
+		diag_set(ClientError, ER_MODIFY_INDEX, index_def->name,
+			 space_name, "hash function is not used by "
+			 "RTREE and BITSET indexes");
+		return false;
+	}
 	for (uint32_t i = 0; i < index_def->key_def->part_count; i++) {
 		assert(index_def->key_def->parts[i].type < field_type_MAX);
 		if (index_def->key_def->parts[i].fieldno > BOX_INDEX_FIELD_MAX) {
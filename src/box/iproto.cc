@@ -60,6 +60,10 @@
 #include "replication.h" /* instance_uuid */
 #include "iproto_constants.h"
 #include "rmean.h"
+#include "latency.h"
+#include "clock.h"
+#include "trace.h"
+#include "info/info.h"
 #include "execute.h"
 #include "errinj.h"
 #include "tt_static.h"
@@ -232,6 +236,15 @@ struct iproto_msg
 	 * and the connection must be closed.
 	 */
 	bool close_connection;
+	/**
+	 * When the request was read by the net thread, in
+	 * clock_ticks(), or 0 if its latency isn't collected.
+	 */
+	uint64_t start_ticks;
+	/** When tx started processing the request. */
+	uint64_t tx_ticks;
+	/** Trace record of the request or NULL if not traced. */
+	struct trace_record *trace;
 };
 
 static struct mempool iproto_msg_pool;
@@ -252,6 +265,8 @@ iproto_msg_decode(struct iproto_msg *msg, const char **pos, const char *reqend,
 static inline void
 iproto_msg_delete(struct iproto_msg *msg)
 {
+	if (msg->trace != NULL)
+		trace_record_delete(msg->trace);
 	mempool_free(&iproto_msg_pool, msg);
 	iproto_resume();
 }
@@ -298,6 +313,39 @@ const char *rmean_net_strings[IPROTO_LAST] = {
 	"REQUESTS",
 };
 
+/**
+ * Latency of requests of one type. The total latency is
+ * collected in the net thread, its parts are collected in tx.
+ * tx reads the net thread histograms without synchronization,
+ * same as rmean_net, but resets them in the net thread.
+ */
+struct iproto_latency {
+	/**
+	 * From reading the request in the net thread until
+	 * its reply gets back there to be sent.
+	 */
+	struct latency total;
+	/** Waiting in the queue to tx. */
+	struct latency queue;
+	/** Processing in tx, except waiting for WAL. */
+	struct latency tx;
+	/** Waiting for WAL, only for requests that wrote to it. */
+	struct latency wal;
+};
+
+static struct iproto_latency iproto_latency[IPROTO_TYPE_STAT_MAX];
+
+/** Total latency of all requests, collected in the net thread. */
+static struct latency iproto_net_latency;
+
+/** Seconds passed from one clock_ticks() value to another. */
+static inline double
+iproto_ticks_to_sec(uint64_t start, uint64_t end)
+{
+	/* Time stamp counters of different cores may drift. */
+	return end > start ? clock_ticks_to_sec(end - start) : 0;
+}
+
 static void
 tx_process_destroy(struct cmsg *m);
 
@@ -566,6 +614,7 @@ iproto_msg_new(struct iproto_connection *con)
 		return NULL;
 	}
 	msg->connection = con;
+	msg->trace = NULL;
 	rmean_collect(rmean_net, IPROTO_REQUESTS, 1);
 	return msg;
 }
@@ -1250,6 +1299,7 @@ iproto_msg_decode(struct iproto_msg *msg, const char **pos, const char *reqend,
 {
 	uint8_t type;
 
+	msg->start_ticks = 0;
 	if (xrow_header_decode(&msg->header, pos, reqend, true))
 		goto error;
 	assert(*pos == reqend);
@@ -1291,7 +1341,9 @@ iproto_msg_decode(struct iproto_msg *msg, const char **pos, const char *reqend,
 		cmsg_init(&msg->base, misc_route);
 		break;
 	case IPROTO_JOIN:
+	case IPROTO_JOIN_STREAM:
 	case IPROTO_FETCH_SNAPSHOT:
+	case IPROTO_FETCH_CHECKPOINT:
 	case IPROTO_REGISTER:
 		cmsg_init(&msg->base, join_route);
 		*stop_input = true;
@@ -1314,6 +1366,11 @@ iproto_msg_decode(struct iproto_msg *msg, const char **pos, const char *reqend,
 			 (uint32_t) type);
 		goto error;
 	}
+	if (type < IPROTO_TYPE_STAT_MAX) {
+		msg->start_ticks = clock_ticks();
+		msg->trace = trace_record_new(type, msg->header.sync,
+					      msg->start_ticks);
+	}
 	return;
 error:
 	/** Log and send the error. */
@@ -1333,6 +1390,8 @@ tx_fiber_init(struct session *session, uint64_t sync)
 	 */
 	assert(rlist_empty(&f->on_stop));
 	f->storage.net.sync = sync;
+	f->storage.net.wal_ticks = 0;
+	f->storage.net.trace = NULL;
 	/*
 	 * We do not cleanup fiber keys at the end of each request.
 	 * This does not lead to privilege escalation as long as
@@ -1484,9 +1543,41 @@ tx_accept_msg(struct cmsg *m)
 	struct iproto_msg *msg = (struct iproto_msg *) m;
 	tx_accept_wpos(msg->connection, &msg->wpos);
 	tx_fiber_init(msg->connection->session, msg->header.sync);
+	if (msg->start_ticks != 0) {
+		struct iproto_latency *latency =
+			&iproto_latency[msg->header.type];
+		msg->tx_ticks = clock_ticks();
+		latency_collect(&latency->queue,
+				iproto_ticks_to_sec(msg->start_ticks,
+						    msg->tx_ticks));
+		trace_record_stamp(msg->trace, TRACE_TX_ACCEPT, msg->tx_ticks);
+		fiber()->storage.net.trace = msg->trace;
+	}
 	return msg;
 }
 
+/**
+ * Set the position of the end of the request reply in the
+ * output buffer and account the time the request spent in tx.
+ */
+static inline void
+tx_end_msg(struct iproto_msg *msg, struct obuf *out)
+{
+	iproto_wpos_create(&msg->wpos, out);
+	if (msg->start_ticks == 0)
+		return;
+	struct iproto_latency *latency = &iproto_latency[msg->header.type];
+	uint64_t end_ticks = clock_ticks();
+	uint64_t wal_ticks = fiber()->storage.net.wal_ticks;
+	uint64_t tx_ticks = end_ticks - msg->tx_ticks;
+	tx_ticks = tx_ticks > wal_ticks ? tx_ticks - wal_ticks : 0;
+	latency_collect(&latency->tx, clock_ticks_to_sec(tx_ticks));
+	if (wal_ticks != 0)
+		latency_collect(&latency->wal, clock_ticks_to_sec(wal_ticks));
+	trace_record_stamp(msg->trace, TRACE_TX_END, end_ticks);
+	fiber()->storage.net.trace = NULL;
+}
+
 /**
  * Write error message to the output buffer and advance
  * write position. Doesn't throw.
@@ -1497,7 +1588,7 @@ tx_reply_error(struct iproto_msg *msg)
 	struct obuf *out = msg->connection->tx.p_obuf;
 	iproto_reply_error(out, diag_last_error(&fiber()->diag),
 			   msg->header.sync, ::schema_version);
-	iproto_wpos_create(&msg->wpos, out);
+	tx_end_msg(msg, out);
 }
 
 /**
@@ -1511,7 +1602,7 @@ tx_reply_iproto_error(struct cmsg *m)
 	struct obuf *out = msg->connection->tx.p_obuf;
 	iproto_reply_error(out, diag_last_error(&msg->diag),
 			   msg->header.sync, ::schema_version);
-	iproto_wpos_create(&msg->wpos, out);
+	tx_end_msg(msg, out);
 }
 
 /** Inject a short delay on tx request processing for testing. */
@@ -1544,7 +1635,7 @@ tx_process1(struct cmsg *m)
 		goto error;
 	iproto_reply_select(out, &svp, msg->header.sync, ::schema_version,
 			    tuple != 0);
-	iproto_wpos_create(&msg->wpos, out);
+	tx_end_msg(msg, out);
 	return;
 error:
 	tx_reply_error(msg);
@@ -1587,7 +1678,7 @@ tx_process_select(struct cmsg *m)
 	}
 	iproto_reply_select(out, &svp, msg->header.sync,
 			    ::schema_version, count);
-	iproto_wpos_create(&msg->wpos, out);
+	tx_end_msg(msg, out);
 	return;
 error:
 	tx_reply_error(msg);
@@ -1677,7 +1768,7 @@ tx_process_call(struct cmsg *m)
 
 	iproto_reply_select(out, &svp, msg->header.sync,
 			    ::schema_version, count);
-	iproto_wpos_create(&msg->wpos, out);
+	tx_end_msg(msg, out);
 	return;
 error:
 	tx_reply_error(msg);
@@ -1717,7 +1808,7 @@ tx_process_misc(struct cmsg *m)
 		default:
 			unreachable();
 		}
-		iproto_wpos_create(&msg->wpos, out);
+		tx_end_msg(msg, out);
 	} catch (Exception *e) {
 		tx_reply_error(msg);
 	}
@@ -1800,7 +1891,7 @@ tx_process_sql(struct cmsg *m)
 	if (is_unprepare) {
 		if (iproto_reply_ok(out, msg->header.sync, schema_version) != 0)
 			goto error;
-		iproto_wpos_create(&msg->wpos, out);
+		tx_end_msg(msg, out);
 		return;
 	}
 	struct obuf_svp header_svp;
@@ -1816,7 +1907,7 @@ tx_process_sql(struct cmsg *m)
 	}
 	port_destroy(&port);
 	iproto_reply_sql(out, &header_svp, msg->header.sync, schema_version);
-	iproto_wpos_create(&msg->wpos, out);
+	tx_end_msg(msg, out);
 	return;
 error:
 	tx_reply_error(msg);
@@ -1839,9 +1930,15 @@ tx_process_replication(struct cmsg *m)
 			 */
 			box_process_join(&io, &msg->header);
 			break;
+		case IPROTO_JOIN_STREAM:
+			box_process_join_stream(&io, &msg->header);
+			break;
 		case IPROTO_FETCH_SNAPSHOT:
 			box_process_fetch_snapshot(&io, &msg->header);
 			break;
+		case IPROTO_FETCH_CHECKPOINT:
+			box_process_fetch_checkpoint(&io, &msg->header);
+			break;
 		case IPROTO_REGISTER:
 			box_process_register(&io, &msg->header);
 			break;
@@ -1881,6 +1978,19 @@ net_send_msg(struct cmsg *m)
 	}
 	con->wend = msg->wpos;
 
+	if (msg->start_ticks != 0) {
+		uint64_t end_ticks = clock_ticks();
+		double total = iproto_ticks_to_sec(msg->start_ticks,
+						   end_ticks);
+		latency_collect(&iproto_latency[msg->header.type].total, total);
+		latency_collect(&iproto_net_latency, total);
+		if (msg->trace != NULL) {
+			trace_record_stamp(msg->trace, TRACE_NET_SEND,
+					   end_ticks);
+			trace_record_commit(msg->trace);
+			msg->trace = NULL;
+		}
+	}
 	if (evio_has_fd(&con->output)) {
 		if (! ev_is_active(&con->output))
 			ev_feed_event(con->loop, &con->output, EV_WRITE);
@@ -2189,6 +2299,17 @@ iproto_init()
 {
 	slab_cache_create(&net_slabc, &runtime);
 
+	for (int i = 0; i < IPROTO_TYPE_STAT_MAX; i++) {
+		struct iproto_latency *latency = &iproto_latency[i];
+		if (latency_create(&latency->total) != 0 ||
+		    latency_create(&latency->queue) != 0 ||
+		    latency_create(&latency->tx) != 0 ||
+		    latency_create(&latency->wal) != 0)
+			panic("failed to allocate iproto latency statistics");
+	}
+	if (latency_create(&iproto_net_latency) != 0)
+		panic("failed to allocate iproto latency statistics");
+
 	if (cord_costart(&net_cord, "iproto", net_cord_f, NULL))
 		panic("failed to initialize iproto thread");
 
@@ -2206,7 +2327,8 @@ iproto_init()
 /** Available iproto configuration changes. */
 enum iproto_cfg_op {
 	IPROTO_CFG_MSG_MAX,
-	IPROTO_CFG_LISTEN
+	IPROTO_CFG_LISTEN,
+	IPROTO_CFG_RESET_STAT,
 };
 
 /**
@@ -2266,6 +2388,13 @@ iproto_do_cfg_f(struct cbus_call_msg *m)
 			cfg_msg->addrlen = binary.addr_len;
 			cfg_msg->addr = binary.addrstorage;
 			break;
+		case IPROTO_CFG_RESET_STAT:
+			/* Statistics collected in the net thread. */
+			rmean_cleanup(rmean_net);
+			for (int i = 0; i < IPROTO_TYPE_STAT_MAX; i++)
+				latency_reset(&iproto_latency[i].total);
+			latency_reset(&iproto_net_latency);
+			break;
 		default:
 			unreachable();
 		}
@@ -2315,7 +2444,53 @@ iproto_request_count(void)
 void
 iproto_reset_stat(void)
 {
-	rmean_cleanup(rmean_net);
+	for (int i = 0; i < IPROTO_TYPE_STAT_MAX; i++) {
+		struct iproto_latency *latency = &iproto_latency[i];
+		latency_reset(&latency->queue);
+		latency_reset(&latency->tx);
+		latency_reset(&latency->wal);
+	}
+	/*
+	 * The rest is collected in the net thread, so reset it
+	 * there. The call can't fail, as the timeout is infinite
+	 * and the fiber can't be cancelled.
+	 */
+	struct iproto_cfg_msg cfg_msg;
+	iproto_cfg_msg_create(&cfg_msg, IPROTO_CFG_RESET_STAT);
+	bool cancellable = fiber_set_cancellable(false);
+	cbus_call(&net_pipe, &tx_pipe, &cfg_msg, iproto_do_cfg_f,
+		  NULL, TIMEOUT_INFINITY);
+	fiber_set_cancellable(cancellable);
+}
+
+void
+iproto_latency_stat(struct info_handler *h)
+{
+	for (int i = 0; i < IPROTO_TYPE_STAT_MAX; i++) {
+		const char *name = iproto_type_strs[i];
+		if (name == NULL)
+			continue;
+		struct iproto_latency *latency = &iproto_latency[i];
+		info_table_begin(h, name);
+		latency_info_append(h, "total", &latency->total);
+		latency_info_append(h, "queue", &latency->queue);
+		latency_info_append(h, "tx", &latency->tx);
+		latency_info_append(h, "wal", &latency->wal);
+		info_table_end(h);
+	}
+}
+
+void
+iproto_net_latency_stat(struct info_handler *h)
+{
+	info_begin(h);
+	info_append_double(h, "p50",
+			   latency_get_permille(&iproto_net_latency, 500));
+	info_append_double(h, "p99",
+			   latency_get_permille(&iproto_net_latency, 990));
+	info_append_double(h, "p999",
+			   latency_get_permille(&iproto_net_latency, 999));
+	info_end(h);
 }
 
 void
@@ -2345,4 +2520,5 @@ iproto_free()
 	*/
 	if (evio_service_is_active(&binary))
 		close(binary.ev.fd);
+	trace_free();
 }
@@ -80,6 +80,23 @@ iproto_request_count(void);
 void
 iproto_reset_stat(void);
 
+struct info_handler;
+
+/**
+ * Append latency percentiles of iproto requests to an info
+ * handler, a table per request type with the total latency
+ * and its queue, tx and wal parts.
+ */
+void
+iproto_latency_stat(struct info_handler *h);
+
+/**
+ * Fill an info handler with latency percentiles of all
+ * iproto requests.
+ */
+void
+iproto_net_latency_stat(struct info_handler *h);
+
 /**
  * String representation of the address served by
  * iproto. To be shown in box.info.
@@ -207,7 +207,8 @@ const char *vy_page_info_key_strs[VY_PAGE_INFO_KEY_MAX] = {
 	"unpacked size",
 	"row count",
 	"min key",
-	"row index offset"
+	"row index offset",
+	"field map offset",
 };
 
 const char *vy_run_info_key_strs[VY_RUN_INFO_KEY_MAX] = {
@@ -220,9 +221,17 @@ const char *vy_run_info_key_strs[VY_RUN_INFO_KEY_MAX] = {
 	"bloom filter legacy",
 	"bloom filter",
 	"stmt stat",
+	"bloom filter versioned",
 };
 
 const char *vy_row_index_key_strs[VY_ROW_INDEX_KEY_MAX] = {
 	NULL,
 	"row index",
 };
+
+const char *vy_field_map_key_strs[VY_FIELD_MAP_KEY_MAX] = {
+	NULL,
+	"field map hash",
+	"field map layout",
+	"field map",
+};
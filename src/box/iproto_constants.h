@@ -127,6 +127,23 @@ enum iproto_key {
 	IPROTO_REPLICA_ANON = 0x50,
 	IPROTO_ID_FILTER = 0x51,
 	IPROTO_ERROR = 0x52,
+	/** Checkpoint file name in FETCH CHECKPOINT. */
+	IPROTO_FILE_NAME = 0x53,
+	/** Offset of a checkpoint file chunk. */
+	IPROTO_FILE_OFFSET = 0x54,
+	/** CRC32 of a checkpoint file chunk. */
+	IPROTO_FILE_CRC32 = 0x55,
+	/** Number of data streams of a parallel JOIN. */
+	IPROTO_JOIN_STREAMS = 0x56,
+	/** Data stream number in JOIN STREAM. */
+	IPROTO_JOIN_STREAM_ID = 0x57,
+	/**
+	 * Set in REGISTER by a replica bootstrapped from
+	 * checkpoint files, which must not skip any rows.
+	 */
+	IPROTO_FROM_CHECKPOINT = 0x58,
+	/** Number of rows sent over an extra stream of a JOIN. */
+	IPROTO_JOIN_STREAM_ROWS = 0x59,
 	IPROTO_KEY_MAX
 };
 
@@ -233,6 +250,10 @@ enum iproto_type {
 	IPROTO_FETCH_SNAPSHOT = 69,
 	/** REGISTER request to leave anonymous replication. */
 	IPROTO_REGISTER = 70,
+	/** Fetch checkpoint files for file-based bootstrap. */
+	IPROTO_FETCH_CHECKPOINT = 71,
+	/** Extra data stream of a parallel JOIN. */
+	IPROTO_JOIN_STREAM = 72,
 
 	/** Vinyl run info stored in .index file */
 	VY_INDEX_RUN_INFO = 100,
@@ -240,6 +261,8 @@ enum iproto_type {
 	VY_INDEX_PAGE_INFO = 101,
 	/** Vinyl row index stored in .run file */
 	VY_RUN_ROW_INDEX = 102,
+	/** Vinyl statement field maps stored in .run file */
+	VY_RUN_FIELD_MAP = 103,
 
 	/** Non-final response type. */
 	IPROTO_CHUNK = 128,
@@ -277,6 +300,8 @@ iproto_type_name(uint32_t type)
 		return "PAGEINFO";
 	case VY_RUN_ROW_INDEX:
 		return "ROWINDEX";
+	case VY_RUN_FIELD_MAP:
+		return "FIELDMAP";
 	default:
 		return NULL;
 	}
@@ -393,6 +418,14 @@ enum vy_run_info_key {
 	VY_RUN_INFO_BLOOM = 7,
 	/** Number of statements of each type (map). */
 	VY_RUN_INFO_STMT_STAT = 8,
+	/**
+	 * Bloom filter built with a hash function other than
+	 * PMurHash: [hash function, bloom filter]. Stored under
+	 * a separate key so that older versions, which don't
+	 * know about it, ignore the filter instead of using it
+	 * with a wrong hash function.
+	 */
+	VY_RUN_INFO_BLOOM_VERSIONED = 9,
 	/** The last key in this enum + 1 */
 	VY_RUN_INFO_KEY_MAX
 };
@@ -427,6 +460,13 @@ enum vy_page_info_key {
 	VY_PAGE_INFO_MIN_KEY = 5,
 	/** Offset of the row index in the page. */
 	VY_PAGE_INFO_ROW_INDEX_OFFSET = 6,
+	/**
+	 * Offset of the statement field maps in the page.
+	 * Optional. The field maps are stored in a row of their
+	 * own, which is only found by this key, so that older
+	 * versions, which ignore the key, never read it.
+	 */
+	VY_PAGE_INFO_FIELD_MAP_OFFSET = 7,
 	/** The last key in this enum + 1 */
 	VY_PAGE_INFO_KEY_MAX
 };
@@ -468,6 +508,44 @@ vy_row_index_key_name(enum vy_row_index_key key)
 	return vy_row_index_key_strs[key];
 }
 
+/**
+ * Xrow keys for Vinyl statement field maps.
+ * @sa struct vy_page.
+ */
+enum vy_field_map_key {
+	/**
+	 * Field map hash of the format the field maps were
+	 * built for, see tuple_format::field_map_hash.
+	 */
+	VY_FIELD_MAP_HASH = 1,
+	/**
+	 * Field map layout of the format the field maps were
+	 * built for, see tuple_format_field_map_layout().
+	 */
+	VY_FIELD_MAP_LAYOUT = 2,
+	/**
+	 * Field maps of the page statements. For each
+	 * statement: the number of 32-bit words in its field
+	 * map followed by the words.
+	 */
+	VY_FIELD_MAP_DATA = 3,
+	/** The last key in this enum + 1 */
+	VY_FIELD_MAP_KEY_MAX
+};
+
+/**
+ * Return vy_field_map key name by @a key code.
+ * @param key key
+ */
+static inline const char *
+vy_field_map_key_name(enum vy_field_map_key key)
+{
+	if (key <= 0 || key >= VY_FIELD_MAP_KEY_MAX)
+		return NULL;
+	extern const char *vy_field_map_key_strs[];
+	return vy_field_map_key_strs[key];
+}
+
 #if defined(__cplusplus)
 } /* extern "C" */
 #endif
@@ -97,6 +97,8 @@ journal_entry_new(size_t n_rows, struct region *region,
 	entry->approx_len = 0;
 	entry->n_rows = n_rows;
 	entry->res = -1;
+	entry->write_start_ticks = 0;
+	entry->write_end_ticks = 0;
 
 	return entry;
 }
@@ -69,6 +69,13 @@ struct journal_entry {
 	 * The number of rows in the request.
 	 */
 	int n_rows;
+	/**
+	 * When the WAL thread started and finished writing the
+	 * entry, in clock_ticks(). Set only while requests are
+	 * traced, see trace.h.
+	 */
+	uint64_t write_start_ticks;
+	uint64_t write_end_ticks;
 	/**
 	 * The rows.
 	 */
@@ -37,6 +37,7 @@
 #include "field_def.h"
 #include "coll_id.h"
 #include "tuple_compare.h"
+#include "tuple_hash.h"
 
 #if defined(__cplusplus)
 extern "C" {
@@ -208,6 +209,18 @@ struct key_def {
 	 * fields assumed to be MP_NIL.
 	 */
 	bool has_optional_parts;
+	/** Comparison hint layout requested for this key. */
+	enum hint_layout hint_layout;
+	/**
+	 * Number of leading key parts encoded in a comparison
+	 * hint. Depends on hint_layout and key part types, 0 if
+	 * hints are not used. Tuple hints computed for key
+	 * definitions with different hint_part_count are not
+	 * compatible.
+	 */
+	uint32_t hint_part_count;
+	/** Hash function used by tuple_hash() and key_hash(). */
+	enum tuple_hash_func hash_func;
 	/** Key fields mask. @sa column_mask.h for details. */
 	uint64_t column_mask;
 	/**
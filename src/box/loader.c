@@ -0,0 +1,1010 @@
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "loader.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <msgpuck.h>
+#include <third_party/qsort_arg.h>
+
+#include "trivia/util.h"
+#include "clock.h"
+#include "coio_file.h"
+#include "coio_task.h"
+#include "diag.h"
+#include "fiber.h"
+#include "fiber_cond.h"
+#include "say.h"
+#include "tt_static.h"
+#include "uuid/mp_uuid.h"
+
+#include "error.h"
+#include "errcode.h"
+#include "index.h"
+#include "memtx_engine.h"
+#include "memtx_space.h"
+#include "replication.h"
+#include "schema.h"
+#include "space.h"
+#include "tuple.h"
+#include "txn.h"
+
+const char *load_format_strs[] = { "csv", "msgpack" };
+
+enum {
+	/** Number of bytes read from the input file at once. */
+	LOADER_READ_SIZE = 1024 * 1024,
+	/** Parsed rows are passed to tx in batches of this size. */
+	LOADER_BATCH_SIZE = 4 * 1024 * 1024,
+	/** Number of batches the parser may be ahead of tx. */
+	LOADER_BATCH_COUNT = 2,
+	/**
+	 * A row that doesn't end within this many bytes is
+	 * considered broken rather than incomplete.
+	 */
+	LOADER_ROW_SIZE_MAX = 64 * 1024 * 1024,
+};
+
+void
+load_opts_create(struct load_opts *opts)
+{
+	opts->format = LOAD_FORMAT_CSV;
+	opts->delimiter = ',';
+	opts->quote_char = '"';
+	opts->skip_header = false;
+	opts->checkpoint = true;
+}
+
+/** A growing byte buffer usable from any thread. */
+struct load_buf {
+	char *data;
+	size_t size;
+	size_t capacity;
+};
+
+static void
+load_buf_create(struct load_buf *buf)
+{
+	buf->data = NULL;
+	buf->size = 0;
+	buf->capacity = 0;
+}
+
+static void
+load_buf_destroy(struct load_buf *buf)
+{
+	free(buf->data);
+}
+
+/** Make room for @a size more bytes, return the end of data. */
+static char *
+load_buf_reserve(struct load_buf *buf, size_t size)
+{
+	if (buf->size + size > buf->capacity) {
+		size_t capacity = MAX(buf->capacity, 4096);
+		while (capacity < buf->size + size)
+			capacity *= 2;
+		char *data = realloc(buf->data, capacity);
+		if (data == NULL) {
+			diag_set(OutOfMemory, capacity, "realloc", "data");
+			return NULL;
+		}
+		buf->data = data;
+		buf->capacity = capacity;
+	}
+	return buf->data + buf->size;
+}
+
+/** Rows parsed by the parser and not yet turned into tuples. */
+struct load_batch {
+	/** MsgPack arrays, one per row. */
+	struct load_buf buf;
+	uint32_t row_count;
+	/** Number of the first row in the input, for errors. */
+	uint64_t first_row;
+	/** Set by the parser, cleared by tx once consumed. */
+	bool is_ready;
+};
+
+struct loader {
+	const char *path;
+	struct load_opts opts;
+	int fd;
+	/**
+	 * Types and nullability of the space format fields,
+	 * used to convert CSV text to MsgPack.
+	 */
+	enum field_type *types;
+	bool *is_nullable;
+	uint32_t type_count;
+	/*
+	 * Parser state, accessed only in a coio thread
+	 * while tx waits for the batches.
+	 */
+	/** Input read from the file, parsed up to in_pos. */
+	struct load_buf in;
+	size_t in_pos;
+	bool is_eof;
+	/** Number of rows parsed so far. */
+	uint64_t row;
+	/** Fields of the CSV row being parsed. */
+	struct load_buf row_buf;
+	uint32_t row_field_count;
+	/** Unquoted text of the CSV field being parsed. */
+	struct load_buf field_buf;
+	/*
+	 * Pipeline state, accessed only in tx.
+	 */
+	struct load_batch batches[LOADER_BATCH_COUNT];
+	/** Signalled when a batch is parsed or consumed. */
+	struct fiber_cond cond;
+	/** Set when the parser fiber has exited. */
+	bool is_done;
+	/** Set by tx to make the parser fiber stop early. */
+	bool is_stopped;
+	/** Tuples made of the parsed rows, each referenced. */
+	struct tuple **tuples;
+	size_t tuple_count;
+	size_t tuple_capacity;
+};
+
+/** Set a parse error for the row being parsed. */
+static void
+loader_set_error(struct loader *loader, const char *msg)
+{
+	diag_set(ClientError, ER_LOAD_DATA, loader->path,
+		 (unsigned long long)loader->row + 1, msg);
+}
+
+/* {{{ CSV parser */
+
+/**
+ * Parse a decimal integer without the overhead of strtoll(),
+ * which also accepts leading spaces and other noise we don't
+ * want to let through.
+ */
+static bool
+loader_parse_int(const char *str, size_t len, bool *is_neg, uint64_t *value)
+{
+	const char *end = str + len;
+	*is_neg = false;
+	if (str < end && (*str == '-' || *str == '+')) {
+		*is_neg = *str == '-';
+		str++;
+	}
+	if (str == end)
+		return false;
+	uint64_t v = 0;
+	for (; str < end; str++) {
+		unsigned digit = (unsigned char)*str - '0';
+		if (digit > 9 || v > (UINT64_MAX - digit) / 10)
+			return false;
+		v = v * 10 + digit;
+	}
+	if (*is_neg && v > (uint64_t)INT64_MAX + 1)
+		return false;
+	*is_neg = *is_neg && v != 0;
+	*value = v;
+	return true;
+}
+
+static bool
+loader_parse_double(const char *str, size_t len, double *value)
+{
+	char buf[64];
+	if (len == 0 || len >= sizeof(buf))
+		return false;
+	memcpy(buf, str, len);
+	buf[len] = '\0';
+	char *end;
+	*value = strtod(buf, &end);
+	return end == buf + len;
+}
+
+/** Append a CSV field to the current row, converting its type. */
+static int
+loader_encode_field(struct loader *loader, const char *str, size_t len)
+{
+	uint32_t fieldno = loader->row_field_count++;
+	/* The header is skipped, don't check its field types. */
+	if (loader->row == 0 && loader->opts.skip_header)
+		return 0;
+	enum field_type type = FIELD_TYPE_ANY;
+	bool is_nullable = true;
+	if (fieldno < loader->type_count) {
+		type = loader->types[fieldno];
+		is_nullable = loader->is_nullable[fieldno];
+	}
+	/* Enough for any scalar and a string header. */
+	char *data = load_buf_reserve(&loader->row_buf, len + 32);
+	if (data == NULL)
+		return -1;
+	char *begin = data;
+	bool is_neg;
+	uint64_t u;
+	double d;
+	if (len == 0 && type != FIELD_TYPE_STRING) {
+		if (is_nullable) {
+			data = mp_encode_nil(data);
+			goto done;
+		}
+		if (type != FIELD_TYPE_ANY && type != FIELD_TYPE_SCALAR)
+			goto error;
+	}
+	switch (type) {
+	case FIELD_TYPE_STRING:
+		data = mp_encode_str(data, str, len);
+		break;
+	case FIELD_TYPE_VARBINARY:
+		data = mp_encode_bin(data, str, len);
+		break;
+	case FIELD_TYPE_UNSIGNED:
+	case FIELD_TYPE_INTEGER:
+		if (!loader_parse_int(str, len, &is_neg, &u))
+			goto error;
+		data = is_neg ? mp_encode_int(data, -(int64_t)(u - 1) - 1) :
+				mp_encode_uint(data, u);
+		break;
+	case FIELD_TYPE_DOUBLE:
+		if (!loader_parse_double(str, len, &d))
+			goto error;
+		data = mp_encode_double(data, d);
+		break;
+	case FIELD_TYPE_NUMBER:
+		if (loader_parse_int(str, len, &is_neg, &u)) {
+			data = is_neg ?
+			       mp_encode_int(data, -(int64_t)(u - 1) - 1) :
+			       mp_encode_uint(data, u);
+		} else if (loader_parse_double(str, len, &d)) {
+			data = mp_encode_double(data, d);
+		} else {
+			goto error;
+		}
+		break;
+	case FIELD_TYPE_BOOLEAN:
+		if (len == 4 && memcmp(str, "true", 4) == 0)
+			data = mp_encode_bool(data, true);
+		else if (len == 5 && memcmp(str, "false", 5) == 0)
+			data = mp_encode_bool(data, false);
+		else
+			goto error;
+		break;
+	case FIELD_TYPE_UUID: {
+		struct tt_uuid uuid;
+		char buf[UUID_STR_LEN + 1];
+		if (len != UUID_STR_LEN)
+			goto error;
+		memcpy(buf, str, len);
+		buf[len] = '\0';
+		if (tt_uuid_from_string(buf, &uuid) != 0)
+			goto error;
+		data = mp_encode_uuid(data, &uuid);
+		break;
+	}
+	case FIELD_TYPE_ANY:
+	case FIELD_TYPE_SCALAR:
+		/*
+		 * Fields not typed by the format are stored
+		 * as numbers if they look like ones.
+		 */
+		if (loader_parse_int(str, len, &is_neg, &u)) {
+			data = is_neg ?
+			       mp_encode_int(data, -(int64_t)(u - 1) - 1) :
+			       mp_encode_uint(data, u);
+		} else if (len > 0 && (*str == '-' || *str == '.' ||
+				       (*str >= '0' && *str <= '9')) &&
+			   loader_parse_double(str, len, &d)) {
+			data = mp_encode_double(data, d);
+		} else {
+			data = mp_encode_str(data, str, len);
+		}
+		break;
+	default:
+		loader_set_error(loader, tt_sprintf("field %u: type '%s' "
+						    "is not supported in CSV",
+						    fieldno + 1,
+						    field_type_strs[type]));
+		return -1;
+	}
+done:
+	loader->row_buf.size += data - begin;
+	return 0;
+error:
+	loader_set_error(loader, tt_sprintf("field %u: '%.*s' is not %s",
+					    fieldno + 1, (int)MIN(len, 64),
+					    str, field_type_strs[type]));
+	return -1;
+}
+
+/** Move the parsed CSV row to a batch. */
+static int
+loader_emit_csv_row(struct loader *loader, struct load_batch *batch)
+{
+	if (loader->row++ == 0 && loader->opts.skip_header)
+		return 0;
+	uint32_t field_count = loader->row_field_count;
+	size_t size = mp_sizeof_array(field_count) + loader->row_buf.size;
+	char *data = load_buf_reserve(&batch->buf, size);
+	if (data == NULL)
+		return -1;
+	data = mp_encode_array(data, field_count);
+	memcpy(data, loader->row_buf.data, loader->row_buf.size);
+	batch->buf.size += size;
+	batch->row_count++;
+	return 0;
+}
+
+/**
+ * Parse a CSV row that has quoted fields. The row may span
+ * several lines if a quoted field has line breaks.
+ *
+ * @retval 1 a row is parsed.
+ * @retval 0 more input is needed.
+ * @retval -1 error.
+ */
+static int
+loader_parse_csv_quoted_row(struct loader *loader, struct load_batch *batch)
+{
+	const char delim = loader->opts.delimiter;
+	const char quote = loader->opts.quote_char;
+	const char *p = loader->in.data + loader->in_pos;
+	const char *end = loader->in.data + loader->in.size;
+	while (true) {
+		const char *field = p;
+		size_t field_len;
+		if (p < end && *p == quote) {
+			struct load_buf *buf = &loader->field_buf;
+			buf->size = 0;
+			p++;
+			while (true) {
+				const char *q = memchr(p, quote, end - p);
+				if (q == NULL || (q + 1 == end &&
+						  !loader->is_eof)) {
+					if (!loader->is_eof)
+						return 0;
+					loader_set_error(loader, "unterminated "
+							 "quoted field");
+					return -1;
+				}
+				size_t len = q - p + 1;
+				char *data = load_buf_reserve(buf, len);
+				if (data == NULL)
+					return -1;
+				memcpy(data, p, len);
+				if (q + 1 < end && q[1] == quote) {
+					/* An escaped quote. */
+					buf->size += len;
+					p = q + 2;
+					continue;
+				}
+				buf->size += len - 1;
+				p = q + 1;
+				break;
+			}
+			if (p < end && *p == '\r') {
+				if (p + 1 == end && !loader->is_eof)
+					return 0;
+				if (p + 1 < end && p[1] == '\n')
+					p++;
+			}
+			if (p < end && *p != delim && *p != '\n') {
+				loader_set_error(loader, "unexpected character "
+						 "after a quoted field");
+				return -1;
+			}
+			if (p == end && !loader->is_eof)
+				return 0;
+			field = buf->data;
+			field_len = buf->size;
+		} else {
+			while (p < end && *p != delim && *p != '\n')
+				p++;
+			if (p == end && !loader->is_eof)
+				return 0;
+			field_len = p - field;
+			if (p < end && *p == '\n' && field_len > 0 &&
+			    field[field_len - 1] == '\r')
+				field_len--;
+		}
+		if (loader_encode_field(loader, field, field_len) != 0)
+			return -1;
+		if (p == end || *p == '\n')
+			break;
+		p++;
+	}
+	loader->in_pos = (p == end ? p : p + 1) - loader->in.data;
+	return loader_emit_csv_row(loader, batch) != 0 ? -1 : 1;
+}
+
+/**
+ * Parse a CSV row. Most rows have no quoted fields, so the
+ * fields of such a row are split with memchr(), which is
+ * vectorized by libc, and only rows with quotes are parsed
+ * character by character.
+ *
+ * @retval 1 a row is parsed or an empty line is skipped.
+ * @retval 0 more input is needed.
+ * @retval -1 error.
+ */
+static int
+loader_parse_csv_row(struct loader *loader, struct load_batch *batch)
+{
+	const char *pos = loader->in.data + loader->in_pos;
+	const char *end = loader->in.data + loader->in.size;
+	if (pos == end)
+		return 0;
+	const char *eol = memchr(pos, '\n', end - pos);
+	if (eol == NULL && !loader->is_eof)
+		return 0;
+	const char *line_end = eol != NULL ? eol : end;
+	const char *next = eol != NULL ? eol + 1 : end;
+	loader->row_buf.size = 0;
+	loader->row_field_count = 0;
+	if (memchr(pos, loader->opts.quote_char, line_end - pos) != NULL)
+		return loader_parse_csv_quoted_row(loader, batch);
+	if (line_end > pos && line_end[-1] == '\r')
+		line_end--;
+	loader->in_pos = next - loader->in.data;
+	if (line_end == pos)
+		return 1;
+	const char *field = pos;
+	while (true) {
+		const char *delim = memchr(field, loader->opts.delimiter,
+					   line_end - field);
+		const char *field_end = delim != NULL ? delim : line_end;
+		if (loader_encode_field(loader, field, field_end - field) != 0)
+			return -1;
+		if (delim == NULL)
+			break;
+		field = delim + 1;
+	}
+	return loader_emit_csv_row(loader, batch) != 0 ? -1 : 1;
+}
+
+/* }}} CSV parser */
+
+/**
+ * Validate a MsgPack row and copy it to a batch as is.
+ * Return values are the same as of loader_parse_csv_row().
+ */
+static int
+loader_parse_msgpack_row(struct loader *loader, struct load_batch *batch)
+{
+	const char *pos = loader->in.data + loader->in_pos;
+	const char *end = loader->in.data + loader->in.size;
+	if (pos == end)
+		return 0;
+	const char *row_end = pos;
+	if (mp_check(&row_end, end) != 0) {
+		if (!loader->is_eof && end - pos < LOADER_ROW_SIZE_MAX)
+			return 0;
+		loader_set_error(loader, "invalid MsgPack");
+		return -1;
+	}
+	if (mp_typeof(*pos) != MP_ARRAY) {
+		loader_set_error(loader, "row is not an array");
+		return -1;
+	}
+	size_t size = row_end - pos;
+	char *data = load_buf_reserve(&batch->buf, size);
+	if (data == NULL)
+		return -1;
+	memcpy(data, pos, size);
+	batch->buf.size += size;
+	batch->row_count++;
+	loader->row++;
+	loader->in_pos += size;
+	return 1;
+}
+
+/** Read the next part of the input file. */
+static int
+loader_read(struct loader *loader)
+{
+	struct load_buf *in = &loader->in;
+	if (in->size - loader->in_pos >= LOADER_ROW_SIZE_MAX) {
+		loader_set_error(loader, "row is too long");
+		return -1;
+	}
+	/* Drop the parsed input. */
+	memmove(in->data, in->data + loader->in_pos,
+		in->size - loader->in_pos);
+	in->size -= loader->in_pos;
+	loader->in_pos = 0;
+	char *data = load_buf_reserve(in, LOADER_READ_SIZE);
+	if (data == NULL)
+		return -1;
+	ssize_t n;
+	do {
+		n = read(loader->fd, data, LOADER_READ_SIZE);
+	} while (n < 0 && errno == EINTR);
+	if (n < 0) {
+		diag_set(SystemError, "failed to read '%s'", loader->path);
+		return -1;
+	}
+	if (n == 0)
+		loader->is_eof = true;
+	in->size += n;
+	return 0;
+}
+
+/**
+ * Fill a batch with parsed rows. Runs in a coio thread.
+ * An empty batch means the end of input.
+ */
+static ssize_t
+loader_parse_batch_f(va_list ap)
+{
+	struct loader *loader = va_arg(ap, struct loader *);
+	struct load_batch *batch = va_arg(ap, struct load_batch *);
+	batch->buf.size = 0;
+	batch->row_count = 0;
+	batch->first_row = loader->row + 1;
+	if (loader->row == 0 && loader->opts.skip_header)
+		batch->first_row++;
+	while (batch->buf.size < LOADER_BATCH_SIZE) {
+		int rc = loader->opts.format == LOAD_FORMAT_CSV ?
+			 loader_parse_csv_row(loader, batch) :
+			 loader_parse_msgpack_row(loader, batch);
+		if (rc < 0)
+			return -1;
+		if (rc > 0)
+			continue;
+		if (loader->is_eof)
+			break;
+		if (loader_read(loader) != 0)
+			return -1;
+	}
+	return 0;
+}
+
+/**
+ * The parser fiber: parses the input in a coio thread one
+ * batch at a time, so that parsing of the next batch overlaps
+ * with making tuples of the previous one in tx.
+ */
+static int
+loader_parser_f(va_list ap)
+{
+	struct loader *loader = va_arg(ap, struct loader *);
+	int rc = 0;
+	for (uint32_t i = 0; !loader->is_stopped; i++) {
+		struct load_batch *batch =
+			&loader->batches[i % LOADER_BATCH_COUNT];
+		while (batch->is_ready && !loader->is_stopped)
+			fiber_cond_wait(&loader->cond);
+		if (loader->is_stopped)
+			break;
+		if (coio_call(loader_parse_batch_f, loader, batch) != 0) {
+			rc = -1;
+			break;
+		}
+		if (batch->row_count == 0)
+			break;
+		batch->is_ready = true;
+		fiber_cond_broadcast(&loader->cond);
+	}
+	loader->is_done = true;
+	fiber_cond_broadcast(&loader->cond);
+	return rc;
+}
+
+/** Make tuples of a parsed batch. */
+static int
+loader_consume_batch(struct loader *loader, struct space *space,
+		     struct load_batch *batch)
+{
+	size_t count = loader->tuple_count + batch->row_count;
+	if (count > loader->tuple_capacity) {
+		size_t capacity = MAX(loader->tuple_capacity * 2, count);
+		struct tuple **tuples = realloc(loader->tuples,
+						capacity * sizeof(*tuples));
+		if (tuples == NULL) {
+			diag_set(OutOfMemory, capacity * sizeof(*tuples),
+				 "realloc", "tuples");
+			return -1;
+		}
+		loader->tuples = tuples;
+		loader->tuple_capacity = capacity;
+	}
+	const char *data = batch->buf.data;
+	for (uint32_t i = 0; i < batch->row_count; i++) {
+		const char *row = data;
+		mp_next(&data);
+		struct tuple *tuple = tuple_new(space->format, row, data);
+		if (tuple == NULL) {
+			struct error *e = diag_last_error(diag_get());
+			diag_set(ClientError, ER_LOAD_DATA, loader->path,
+				 (unsigned long long)batch->first_row + i,
+				 e->errmsg);
+			return -1;
+		}
+		tuple_ref(tuple);
+		loader->tuples[loader->tuple_count++] = tuple;
+	}
+	return 0;
+}
+
+static int
+loader_tuple_compare(const void *a, const void *b, void *arg)
+{
+	return tuple_compare(*(struct tuple **)a, HINT_NONE,
+			     *(struct tuple **)b, HINT_NONE,
+			     (struct key_def *)arg);
+}
+
+/**
+ * Sort the tuples by the primary key unless they are sorted
+ * already, and check that there are no duplicates, which
+ * memtx_tree_build() does not expect.
+ */
+static int
+loader_sort(struct loader *loader, struct space *space, struct index *pk)
+{
+	struct key_def *cmp_def = pk->def->cmp_def;
+	struct tuple **tuples = loader->tuples;
+	bool is_sorted = true;
+	for (size_t i = 1; i < loader->tuple_count && is_sorted; i++) {
+		if (tuple_compare(tuples[i - 1], HINT_NONE, tuples[i],
+				  HINT_NONE, cmp_def) >= 0)
+			is_sorted = false;
+	}
+	if (is_sorted)
+		return 0;
+	qsort_arg(tuples, loader->tuple_count, sizeof(*tuples),
+		  loader_tuple_compare, cmp_def);
+	for (size_t i = 1; i < loader->tuple_count; i++) {
+		if (tuple_compare(tuples[i - 1], HINT_NONE, tuples[i],
+				  HINT_NONE, cmp_def) == 0) {
+			diag_set(ClientError, ER_TUPLE_FOUND, pk->def->name,
+				 space_name(space));
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * Insert the tuples into an index one by one. @a count is set
+ * to the number of tuples the index has accepted.
+ */
+static int
+loader_insert(struct loader *loader, struct index *index, size_t *count)
+{
+	for (*count = 0; *count < loader->tuple_count; ++*count) {
+		struct tuple *unused;
+		if (index_replace(index, NULL, loader->tuples[*count],
+				  DUP_INSERT, &unused) != 0)
+			return -1;
+	}
+	return 0;
+}
+
+/**
+ * Build an index of the tuples in bulk. Unlike index_build(),
+ * counts the tuples the index has accepted in @a count.
+ */
+static int
+loader_build_index(struct loader *loader, struct index *index,
+		   size_t *count)
+{
+	*count = 0;
+	index_begin_build(index);
+	int rc = index_reserve(index, loader->tuple_count);
+	while (rc == 0 && *count < loader->tuple_count) {
+		rc = index_build_next(index, loader->tuples[*count]);
+		if (rc == 0)
+			++*count;
+	}
+	/* Finish the build anyway to leave the index consistent. */
+	index_end_build(index);
+	return rc;
+}
+
+/** Build the primary key of the tuples. */
+static int
+loader_build_pk(struct loader *loader, struct space *space, size_t *count)
+{
+	struct index *pk = space->index[0];
+	*count = 0;
+	if (pk->def->type != TREE)
+		return loader_insert(loader, pk, count);
+	if (loader_sort(loader, space, pk) != 0)
+		return -1;
+	return loader_build_index(loader, pk, count);
+}
+
+/** Delete the first @a count tuples from an index. */
+static void
+loader_delete(struct loader *loader, struct index *index, size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		struct tuple *unused;
+		index_replace(index, loader->tuples[i], NULL,
+			      DUP_REPLACE_OR_INSERT, &unused);
+	}
+}
+
+/**
+ * Put the loaded tuples into the space indexes. Runs without
+ * yields, so the space can't change under our feet.
+ */
+static int
+loader_build(struct loader *loader, struct space *space)
+{
+	uint32_t i = 0;
+	size_t count;
+	int rc = loader_build_pk(loader, space, &count);
+	while (rc == 0 && ++i < space->index_count) {
+		struct index *index = space->index[i];
+		if (index->def->opts.is_unique) {
+			/* Only insertion checks uniqueness. */
+			rc = loader_insert(loader, index, &count);
+		} else {
+			rc = loader_build_index(loader, index, &count);
+		}
+	}
+	if (rc == 0) {
+		/* The primary key keeps the references now. */
+		for (size_t j = 0; j < loader->tuple_count; j++)
+			memtx_space_update_bsize(space, NULL,
+						 loader->tuples[j]);
+		loader->tuple_count = 0;
+		return 0;
+	}
+	/*
+	 * Index i failed after accepting count tuples, the
+	 * indexes before it have accepted all of them. Deleting
+	 * a tuple an index doesn't have is not allowed.
+	 */
+	loader_delete(loader, space->index[i], count);
+	while (i-- > 0)
+		loader_delete(loader, space->index[i], loader->tuple_count);
+	return -1;
+}
+
+/**
+ * Check if there are instances that replicate from this one.
+ * They would never get the loaded data, as it bypasses WAL.
+ */
+static bool
+loader_has_replicas(void)
+{
+	if (replicaset.anon_count > 0)
+		return true;
+	replicaset_foreach(replica) {
+		if (replica->id != REPLICA_ID_NIL &&
+		    replica->id != instance_id)
+			return true;
+	}
+	return false;
+}
+
+/** Check if tuples can be loaded into a space bypassing WAL. */
+static int
+loader_check_space(struct space *space)
+{
+	/* Same check as for INSERT, see box_process_rw(). */
+	if (access_check_space(space, PRIV_W) != 0)
+		return -1;
+	if (!space_is_memtx(space)) {
+		diag_set(ClientError, ER_UNSUPPORTED, space->engine->name,
+			 "box.load()");
+		return -1;
+	}
+	struct memtx_space *memtx_space = (struct memtx_space *)space;
+	struct memtx_engine *memtx = (struct memtx_engine *)space->engine;
+	const char *msg = NULL;
+	if (space->index_count == 0)
+		msg = "the space has no primary key";
+	else if (index_size(space->index[0]) != 0)
+		msg = "the space is not empty";
+	else if (memtx_space->replace != memtx_space_replace_all_keys)
+		msg = "the space is being recovered";
+	else if (space_is_system(space))
+		msg = "the space is a system one";
+	else if (space->sequence != NULL ||
+		 !rlist_empty(&space->before_replace) ||
+		 !rlist_empty(&space->on_replace) ||
+		 !rlist_empty(&space->ck_constraint) ||
+		 !rlist_empty(&space->child_fk_constraint) ||
+		 !rlist_empty(&space->parent_fk_constraint))
+		msg = "the space has triggers, constraints or a sequence";
+	else if (memtx->checkpoint != NULL ||
+		 memtx->replica_join_count > 0)
+		msg = "a checkpoint or a replica join is in progress";
+	else if (loader_has_replicas())
+		msg = "the instance has replicas";
+	if (msg != NULL) {
+		diag_set(ClientError, ER_ILLEGAL_PARAMS,
+			 tt_sprintf("can't load into space '%s': %s",
+				    space_name(space), msg));
+		return -1;
+	}
+	return 0;
+}
+
+static int
+loader_create(struct loader *loader, struct space *space, const char *path,
+	      const struct load_opts *opts)
+{
+	memset(loader, 0, sizeof(*loader));
+	loader->path = path;
+	loader->opts = *opts;
+	loader->fd = -1;
+	load_buf_create(&loader->in);
+	load_buf_create(&loader->row_buf);
+	load_buf_create(&loader->field_buf);
+	for (int i = 0; i < LOADER_BATCH_COUNT; i++)
+		load_buf_create(&loader->batches[i].buf);
+	fiber_cond_create(&loader->cond);
+
+	uint32_t count = tuple_format_field_count(space->format);
+	loader->types = malloc(count * sizeof(*loader->types) + 1);
+	loader->is_nullable = malloc(count * sizeof(*loader->is_nullable) + 1);
+	if (loader->types == NULL || loader->is_nullable == NULL) {
+		diag_set(OutOfMemory, count * sizeof(*loader->types),
+			 "malloc", "types");
+		return -1;
+	}
+	for (uint32_t i = 0; i < count; i++) {
+		struct tuple_field *field =
+			tuple_format_field(space->format, i);
+		loader->types[i] = field->type;
+		loader->is_nullable[i] = tuple_field_is_nullable(field);
+	}
+	loader->type_count = count;
+
+	loader->fd = coio_file_open(path, O_RDONLY, 0);
+	if (loader->fd < 0) {
+		diag_set(SystemError, "failed to open '%s'", path);
+		return -1;
+	}
+	return 0;
+}
+
+static void
+loader_destroy(struct loader *loader)
+{
+	for (size_t i = 0; i < loader->tuple_count; i++)
+		tuple_unref(loader->tuples[i]);
+	free(loader->tuples);
+	if (loader->fd >= 0)
+		close(loader->fd);
+	free(loader->types);
+	free(loader->is_nullable);
+	for (int i = 0; i < LOADER_BATCH_COUNT; i++)
+		load_buf_destroy(&loader->batches[i].buf);
+	load_buf_destroy(&loader->field_buf);
+	load_buf_destroy(&loader->row_buf);
+	load_buf_destroy(&loader->in);
+	fiber_cond_destroy(&loader->cond);
+}
+
+/**
+ * Parse the input and make tuples of it. The schema must stay
+ * at @a version, so that @a space stays valid.
+ */
+static int
+loader_read_tuples(struct loader *loader, uint32_t version,
+		   struct space *space)
+{
+	struct fiber *parser = fiber_new("loader", loader_parser_f);
+	if (parser == NULL)
+		return -1;
+	fiber_set_joinable(parser, true);
+	fiber_start(parser, loader);
+	int rc = 0;
+	for (uint32_t i = 0; rc == 0; i++) {
+		struct load_batch *batch =
+			&loader->batches[i % LOADER_BATCH_COUNT];
+		while (!batch->is_ready && !loader->is_done) {
+			if (fiber_cond_wait(&loader->cond) != 0) {
+				rc = -1;
+				break;
+			}
+		}
+		if (rc != 0 || !batch->is_ready)
+			break;
+		/* The space may have been altered while we waited. */
+		if (schema_version != version) {
+			diag_set(ClientError, ER_ILLEGAL_PARAMS,
+				 "space was altered while being loaded");
+			rc = -1;
+			break;
+		}
+		rc = loader_consume_batch(loader, space, batch);
+		batch->is_ready = false;
+		fiber_cond_broadcast(&loader->cond);
+	}
+	loader->is_stopped = true;
+	fiber_cond_broadcast(&loader->cond);
+	if (rc != 0) {
+		/* Keep our error, not the parser one. */
+		struct diag diag;
+		diag_create(&diag);
+		diag_move(diag_get(), &diag);
+		fiber_join(parser);
+		diag_move(&diag, diag_get());
+		diag_destroy(&diag);
+		return -1;
+	}
+	return fiber_join(parser);
+}
+
+ssize_t
+load_file(uint32_t space_id, const char *path, const struct load_opts *opts)
+{
+	if (in_txn() != NULL) {
+		diag_set(ClientError, ER_UNSUPPORTED, "Transaction",
+			 "box.load()");
+		return -1;
+	}
+	struct space *space = space_cache_find(space_id);
+	if (space == NULL || loader_check_space(space) != 0)
+		return -1;
+	/*
+	 * Any DDL bumps the schema version, while comparing
+	 * space pointers could miss a space dropped and created
+	 * anew at the same address.
+	 */
+	uint32_t version = schema_version;
+	double start = clock_monotonic();
+	struct loader loader;
+	ssize_t rc = -1;
+	if (loader_create(&loader, space, path, opts) != 0)
+		goto out;
+	if (loader_read_tuples(&loader, version, space) != 0)
+		goto out;
+	/* Recheck the space as it could change while we yielded. */
+	if (schema_version != version) {
+		diag_set(ClientError, ER_ILLEGAL_PARAMS,
+			 "space was altered while being loaded");
+		goto out;
+	}
+	if (loader_check_space(space) != 0)
+		goto out;
+	rc = loader.tuple_count;
+	say_info("loaded %zd tuples from '%s', building indexes of "
+		 "space '%s'", rc, path, space_name(space));
+	if (loader_build(&loader, space) != 0) {
+		rc = -1;
+		goto out;
+	}
+	say_info("space '%s' loaded in %.3f sec", space_name(space),
+		 clock_monotonic() - start);
+out:
+	loader_destroy(&loader);
+	return rc;
+}
@@ -0,0 +1,98 @@
+#ifndef TARANTOOL_BOX_LOADER_H_INCLUDED
+#define TARANTOOL_BOX_LOADER_H_INCLUDED
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+/** Format of a box.load() input file. */
+enum load_format {
+	/** Text lines of delimited fields, RFC 4180 quoting. */
+	LOAD_FORMAT_CSV,
+	/** A stream of MsgPack arrays, one per tuple. */
+	LOAD_FORMAT_MSGPACK,
+	load_format_MAX,
+};
+
+extern const char *load_format_strs[];
+
+struct load_opts {
+	enum load_format format;
+	/** CSV field delimiter. */
+	char delimiter;
+	/** CSV quote character. */
+	char quote_char;
+	/** Skip the first CSV line, which is a header. */
+	bool skip_header;
+	/**
+	 * Make a checkpoint once the data is loaded. Without it
+	 * the loaded data is lost on restart, unless a checkpoint
+	 * is made later by other means.
+	 */
+	bool checkpoint;
+};
+
+/** Initialize load options with default values. */
+void
+load_opts_create(struct load_opts *opts);
+
+/**
+ * Load a file into an empty memtx space.
+ *
+ * The file is parsed in a coio thread while the tx thread
+ * makes tuples of the already parsed part. Once the whole file
+ * is read, the indexes are built in bulk the same way they are
+ * during snapshot recovery: the primary key is sorted once,
+ * unless the input is already sorted, instead of being updated
+ * tuple by tuple. The loaded tuples are not written to WAL and
+ * are not replicated, they become persistent with the next
+ * checkpoint. Until then a restart loses them, while the rows
+ * written to WAL after the load are kept. So the load is refused
+ * if the instance has replicas. Nothing is loaded if any row
+ * fails to parse or violates the space format or a unique
+ * constraint.
+ *
+ * @retval >= 0 the number of loaded tuples.
+ * @retval -1 error, diag is set.
+ */
+ssize_t
+load_file(uint32_t space_id, const char *path, const struct load_opts *opts);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_BOX_LOADER_H_INCLUDED */
@@ -44,6 +44,7 @@
 #include "box/vclock.h"
 #include "box/session.h"
 #include "box/mp_error.h"
+#include "box/loader.h"
 
 #include "box/lua/error.h"
 #include "box/lua/tuple.h"
@@ -65,6 +66,9 @@
 #include "box/lua/execute.h"
 #include "box/lua/key_def.h"
 #include "box/lua/merger.h"
+#include "box/lua/profiler.h"
+#include "box/lua/trace.h"
+#include "box/lua/tuple_batch.h"
 
 #include "mpstream/mpstream.h"
 
@@ -340,6 +344,74 @@ lbox_snapshot(struct lua_State *L)
 	return luaT_error(L);
 }
 
+/** Get a single character option of box.load(). */
+static int
+lbox_load_char_opt(struct lua_State *L, int idx, const char *name, char *c)
+{
+	lua_getfield(L, idx, name);
+	if (!lua_isnil(L, -1)) {
+		size_t len;
+		const char *str = lua_tolstring(L, -1, &len);
+		if (str == NULL || len != 1)
+			return -1;
+		*c = *str;
+	}
+	lua_pop(L, 1);
+	return 0;
+}
+
+/**
+ * box.load(space, path[, {format = 'csv' | 'msgpack',
+ *                        delimiter = ',', quote_char = '"',
+ *                        skip_header = false, checkpoint = true}])
+ */
+static int
+lbox_load(struct lua_State *L)
+{
+	static const char *usage = "Usage: box.load(space, path[, opts])";
+	int top = lua_gettop(L);
+	if (top < 2 || top > 3 || lua_type(L, 2) != LUA_TSTRING ||
+	    (top == 3 && !lua_isnil(L, 3) && !lua_istable(L, 3)))
+		return luaL_error(L, usage);
+	/* Accept both a space object and a space id. */
+	if (lua_istable(L, 1)) {
+		lua_getfield(L, 1, "id");
+		lua_replace(L, 1);
+	}
+	if (!lua_isnumber(L, 1))
+		return luaL_error(L, usage);
+	uint32_t space_id = lua_tonumber(L, 1);
+	const char *path = lua_tostring(L, 2);
+	struct load_opts opts;
+	load_opts_create(&opts);
+	if (top == 3 && lua_istable(L, 3)) {
+		lua_getfield(L, 3, "format");
+		if (!lua_isnil(L, -1)) {
+			const char *format = lua_tostring(L, -1);
+			opts.format = format == NULL ? load_format_MAX :
+				      STR2ENUM(load_format, format);
+			if (opts.format == load_format_MAX)
+				return luaL_error(L, usage);
+		}
+		lua_pop(L, 1);
+		if (lbox_load_char_opt(L, 3, "delimiter",
+				       &opts.delimiter) != 0 ||
+		    lbox_load_char_opt(L, 3, "quote_char",
+				       &opts.quote_char) != 0)
+			return luaL_error(L, usage);
+		lua_getfield(L, 3, "skip_header");
+		opts.skip_header = lua_toboolean(L, -1);
+		lua_getfield(L, 3, "checkpoint");
+		opts.checkpoint = lua_isnil(L, -1) || lua_toboolean(L, -1);
+		lua_pop(L, 2);
+	}
+	ssize_t count = box_load(space_id, path, &opts);
+	if (count < 0)
+		return luaT_error(L);
+	lua_pushinteger(L, count);
+	return 1;
+}
+
 /** Argument passed to lbox_backup_fn(). */
 struct lbox_backup_arg {
 	/** Lua state. */
@@ -390,6 +462,7 @@ static const struct luaL_Reg boxlib[] = {
 	{"on_commit", lbox_on_commit},
 	{"on_rollback", lbox_on_rollback},
 	{"snapshot", lbox_snapshot},
+	{"load", lbox_load},
 	{"rollback_to_savepoint", lbox_rollback_to_savepoint},
 	{NULL, NULL}
 };
@@ -471,9 +544,12 @@ box_lua_init(struct lua_State *L)
 	box_lua_space_init(L);
 	box_lua_sequence_init(L);
 	box_lua_misc_init(L);
+	box_lua_tuple_batch_init(L);
 	box_lua_info_init(L);
 	box_lua_stat_init(L);
 	box_lua_ctl_init(L);
+	box_lua_profiler_init(L);
+	box_lua_trace_init(L);
 	box_lua_session_init(L);
 	box_lua_xlog_init(L);
 	box_lua_sql_init(L);
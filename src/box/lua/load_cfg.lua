@@ -61,6 +61,8 @@ local default_cfg = {
     vinyl_bloom_fpr           = 0.05,
     log                 = nil,
     log_nonblock        = nil,
+    log_async           = nil,
+    log_async_overflow  = nil,
     log_level           = 5,
     log_format          = "plain",
     io_collect_interval = nil,
@@ -82,6 +84,7 @@ local default_cfg = {
     read_only           = false,
     hot_standby         = false,
     checkpoint_interval = 3600,
+    checkpoint_on_shutdown = false,
     checkpoint_wal_threshold = 1e18,
     checkpoint_count    = 2,
     worker_pool_threads = 4,
@@ -92,6 +95,8 @@ local default_cfg = {
     replication_connect_quorum = nil, -- connect all
     replication_skip_conflict = false,
     replication_anon      = false,
+    replication_fetch_checkpoint = false,
+    replication_join_streams = 1,
     feedback_enabled      = true,
     feedback_host         = "https://feedback.tarantool.io",
     feedback_interval     = 3600,
@@ -126,6 +131,8 @@ local template_cfg = {
 
     log              = 'string',
     log_nonblock     = 'boolean',
+    log_async        = 'boolean',
+    log_async_overflow = 'string',
     log_level           = 'number',
     log_format          = 'string',
     io_collect_interval = 'number',
@@ -145,6 +152,7 @@ local template_cfg = {
     username            = 'string',
     coredump            = 'boolean',
     checkpoint_interval = 'number',
+    checkpoint_on_shutdown = 'boolean',
     checkpoint_wal_threshold = 'number',
     checkpoint_count    = 'number',
     read_only           = 'boolean',
@@ -157,6 +165,8 @@ local template_cfg = {
     replication_connect_quorum = 'number',
     replication_skip_conflict = 'boolean',
     replication_anon      = 'boolean',
+    replication_fetch_checkpoint = 'boolean',
+    replication_join_streams = 'number',
     feedback_enabled      = ifdef_feedback('boolean'),
     feedback_host         = ifdef_feedback('string'),
     feedback_interval     = ifdef_feedback('number'),
@@ -248,6 +258,8 @@ local dynamic_cfg = {
     vinyl_timeout           = private.cfg_set_vinyl_timeout,
     checkpoint_count        = private.cfg_set_checkpoint_count,
     checkpoint_interval     = private.cfg_set_checkpoint_interval,
+    -- read on shutdown
+    checkpoint_on_shutdown  = function() end,
     checkpoint_wal_threshold = private.cfg_set_checkpoint_wal_threshold,
     worker_pool_threads     = private.cfg_set_worker_pool_threads,
     feedback_enabled        = ifdef_feedback_set_params,
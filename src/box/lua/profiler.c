@@ -0,0 +1,188 @@
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY AUTHORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * AUTHORS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "box/lua/profiler.h"
+
+#include <stdio.h>
+
+#include <lua.h>
+#include <lauxlib.h>
+
+#include "lua/utils.h"
+#include "fiber.h"
+#include "profiler.h"
+
+/** Default sampling interval, in seconds of CPU time. */
+static const double PROFILER_INTERVAL_DEFAULT = 0.01;
+
+/**
+ * The hook that was set on the Lua stack before the profiler
+ * requested a frame, restored once the frame is taken.
+ */
+static lua_Hook lua_profiler_saved_hook = NULL;
+static int lua_profiler_saved_mask = 0;
+static int lua_profiler_saved_count = 0;
+/** The fiber interrupted by the signal handler. */
+static struct fiber *lua_profiler_fiber = NULL;
+
+static void
+lua_profiler_hook(struct lua_State *L, lua_Debug *ar);
+
+/**
+ * Frame request callback, runs in the signal handler. Lua
+ * state may be in the middle of anything, so the only safe
+ * thing is to set a hook firing on the next VM instruction.
+ */
+static bool
+lua_profiler_frame_request(void)
+{
+	struct fiber *f = fiber();
+	struct lua_State *L = f->storage.lua.stack;
+	if (L == NULL)
+		return false;
+	lua_Hook hook = lua_gethook(L);
+	if (hook != lua_profiler_hook) {
+		lua_profiler_saved_hook = hook;
+		lua_profiler_saved_mask = lua_gethookmask(L);
+		lua_profiler_saved_count = lua_gethookcount(L);
+	}
+	lua_profiler_fiber = f;
+	lua_sethook(L, lua_profiler_hook, LUA_MASKCOUNT, 1);
+	return true;
+}
+
+static void
+lua_profiler_hook(struct lua_State *L, lua_Debug *ar)
+{
+	(void)ar;
+	lua_sethook(L, lua_profiler_saved_hook, lua_profiler_saved_mask,
+		    lua_profiler_saved_count);
+	if (fiber() != lua_profiler_fiber)
+		return;
+	lua_Debug info;
+	if (lua_getstack(L, 0, &info) == 0 ||
+	    lua_getinfo(L, "Sln", &info) == 0)
+		return;
+	char name[PROFILER_FRAME_NAME_MAX];
+	snprintf(name, sizeof(name), "%s@%s:%d",
+		 info.name != NULL ? info.name : "?", info.short_src,
+		 info.currentline);
+	profiler_set_frame(name);
+}
+
+static int
+lbox_profiler_start(struct lua_State *L)
+{
+	double interval = PROFILER_INTERVAL_DEFAULT;
+	if (!lua_isnoneornil(L, 1)) {
+		if (!lua_istable(L, 1))
+			goto usage;
+		lua_getfield(L, 1, "interval");
+		if (lua_isnumber(L, -1))
+			interval = lua_tonumber(L, -1);
+		else if (!lua_isnil(L, -1))
+			goto usage;
+		lua_pop(L, 1);
+	}
+	if (profiler_start(interval) != 0)
+		return luaT_error(L);
+	return 0;
+usage:
+	return luaL_error(L, "Usage: box.profiler.start([{interval = "
+			  "<seconds>}])");
+}
+
+static int
+lbox_profiler_stop(struct lua_State *L)
+{
+	(void)L;
+	profiler_stop();
+	return 0;
+}
+
+static int
+lbox_profiler_dump_cb(const char *stack, uint64_t count, void *ctx)
+{
+	luaL_Buffer *b = (luaL_Buffer *)ctx;
+	char buf[32];
+	luaL_addstring(b, stack);
+	snprintf(buf, sizeof(buf), " %llu\n", (unsigned long long)count);
+	luaL_addstring(b, buf);
+	return 0;
+}
+
+/**
+ * Return the collected stacks in the folded format, one
+ * "frame;frame;... count" line per distinct stack, ready to be
+ * fed to flame graph tools.
+ */
+static int
+lbox_profiler_dump(struct lua_State *L)
+{
+	luaL_Buffer b;
+	luaL_buffinit(L, &b);
+	if (profiler_dump(lbox_profiler_dump_cb, &b) != 0)
+		return luaT_error(L);
+	luaL_pushresult(&b);
+	return 1;
+}
+
+static int
+lbox_profiler_stat(struct lua_State *L)
+{
+	struct profiler_stat stat;
+	profiler_stat(&stat);
+	lua_createtable(L, 0, 4);
+	lua_pushboolean(L, profiler_is_running());
+	lua_setfield(L, -2, "running");
+	luaL_pushuint64(L, stat.samples);
+	lua_setfield(L, -2, "samples");
+	luaL_pushuint64(L, stat.dropped);
+	lua_setfield(L, -2, "dropped");
+	luaL_pushuint64(L, stat.stacks);
+	lua_setfield(L, -2, "stacks");
+	return 1;
+}
+
+static const struct luaL_Reg lbox_profiler_lib[] = {
+	{"start", lbox_profiler_start},
+	{"stop", lbox_profiler_stop},
+	{"dump", lbox_profiler_dump},
+	{"stat", lbox_profiler_stat},
+	{NULL, NULL}
+};
+
+void
+box_lua_profiler_init(struct lua_State *L)
+{
+	profiler_set_frame_request(lua_profiler_frame_request, "lua");
+	luaL_register_module(L, "box.profiler", lbox_profiler_lib);
+	lua_pop(L, 1);
+}
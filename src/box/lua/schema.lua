@@ -413,6 +413,7 @@ box.schema.space.create = function(name, options)
         format = 'table',
         is_local = 'boolean',
         temporary = 'boolean',
+        expire_field = 'number, string',
     }
     local options_defaults = {
         engine = 'memtx',
@@ -453,10 +454,24 @@ box.schema.space.create = function(name, options)
     local format = options.format and options.format or {}
     check_param(format, 'format', 'table')
     format = update_format(format)
+    local expire_field = options.expire_field
+    if type(expire_field) == 'string' then
+        for i, field in ipairs(format) do
+            if field.name == expire_field then
+                expire_field = i
+                break
+            end
+        end
+        if type(expire_field) == 'string' then
+            box.error(box.error.ILLEGAL_PARAMS,
+                      "expire_field: unknown field '" .. expire_field .. "'")
+        end
+    end
     -- filter out global parameters from the options array
     local space_options = setmap({
         group_id = options.is_local and 1 or nil,
         temporary = options.temporary and true or nil,
+        expire_field = expire_field and expire_field - 1 or nil,
     })
     _space:insert{id, uid, name, options.engine, options.field_count,
         space_options, format}
@@ -942,6 +957,8 @@ local index_options = {
     page_size = 'number',
     bloom_fpr = 'number',
     func = 'number, string',
+    hint = 'string',
+    hash_func = 'string',
 }
 
 --
@@ -1057,6 +1074,8 @@ box.schema.index.create = function(space_id, name, options)
             run_size_ratio = options.run_size_ratio,
             bloom_fpr = options.bloom_fpr,
             func = options.func,
+            hint = options.hint,
+            hash_func = options.hash_func,
     }
     local field_type_aliases = {
         num = 'unsigned'; -- Deprecated since 1.7.2
@@ -1561,6 +1580,16 @@ base_index_mt.select_luac = function(index, key, opts)
         offset, limit, key)
 end
 
+-- Same as select(), but returns a box.tuple_batch object: a
+-- single GC object instead of a cdata per tuple.
+base_index_mt.select_batch = function(index, key, opts)
+    check_index_arg(index, 'select_batch')
+    local key = keify(key)
+    local iterator, offset, limit = check_select_opts(opts, #key == 0)
+    return internal.select_batch(index.space_id, index.id, iterator,
+        offset, limit, key)
+end
+
 base_index_mt.update = function(index, key, ops)
     check_index_arg(index, 'update')
     return internal.update(index.space_id, index.id, keify(key), ops);
@@ -1639,6 +1668,10 @@ space_mt.select = function(space, key, opts)
     check_space_arg(space, 'select')
     return check_primary_index(space):select(key, opts)
 end
+space_mt.select_batch = function(space, key, opts)
+    check_space_arg(space, 'select_batch')
+    return check_primary_index(space):select_batch(key, opts)
+end
 space_mt.insert = function(space, tuple)
     check_space_arg(space, 'insert')
     return internal.insert(space.id, tuple);
@@ -1731,7 +1764,27 @@ space_mt.run_triggers = function(space, yesno)
     end
     builtin.space_run_triggers(s, yesno)
 end
+space_mt.aggregate = function(space, op, field)
+    check_space_arg(space, 'aggregate')
+    if field == nil then
+        field = 1
+    elseif type(field) == 'string' then
+        local fieldno = nil
+        for i, f in ipairs(space:format()) do
+            if f.name == field then
+                fieldno = i
+                break
+            end
+        end
+        if fieldno == nil then
+            box.error(box.error.NO_SUCH_FIELD_NAME_IN_SPACE, field, space.name)
+        end
+        field = fieldno
+    end
+    return box.internal.space.aggregate(space, op, field)
+end
 space_mt.frommap = box.internal.space.frommap
+space_mt.expire_stat = box.internal.space.expire_stat
 space_mt.__index = space_mt
 
 local ck_constraint_mt = {}
@@ -51,6 +51,8 @@ extern "C" {
 #include "box/txn.h"
 #include "box/vclock.h" /* VCLOCK_MAX */
 #include "box/sequence.h"
+#include "box/memtx_expire.h"
+#include "box/column_engine.h"
 #include "box/coll_id_cache.h"
 #include "box/replication.h" /* GROUP_LOCAL */
 #include "box/iproto_constants.h" /* iproto_type_name */
@@ -598,6 +600,92 @@ usage_error:
 	return luaL_error(L, "Usage: space:frommap(map, opts)");
 }
 
+/**
+ * Get expiration statistics of a space.
+ * @param Lua space object.
+ * @retval A table with the number of expired tuples deleted
+ *         so far and the number of the ones pending deletion.
+ */
+static int
+lbox_space_expire_stat(struct lua_State *L)
+{
+	if (lua_gettop(L) != 1 || !lua_istable(L, 1))
+		return luaL_error(L, "Usage: space:expire_stat()");
+	lua_getfield(L, 1, "id");
+	uint32_t id = (uint32_t)lua_tointeger(L, -1);
+	struct space *space = space_cache_find(id);
+	if (space == NULL)
+		return luaT_error(L);
+	struct memtx_expire_stat stat = { 0, 0 };
+	/* Only memtx spaces may have the expire field. */
+	if (space->def->opts.expire_field != SPACE_EXPIRE_FIELD_NONE &&
+	    memtx_expire_stat(space, &stat) != 0)
+		return luaT_error(L);
+	lua_newtable(L);
+	luaL_pushuint64(L, stat.expired);
+	lua_setfield(L, -2, "expired");
+	luaL_pushuint64(L, stat.pending);
+	lua_setfield(L, -2, "pending");
+	return 1;
+}
+
+/**
+ * Compute an aggregate function over a field of a column space.
+ * @param Lua space object.
+ * @param Lua aggregate function name: count, sum, min or max.
+ * @param Lua field number, 1-based.
+ * @retval The aggregate value or nil if there are no rows.
+ */
+static int
+lbox_space_aggregate(struct lua_State *L)
+{
+	if (lua_gettop(L) != 3 || !lua_istable(L, 1) ||
+	    lua_type(L, 2) != LUA_TSTRING || !lua_isnumber(L, 3))
+		return luaL_error(L, "Usage: space:aggregate(op, field)");
+	const char *name = lua_tostring(L, 2);
+	enum column_aggregate_op op = STR2ENUM(column_aggregate_op, name);
+	if (op == column_aggregate_op_MAX)
+		return luaL_error(L, "Unknown aggregate function '%s'", name);
+	int fieldno = lua_tointeger(L, 3);
+	if (fieldno < TUPLE_INDEX_BASE) {
+		diag_set(ClientError, ER_NO_SUCH_FIELD_NO, fieldno);
+		return luaT_error(L);
+	}
+	lua_getfield(L, 1, "id");
+	uint32_t id = (uint32_t)lua_tointeger(L, -1);
+	struct space *space = space_cache_find(id);
+	if (space == NULL)
+		return luaT_error(L);
+	struct column_value value;
+	if (column_space_aggregate(space, fieldno - TUPLE_INDEX_BASE,
+				   op, &value) != 0)
+		return luaT_error(L);
+	if (value.is_null) {
+		lua_pushnil(L);
+		return 1;
+	}
+	switch (value.type) {
+	case COLUMN_UNSIGNED:
+		luaL_pushuint64(L, value.u);
+		break;
+	case COLUMN_INTEGER:
+		luaL_pushint64(L, value.i);
+		break;
+	case COLUMN_DOUBLE:
+		lua_pushnumber(L, value.d);
+		break;
+	case COLUMN_STRING:
+		lua_pushlstring(L, value.str.data, value.str.len);
+		break;
+	case COLUMN_BOOLEAN:
+		lua_pushboolean(L, value.b);
+		break;
+	default:
+		unreachable();
+	}
+	return 1;
+}
+
 void
 box_lua_space_init(struct lua_State *L)
 {
@@ -697,6 +785,8 @@ box_lua_space_init(struct lua_State *L)
 
 	static const struct luaL_Reg space_internal_lib[] = {
 		{"frommap", lbox_space_frommap},
+		{"expire_stat", lbox_space_expire_stat},
+		{"aggregate", lbox_space_aggregate},
 		{NULL, NULL}
 	};
 	luaL_register(L, "box.internal.space", space_internal_lib);
@@ -42,7 +42,9 @@
 #include "box/iproto.h"
 #include "box/engine.h"
 #include "box/vinyl.h"
+#include "box/wal.h"
 #include "box/sql.h"
+#include "coio_task.h"
 #include "info/info.h"
 #include "lua/info.h"
 #include "lua/utils.h"
@@ -133,9 +135,78 @@ lbox_stat_reset(struct lua_State *L)
 	(void)L;
 	box_reset_stat();
 	iproto_reset_stat();
+	wal_reset_stat();
 	return 0;
 }
 
+/**
+ * Push a table of latency percentiles to a Lua stack: per
+ * iproto request type split into queue, tx and wal parts,
+ * and for WAL writes.
+ */
+static int
+lbox_stat_latency(struct lua_State *L)
+{
+	struct info_handler h;
+	luaT_info_handler_create(&h, L);
+	info_begin(&h);
+	iproto_latency_stat(&h);
+	wal_latency_stat(&h);
+	info_end(&h);
+	return 1;
+}
+
+/** Push statistics of a coio submission queue to a Lua stack. */
+static void
+lbox_stat_push_coio_queue(struct lua_State *L, unsigned queue)
+{
+	struct eio_queue_stat stat;
+	eio_queue_stat(queue, &stat);
+	lua_newtable(L);
+	luaL_pushuint64(L, stat.submitted);
+	lua_setfield(L, -2, "submitted");
+	luaL_pushuint64(L, stat.executed);
+	lua_setfield(L, -2, "executed");
+	luaL_pushuint64(L, stat.stolen);
+	lua_setfield(L, -2, "stolen");
+	lua_pushnumber(L, stat.pending);
+	lua_setfield(L, -2, "pending");
+	lua_pushnumber(L, stat.wait_total);
+	lua_setfield(L, -2, "wait_total");
+	lua_pushnumber(L, stat.wait_max);
+	lua_setfield(L, -2, "wait_max");
+}
+
+/**
+ * Push a table of coio thread pool statistics to a Lua stack:
+ * an array of per-thread submission queues in 'queues' and
+ * the queue shared by high priority tasks in 'high_priority'.
+ */
+static int
+lbox_stat_coio(struct lua_State *L)
+{
+	unsigned queue_count = eio_nqueues();
+	lua_newtable(L);
+	lua_createtable(L, queue_count, 0);
+	for (unsigned i = 0; i < queue_count; i++) {
+		lbox_stat_push_coio_queue(L, i);
+		lua_rawseti(L, -2, i + 1);
+	}
+	lua_setfield(L, -2, "queues");
+	lbox_stat_push_coio_queue(L, queue_count);
+	lua_setfield(L, -2, "high_priority");
+	return 1;
+}
+
+/** Push latency percentiles of all iproto requests to a Lua stack. */
+static void
+lbox_stat_push_net_latency(struct lua_State *L)
+{
+	struct info_handler h;
+	luaT_info_handler_create(&h, L);
+	iproto_net_latency_stat(&h);
+}
+
 /**
  * Push a table with a network metric to a Lua stack.
  *
@@ -148,6 +219,10 @@ static int
 lbox_stat_net_index(struct lua_State *L)
 {
 	const char *key = luaL_checkstring(L, -1);
+	if (strcmp(key, "LATENCY") == 0) {
+		lbox_stat_push_net_latency(L);
+		return 1;
+	}
 	if (rmean_foreach(rmean_net, seek_stat_item, L) == 0)
 		return 0;
 
@@ -170,7 +245,8 @@ lbox_stat_net_index(struct lua_State *L)
  *
  * - SENT (packets): total, rps;
  * - RECEIVED (packets): total, rps;
- * - CONNECTIONS: current.
+ * - CONNECTIONS: current;
+ * - LATENCY (of all requests, in seconds): p50, p99, p999.
  *
  * These fields have the following meaning:
  *
@@ -199,6 +275,10 @@ lbox_stat_net_call(struct lua_State *L)
 	lua_rawset(L, -3);
 	lua_pop(L, 1);
 
+	lua_pushstring(L, "LATENCY");
+	lbox_stat_push_net_latency(L);
+	lua_rawset(L, -3);
+
 	return 1;
 }
 
@@ -231,6 +311,8 @@ box_lua_stat_init(struct lua_State *L)
 		{"vinyl", lbox_stat_vinyl},
 		{"reset", lbox_stat_reset},
 		{"sql", lbox_stat_sql},
+		{"latency", lbox_stat_latency},
+		{"coio", lbox_stat_coio},
 		{NULL, NULL}
 	};
 
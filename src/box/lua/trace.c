@@ -0,0 +1,171 @@
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY AUTHORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * AUTHORS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "box/lua/trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <lua.h>
+#include <lauxlib.h>
+
+#include "trivia/util.h"
+#include "lua/utils.h"
+#include "box/trace.h"
+#include "box/iproto_constants.h"
+#include "clock.h"
+
+/** Default share of traced requests. */
+static const double TRACE_RATE_DEFAULT = 0.01;
+/** Default number of kept trace records. */
+static const uint32_t TRACE_SIZE_DEFAULT = 1024;
+
+/** A part of a request trace shown as a span. */
+struct trace_span {
+	const char *name;
+	enum trace_stage begin;
+	enum trace_stage end;
+};
+
+static const struct trace_span trace_spans[] = {
+	{"request", TRACE_NET_READ, TRACE_NET_SEND},
+	{"tx queue", TRACE_NET_READ, TRACE_TX_ACCEPT},
+	{"tx", TRACE_TX_ACCEPT, TRACE_TX_END},
+	{"wal queue", TRACE_WAL_SUBMIT, TRACE_WAL_WRITE},
+	{"wal write", TRACE_WAL_WRITE, TRACE_WAL_DONE},
+	{"wal wakeup", TRACE_WAL_DONE, TRACE_WAL_WAKEUP},
+	{"net queue", TRACE_TX_END, TRACE_NET_SEND},
+};
+
+static int
+lbox_trace_start(struct lua_State *L)
+{
+	double rate = TRACE_RATE_DEFAULT;
+	uint32_t size = TRACE_SIZE_DEFAULT;
+	if (!lua_isnoneornil(L, 1)) {
+		if (!lua_istable(L, 1))
+			goto usage;
+		lua_getfield(L, 1, "rate");
+		if (lua_isnumber(L, -1))
+			rate = lua_tonumber(L, -1);
+		else if (!lua_isnil(L, -1))
+			goto usage;
+		lua_getfield(L, 1, "size");
+		if (lua_isnumber(L, -1))
+			size = lua_tointeger(L, -1);
+		else if (!lua_isnil(L, -1))
+			goto usage;
+		lua_pop(L, 2);
+	}
+	if (trace_start(rate, size) != 0)
+		return luaT_error(L);
+	return 0;
+usage:
+	return luaL_error(L, "Usage: box.trace.start([{rate = <share>, "
+			  "size = <records>}])");
+}
+
+static int
+lbox_trace_stop(struct lua_State *L)
+{
+	(void)L;
+	trace_stop();
+	return 0;
+}
+
+/** Microseconds passed from one clock_ticks() value to another. */
+static double
+trace_ticks_to_usec(uint64_t start, uint64_t end)
+{
+	return end > start ? clock_ticks_to_sec(end - start) * 1e6 : 0;
+}
+
+/**
+ * Return the trace records in the Chrome trace event format,
+ * which can be loaded to chrome://tracing or Perfetto. Each
+ * request is shown on a row of its own, with nested spans of
+ * the stages it has passed.
+ */
+static int
+lbox_trace_dump(struct lua_State *L)
+{
+	struct trace_record *records;
+	uint32_t count;
+	if (trace_records(&records, &count) != 0)
+		return luaT_error(L);
+	luaL_Buffer b;
+	luaL_buffinit(L, &b);
+	luaL_addstring(&b, "{\"traceEvents\":[");
+	uint64_t base = count > 0 ? records[0].ticks[TRACE_NET_READ] : 0;
+	bool is_first = true;
+	char buf[256];
+	for (uint32_t i = 0; i < count; i++) {
+		struct trace_record *record = &records[i];
+		const char *type = iproto_type_name(record->type);
+		if (type == NULL)
+			type = "UNKNOWN";
+		for (uint32_t j = 0; j < lengthof(trace_spans); j++) {
+			const struct trace_span *span = &trace_spans[j];
+			uint64_t begin = record->ticks[span->begin];
+			uint64_t end = record->ticks[span->end];
+			if (begin == 0 || end == 0)
+				continue;
+			snprintf(buf, sizeof(buf), "%s{\"name\":\"%s\","
+				 "\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,"
+				 "\"dur\":%.3f,\"pid\":1,\"tid\":%u,"
+				 "\"args\":{\"sync\":%llu}}",
+				 is_first ? "" : ",", span->name,
+				 type,
+				 trace_ticks_to_usec(base, begin),
+				 trace_ticks_to_usec(begin, end), i,
+				 (unsigned long long)record->sync);
+			luaL_addstring(&b, buf);
+			is_first = false;
+		}
+	}
+	luaL_addstring(&b, "]}");
+	luaL_pushresult(&b);
+	free(records);
+	return 1;
+}
+
+static const struct luaL_Reg lbox_trace_lib[] = {
+	{"start", lbox_trace_start},
+	{"stop", lbox_trace_stop},
+	{"dump", lbox_trace_dump},
+	{NULL, NULL}
+};
+
+void
+box_lua_trace_init(struct lua_State *L)
+{
+	luaL_register_module(L, "box.trace", lbox_trace_lib);
+	lua_pop(L, 1);
+}
@@ -33,6 +33,7 @@
 
 #include "lua/utils.h" /* luaT_error() */
 #include "lua/msgpack.h" /* luamp_encode_XXX() */
+#include "third_party/lua-cjson/lua_cjson.h" /* json_encode_msgpack() */
 #include "diag.h" /* diag_set() */
 #include <small/ibuf.h>
 #include <small/region.h>
@@ -504,6 +505,20 @@ lbox_tuple_to_string(struct lua_State *L)
 	return 1;
 }
 
+/**
+ * Encode a tuple into JSON straight from its MsgPack data,
+ * without converting it to a Lua table first.
+ */
+static int
+lbox_tuple_to_json(struct lua_State *L)
+{
+	if (lua_gettop(L) != 1)
+		return luaL_error(L, "Usage: tuple:tojson()");
+	struct tuple *tuple = luaT_checktuple(L, 1);
+	json_encode_msgpack(L, tuple_data(tuple));
+	return 1;
+}
+
 void
 luaT_pushtuple(struct lua_State *L, box_tuple_t *tuple)
 {
@@ -523,6 +538,7 @@ static const struct luaL_Reg lbox_tuple_meta[] = {
 	{"slice", lbox_tuple_slice},
 	{"transform", lbox_tuple_transform},
 	{"tuple_to_map", lbox_tuple_to_map},
+	{"tojson", lbox_tuple_to_json},
 	{"tuple_field_by_path", lbox_tuple_field_by_path},
 	{NULL, NULL}
 };
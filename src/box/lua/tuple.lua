@@ -287,6 +287,7 @@ local methods = {
     ["upsert"]      = tuple_upsert;
     ["bsize"]       = tuple_bsize;
     ["tomap"]       = internal.tuple.tuple_to_map;
+    ["tojson"]      = internal.tuple.tojson;
 }
 
 -- Aliases for tuple:methods().
@@ -346,6 +347,7 @@ ffi.metatype(tuple_iterator_t, {
 internal.tuple.slice = nil
 internal.tuple.transform = nil
 internal.tuple.tuple_to_map = nil
+internal.tuple.tojson = nil
 internal.tuple.tostring = nil
 
 -- internal api for box.select and iterators
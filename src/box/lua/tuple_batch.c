@@ -0,0 +1,249 @@
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY AUTHORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * AUTHORS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "box/lua/tuple_batch.h"
+
+#include <lua.h>
+#include <lauxlib.h>
+
+#include "trivia/util.h"
+#include "lua/utils.h"
+#include "lua/msgpack.h"
+#include "box/box.h"
+#include "box/port.h"
+#include "box/tuple.h"
+#include "box/lua/tuple.h"
+#include "box/lua/misc.h"
+
+static const char *tuple_batchlib_name = "box.tuple_batch";
+
+/**
+ * Result of a select kept as a single Lua object. Every tuple
+ * returned as a cdata costs a GC object with a finalizer, so a
+ * batch holds references to all tuples itself and makes a cdata
+ * only for a tuple accessed by index. Fields can be read without
+ * making one at all.
+ */
+struct tuple_batch {
+	uint32_t count;
+	struct tuple *tuples[0];
+};
+
+static struct tuple_batch *
+lbox_check_tuple_batch(struct lua_State *L, int idx)
+{
+	return (struct tuple_batch *) luaL_checkudata(L, idx,
+						      tuple_batchlib_name);
+}
+
+/** Check a 1-based tuple number, return the tuple. */
+static struct tuple *
+lbox_tuple_batch_check_tuple(struct lua_State *L,
+			     struct tuple_batch *batch, int idx)
+{
+	lua_Integer i = luaL_checkinteger(L, idx);
+	if (i < 1 || i > batch->count)
+		luaL_error(L, "tuple number %d is out of range", (int) i);
+	return batch->tuples[i - 1];
+}
+
+/**
+ * Push a batch of the tuples of a port passed as a light
+ * userdata. The port is left intact, so that it can be
+ * destroyed by the caller even if this function raises.
+ */
+static int
+lbox_push_tuple_batch(struct lua_State *L)
+{
+	struct port_c *port = (struct port_c *) lua_touserdata(L, 1);
+	size_t size = sizeof(struct tuple_batch) +
+		      port->size * sizeof(struct tuple *);
+	struct tuple_batch *batch = (struct tuple_batch *)
+		lua_newuserdata(L, size);
+	batch->count = 0;
+	/* Set the finalizer before referencing the tuples. */
+	luaL_getmetatable(L, tuple_batchlib_name);
+	lua_setmetatable(L, -2);
+	for (struct port_c_entry *pe = port->first; pe != NULL;
+	     pe = pe->next) {
+		assert(pe->mp_size == 0);
+		tuple_ref(pe->tuple);
+		batch->tuples[batch->count++] = pe->tuple;
+	}
+	return 1;
+}
+
+static int
+lbox_select_batch(struct lua_State *L)
+{
+	if (lua_gettop(L) != 6 || !lua_isnumber(L, 1) || !lua_isnumber(L, 2) ||
+	    !lua_isnumber(L, 3) || !lua_isnumber(L, 4) || !lua_isnumber(L, 5)) {
+		return luaL_error(L, "Usage index:select_batch(iterator, "
+				  "offset, limit, key)");
+	}
+	uint32_t space_id = lua_tonumber(L, 1);
+	uint32_t index_id = lua_tonumber(L, 2);
+	int iterator = lua_tonumber(L, 3);
+	uint32_t offset = lua_tonumber(L, 4);
+	uint32_t limit = lua_tonumber(L, 5);
+
+	size_t key_len;
+	const char *key = lbox_encode_tuple_on_gc(L, 6, &key_len);
+	/*
+	 * The port references the tuples, so nothing may raise
+	 * until it is destroyed: push the function beforehand
+	 * and make the batch in a protected call.
+	 */
+	lua_pushcfunction(L, lbox_push_tuple_batch);
+
+	struct port port;
+	if (box_select(space_id, index_id, iterator, offset, limit,
+		       key, key + key_len, &port) != 0)
+		return luaT_error(L);
+	lua_pushlightuserdata(L, &port);
+	int rc = lua_pcall(L, 1, 1, 0);
+	port_destroy(&port);
+	if (rc != 0)
+		return lua_error(L);
+	return 1;
+}
+
+static int
+lbox_tuple_batch_gc(struct lua_State *L)
+{
+	struct tuple_batch *batch = lbox_check_tuple_batch(L, 1);
+	for (uint32_t i = 0; i < batch->count; i++)
+		tuple_unref(batch->tuples[i]);
+	batch->count = 0;
+	return 0;
+}
+
+static int
+lbox_tuple_batch_len(struct lua_State *L)
+{
+	struct tuple_batch *batch = lbox_check_tuple_batch(L, 1);
+	lua_pushinteger(L, batch->count);
+	return 1;
+}
+
+/** batch[i] makes a tuple, batch.name looks up a method. */
+static int
+lbox_tuple_batch_index(struct lua_State *L)
+{
+	struct tuple_batch *batch = lbox_check_tuple_batch(L, 1);
+	if (lua_type(L, 2) == LUA_TNUMBER) {
+		lua_Integer i = lua_tointeger(L, 2);
+		if (i < 1 || i > batch->count)
+			return 0;
+		luaT_pushtuple(L, batch->tuples[i - 1]);
+		return 1;
+	}
+	lua_getmetatable(L, 1);
+	lua_pushvalue(L, 2);
+	lua_rawget(L, -2);
+	return 1;
+}
+
+/**
+ * batch:field(i, fieldno) returns a field of the i-th tuple,
+ * both numbers are 1-based like in tuple[fieldno].
+ */
+static int
+lbox_tuple_batch_field(struct lua_State *L)
+{
+	struct tuple_batch *batch = lbox_check_tuple_batch(L, 1);
+	struct tuple *tuple = lbox_tuple_batch_check_tuple(L, batch, 2);
+	lua_Integer fieldno = luaL_checkinteger(L, 3);
+	const char *field = fieldno < 1 ? NULL :
+			    tuple_field(tuple, fieldno - 1);
+	if (field == NULL)
+		return 0;
+	luamp_decode(L, luaL_msgpack_default, &field);
+	return 1;
+}
+
+static int
+lbox_tuple_batch_next(struct lua_State *L)
+{
+	struct tuple_batch *batch = lbox_check_tuple_batch(L, 1);
+	lua_Integer i = luaL_checkinteger(L, 2);
+	if (i < 0 || i >= batch->count)
+		return 0;
+	lua_pushinteger(L, i + 1);
+	luaT_pushtuple(L, batch->tuples[i]);
+	return 2;
+}
+
+/** for i, tuple in batch:pairs() do ... end */
+static int
+lbox_tuple_batch_pairs(struct lua_State *L)
+{
+	lbox_check_tuple_batch(L, 1);
+	lua_pushcfunction(L, lbox_tuple_batch_next);
+	lua_pushvalue(L, 1);
+	lua_pushinteger(L, 0);
+	return 3;
+}
+
+/** Make a table of tuples, as select() returns. */
+static int
+lbox_tuple_batch_totable(struct lua_State *L)
+{
+	struct tuple_batch *batch = lbox_check_tuple_batch(L, 1);
+	lua_createtable(L, batch->count, 0);
+	for (uint32_t i = 0; i < batch->count; i++) {
+		luaT_pushtuple(L, batch->tuples[i]);
+		lua_rawseti(L, -2, i + 1);
+	}
+	return 1;
+}
+
+void
+box_lua_tuple_batch_init(struct lua_State *L)
+{
+	static const struct luaL_Reg tuple_batch_meta[] = {
+		{"__gc", lbox_tuple_batch_gc},
+		{"__len", lbox_tuple_batch_len},
+		{"__index", lbox_tuple_batch_index},
+		{"__serialize", lbox_tuple_batch_totable},
+		{"field", lbox_tuple_batch_field},
+		{"pairs", lbox_tuple_batch_pairs},
+		{"totable", lbox_tuple_batch_totable},
+		{NULL, NULL}
+	};
+	luaL_register_type(L, tuple_batchlib_name, tuple_batch_meta);
+
+	static const struct luaL_Reg boxlib_internal[] = {
+		{"select_batch", lbox_select_batch},
+		{NULL, NULL}
+	};
+	luaL_register(L, "box.internal", boxlib_internal);
+	lua_pop(L, 1);
+}
@@ -103,6 +103,8 @@ lbox_xlog_parse_body_kv(struct lua_State *L, int type, const char **beg, const c
 		lbox_xlog_pushkey(L, vy_page_info_key_name(v));
 	} else if (type == VY_RUN_ROW_INDEX && vy_row_index_key_name(v)) {
 		lbox_xlog_pushkey(L, vy_row_index_key_name(v));
+	} else if (type == VY_RUN_FIELD_MAP && vy_field_map_key_name(v)) {
+		lbox_xlog_pushkey(L, vy_field_map_key_name(v));
 	} else {
 		lua_pushinteger(L, v); /* unknown key */
 	}
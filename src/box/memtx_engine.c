@@ -30,6 +30,7 @@
  */
 #include "memtx_engine.h"
 #include "memtx_space.h"
+#include "memtx_expire.h"
 
 #include <small/quota.h>
 #include <small/small.h>
@@ -56,7 +57,7 @@ static void
 checkpoint_cancel(struct checkpoint *ckpt);
 
 static void
-replica_join_cancel(struct cord *replica_join_cord);
+replica_join_cancel(struct memtx_engine *memtx);
 
 struct PACKED memtx_tuple {
 	/*
@@ -132,8 +133,7 @@ memtx_engine_shutdown(struct engine *engine)
 	struct memtx_engine *memtx = (struct memtx_engine *)engine;
 	if (memtx->checkpoint != NULL)
 		checkpoint_cancel(memtx->checkpoint);
-	if (memtx->replica_join_cord != NULL)
-		replica_join_cancel(memtx->replica_join_cord);
+	replica_join_cancel(memtx);
 	mempool_destroy(&memtx->iterator_pool);
 	if (mempool_is_initialized(&memtx->rtree_iterator_pool))
 		mempool_destroy(&memtx->rtree_iterator_pool);
@@ -532,16 +532,27 @@ checkpoint_cancel(struct checkpoint *ckpt)
 	checkpoint_delete(ckpt);
 }
 
+/** A thread feeding a join stream. */
+struct memtx_join_cord {
+	struct cord cord;
+	/** Link in memtx_engine::replica_join_cords. */
+	struct rlist in_engine;
+};
+
 static void
-replica_join_cancel(struct cord *replica_join_cord)
+replica_join_cancel(struct memtx_engine *memtx)
 {
 	/*
-	 * Cancel the thread being used to join replica if it's
-	 * running and wait for it to terminate so as to
-	 * eliminate the possibility of use-after-free.
+	 * Cancel the threads being used to join replicas if
+	 * they're running and wait for them to terminate so as
+	 * to eliminate the possibility of use-after-free.
 	 */
-	tt_pthread_cancel(replica_join_cord->id);
-	tt_pthread_join(replica_join_cord->id, NULL);
+	struct memtx_join_cord *join_cord;
+	rlist_foreach_entry(join_cord, &memtx->replica_join_cords,
+			    in_engine) {
+		tt_pthread_cancel(join_cord->cord.id);
+		tt_pthread_join(join_cord->cord.id, NULL);
+	}
 }
 
 static int
@@ -754,11 +765,24 @@ memtx_engine_backup(struct engine *engine, const struct vclock *vclock,
 struct memtx_join_entry {
 	struct rlist in_ctx;
 	uint32_t space_id;
+	/** Set if the space is a system one. */
+	bool is_system;
+	/** Size of the space data, used to balance join streams. */
+	size_t size;
+	/** Id of the join stream the space data is sent over. */
+	int stream_id;
 	struct snapshot_iterator *iterator;
 };
 
 struct memtx_join_ctx {
 	struct rlist entries;
+};
+
+/** Argument of a thread feeding a join stream. */
+struct memtx_join_stream {
+	struct memtx_join_ctx *ctx;
+	/** Only spaces assigned to this stream are sent. */
+	int stream_id;
 	struct xstream *stream;
 };
 
@@ -782,6 +806,9 @@ memtx_join_add_space(struct space *space, void *arg)
 		return -1;
 	}
 	entry->space_id = space_id(space);
+	entry->is_system = space_is_system(space);
+	entry->size = space_bsize(space);
+	entry->stream_id = 0;
 	entry->iterator = index_create_snapshot_iterator(pk);
 	if (entry->iterator == NULL) {
 		free(entry);
@@ -810,6 +837,75 @@ memtx_engine_prepare_join(struct engine *engine, void **arg)
 	return 0;
 }
 
+/** Order join entries by data size, the largest first. */
+static int
+memtx_join_entry_cmp(const void *a, const void *b)
+{
+	const struct memtx_join_entry *e1 =
+		*(const struct memtx_join_entry **)a;
+	const struct memtx_join_entry *e2 =
+		*(const struct memtx_join_entry **)b;
+	if (e1->size > e2->size)
+		return -1;
+	if (e1->size < e2->size)
+		return 1;
+	return 0;
+}
+
+static int
+memtx_engine_split_join(struct engine *engine, void *arg, int stream_count)
+{
+	(void)engine;
+	struct memtx_join_ctx *ctx = arg;
+	assert(stream_count > 0);
+	/*
+	 * System spaces always go over stream 0, because the
+	 * replica can't apply user data before it has the schema.
+	 * User spaces are assigned greedily, the largest one to
+	 * the least loaded stream.
+	 */
+	int count = 0;
+	size_t system_size = 0;
+	struct memtx_join_entry *entry;
+	rlist_foreach_entry(entry, &ctx->entries, in_ctx) {
+		entry->stream_id = 0;
+		if (entry->is_system)
+			system_size += entry->size;
+		else
+			count++;
+	}
+	if (stream_count == 1 || count == 0)
+		return 0;
+	/*
+	 * Splitting is merely an optimization so on allocation
+	 * failure all data is just sent over stream 0.
+	 */
+	struct memtx_join_entry **sorted = malloc(count * sizeof(*sorted));
+	size_t *load = calloc(stream_count, sizeof(*load));
+	if (sorted == NULL || load == NULL)
+		goto out;
+	int i = 0;
+	rlist_foreach_entry(entry, &ctx->entries, in_ctx) {
+		if (!entry->is_system)
+			sorted[i++] = entry;
+	}
+	qsort(sorted, count, sizeof(*sorted), memtx_join_entry_cmp);
+	load[0] = system_size;
+	for (i = 0; i < count; i++) {
+		int min = 0;
+		for (int j = 1; j < stream_count; j++) {
+			if (load[j] < load[min])
+				min = j;
+		}
+		sorted[i]->stream_id = min;
+		load[min] += sorted[i]->size;
+	}
+out:
+	free(load);
+	free(sorted);
+	return 0;
+}
+
 static int
 memtx_join_send_tuple(struct xstream *stream, uint32_t space_id,
 		      const char *data, size_t size)
@@ -833,15 +929,17 @@ memtx_join_send_tuple(struct xstream *stream, uint32_t space_id,
 static int
 memtx_join_f(va_list ap)
 {
-	struct memtx_join_ctx *ctx = va_arg(ap, struct memtx_join_ctx *);
+	struct memtx_join_stream *arg = va_arg(ap, struct memtx_join_stream *);
 	struct memtx_join_entry *entry;
-	rlist_foreach_entry(entry, &ctx->entries, in_ctx) {
+	rlist_foreach_entry(entry, &arg->ctx->entries, in_ctx) {
+		if (entry->stream_id != arg->stream_id)
+			continue;
 		struct snapshot_iterator *it = entry->iterator;
 		int rc;
 		uint32_t size;
 		const char *data;
 		while ((rc = it->next(it, &data, &size)) == 0 && data != NULL) {
-			if (memtx_join_send_tuple(ctx->stream, entry->space_id,
+			if (memtx_join_send_tuple(arg->stream, entry->space_id,
 						  data, size) != 0)
 				return -1;
 		}
@@ -851,27 +949,46 @@ memtx_join_f(va_list ap)
 	return 0;
 }
 
+/** Send the spaces assigned to the given join stream. */
 static int
-memtx_engine_join(struct engine *engine, void *arg, struct xstream *stream)
+memtx_join_send_stream(struct memtx_engine *memtx, struct memtx_join_ctx *ctx,
+		       int stream_id, struct xstream *stream)
 {
-	(void)engine;
-	struct memtx_join_ctx *ctx = arg;
-	ctx->stream = stream;
+	struct memtx_join_stream arg = { ctx, stream_id, stream };
 	/*
 	 * Memtx snapshot iterators are safe to use from another
 	 * thread and so we do so as not to consume too much of
 	 * precious tx cpu time while a new replica is joining.
 	 */
-	struct cord cord;
-	if (cord_costart(&cord, "initial_join", memtx_join_f, ctx) != 0)
+	struct memtx_join_cord join_cord;
+	if (cord_costart(&join_cord.cord, "initial_join", memtx_join_f,
+			 &arg) != 0)
 		return -1;
-	struct memtx_engine *memtx = (struct memtx_engine *)engine;
-	memtx->replica_join_cord = &cord;
-	int res = cord_cojoin(&cord);
-	memtx->replica_join_cord = NULL;
+	/* Streams of a parallel join run concurrently. */
+	rlist_add_tail_entry(&memtx->replica_join_cords, &join_cord,
+			     in_engine);
+	memtx->replica_join_count++;
+	int res = cord_cojoin(&join_cord.cord);
+	rlist_del_entry(&join_cord, in_engine);
+	memtx->replica_join_count--;
 	return res;
 }
 
+static int
+memtx_engine_join(struct engine *engine, void *arg, struct xstream *stream)
+{
+	struct memtx_engine *memtx = (struct memtx_engine *)engine;
+	return memtx_join_send_stream(memtx, arg, 0, stream);
+}
+
+static int
+memtx_engine_join_stream(struct engine *engine, void *arg, int stream_id,
+			 struct xstream *stream)
+{
+	struct memtx_engine *memtx = (struct memtx_engine *)engine;
+	return memtx_join_send_stream(memtx, arg, stream_id, stream);
+}
+
 static void
 memtx_engine_complete_join(struct engine *engine, void *arg)
 {
@@ -910,6 +1027,8 @@ static const struct engine_vtab memtx_engine_vtab = {
 	/* .create_space = */ memtx_engine_create_space,
 	/* .prepare_join = */ memtx_engine_prepare_join,
 	/* .join = */ memtx_engine_join,
+	/* .split_join = */ memtx_engine_split_join,
+	/* .join_stream = */ memtx_engine_join_stream,
 	/* .complete_join = */ memtx_engine_complete_join,
 	/* .begin = */ memtx_engine_begin,
 	/* .begin_statement = */ generic_engine_begin_statement,
@@ -1025,6 +1144,9 @@ memtx_engine_new(const char *snap_dirname, bool force_recovery,
 	memtx->gc_fiber = fiber_new("memtx.gc", memtx_engine_gc_f);
 	if (memtx->gc_fiber == NULL)
 		goto fail;
+	memtx->expire_fiber = fiber_new("memtx.expire", memtx_expire_f);
+	if (memtx->expire_fiber == NULL)
+		goto fail;
 
 	/* Apply lowest allowed objsize bound. */
 	if (objsize_min < OBJSIZE_MIN)
@@ -1051,12 +1173,14 @@ memtx_engine_new(const char *snap_dirname, bool force_recovery,
 	memtx->max_tuple_size = MAX_TUPLE_SIZE;
 	memtx->force_recovery = force_recovery;
 
-	memtx->replica_join_cord = NULL;
+	rlist_create(&memtx->replica_join_cords);
+	memtx->replica_join_count = 0;
 
 	memtx->base.vtab = &memtx_engine_vtab;
 	memtx->base.name = "memtx";
 
 	fiber_start(memtx->gc_fiber, memtx);
+	fiber_start(memtx->expire_fiber, memtx);
 	return memtx;
 fail:
 	xdir_destroy(&memtx->snap_dir);
@@ -1316,6 +1440,10 @@ memtx_index_def_change_requires_rebuild(struct index *index,
 		return true;
 	if (old_def->opts.func_id != new_def->opts.func_id)
 		return true;
+	/* Tuples must be rehashed with the new hash function. */
+	if (old_def->type == HASH &&
+	    old_def->opts.hash_func != new_def->opts.hash_func)
+		return true;
 
 	const struct key_def *old_cmp_def, *new_cmp_def;
 	if (index_depends_on_pk(index)) {
@@ -1347,5 +1475,8 @@ memtx_index_def_change_requires_rebuild(struct index *index,
 			return true;
 	}
 	assert(old_cmp_def->is_multikey == new_cmp_def->is_multikey);
+	/* Tuple hints stored in the index must be recomputed. */
+	if (old_cmp_def->hint_part_count != new_cmp_def->hint_part_count)
+		return true;
 	return false;
 }
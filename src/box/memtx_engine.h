@@ -120,10 +120,13 @@ struct memtx_engine {
 	/** Skip invalid snapshot records if this flag is set. */
 	bool force_recovery;
 	/**
-	 * Cord being currently used to join replica. It is only
-	 * needed to be able to cancel it on shutdown.
+	 * Cords being currently used to join replicas, linked by
+	 * memtx_join_cord::in_engine. They are only needed to be
+	 * able to cancel them on shutdown.
 	 */
-	struct cord *replica_join_cord;
+	struct rlist replica_join_cords;
+	/** Number of cords in @replica_join_cords. */
+	int replica_join_count;
 	/** Common quota for tuples and indexes. */
 	struct quota quota;
 	/**
@@ -178,6 +181,11 @@ struct memtx_engine {
 	 * memtx_gc_task::link.
 	 */
 	struct stailq gc_queue;
+	/**
+	 * Fiber deleting expired tuples of spaces with
+	 * the expire_field option, see memtx_expire.h.
+	 */
+	struct fiber *expire_fiber;
 };
 
 struct memtx_gc_task;
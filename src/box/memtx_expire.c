@@ -0,0 +1,297 @@
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "memtx_expire.h"
+
+#include <msgpuck.h>
+#include <small/region.h>
+
+#include "box.h"
+#include "diag.h"
+#include "fiber.h"
+#include "index.h"
+#include "memtx_engine.h"
+#include "memtx_space.h"
+#include "schema.h"
+#include "say.h"
+#include "session.h"
+#include "space.h"
+#include "tuple.h"
+#include "txn.h"
+
+enum {
+	/**
+	 * Max number of tuples deleted in one transaction.
+	 * Keeps each slice of tx thread time short.
+	 */
+	MEMTX_EXPIRE_BATCH = 128,
+};
+
+/** Time between two expiration passes, in seconds. */
+static const double MEMTX_EXPIRE_PERIOD = 1.0;
+
+/**
+ * Find an index which orders tuples of a space by expiration
+ * time: a tree index with the expire field as the first part.
+ */
+static struct index *
+memtx_expire_index(struct space *space)
+{
+	uint32_t fieldno = space->def->opts.expire_field;
+	if (fieldno == SPACE_EXPIRE_FIELD_NONE || space_index(space, 0) == NULL)
+		return NULL;
+	for (uint32_t i = 0; i < space->index_count; i++) {
+		struct index *index = space->index[i];
+		struct key_def *key_def = index->def->key_def;
+		struct key_part *part = &key_def->parts[0];
+		if (index->def->type == TREE && part->fieldno == fieldno &&
+		    part->path == NULL && part->sort_order != SORT_ORDER_DESC &&
+		    !key_def->is_multikey && !key_def->for_func_index)
+			return index;
+	}
+	return NULL;
+}
+
+/**
+ * Open an iterator over the tuples of an expiration index
+ * which have the expire field set.
+ */
+static struct iterator *
+memtx_expire_iterator(struct index *index)
+{
+	struct key_part *part = &index->def->key_def->parts[0];
+	char key[1];
+	if (part->type == FIELD_TYPE_SCALAR) {
+		/* NULLs go before numbers, skip them. */
+		mp_encode_bool(key, true);
+	} else if (key_part_is_nullable(part)) {
+		/* Tuples without expiration time go first, skip them. */
+		mp_encode_nil(key);
+	} else {
+		return index_create_iterator(index, ITER_ALL, NULL, 0);
+	}
+	return index_create_iterator(index, ITER_GT, key, 1);
+}
+
+/**
+ * Check if the time has come for a tuple. Since the index is
+ * ordered, the walk stops at the first tuple which is not due:
+ * all the following ones expire later.
+ */
+static bool
+memtx_expire_is_due(struct tuple *tuple, uint32_t fieldno, double now)
+{
+	const char *field = tuple_field(tuple, fieldno);
+	double time;
+	return field != NULL && mp_read_double(&field, &time) == 0 &&
+	       time <= now;
+}
+
+/**
+ * Collect up to MEMTX_EXPIRE_BATCH expired tuples of a space.
+ * The tuples are referenced.
+ * @return the number of tuples collected or -1 on error
+ */
+static int
+memtx_expire_collect(struct index *index, double now, struct tuple **batch)
+{
+	uint32_t fieldno = index->def->key_def->parts[0].fieldno;
+	struct iterator *it = memtx_expire_iterator(index);
+	if (it == NULL)
+		return -1;
+	int count = 0;
+	while (count < MEMTX_EXPIRE_BATCH) {
+		struct tuple *tuple;
+		if (iterator_next(it, &tuple) != 0) {
+			for (int i = 0; i < count; i++)
+				tuple_unref(batch[i]);
+			count = -1;
+			break;
+		}
+		if (tuple == NULL || !memtx_expire_is_due(tuple, fieldno, now))
+			break;
+		tuple_ref(tuple);
+		batch[count++] = tuple;
+	}
+	iterator_delete(it);
+	return count;
+}
+
+/** Delete a batch of tuples from a space in one transaction. */
+static int
+memtx_expire_delete(struct space *space, struct tuple **batch, int count)
+{
+	uint32_t id = space_id(space);
+	struct key_def *pk_def = space_index(space, 0)->def->key_def;
+	if (box_txn_begin() != 0)
+		return -1;
+	for (int i = 0; i < count; i++) {
+		uint32_t key_size;
+		const char *key = tuple_extract_key(batch[i], pk_def,
+						    MULTIKEY_NONE, &key_size);
+		if (key == NULL ||
+		    box_delete(id, 0, key, key + key_size, NULL) != 0) {
+			box_txn_rollback();
+			return -1;
+		}
+	}
+	return box_txn_commit();
+}
+
+/** Delete all tuples of a space which are due by @a now. */
+static void
+memtx_expire_space(uint32_t space_id, double now)
+{
+	struct tuple *batch[MEMTX_EXPIRE_BATCH];
+	while (!fiber_is_cancelled() && !box_is_ro()) {
+		/* The space may be altered or dropped while we yield. */
+		struct space *space = space_by_id(space_id);
+		if (space == NULL)
+			return;
+		struct index *index = memtx_expire_index(space);
+		if (index == NULL)
+			return;
+		int count = memtx_expire_collect(index, now, batch);
+		if (count <= 0) {
+			if (count < 0)
+				diag_log();
+			return;
+		}
+		int rc = memtx_expire_delete(space, batch, count);
+		for (int i = 0; i < count; i++)
+			tuple_unref(batch[i]);
+		fiber_gc();
+		if (rc != 0) {
+			say_error("failed to expire tuples of space %u",
+				  (unsigned)space_id);
+			diag_log();
+			return;
+		}
+		space = space_by_id(space_id);
+		if (space != NULL)
+			((struct memtx_space *)space)->expired += count;
+		if (count < MEMTX_EXPIRE_BATCH)
+			return;
+		/* Let other fibers run between batches. */
+		fiber_sleep(0);
+	}
+}
+
+static int
+memtx_expire_count_space(struct space *space, void *arg)
+{
+	uint32_t *count = (uint32_t *)arg;
+	if (space->def->opts.expire_field != SPACE_EXPIRE_FIELD_NONE)
+		(*count)++;
+	return 0;
+}
+
+struct memtx_expire_ids {
+	uint32_t *ids;
+	uint32_t count;
+	uint32_t size;
+};
+
+static int
+memtx_expire_add_space(struct space *space, void *arg)
+{
+	struct memtx_expire_ids *ids = (struct memtx_expire_ids *)arg;
+	if (space->def->opts.expire_field != SPACE_EXPIRE_FIELD_NONE &&
+	    ids->count < ids->size)
+		ids->ids[ids->count++] = space_id(space);
+	return 0;
+}
+
+/** Run one expiration pass over all spaces. */
+static void
+memtx_expire_run(void)
+{
+	/*
+	 * Deletions yield, and the space cache may change
+	 * meanwhile, so remember space ids rather than spaces.
+	 */
+	struct memtx_expire_ids ids = { NULL, 0, 0 };
+	space_foreach(memtx_expire_count_space, &ids.size);
+	if (ids.size == 0)
+		return;
+	ids.ids = (uint32_t *)malloc(ids.size * sizeof(*ids.ids));
+	if (ids.ids == NULL) {
+		say_error("failed to allocate %zu bytes for expiration",
+			  ids.size * sizeof(*ids.ids));
+		return;
+	}
+	space_foreach(memtx_expire_add_space, &ids);
+	double now = fiber_time();
+	for (uint32_t i = 0; i < ids.count; i++)
+		memtx_expire_space(ids.ids[i], now);
+	free(ids.ids);
+}
+
+int
+memtx_expire_f(va_list ap)
+{
+	struct memtx_engine *memtx = va_arg(ap, struct memtx_engine *);
+	/* Expired tuples are deleted regardless of space privileges. */
+	fiber_set_user(fiber(), &admin_credentials);
+	while (!fiber_is_cancelled()) {
+		fiber_sleep(MEMTX_EXPIRE_PERIOD);
+		/*
+		 * Deletions are replicated, so only a writable
+		 * instance expires tuples, and only after recovery.
+		 */
+		if (memtx->state != MEMTX_OK || box_is_ro())
+			continue;
+		memtx_expire_run();
+	}
+	return 0;
+}
+
+int
+memtx_expire_stat(struct space *space, struct memtx_expire_stat *stat)
+{
+	stat->expired = ((struct memtx_space *)space)->expired;
+	stat->pending = 0;
+	struct index *index = memtx_expire_index(space);
+	if (index == NULL)
+		return 0;
+	uint32_t fieldno = index->def->key_def->parts[0].fieldno;
+	double now = fiber_time();
+	struct iterator *it = memtx_expire_iterator(index);
+	if (it == NULL)
+		return -1;
+	struct tuple *tuple;
+	int rc = 0;
+	while (stat->pending < MEMTX_EXPIRE_STAT_MAX &&
+	       (rc = iterator_next(it, &tuple)) == 0 && tuple != NULL &&
+	       memtx_expire_is_due(tuple, fieldno, now))
+		stat->pending++;
+	iterator_delete(it);
+	return rc;
+}
@@ -0,0 +1,92 @@
+#ifndef TARANTOOL_BOX_MEMTX_EXPIRE_H_INCLUDED
+#define TARANTOOL_BOX_MEMTX_EXPIRE_H_INCLUDED
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stdarg.h>
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+/**
+ * Background expiration of memtx tuples.
+ *
+ * A space with the expire_field option set keeps the expiration
+ * time of each tuple, in seconds since the epoch, in that field.
+ * The expiration fiber periodically walks a TREE index whose
+ * first key part is the expire field, in the key order, and
+ * deletes the tuples whose time has come, in small transactions.
+ * A space without such an index is left alone.
+ */
+
+struct space;
+
+enum {
+	/**
+	 * Max number of pending tuples counted by statistics.
+	 * The count doesn't yield, so it mustn't grow with
+	 * the backlog.
+	 */
+	MEMTX_EXPIRE_STAT_MAX = 10000,
+};
+
+/** Expiration statistics of a space. */
+struct memtx_expire_stat {
+	/** Number of tuples deleted by expiration. */
+	uint64_t expired;
+	/**
+	 * Number of expired tuples not deleted yet,
+	 * counted up to MEMTX_EXPIRE_STAT_MAX.
+	 */
+	uint64_t pending;
+};
+
+/**
+ * Expiration fiber function.
+ * Takes a struct memtx_engine * argument.
+ */
+int
+memtx_expire_f(va_list ap);
+
+/**
+ * Get expiration statistics of a space.
+ * @retval 0 success
+ * @retval -1 error, check diag
+ */
+int
+memtx_expire_stat(struct space *space, struct memtx_expire_stat *stat);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_BOX_MEMTX_EXPIRE_H_INCLUDED */
@@ -624,7 +624,25 @@ memtx_space_check_index_def(struct space *space, struct index_def *index_def)
 		}
 		break;
 	case TREE:
-		/* TREE index has no limitations. */
+		/* Only vinyl TREE indexes hash keys, in bloom filters. */
+		if (index_def->opts.hash_func != TUPLE_HASH_MURMUR) {
+			diag_set(ClientError, ER_MODIFY_INDEX,
+				 index_def->name, space_name(space),
+				 "hash function is supported only by "
+				 "HASH index");
+			return -1;
+		}
+		/* Tuples are expired in the ascending key order. */
+		struct key_part *part = &index_def->key_def->parts[0];
+		if (part->fieldno == space->def->opts.expire_field &&
+		    part->path == NULL &&
+		    part->sort_order == SORT_ORDER_DESC) {
+			diag_set(ClientError, ER_MODIFY_INDEX,
+				 index_def->name, space_name(space),
+				 "expire field must be indexed in "
+				 "ascending order");
+			return -1;
+		}
 		break;
 	case RTREE:
 		if (index_def->key_def->part_count != 1) {
@@ -1118,6 +1136,7 @@ memtx_space_prepare_alter(struct space *old_space, struct space *new_space)
 
 	new_memtx_space->replace = old_memtx_space->replace;
 	new_memtx_space->bsize = old_memtx_space->bsize;
+	new_memtx_space->expired = old_memtx_space->expired;
 	return 0;
 }
 
@@ -1143,6 +1162,7 @@ static const struct space_vtab memtx_space_vtab = {
 	/* .build_index = */ memtx_space_build_index,
 	/* .swap_index = */ generic_space_swap_index,
 	/* .prepare_alter = */ memtx_space_prepare_alter,
+	/* .prepare_truncate = */ generic_space_prepare_truncate,
 	/* .invalidate = */ generic_space_invalidate,
 };
 
@@ -1187,6 +1207,7 @@ memtx_space_new(struct memtx_engine *memtx,
 
 	memtx_space->bsize = 0;
 	memtx_space->rowid = 0;
+	memtx_space->expired = 0;
 	memtx_space->replace = memtx_space_replace_no_keys;
 	return (struct space *)memtx_space;
 }
@@ -55,6 +55,8 @@ struct memtx_space {
 	 */
 	int (*replace)(struct space *, struct tuple *, struct tuple *,
 		       enum dup_replace_mode, struct tuple **);
+	/** Number of tuples deleted by expiration. */
+	uint64_t expired;
 };
 
 /**
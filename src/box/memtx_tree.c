@@ -37,6 +37,7 @@
 #include "fiber.h"
 #include "key_list.h"
 #include "tuple.h"
+#include "info/info.h"
 #include <third_party/qsort_arg.h>
 #include <small/mempool.h>
 
@@ -77,14 +78,53 @@ memtx_tree_data_is_equal(const struct memtx_tree_data *a,
 	return a->tuple == b->tuple;
 }
 
+/** Statistics of comparison hint efficiency. */
+struct memtx_tree_hint_stat {
+	/** Number of tree lookups, used for sampling. */
+	uint32_t lookup_count;
+	/** Number of sampled comparisons resolved by hints. */
+	int64_t resolved;
+	/** Number of sampled comparisons that compared tuples. */
+	int64_t unresolved;
+};
+
+enum {
+	/**
+	 * Comparisons of one in MEMTX_TREE_HINT_STAT_SAMPLE tree
+	 * lookups are accounted in hint statistics.
+	 */
+	MEMTX_TREE_HINT_STAT_SAMPLE = 64,
+};
+
+/**
+ * Hint statistics of the index a sampled tree lookup is being
+ * done in, NULL if the current lookup isn't sampled. Memtx
+ * indexes are only accessed from the tx thread.
+ */
+static struct memtx_tree_hint_stat *memtx_tree_hint_sample;
+
+static inline void
+memtx_tree_hint_stat_collect(hint_t hint_a, hint_t hint_b)
+{
+	struct memtx_tree_hint_stat *stat = memtx_tree_hint_sample;
+	if (likely(stat == NULL))
+		return;
+	if (hint_a != HINT_NONE && hint_b != HINT_NONE && hint_a != hint_b)
+		stat->resolved++;
+	else
+		stat->unresolved++;
+}
+
 #define BPS_TREE_NAME memtx_tree
 #define BPS_TREE_BLOCK_SIZE (512)
 #define BPS_TREE_EXTENT_SIZE MEMTX_EXTENT_SIZE
 #define BPS_TREE_COMPARE(a, b, arg)\
-	tuple_compare((&a)->tuple, (&a)->hint, (&b)->tuple, (&b)->hint, arg)
+	(memtx_tree_hint_stat_collect((&a)->hint, (&b)->hint),\
+	 tuple_compare((&a)->tuple, (&a)->hint, (&b)->tuple, (&b)->hint, arg))
 #define BPS_TREE_COMPARE_KEY(a, b, arg)\
-	tuple_compare_with_key((&a)->tuple, (&a)->hint, (b)->key,\
-			       (b)->part_count, (b)->hint, arg)
+	(memtx_tree_hint_stat_collect((&a)->hint, (b)->hint),\
+	 tuple_compare_with_key((&a)->tuple, (&a)->hint, (b)->key,\
+				(b)->part_count, (b)->hint, arg))
 #define BPS_TREE_IS_IDENTICAL(a, b) memtx_tree_data_is_equal(&a, &b)
 #define BPS_TREE_NO_DEBUG 1
 #define bps_tree_elem_t struct memtx_tree_data
@@ -111,6 +151,7 @@ struct memtx_tree_index {
 	size_t build_array_size, build_array_alloc_size;
 	struct memtx_gc_task gc_task;
 	struct memtx_tree_iterator gc_iterator;
+	struct memtx_tree_hint_stat hint_stat;
 };
 
 /* {{{ Utilities. *************************************************/
@@ -121,6 +162,24 @@ memtx_tree_cmp_def(struct memtx_tree *tree)
 	return tree->arg;
 }
 
+/**
+ * Account comparisons of a tree lookup in the index hint
+ * statistics if the lookup is sampled. Must be paired with
+ * memtx_tree_hint_sample_end().
+ */
+static inline void
+memtx_tree_hint_sample_begin(struct memtx_tree_index *index)
+{
+	if (++index->hint_stat.lookup_count % MEMTX_TREE_HINT_STAT_SAMPLE == 0)
+		memtx_tree_hint_sample = &index->hint_stat;
+}
+
+static inline void
+memtx_tree_hint_sample_end(void)
+{
+	memtx_tree_hint_sample = NULL;
+}
+
 static int
 memtx_tree_qcompare(const void* a, const void *b, void *c)
 {
@@ -350,17 +409,20 @@ tree_iterator_start(struct iterator *iterator, struct tuple **ret)
 		else
 			it->tree_iterator = memtx_tree_iterator_first(tree);
 	} else {
+		memtx_tree_hint_sample_begin(index);
 		if (type == ITER_ALL || type == ITER_EQ ||
 		    type == ITER_GE || type == ITER_LT) {
 			it->tree_iterator =
 				memtx_tree_lower_bound(tree, &it->key_data,
 						       &exact);
+			memtx_tree_hint_sample_end();
 			if (type == ITER_EQ && !exact)
 				return 0;
 		} else { // ITER_GT, ITER_REQ, ITER_LE
 			it->tree_iterator =
 				memtx_tree_upper_bound(tree, &it->key_data,
 						       &exact);
+			memtx_tree_hint_sample_end();
 			if (type == ITER_REQ && !exact)
 				return 0;
 		}
@@ -494,6 +556,29 @@ memtx_tree_index_depends_on_pk(struct index *base)
 	return !def->opts.is_unique || def->key_def->is_nullable;
 }
 
+static void
+memtx_tree_index_stat(struct index *base, struct info_handler *h)
+{
+	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
+	struct key_def *cmp_def = memtx_tree_cmp_def(&index->tree);
+	info_begin(h);
+	info_table_begin(h, "hint");
+	info_append_str(h, "layout", hint_layout_strs[cmp_def->hint_layout]);
+	info_append_int(h, "part_count", cmp_def->hint_part_count);
+	/* Sampled, see MEMTX_TREE_HINT_STAT_SAMPLE. */
+	info_append_int(h, "resolved", index->hint_stat.resolved);
+	info_append_int(h, "unresolved", index->hint_stat.unresolved);
+	info_table_end(h); /* hint */
+	info_end(h);
+}
+
+static void
+memtx_tree_index_reset_stat(struct index *base)
+{
+	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
+	memset(&index->hint_stat, 0, sizeof(index->hint_stat));
+}
+
 static ssize_t
 memtx_tree_index_size(struct index *base)
 {
@@ -538,7 +623,9 @@ memtx_tree_index_get(struct index *base, const char *key,
 	key_data.key = key;
 	key_data.part_count = part_count;
 	key_data.hint = key_hint(key, part_count, cmp_def);
+	memtx_tree_hint_sample_begin(index);
 	struct memtx_tree_data *res = memtx_tree_find(&index->tree, &key_data);
+	memtx_tree_hint_sample_end();
 	*result = res != NULL ? res->tuple : NULL;
 	return 0;
 }
@@ -558,8 +645,10 @@ memtx_tree_index_replace(struct index *base, struct tuple *old_tuple,
 		dup_data.tuple = NULL;
 
 		/* Try to optimistically replace the new_tuple. */
+		memtx_tree_hint_sample_begin(index);
 		int tree_res = memtx_tree_insert(&index->tree, new_data,
 						 &dup_data);
+		memtx_tree_hint_sample_end();
 		if (tree_res) {
 			diag_set(OutOfMemory, MEMTX_EXTENT_SIZE,
 				 "memtx_tree_index", "replace");
@@ -1174,13 +1263,33 @@ memtx_tree_index_build_array_deduplicate(struct memtx_tree_index *index,
 	index->build_array_size = w_idx + 1;
 }
 
+/**
+ * Check if build_array is already sorted. The primary key is
+ * recovered from a snapshot and bulk loaded in key order, so
+ * a linear pass is often enough to skip sorting altogether.
+ */
+static bool
+memtx_tree_index_build_array_is_sorted(struct memtx_tree_index *index)
+{
+	struct key_def *cmp_def = memtx_tree_cmp_def(&index->tree);
+	for (size_t i = 1; i < index->build_array_size; i++) {
+		if (memtx_tree_qcompare(&index->build_array[i - 1],
+					&index->build_array[i], cmp_def) > 0)
+			return false;
+	}
+	return true;
+}
+
 static void
 memtx_tree_index_end_build(struct index *base)
 {
 	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
 	struct key_def *cmp_def = memtx_tree_cmp_def(&index->tree);
-	qsort_arg(index->build_array, index->build_array_size,
-		  sizeof(index->build_array[0]), memtx_tree_qcompare, cmp_def);
+	if (!memtx_tree_index_build_array_is_sorted(index)) {
+		qsort_arg(index->build_array, index->build_array_size,
+			  sizeof(index->build_array[0]),
+			  memtx_tree_qcompare, cmp_def);
+	}
 	if (cmp_def->is_multikey) {
 		/*
 		 * Multikey index may have equal(in terms of
@@ -1289,9 +1398,9 @@ static const struct index_vtab memtx_tree_index_vtab = {
 	/* .create_iterator = */ memtx_tree_index_create_iterator,
 	/* .create_snapshot_iterator = */
 		memtx_tree_index_create_snapshot_iterator,
-	/* .stat = */ generic_index_stat,
+	/* .stat = */ memtx_tree_index_stat,
 	/* .compact = */ generic_index_compact,
-	/* .reset_stat = */ generic_index_reset_stat,
+	/* .reset_stat = */ memtx_tree_index_reset_stat,
 	/* .begin_build = */ memtx_tree_index_begin_build,
 	/* .reserve = */ memtx_tree_index_reserve,
 	/* .build_next = */ memtx_tree_index_build_next,
@@ -36,8 +36,8 @@
 #include <stdint.h>
 #include <stdlib.h>
 
-#define HEAP_FORWARD_DECLARATION
-#include "salad/heap.h"
+#define LOSER_TREE_FORWARD_DECLARATION
+#include "salad/loser_tree.h"
 
 #include "diag.h"             /* diag_set() */
 #include "box/tuple.h"        /* tuple_ref(), tuple_unref(),
@@ -54,14 +54,14 @@
  * compare the node against other nodes.
  *
  * The main reason why this structure is separated from a merge
- * source is that a heap node can not be a member of several
- * heaps.
+ * source is that a tree node can not be a member of several
+ * trees.
  *
- * The second reason is that it allows to encapsulate all heap
+ * The second reason is that it allows to encapsulate all tree
  * related logic inside this compilation unit, without any traces
  * in externally visible structures.
  */
-struct merger_heap_node {
+struct merger_node {
 	/* A source of tuples. */
 	struct merge_source *source;
 	/*
@@ -69,25 +69,21 @@ struct merger_heap_node {
 	 * other nodes.
 	 */
 	struct tuple *tuple;
-	/* An anchor to make the structure a merger heap node. */
-	struct heap_node in_merger;
+	/* An anchor to make the structure a merger tree node. */
+	struct loser_tree_node in_merger;
 };
 
 static bool
-merge_source_less(const heap_t *heap, const struct merger_heap_node *left,
-		  const struct merger_heap_node *right);
-#define HEAP_NAME merger_heap
-#define HEAP_LESS merge_source_less
-#define heap_value_t struct merger_heap_node
-#define heap_value_attr in_merger
-#include "salad/heap.h"
-#undef HEAP_NAME
-#undef HEAP_LESS
-#undef heap_value_t
-#undef heap_value_attr
+merge_source_less(const loser_tree_t *tree, const struct merger_node *left,
+		  const struct merger_node *right);
+#define LOSER_TREE_NAME merger_tree
+#define LOSER_TREE_LESS merge_source_less
+#define loser_tree_value_t struct merger_node
+#define loser_tree_value_attr in_merger
+#include "salad/loser_tree.h"
 
 /**
- * Holds a heap, parameters of a merge process and utility fields.
+ * Holds a tree, parameters of a merge process and utility fields.
  */
 struct merger {
 	/* A merger is a source. */
@@ -95,7 +91,7 @@ struct merger {
 	/*
 	 * Whether a merge process started.
 	 *
-	 * The merger postpones charging of heap nodes until a
+	 * The merger postpones charging of tree nodes until a
 	 * first output tuple is acquired.
 	 */
 	bool started;
@@ -104,13 +100,14 @@ struct merger {
 	/* A format to acquire compatible tuples from sources. */
 	struct tuple_format *format;
 	/*
-	 * A heap of sources (of nodes that contains a source to
-	 * be exact).
+	 * A tournament tree of sources (of nodes that contains a
+	 * source to be exact). It takes about log2(k) comparisons
+	 * per output tuple, while a heap needs up to 2 * log2(k).
 	 */
-	heap_t heap;
-	/* An array of heap nodes. */
+	loser_tree_t tree;
+	/* An array of tree nodes. */
 	uint32_t node_count;
-	struct merger_heap_node *nodes;
+	struct merger_node *nodes;
 	/* Ascending (false) / descending (true) order. */
 	bool reverse;
 };
@@ -118,38 +115,37 @@ struct merger {
 /* Helpers */
 
 /**
- * Data comparing function to construct a heap of sources.
+ * Data comparing function to construct a tree of sources.
  */
 static bool
-merge_source_less(const heap_t *heap, const struct merger_heap_node *left,
-		  const struct merger_heap_node *right)
+merge_source_less(const loser_tree_t *tree, const struct merger_node *left,
+		  const struct merger_node *right)
 {
 	assert(left->tuple != NULL);
 	assert(right->tuple != NULL);
-	struct merger *merger = container_of(heap, struct merger, heap);
+	struct merger *merger = container_of(tree, struct merger, tree);
 	int cmp = tuple_compare(left->tuple, HINT_NONE, right->tuple, HINT_NONE,
 				merger->key_def);
 	return merger->reverse ? cmp >= 0 : cmp < 0;
 }
 
 /**
- * Initialize a new merger heap node.
+ * Initialize a new merger tree node.
  */
 static void
-merger_heap_node_create(struct merger_heap_node *node,
-			struct merge_source *source)
+merger_node_create(struct merger_node *node, struct merge_source *source)
 {
 	node->source = source;
 	merge_source_ref(node->source);
 	node->tuple = NULL;
-	heap_node_create(&node->in_merger);
+	loser_tree_node_create(&node->in_merger);
 }
 
 /**
- * Free a merger heap node.
+ * Free a merger tree node.
  */
 static void
-merger_heap_node_delete(struct merger_heap_node *node)
+merger_node_delete(struct merger_node *node)
 {
 	merge_source_unref(node->source);
 	if (node->tuple != NULL)
@@ -157,15 +153,15 @@ merger_heap_node_delete(struct merger_heap_node *node)
 }
 
 /**
- * The helper to add a new heap node to a merger heap.
+ * The helper to add a new tree node to a merger tree.
  *
  * Return -1 at an error and set a diag.
  *
  * Otherwise store a next tuple in node->tuple, add the node to
- * merger->heap and return 0.
+ * merger->tree and return 0.
  */
 static int
-merger_add_heap_node(struct merger *merger, struct merger_heap_node *node)
+merger_add_node(struct merger *merger, struct merger_node *node)
 {
 	struct tuple *tuple = NULL;
 
@@ -174,15 +170,15 @@ merger_add_heap_node(struct merger *merger, struct merger_heap_node *node)
 	if (merge_source_next(source, merger->format, &tuple) != 0)
 		return -1;
 
-	/* Don't add an empty source to a heap. */
+	/* Don't add an empty source to a tree. */
 	if (tuple == NULL)
 		return 0;
 
 	node->tuple = tuple;
 
-	/* Add a node to a heap. */
-	if (merger_heap_insert(&merger->heap, node) != 0) {
-		diag_set(OutOfMemory, 0, "malloc", "merger->heap");
+	/* Add a node to a tree. */
+	if (merger_tree_insert(&merger->tree, node) != 0) {
+		diag_set(OutOfMemory, 0, "malloc", "merger->tree");
 		return -1;
 	}
 
@@ -210,17 +206,16 @@ static int
 merger_set_sources(struct merger *merger, struct merge_source **sources,
 		   uint32_t source_count)
 {
-	const size_t nodes_size = sizeof(struct merger_heap_node) *
-		source_count;
-	struct merger_heap_node *nodes = malloc(nodes_size);
+	const size_t nodes_size = sizeof(struct merger_node) * source_count;
+	struct merger_node *nodes = malloc(nodes_size);
 	if (nodes == NULL) {
 		diag_set(OutOfMemory, nodes_size, "malloc",
-			 "merger heap nodes");
+			 "merger tree nodes");
 		return -1;
 	}
 
 	for (uint32_t i = 0; i < source_count; ++i)
-		merger_heap_node_create(&nodes[i], sources[i]);
+		merger_node_create(&nodes[i], sources[i]);
 
 	merger->node_count = source_count;
 	merger->nodes = nodes;
@@ -266,7 +261,7 @@ merger_new(struct key_def *key_def, struct merge_source **sources,
 	merger->started = false;
 	merger->key_def = key_def;
 	merger->format = format;
-	merger_heap_create(&merger->heap);
+	merger_tree_create(&merger->tree);
 	merger->node_count = 0;
 	merger->nodes = NULL;
 	merger->reverse = reverse;
@@ -274,7 +269,7 @@ merger_new(struct key_def *key_def, struct merge_source **sources,
 	if (merger_set_sources(merger, sources, source_count) != 0) {
 		key_def_delete(merger->key_def);
 		tuple_format_unref(merger->format);
-		merger_heap_destroy(&merger->heap);
+		merger_tree_destroy(&merger->tree);
 		free(merger);
 		return NULL;
 	}
@@ -291,10 +286,10 @@ merger_delete(struct merge_source *base)
 
 	key_def_delete(merger->key_def);
 	tuple_format_unref(merger->format);
-	merger_heap_destroy(&merger->heap);
+	merger_tree_destroy(&merger->tree);
 
 	for (uint32_t i = 0; i < merger->node_count; ++i)
-		merger_heap_node_delete(&merger->nodes[i]);
+		merger_node_delete(&merger->nodes[i]);
 
 	if (merger->nodes != NULL)
 		free(merger->nodes);
@@ -309,20 +304,20 @@ merger_next(struct merge_source *base, struct tuple_format *format,
 	struct merger *merger = container_of(base, struct merger, base);
 
 	/*
-	 * Fetch a first tuple for each source and add all heap
-	 * nodes to a merger heap.
+	 * Fetch a first tuple for each source and add all tree
+	 * nodes to a merger tree.
 	 */
 	if (!merger->started) {
 		for (uint32_t i = 0; i < merger->node_count; ++i) {
-			struct merger_heap_node *node = &merger->nodes[i];
-			if (merger_add_heap_node(merger, node) != 0)
+			struct merger_node *node = &merger->nodes[i];
+			if (merger_add_node(merger, node) != 0)
 				return -1;
 		}
 		merger->started = true;
 	}
 
 	/* Get a next tuple. */
-	struct merger_heap_node *node = merger_heap_top(&merger->heap);
+	struct merger_node *node = merger_tree_top(&merger->tree);
 	if (node == NULL) {
 		*out = NULL;
 		return 0;
@@ -343,11 +338,11 @@ merger_next(struct merge_source *base, struct tuple_format *format,
 	if (merge_source_next(source, merger->format, &node->tuple) != 0)
 		return -1;
 
-	/* Update a heap. */
+	/* Replay the matches of the node. */
 	if (node->tuple == NULL)
-		merger_heap_delete(&merger->heap, node);
+		merger_tree_delete(&merger->tree, node);
 	else
-		merger_heap_update(&merger->heap, node);
+		merger_tree_update(&merger->tree, node);
 
 	*out = tuple;
 	return 0;
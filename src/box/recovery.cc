@@ -42,6 +42,8 @@
 #include "session.h"
 #include "coio_file.h"
 #include "error.h"
+#include "tt_pthread.h"
+#include "salad/stailq.h"
 
 /*
  * Recovery subsystem
@@ -230,6 +232,377 @@ recovery_delete(struct recovery *r)
 	free(r);
 }
 
+/**
+ * Apply a row read from the current WAL, unless it has
+ * already been applied.
+ */
+static void
+recovery_apply_row(struct recovery *r, struct xstream *stream,
+		   struct xrow_header *row, uint64_t *row_count)
+{
+	int64_t current_lsn = vclock_get(&r->vclock, row->replica_id);
+	if (row->lsn <= current_lsn)
+		return; /* already applied, skip */
+
+	/*
+	 * All rows in xlog files have an assigned replica
+	 * id. The only exception are local rows, which
+	 * are signed with a zero replica id.
+	 */
+	assert(row->replica_id != 0 || row->group_id == GROUP_LOCAL);
+	/*
+	 * We can promote the vclock either before or
+	 * after xstream_write(): it only makes any impact
+	 * in case of forced recovery, when we skip the
+	 * failed row anyway.
+	 */
+	vclock_follow_xrow(&r->vclock, row);
+	if (xstream_write(stream, row) == 0) {
+		++*row_count;
+		if (*row_count % 100000 == 0)
+			say_info("%.1fM rows processed",
+				 *row_count / 1000000.);
+	} else {
+		if (!r->wal_dir.force_recovery)
+			diag_raise();
+
+		say_error("skipping row {%u: %lld}",
+			  (unsigned)row->replica_id, (long long)row->lsn);
+		diag_log();
+	}
+}
+
+/* {{{ Read-ahead of WAL rows in a separate thread */
+
+enum {
+	/** Max number of rows in a read-ahead batch. */
+	RECOVERY_BATCH_ROWS = 1024,
+	/** Size of row bodies after which a batch is sent. */
+	RECOVERY_BATCH_SIZE = 1024 * 1024,
+	/** Max number of batches read ahead. */
+	RECOVERY_BATCH_MAX = 8,
+};
+
+/** A batch of rows read ahead by the reader thread. */
+struct recovery_batch {
+	/** Link in recovery_reader::batches. */
+	struct stailq_entry in_reader;
+	/** Number of rows in the batch. */
+	int row_count;
+	/** Rows, with bodies pointing to @a data. */
+	struct xrow_header rows[RECOVERY_BATCH_ROWS];
+	/** Copy of the row bodies. */
+	char *data;
+	/** Size of @a data and the used part of it. */
+	size_t data_size;
+	size_t data_used;
+};
+
+/**
+ * The reader thread reads the current WAL with a cursor of its
+ * own, so that reading the file, decompressing and decoding
+ * rows overlaps with applying them in the tx thread. Then the
+ * recovery cursor is repositioned past the rows read.
+ */
+struct recovery_reader {
+	/** The reader thread. */
+	struct cord cord;
+	/** Name of the file to read. */
+	const char *filename;
+	/** Offset to start reading from. */
+	off_t start_pos;
+	/** Offset of the first row not read, set on exit. */
+	off_t end_pos;
+	bool force_recovery;
+	/** Protects the members below. */
+	pthread_mutex_t mutex;
+	/** Signalled when a batch is consumed or on cancel. */
+	pthread_cond_t cond;
+	/** Batches read and not yet applied. */
+	struct stailq batches;
+	int batch_count;
+	/** Set when the reader thread is done. */
+	bool is_done;
+	/** Set by the tx thread to stop the reader thread. */
+	bool is_cancelled;
+	/** Error the reader thread stopped at, if any. */
+	struct diag diag;
+	/** Wakes up the tx thread when a batch is ready. */
+	struct ev_async async;
+	/** Event loop of the tx thread. */
+	struct ev_loop *tx_loop;
+	/** Signalled when a batch is ready or the thread is done. */
+	struct fiber_cond ready;
+};
+
+static struct recovery_batch *
+recovery_batch_new(void)
+{
+	struct recovery_batch *batch =
+		(struct recovery_batch *)malloc(sizeof(*batch));
+	if (batch == NULL) {
+		diag_set(OutOfMemory, sizeof(*batch), "malloc",
+			 "struct recovery_batch");
+		return NULL;
+	}
+	batch->row_count = 0;
+	batch->data = NULL;
+	batch->data_size = 0;
+	batch->data_used = 0;
+	return batch;
+}
+
+static void
+recovery_batch_delete(struct recovery_batch *batch)
+{
+	free(batch->data);
+	free(batch);
+}
+
+/**
+ * Append a row to a batch. The row body is copied and its
+ * offset in the batch data is stored instead of the pointer
+ * until the batch is complete, see recovery_batch_finish().
+ */
+static int
+recovery_batch_add(struct recovery_batch *batch, struct xrow_header *row)
+{
+	assert(batch->row_count < RECOVERY_BATCH_ROWS);
+	size_t size = 0;
+	for (int i = 0; i < row->bodycnt; i++)
+		size += row->body[i].iov_len;
+	if (batch->data_used + size > batch->data_size) {
+		size_t new_size = MAX(batch->data_size * 2,
+				      batch->data_used + size);
+		char *data = (char *)realloc(batch->data, new_size);
+		if (data == NULL) {
+			diag_set(OutOfMemory, new_size, "realloc",
+				 "recovery batch");
+			return -1;
+		}
+		batch->data = data;
+		batch->data_size = new_size;
+	}
+	struct xrow_header *copy = &batch->rows[batch->row_count++];
+	*copy = *row;
+	copy->bodycnt = row->bodycnt > 0 ? 1 : 0;
+	copy->body[0].iov_base = (void *)(uintptr_t)batch->data_used;
+	copy->body[0].iov_len = size;
+	for (int i = 0; i < row->bodycnt; i++) {
+		memcpy(batch->data + batch->data_used, row->body[i].iov_base,
+		       row->body[i].iov_len);
+		batch->data_used += row->body[i].iov_len;
+	}
+	return 0;
+}
+
+static void
+recovery_batch_finish(struct recovery_batch *batch)
+{
+	for (int i = 0; i < batch->row_count; i++) {
+		struct xrow_header *row = &batch->rows[i];
+		row->body[0].iov_base = batch->data +
+					(uintptr_t)row->body[0].iov_base;
+	}
+}
+
+/**
+ * Pass a complete batch to the tx thread. Blocks while too
+ * many batches are pending. The batch is deleted if the
+ * reader was cancelled.
+ * @retval 0 success
+ * @retval -1 the reader was cancelled
+ */
+static int
+recovery_reader_push(struct recovery_reader *reader,
+		     struct recovery_batch *batch)
+{
+	recovery_batch_finish(batch);
+	tt_pthread_mutex_lock(&reader->mutex);
+	while (reader->batch_count >= RECOVERY_BATCH_MAX &&
+	       !reader->is_cancelled)
+		tt_pthread_cond_wait(&reader->cond, &reader->mutex);
+	bool is_cancelled = reader->is_cancelled;
+	if (!is_cancelled) {
+		stailq_add_tail_entry(&reader->batches, batch, in_reader);
+		reader->batch_count++;
+	}
+	tt_pthread_mutex_unlock(&reader->mutex);
+	if (is_cancelled) {
+		recovery_batch_delete(batch);
+		return -1;
+	}
+	ev_async_send(reader->tx_loop, &reader->async);
+	return 0;
+}
+
+static int
+recovery_reader_f(va_list ap)
+{
+	struct recovery_reader *reader = va_arg(ap, struct recovery_reader *);
+	struct xlog_cursor cursor;
+	struct recovery_batch *batch = NULL;
+	int rc = xlog_cursor_open(&cursor, reader->filename);
+	if (rc != 0)
+		goto out;
+	xlog_cursor_reset(&cursor, reader->start_pos);
+	struct xrow_header row;
+	while ((rc = xlog_cursor_next(&cursor, &row,
+				      reader->force_recovery)) == 0) {
+		if (batch == NULL && (batch = recovery_batch_new()) == NULL) {
+			rc = -1;
+			break;
+		}
+		if (recovery_batch_add(batch, &row) != 0) {
+			rc = -1;
+			break;
+		}
+		if (batch->row_count < RECOVERY_BATCH_ROWS &&
+		    batch->data_used < RECOVERY_BATCH_SIZE)
+			continue;
+		rc = recovery_reader_push(reader, batch);
+		batch = NULL;
+		if (rc != 0)
+			break;
+	}
+	/*
+	 * Unless there was an error, the cursor stopped at a tx
+	 * boundary: at the EOF marker or at a tx that hasn't
+	 * been written completely yet.
+	 */
+	reader->end_pos = xlog_cursor_pos(&cursor);
+	xlog_cursor_close(&cursor, false);
+out:
+	if (rc < 0)
+		diag_move(diag_get(), &reader->diag);
+	if (batch != NULL) {
+		if (batch->row_count > 0)
+			recovery_reader_push(reader, batch);
+		else
+			recovery_batch_delete(batch);
+	}
+	tt_pthread_mutex_lock(&reader->mutex);
+	reader->is_done = true;
+	tt_pthread_mutex_unlock(&reader->mutex);
+	ev_async_send(reader->tx_loop, &reader->async);
+	return 0;
+}
+
+static void
+recovery_reader_async_cb(struct ev_loop *loop, struct ev_async *watcher,
+			 int events)
+{
+	(void)loop;
+	(void)events;
+	struct recovery_reader *reader =
+		(struct recovery_reader *)watcher->data;
+	fiber_cond_broadcast(&reader->ready);
+}
+
+/**
+ * Take the next batch read by the reader thread, waiting for
+ * it if necessary.
+ * @retval NULL the reader thread is done
+ */
+static struct recovery_batch *
+recovery_reader_pop(struct recovery_reader *reader)
+{
+	struct recovery_batch *batch = NULL;
+	tt_pthread_mutex_lock(&reader->mutex);
+	while (stailq_empty(&reader->batches) && !reader->is_done) {
+		tt_pthread_mutex_unlock(&reader->mutex);
+		fiber_cond_wait(&reader->ready);
+		tt_pthread_mutex_lock(&reader->mutex);
+	}
+	if (!stailq_empty(&reader->batches)) {
+		batch = stailq_shift_entry(&reader->batches,
+					   struct recovery_batch, in_reader);
+		reader->batch_count--;
+		tt_pthread_cond_signal(&reader->cond);
+	}
+	tt_pthread_mutex_unlock(&reader->mutex);
+	return batch;
+}
+
+/**
+ * Stop the reader thread and free the batches it has read.
+ */
+static void
+recovery_reader_stop(struct recovery_reader *reader)
+{
+	tt_pthread_mutex_lock(&reader->mutex);
+	reader->is_cancelled = true;
+	tt_pthread_cond_signal(&reader->cond);
+	tt_pthread_mutex_unlock(&reader->mutex);
+	cord_cojoin(&reader->cord);
+	ev_async_stop(reader->tx_loop, &reader->async);
+	struct recovery_batch *batch, *tmp;
+	stailq_foreach_entry_safe(batch, tmp, &reader->batches, in_reader)
+		recovery_batch_delete(batch);
+	fiber_cond_destroy(&reader->ready);
+	tt_pthread_cond_destroy(&reader->cond);
+	tt_pthread_mutex_destroy(&reader->mutex);
+	diag_destroy(&reader->diag);
+}
+
+/**
+ * Apply rows of the current WAL read ahead in a separate
+ * thread, then reposition the recovery cursor past them.
+ * Falls back on reading in the tx thread if the thread
+ * can't be started.
+ */
+static void
+recover_xlog_read_ahead(struct recovery *r, struct xstream *stream,
+			uint64_t *row_count)
+{
+	struct recovery_reader reader;
+	reader.filename = r->cursor.name;
+	reader.start_pos = xlog_cursor_pos(&r->cursor);
+	reader.end_pos = reader.start_pos;
+	reader.force_recovery = r->wal_dir.force_recovery;
+	tt_pthread_mutex_init(&reader.mutex, NULL);
+	tt_pthread_cond_init(&reader.cond, NULL);
+	stailq_create(&reader.batches);
+	reader.batch_count = 0;
+	reader.is_done = false;
+	reader.is_cancelled = false;
+	diag_create(&reader.diag);
+	fiber_cond_create(&reader.ready);
+	reader.tx_loop = loop();
+	ev_async_init(&reader.async, recovery_reader_async_cb);
+	reader.async.data = &reader;
+	ev_async_start(reader.tx_loop, &reader.async);
+	if (cord_costart(&reader.cord, "xlog_reader",
+			 recovery_reader_f, &reader) != 0) {
+		diag_log();
+		ev_async_stop(reader.tx_loop, &reader.async);
+		fiber_cond_destroy(&reader.ready);
+		tt_pthread_cond_destroy(&reader.cond);
+		tt_pthread_mutex_destroy(&reader.mutex);
+		diag_destroy(&reader.diag);
+		return;
+	}
+	auto guard = make_scoped_guard([&]{
+		recovery_reader_stop(&reader);
+	});
+	struct recovery_batch *batch;
+	while ((batch = recovery_reader_pop(&reader)) != NULL) {
+		auto batch_guard = make_scoped_guard([=]{
+			recovery_batch_delete(batch);
+		});
+		for (int i = 0; i < batch->row_count; i++)
+			recovery_apply_row(r, stream, &batch->rows[i],
+					   row_count);
+	}
+	if (!diag_is_empty(&reader.diag)) {
+		diag_move(&reader.diag, diag_get());
+		diag_raise();
+	}
+	xlog_cursor_reset(&r->cursor, reader.end_pos);
+}
+
+/* }}} */
+
 /**
  * Read all rows in a file starting from the last position.
  * Advance the position. If end of file is reached,
@@ -243,6 +616,14 @@ recover_xlog(struct recovery *r, struct xstream *stream,
 {
 	struct xrow_header row;
 	uint64_t row_count = 0;
+	/*
+	 * Read-ahead can't stop at a vclock and can only start
+	 * at a tx boundary. The rest of the file, e.g. the EOF
+	 * marker or a tx being written, is read as usual.
+	 */
+	if (r->read_ahead && stop_vclock == NULL &&
+	    r->cursor.state == XLOG_CURSOR_ACTIVE && r->cursor.fd >= 0)
+		recover_xlog_read_ahead(r, stream, &row_count);
 	while (xlog_cursor_next_xc(&r->cursor, &row,
 				   r->wal_dir.force_recovery) == 0) {
 		/*
@@ -256,36 +637,7 @@ recover_xlog(struct recovery *r, struct xstream *stream,
 		if (stop_vclock != NULL &&
 		    r->vclock.signature >= stop_vclock->signature)
 			return;
-		int64_t current_lsn = vclock_get(&r->vclock, row.replica_id);
-		if (row.lsn <= current_lsn)
-			continue; /* already applied, skip */
-
-		/*
-		 * All rows in xlog files have an assigned replica
-		 * id. The only exception are local rows, which
-		 * are signed with a zero replica id.
-		 */
-		assert(row.replica_id != 0 || row.group_id == GROUP_LOCAL);
-		/*
-		 * We can promote the vclock either before or
-		 * after xstream_write(): it only makes any impact
-		 * in case of forced recovery, when we skip the
-		 * failed row anyway.
-		 */
-		vclock_follow_xrow(&r->vclock, &row);
-		if (xstream_write(stream, &row) == 0) {
-			++row_count;
-			if (row_count % 100000 == 0)
-				say_info("%.1fM rows processed",
-					 row_count / 1000000.);
-		} else {
-			if (!r->wal_dir.force_recovery)
-				diag_raise();
-
-			say_error("skipping row {%u: %lld}",
-				  (unsigned)row.replica_id, (long long)row.lsn);
-			diag_log();
-		}
+		recovery_apply_row(r, stream, &row, &row_count);
 	}
 }
 
@@ -58,6 +58,12 @@ struct recovery {
 	struct fiber *watcher;
 	/** List of triggers invoked when the current WAL is closed. */
 	struct rlist on_close_log;
+	/**
+	 * If set, rows of a WAL are read, decompressed and
+	 * decoded in a separate thread while the rows read
+	 * before are being applied.
+	 */
+	bool read_ahead;
 };
 
 struct recovery *
@@ -139,6 +139,8 @@ struct relay {
 	double last_row_time;
 	/** Relay sync state. */
 	enum relay_state state;
+	/** Number of rows sent during initial join. */
+	uint64_t join_row_count;
 
 	struct {
 		/* Align to prevent false-sharing with tx thread */
@@ -292,9 +294,117 @@ relay_set_cord_name(int fd)
 	cord_set_name(name);
 }
 
+/** State of an extra data stream of a parallel initial join. */
+enum relay_join_stream_state {
+	/** The replica hasn't attached to the stream yet. */
+	RELAY_JOIN_STREAM_PENDING,
+	/** The stream data is being sent. */
+	RELAY_JOIN_STREAM_SENDING,
+	/** The stream data has been sent or taken over. */
+	RELAY_JOIN_STREAM_DONE,
+};
+
+/**
+ * Initial join sending data to a replica over several
+ * connections. Stream 0 is the JOIN connection itself,
+ * the replica attaches to the others with JOIN_STREAM
+ * requests.
+ */
+struct relay_join {
+	/** Link in relay_joins. */
+	struct rlist in_joins;
+	/** UUID of the joining replica. */
+	struct tt_uuid instance_uuid;
+	/** Read view sent to the replica. */
+	struct engine_join_ctx *ctx;
+	/** Number of streams, including the JOIN connection. */
+	uint32_t stream_count;
+	/** State of each stream. Stream 0 is unused. */
+	enum relay_join_stream_state states[REPLICATION_JOIN_STREAMS_MAX];
+	/**
+	 * Number of rows sent over each extra stream's own
+	 * connection, reported to the replica so that it can
+	 * check it has received them all.
+	 */
+	uint64_t row_counts[REPLICATION_JOIN_STREAMS_MAX];
+	/** Error that occurred while sending an extra stream. */
+	struct diag diag;
+	/** Signaled whenever an extra stream is done. */
+	struct fiber_cond cond;
+};
+
+/** Parallel initial joins in progress. */
+static struct rlist relay_joins = RLIST_HEAD_INITIALIZER(relay_joins);
+
+static struct relay_join *
+relay_join_find(const struct tt_uuid *instance_uuid)
+{
+	struct relay_join *join;
+	rlist_foreach_entry(join, &relay_joins, in_joins) {
+		if (tt_uuid_is_equal(&join->instance_uuid, instance_uuid))
+			return join;
+	}
+	return NULL;
+}
+
+/** Wait until no extra stream of a join is being sent. */
+static void
+relay_join_wait_sending(struct relay_join *join)
+{
+	for (uint32_t i = 1; i < join->stream_count; i++) {
+		while (join->states[i] == RELAY_JOIN_STREAM_SENDING)
+			fiber_cond_wait(&join->cond);
+	}
+}
+
+/**
+ * Wait for all extra streams of a join to be sent. Streams
+ * the replica hasn't attached to in time are sent over the
+ * JOIN connection instead.
+ */
+static void
+relay_join_wait(struct relay_join *join, struct relay *relay)
+{
+	double deadline = ev_monotonic_now(loop()) +
+			  replication_disconnect_timeout();
+	for (uint32_t i = 1; i < join->stream_count; i++) {
+		while (join->states[i] == RELAY_JOIN_STREAM_PENDING &&
+		       ev_monotonic_now(loop()) < deadline) {
+			fiber_testcancel();
+			fiber_cond_wait_deadline(&join->cond, deadline);
+		}
+		fiber_testcancel();
+		if (join->states[i] != RELAY_JOIN_STREAM_PENDING)
+			continue;
+		diag_clear(diag_get());
+		say_warn("replica %s hasn't attached to join stream %u, "
+			 "sending it over the main connection",
+			 tt_uuid_str(&join->instance_uuid), (unsigned)i);
+		join->states[i] = RELAY_JOIN_STREAM_DONE;
+		engine_join_stream_xc(join->ctx, i, &relay->stream);
+	}
+	for (uint32_t i = 1; i < join->stream_count; i++) {
+		while (join->states[i] == RELAY_JOIN_STREAM_SENDING) {
+			fiber_testcancel();
+			fiber_cond_wait(&join->cond);
+		}
+	}
+	if (!diag_is_empty(&join->diag)) {
+		diag_move(&join->diag, diag_get());
+		diag_raise();
+	}
+}
+
 void
-relay_initial_join(int fd, uint64_t sync, struct vclock *vclock)
+relay_initial_join(int fd, uint64_t sync, struct vclock *vclock,
+		   const struct tt_uuid *instance_uuid, uint32_t stream_count)
 {
+	assert(stream_count > 0);
+	if (instance_uuid == NULL)
+		stream_count = 1;
+	stream_count = MIN(stream_count,
+			   (uint32_t)REPLICATION_JOIN_STREAMS_MAX);
+
 	struct relay *relay = relay_new(NULL);
 	if (relay == NULL)
 		diag_raise();
@@ -320,14 +430,137 @@ relay_initial_join(int fd, uint64_t sync, struct vclock *vclock)
 	if (wal_sync(vclock) != 0)
 		diag_raise();
 
+	/*
+	 * Let the replica attach extra streams to the join.
+	 * They must be registered before the response, which
+	 * tells the replica how many streams to open.
+	 */
+	struct relay_join join;
+	join.instance_uuid = instance_uuid != NULL ? *instance_uuid : uuid_nil;
+	join.ctx = &ctx;
+	join.stream_count = stream_count;
+	for (uint32_t i = 0; i < stream_count; i++) {
+		join.states[i] = RELAY_JOIN_STREAM_PENDING;
+		join.row_counts[i] = 0;
+	}
+	diag_create(&join.diag);
+	fiber_cond_create(&join.cond);
+	if (stream_count > 1) {
+		engine_split_join_xc(&ctx, stream_count);
+		rlist_add_entry(&relay_joins, &join, in_joins);
+	}
+	auto stream_guard = make_scoped_guard([&] {
+		if (stream_count > 1) {
+			rlist_del_entry(&join, in_joins);
+			for (uint32_t i = 1; i < stream_count; i++) {
+				if (join.states[i] == RELAY_JOIN_STREAM_PENDING)
+					join.states[i] = RELAY_JOIN_STREAM_DONE;
+			}
+			/* Streams use the read view, wait for them. */
+			relay_join_wait_sending(&join);
+		}
+		diag_destroy(&join.diag);
+		fiber_cond_destroy(&join.cond);
+	});
+
 	/* Respond to the JOIN request with the current vclock. */
 	struct xrow_header row;
-	xrow_encode_vclock_xc(&row, vclock);
+	xrow_encode_join_response_xc(&row, vclock, stream_count);
 	row.sync = sync;
 	coio_write_xrow(&relay->io, &row);
 
 	/* Send read view to the replica. */
 	engine_join_xc(&ctx, &relay->stream);
+	if (stream_count == 1)
+		return;
+
+	/*
+	 * Tell the replica that the data sent over the JOIN
+	 * connection, including the whole schema, is over so
+	 * that it can apply the data of extra streams.
+	 */
+	xrow_encode_join_stream_xc(&row, instance_uuid, 0);
+	row.sync = sync;
+	coio_write_xrow(&relay->io, &row);
+
+	relay_join_wait(&join, relay);
+
+	/*
+	 * A stream connection may break after the data has been
+	 * written to the socket, so let the replica check that
+	 * it has received every row of every stream.
+	 */
+	for (uint32_t i = 1; i < stream_count; i++) {
+		xrow_encode_join_stream_rows_xc(&row, instance_uuid, i,
+						join.row_counts[i]);
+		row.sync = sync;
+		coio_write_xrow(&relay->io, &row);
+	}
+}
+
+void
+relay_initial_join_stream(int fd, uint64_t sync,
+			  const struct tt_uuid *instance_uuid,
+			  uint32_t stream_id)
+{
+	if (stream_id == 0 || stream_id >= REPLICATION_JOIN_STREAMS_MAX) {
+		tnt_raise(ClientError, ER_PROTOCOL,
+			  "Invalid join stream id");
+	}
+	ERROR_INJECT(ERRINJ_RELAY_JOIN_STREAM,
+		     tnt_raise(ClientError, ER_INJECTION, "relay join stream"));
+
+	struct relay *relay = relay_new(NULL);
+	if (relay == NULL)
+		diag_raise();
+
+	relay_start(relay, fd, sync, relay_send_initial_join_row);
+	auto relay_guard = make_scoped_guard([=] {
+		relay_stop(relay);
+		relay_delete(relay);
+	});
+
+	/*
+	 * Acknowledge the attach before sending any data. After
+	 * receiving the ack the replica doesn't expect the stream
+	 * to be sent over the JOIN connection, so any failure of
+	 * the stream fails the whole join.
+	 */
+	struct xrow_header row;
+	struct relay_join *join = relay_join_find(instance_uuid);
+	if (join != NULL && stream_id < join->stream_count &&
+	    join->states[stream_id] == RELAY_JOIN_STREAM_PENDING) {
+		xrow_encode_join_stream_xc(&row, instance_uuid, stream_id);
+		row.sync = sync;
+		coio_write_xrow(&relay->io, &row);
+	}
+
+	/*
+	 * If the join is over or the stream has been taken over
+	 * by the JOIN connection while the ack was being written,
+	 * the stream is just empty. The join may be gone by now,
+	 * so look it up again.
+	 */
+	join = relay_join_find(instance_uuid);
+	if (join != NULL && stream_id < join->stream_count &&
+	    join->states[stream_id] == RELAY_JOIN_STREAM_PENDING) {
+		join->states[stream_id] = RELAY_JOIN_STREAM_SENDING;
+		int rc = engine_join_stream(join->ctx, stream_id,
+					    &relay->stream);
+		if (rc != 0 && diag_is_empty(&join->diag))
+			diag_set_error(&join->diag, diag_last_error(diag_get()));
+		join->row_counts[stream_id] = relay->join_row_count;
+		join->states[stream_id] = RELAY_JOIN_STREAM_DONE;
+		fiber_cond_broadcast(&join->cond);
+		if (rc != 0)
+			diag_raise();
+	}
+
+	/* Send end of stream data marker. */
+	memset(&row, 0, sizeof(row));
+	row.type = IPROTO_OK;
+	row.sync = sync;
+	coio_write_xrow(&relay->io, &row);
 }
 
 int
@@ -750,8 +983,10 @@ relay_send_initial_join_row(struct xstream *stream, struct xrow_header *row)
 	 * Ignore replica local requests as we don't need to promote
 	 * vclock while sending a snapshot.
 	 */
-	if (row->group_id != GROUP_LOCAL)
+	if (row->group_id != GROUP_LOCAL) {
 		relay_send(relay, row);
+		relay->join_row_count++;
+	}
 }
 
 /** Send a single row to the client. */
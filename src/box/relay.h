@@ -103,9 +103,28 @@ relay_last_row_time(const struct relay *relay);
  * @param fd        client connection
  * @param sync      sync from incoming JOIN request
  * @param vclock[out] vclock of the read view sent to the replica
+ * @param instance_uuid UUID of the replica, may be NULL
+ * @param stream_count number of data streams the replica
+ *                  requested, the data is sent over a single
+ *                  one unless instance_uuid is given
  */
 void
-relay_initial_join(int fd, uint64_t sync, struct vclock *vclock);
+relay_initial_join(int fd, uint64_t sync, struct vclock *vclock,
+		   const struct tt_uuid *instance_uuid, uint32_t stream_count);
+
+/**
+ * Send initial JOIN rows of an extra data stream of a parallel
+ * join to the replica.
+ *
+ * @param fd        client connection
+ * @param sync      sync from incoming JOIN_STREAM request
+ * @param instance_uuid UUID of the joining replica
+ * @param stream_id id of the stream
+ */
+void
+relay_initial_join_stream(int fd, uint64_t sync,
+			  const struct tt_uuid *instance_uuid,
+			  uint32_t stream_id);
 
 /**
  * Send final JOIN rows to the replica.
@@ -98,6 +98,12 @@ struct gc_consumer;
 
 static const int REPLICATION_CONNECT_QUORUM_ALL = INT_MAX;
 
+/**
+ * Max number of data streams a master may use to send the
+ * initial data to a joining replica.
+ */
+static const int REPLICATION_JOIN_STREAMS_MAX = 16;
+
 /**
  * Network timeout. Determines how often master and slave exchange
  * heartbeat messages. Set by box.cfg.replication_timeout.
@@ -95,6 +95,8 @@ static const struct engine_vtab service_engine_vtab = {
 	/* .create_space = */ service_engine_create_space,
 	/* .prepare_join = */ generic_engine_prepare_join,
 	/* .join = */ generic_engine_join,
+	/* .split_join = */ generic_engine_split_join,
+	/* .join_stream = */ generic_engine_join_stream,
 	/* .complete_join = */ generic_engine_complete_join,
 	/* .begin = */ generic_engine_begin,
 	/* .begin_statement = */ generic_engine_begin_statement,
@@ -439,6 +439,7 @@ const struct space_vtab session_settings_space_vtab = {
 	/* .build_index = */ generic_space_build_index,
 	/* .swap_index = */ generic_space_swap_index,
 	/* .prepare_alter = */ generic_space_prepare_alter,
+	/* .prepare_truncate = */ generic_space_prepare_truncate,
 	/* .invalidate = */ generic_space_invalidate,
 };
 
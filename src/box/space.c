@@ -766,6 +766,13 @@ generic_space_prepare_alter(struct space *old_space, struct space *new_space)
 	return 0;
 }
 
+int
+generic_space_prepare_truncate(struct space *space)
+{
+	(void)space;
+	return 0;
+}
+
 void
 generic_space_invalidate(struct space *space)
 {
@@ -142,6 +142,11 @@ struct space_vtab {
 	 */
 	int (*prepare_alter)(struct space *old_space,
 			     struct space *new_space);
+	/**
+	 * Check that the space can be truncated. Called before
+	 * the truncation is started.
+	 */
+	int (*prepare_truncate)(struct space *space);
 	/**
 	 * Called right after removing a space from the cache.
 	 * The engine should abort all transactions involving
@@ -473,6 +478,12 @@ space_prepare_alter(struct space *old_space, struct space *new_space)
 	return new_space->vtab->prepare_alter(old_space, new_space);
 }
 
+static inline int
+space_prepare_truncate(struct space *space)
+{
+	return space->vtab->prepare_truncate(space);
+}
+
 static inline void
 space_invalidate(struct space *space)
 {
@@ -575,6 +586,7 @@ int generic_space_check_format(struct space *, struct tuple_format *);
 int generic_space_build_index(struct space *, struct index *,
 			      struct tuple_format *, bool);
 int generic_space_prepare_alter(struct space *, struct space *);
+int generic_space_prepare_truncate(struct space *);
 void generic_space_invalidate(struct space *);
 
 #if defined(__cplusplus)
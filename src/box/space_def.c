@@ -42,6 +42,7 @@ const struct space_opts space_opts_default = {
 	/* .is_ephemeral = */ false,
 	/* .view = */ false,
 	/* .sql        = */ NULL,
+	/* .expire_field = */ SPACE_EXPIRE_FIELD_NONE,
 };
 
 const struct opt_def space_opts_reg[] = {
@@ -49,6 +50,7 @@ const struct opt_def space_opts_reg[] = {
 	OPT_DEF("temporary", OPT_BOOL, struct space_opts, is_temporary),
 	OPT_DEF("view", OPT_BOOL, struct space_opts, is_view),
 	OPT_DEF("sql", OPT_STRPTR, struct space_opts, sql),
+	OPT_DEF("expire_field", OPT_UINT32, struct space_opts, expire_field),
 	OPT_DEF_LEGACY("checks"),
 	OPT_END,
 };
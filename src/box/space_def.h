@@ -69,6 +69,18 @@ struct space_opts {
 	bool is_view;
 	/** SQL statement that produced this space. */
 	char *sql;
+	/**
+	 * Number of the field holding the expiration time of a
+	 * tuple, in seconds since the epoch, or
+	 * SPACE_EXPIRE_FIELD_NONE. Expired tuples are deleted
+	 * in background, see memtx_expire.h.
+	 */
+	uint32_t expire_field;
+};
+
+enum {
+	/** The space doesn't expire tuples. */
+	SPACE_EXPIRE_FIELD_NONE = UINT32_MAX,
 };
 
 extern const struct space_opts space_opts_default;
@@ -0,0 +1,170 @@
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY AUTHORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * AUTHORS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "trace.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "diag.h"
+#include "tt_pthread.h"
+#include "trivia/util.h"
+
+/** Ring buffer of committed records. */
+static struct trace_record *trace_ring = NULL;
+/** Capacity of the ring. Changed only by tx. */
+static uint32_t trace_ring_size = 0;
+/** Number of records committed since the last start. */
+static uint64_t trace_ring_count = 0;
+/** Protects the ring from concurrent commit and dump. */
+static pthread_mutex_t trace_mutex = PTHREAD_MUTEX_INITIALIZER;
+/**
+ * Every trace_period-th request is traced, 0 if tracing is
+ * disabled. Set by tx, read by the net thread.
+ */
+static uint32_t trace_period = 0;
+/** Requests read since the last traced one. */
+static __thread uint32_t trace_counter = 0;
+
+int
+trace_start(double rate, uint32_t size)
+{
+	if (!(rate > 0 && rate <= 1)) {
+		diag_set(IllegalParams, "trace rate must be in (0, 1]");
+		return -1;
+	}
+	if (size == 0) {
+		diag_set(IllegalParams, "trace size must be positive");
+		return -1;
+	}
+	struct trace_record *ring =
+		(struct trace_record *)calloc(size, sizeof(*ring));
+	if (ring == NULL) {
+		diag_set(OutOfMemory, size * sizeof(*ring), "calloc",
+			 "trace ring");
+		return -1;
+	}
+	tt_pthread_mutex_lock(&trace_mutex);
+	struct trace_record *old_ring = trace_ring;
+	trace_ring = ring;
+	trace_ring_size = size;
+	trace_ring_count = 0;
+	tt_pthread_mutex_unlock(&trace_mutex);
+	free(old_ring);
+	__atomic_store_n(&trace_period, (uint32_t)(1 / rate + 0.5),
+			 __ATOMIC_RELAXED);
+	return 0;
+}
+
+void
+trace_stop(void)
+{
+	__atomic_store_n(&trace_period, 0, __ATOMIC_RELAXED);
+}
+
+bool
+trace_is_enabled(void)
+{
+	return __atomic_load_n(&trace_period, __ATOMIC_RELAXED) != 0;
+}
+
+struct trace_record *
+trace_record_new(uint32_t type, uint64_t sync, uint64_t start_ticks)
+{
+	uint32_t period = __atomic_load_n(&trace_period, __ATOMIC_RELAXED);
+	if (likely(period == 0) || ++trace_counter < period)
+		return NULL;
+	trace_counter = 0;
+	struct trace_record *record =
+		(struct trace_record *)malloc(sizeof(*record));
+	/* Tracing is best effort, skip the request on OOM. */
+	if (record == NULL)
+		return NULL;
+	memset(record, 0, sizeof(*record));
+	record->type = type;
+	record->sync = sync;
+	record->ticks[TRACE_NET_READ] = start_ticks;
+	return record;
+}
+
+void
+trace_record_commit(struct trace_record *record)
+{
+	tt_pthread_mutex_lock(&trace_mutex);
+	if (trace_ring != NULL) {
+		trace_ring[trace_ring_count % trace_ring_size] = *record;
+		trace_ring_count++;
+	}
+	tt_pthread_mutex_unlock(&trace_mutex);
+	free(record);
+}
+
+void
+trace_record_delete(struct trace_record *record)
+{
+	free(record);
+}
+
+int
+trace_records(struct trace_record **records, uint32_t *count)
+{
+	*records = NULL;
+	*count = 0;
+	if (trace_ring_size == 0)
+		return 0;
+	/* The ring is resized only by tx, so it's safe to read. */
+	size_t size = trace_ring_size * sizeof(**records);
+	struct trace_record *copy = (struct trace_record *)malloc(size);
+	if (copy == NULL) {
+		diag_set(OutOfMemory, size, "malloc", "trace records");
+		return -1;
+	}
+	tt_pthread_mutex_lock(&trace_mutex);
+	uint64_t n = MIN(trace_ring_count, (uint64_t)trace_ring_size);
+	uint64_t first = trace_ring_count - n;
+	for (uint64_t i = 0; i < n; i++)
+		copy[i] = trace_ring[(first + i) % trace_ring_size];
+	tt_pthread_mutex_unlock(&trace_mutex);
+	*records = copy;
+	*count = n;
+	return 0;
+}
+
+void
+trace_free(void)
+{
+	trace_stop();
+	tt_pthread_mutex_lock(&trace_mutex);
+	free(trace_ring);
+	trace_ring = NULL;
+	trace_ring_size = 0;
+	trace_ring_count = 0;
+	tt_pthread_mutex_unlock(&trace_mutex);
+}
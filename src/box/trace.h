@@ -0,0 +1,143 @@
+#ifndef TARANTOOL_BOX_TRACE_H_INCLUDED
+#define TARANTOOL_BOX_TRACE_H_INCLUDED
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY AUTHORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * AUTHORS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+/**
+ * Request tracing. A sampled share of iproto requests gets a
+ * trace record, which is stamped with clock_ticks() when the
+ * request moves from one stage to another on its way through
+ * the net, tx and WAL threads. Once the reply is back in the
+ * net thread, the record is copied to a ring buffer, from
+ * which tx can dump the latest records.
+ */
+
+/** Points in the life of a request, in their order. */
+enum trace_stage {
+	/** The net thread has read the request. */
+	TRACE_NET_READ,
+	/** tx has picked the request from the queue. */
+	TRACE_TX_ACCEPT,
+	/** tx has submitted a transaction to WAL. */
+	TRACE_WAL_SUBMIT,
+	/** The WAL thread has started writing the transaction. */
+	TRACE_WAL_WRITE,
+	/** The WAL thread has written the transaction. */
+	TRACE_WAL_DONE,
+	/** The fiber waiting for WAL has been woken up. */
+	TRACE_WAL_WAKEUP,
+	/** tx has put the reply to the output buffer. */
+	TRACE_TX_END,
+	/** The reply is back in the net thread. */
+	TRACE_NET_SEND,
+	trace_stage_MAX
+};
+
+struct trace_record {
+	/** Request type. */
+	uint32_t type;
+	/** Request sync. */
+	uint64_t sync;
+	/**
+	 * clock_ticks() at each stage, 0 if the request hasn't
+	 * passed it. If a request writes to WAL several times,
+	 * WAL stages refer to the last write.
+	 */
+	uint64_t ticks[trace_stage_MAX];
+};
+
+/**
+ * Start tracing @a rate share of requests, keeping the last
+ * @a size records. Resets the records collected before.
+ * Must be called from tx.
+ */
+int
+trace_start(double rate, uint32_t size);
+
+/**
+ * Stop tracing. The collected records are kept until the
+ * next start. Must be called from tx.
+ */
+void
+trace_stop(void);
+
+/** True if requests are being traced. */
+bool
+trace_is_enabled(void);
+
+/**
+ * Create a trace record for a request if the request is sampled.
+ * Must be called from a single thread, which reads requests.
+ * Returns NULL if the request isn't traced.
+ */
+struct trace_record *
+trace_record_new(uint32_t type, uint64_t sync, uint64_t start_ticks);
+
+/** Stamp a stage of a request. @a record may be NULL. */
+static inline void
+trace_record_stamp(struct trace_record *record, enum trace_stage stage,
+		   uint64_t ticks)
+{
+	if (record != NULL)
+		record->ticks[stage] = ticks;
+}
+
+/** Copy a record to the ring buffer and delete it. */
+void
+trace_record_commit(struct trace_record *record);
+
+/** Delete a record which isn't committed. */
+void
+trace_record_delete(struct trace_record *record);
+
+/**
+ * Copy the records from the ring buffer to a new array,
+ * oldest first. The array must be freed with free().
+ * Returns -1 and sets diag on out of memory.
+ */
+int
+trace_records(struct trace_record **records, uint32_t *count);
+
+void
+trace_free(void);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_BOX_TRACE_H_INCLUDED */
@@ -48,7 +48,7 @@
 enum { HASH_SEED = 13U };
 
 struct tuple_bloom_builder *
-tuple_bloom_builder_new(uint32_t part_count)
+tuple_bloom_builder_new(uint32_t part_count, enum tuple_hash_func hash_func)
 {
 	size_t size = sizeof(struct tuple_bloom_builder) +
 		part_count * sizeof(struct tuple_hash_array);
@@ -58,6 +58,7 @@ tuple_bloom_builder_new(uint32_t part_count)
 		return NULL;
 	}
 	memset(builder, 0, size);
+	builder->hash_func = hash_func;
 	builder->part_count = part_count;
 	return builder;
 }
@@ -111,6 +112,20 @@ tuple_bloom_builder_add(struct tuple_bloom_builder *builder,
 	assert(builder->part_count == key_def->part_count);
 	assert(!key_def->is_multikey || multikey_idx != MULTIKEY_NONE);
 
+	if (builder->hash_func == TUPLE_HASH_MUM64) {
+		uint64_t h = TUPLE_HASH64_SEED;
+		for (uint32_t i = 0; i < key_def->part_count; i++) {
+			h = tuple_hash64_mix(h, tuple_hash64_key_part(tuple,
+						&key_def->parts[i],
+						multikey_idx));
+			uint32_t hash = tuple_hash64_result(h);
+			if (tuple_hash_array_add(&builder->parts[i],
+						 hash) != 0)
+				return -1;
+		}
+		return 0;
+	}
+
 	uint32_t h = HASH_SEED;
 	uint32_t carry = 0;
 	uint32_t total_size = 0;
@@ -135,6 +150,19 @@ tuple_bloom_builder_add_key(struct tuple_bloom_builder *builder,
 	assert(part_count >= key_def->part_count);
 	assert(builder->part_count == key_def->part_count);
 
+	if (builder->hash_func == TUPLE_HASH_MUM64) {
+		uint64_t h = TUPLE_HASH64_SEED;
+		for (uint32_t i = 0; i < key_def->part_count; i++) {
+			h = tuple_hash64_mix(h, tuple_hash64_field(&key,
+						key_def->parts[i].coll));
+			uint32_t hash = tuple_hash64_result(h);
+			if (tuple_hash_array_add(&builder->parts[i],
+						 hash) != 0)
+				return -1;
+		}
+		return 0;
+	}
+
 	uint32_t h = HASH_SEED;
 	uint32_t carry = 0;
 	uint32_t total_size = 0;
@@ -162,6 +190,7 @@ tuple_bloom_new(struct tuple_bloom_builder *builder, double fpr)
 	}
 
 	bloom->is_legacy = false;
+	bloom->hash_func = builder->hash_func;
 	bloom->part_count = 0;
 
 	for (uint32_t i = 0; i < part_count; i++) {
@@ -207,12 +236,28 @@ tuple_bloom_maybe_has(const struct tuple_bloom *bloom, struct tuple *tuple,
 	assert(!key_def->is_multikey || multikey_idx != MULTIKEY_NONE);
 
 	if (bloom->is_legacy) {
+		/* Legacy filters are only built with PMurHash. */
+		if (key_def->hash_func != TUPLE_HASH_MURMUR)
+			return true;
 		return bloom_maybe_has(&bloom->parts[0],
 				       tuple_hash(tuple, key_def));
 	}
 
 	assert(bloom->part_count == key_def->part_count);
 
+	if (bloom->hash_func == TUPLE_HASH_MUM64) {
+		uint64_t h = TUPLE_HASH64_SEED;
+		for (uint32_t i = 0; i < key_def->part_count; i++) {
+			h = tuple_hash64_mix(h, tuple_hash64_key_part(tuple,
+						&key_def->parts[i],
+						multikey_idx));
+			if (!bloom_maybe_has(&bloom->parts[i],
+					     tuple_hash64_result(h)))
+				return false;
+		}
+		return true;
+	}
+
 	uint32_t h = HASH_SEED;
 	uint32_t carry = 0;
 	uint32_t total_size = 0;
@@ -234,7 +279,8 @@ tuple_bloom_maybe_has_key(const struct tuple_bloom *bloom,
 			  struct key_def *key_def)
 {
 	if (bloom->is_legacy) {
-		if (part_count < key_def->part_count)
+		if (part_count < key_def->part_count ||
+		    key_def->hash_func != TUPLE_HASH_MURMUR)
 			return true;
 		return bloom_maybe_has(&bloom->parts[0],
 				       key_hash(key, key_def));
@@ -243,6 +289,18 @@ tuple_bloom_maybe_has_key(const struct tuple_bloom *bloom,
 	assert(part_count <= key_def->part_count);
 	assert(bloom->part_count == key_def->part_count);
 
+	if (bloom->hash_func == TUPLE_HASH_MUM64) {
+		uint64_t h = TUPLE_HASH64_SEED;
+		for (uint32_t i = 0; i < part_count; i++) {
+			h = tuple_hash64_mix(h, tuple_hash64_field(&key,
+						key_def->parts[i].coll));
+			if (!bloom_maybe_has(&bloom->parts[i],
+					     tuple_hash64_result(h)))
+				return false;
+		}
+		return true;
+	}
+
 	uint32_t h = HASH_SEED;
 	uint32_t carry = 0;
 	uint32_t total_size = 0;
@@ -331,6 +389,7 @@ tuple_bloom_decode(const char **data)
 	}
 
 	bloom->is_legacy = false;
+	bloom->hash_func = TUPLE_HASH_MURMUR;
 	bloom->part_count = 0;
 
 	for (uint32_t i = 0; i < part_count; i++) {
@@ -355,6 +414,7 @@ tuple_bloom_decode_legacy(const char **data)
 	}
 
 	bloom->is_legacy = true;
+	bloom->hash_func = TUPLE_HASH_MURMUR;
 	bloom->part_count = 1;
 
 	if (mp_decode_array(data) != 4)
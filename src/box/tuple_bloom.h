@@ -35,6 +35,7 @@
 #include <stddef.h>
 #include <stdint.h>
 #include "salad/bloom.h"
+#include "tuple_hash.h"
 
 #if defined(__cplusplus)
 extern "C" {
@@ -58,6 +59,8 @@ struct tuple_bloom {
 	 * (see tuple_bloom_decode_legacy).
 	 */
 	bool is_legacy;
+	/** Hash function used to build the bloom filter. */
+	enum tuple_hash_func hash_func;
 	/** Number of key parts. */
 	uint32_t part_count;
 	/** Array of bloom filters, one per each partial key. */
@@ -103,6 +106,8 @@ struct tuple_hash_array {
  * For more details, see tuple_bloom_new() implementation.
  */
 struct tuple_bloom_builder {
+	/** Hash function used for hashing added tuples. */
+	enum tuple_hash_func hash_func;
 	/** Number of key parts. */
 	uint32_t part_count;
 	/** Hash arrays, one per each partial key. */
@@ -112,10 +117,11 @@ struct tuple_bloom_builder {
 /**
  * Create a new tuple bloom filter builder.
  * @param part_count - number of key parts
+ * @param hash_func - hash function to use
  * @return bloom filter builder on success or NULL on OOM
  */
 struct tuple_bloom_builder *
-tuple_bloom_builder_new(uint32_t part_count);
+tuple_bloom_builder_new(uint32_t part_count, enum tuple_hash_func hash_func);
 
 /**
  * Destroy a tuple bloom filter builder.
@@ -215,6 +221,10 @@ tuple_bloom_encode(const struct tuple_bloom *bloom, char *buf);
  * @param data - pointer to buffer storing encoded bloom filter;
  *  on success it is advanced by the number of decoded bytes
  * @return the decoded bloom on success or NULL on OOM
+ *
+ * The hash function is not stored in the encoded bloom filter,
+ * it is set to TUPLE_HASH_MURMUR and must be updated by the
+ * caller if the filter was built with another function.
  */
 struct tuple_bloom *
 tuple_bloom_decode(const char **data);
@@ -38,6 +38,8 @@
 #include "uuid/mp_uuid.h"
 #include "lib/core/mp_extension_types.h"
 
+const char *hint_layout_strs[] = { "first_part", "multipart" };
+
 /* {{{ tuple_compare */
 
 /**
@@ -1007,9 +1009,56 @@ field_compare<FIELD_TYPE_STRING>(const char **field_a, const char **field_b)
 	return r;
 }
 
+template <>
+inline int
+field_compare<FIELD_TYPE_INTEGER>(const char **field_a, const char **field_b)
+{
+	return mp_compare_integer_with_type(*field_a, mp_typeof(**field_a),
+					    *field_b, mp_typeof(**field_b));
+}
+
+template <>
+inline int
+field_compare<FIELD_TYPE_NUMBER>(const char **field_a, const char **field_b)
+{
+	return mp_compare_number(*field_a, *field_b);
+}
+
+template <>
+inline int
+field_compare<FIELD_TYPE_DOUBLE>(const char **field_a, const char **field_b)
+{
+	return mp_compare_double(*field_a, *field_b);
+}
+
+template <>
+inline int
+field_compare<FIELD_TYPE_DECIMAL>(const char **field_a, const char **field_b)
+{
+	return mp_compare_decimal(*field_a, *field_b);
+}
+
+template <>
+inline int
+field_compare<FIELD_TYPE_UUID>(const char **field_a, const char **field_b)
+{
+	return mp_compare_uuid(*field_a, *field_b);
+}
+
+/**
+ * Compare two fields and move both pointers to the next field.
+ * The generic version suits all types whose field_compare()
+ * leaves the pointers intact.
+ */
 template <int TYPE>
 static inline int
-field_compare_and_next(const char **field_a, const char **field_b);
+field_compare_and_next(const char **field_a, const char **field_b)
+{
+	int r = field_compare<TYPE>(field_a, field_b);
+	mp_next(field_a);
+	mp_next(field_b);
+	return r;
+}
 
 template <>
 inline int
@@ -1152,18 +1201,74 @@ struct comparator_signature {
 static const comparator_signature cmp_arr[] = {
 	COMPARATOR(0, FIELD_TYPE_UNSIGNED)
 	COMPARATOR(0, FIELD_TYPE_STRING)
+	COMPARATOR(0, FIELD_TYPE_INTEGER)
+	COMPARATOR(0, FIELD_TYPE_NUMBER)
+	COMPARATOR(0, FIELD_TYPE_DOUBLE)
+	COMPARATOR(0, FIELD_TYPE_DECIMAL)
+	COMPARATOR(0, FIELD_TYPE_UUID)
 	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_UNSIGNED)
 	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_UNSIGNED)
+	COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_UNSIGNED)
+	COMPARATOR(0, FIELD_TYPE_NUMBER  , 1, FIELD_TYPE_UNSIGNED)
+	COMPARATOR(0, FIELD_TYPE_DOUBLE  , 1, FIELD_TYPE_UNSIGNED)
+	COMPARATOR(0, FIELD_TYPE_UUID    , 1, FIELD_TYPE_UNSIGNED)
 	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_STRING)
 	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_STRING)
+	COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_STRING)
+	COMPARATOR(0, FIELD_TYPE_NUMBER  , 1, FIELD_TYPE_STRING)
+	COMPARATOR(0, FIELD_TYPE_DOUBLE  , 1, FIELD_TYPE_STRING)
+	COMPARATOR(0, FIELD_TYPE_UUID    , 1, FIELD_TYPE_STRING)
+	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_INTEGER)
+	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_INTEGER)
+	COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_INTEGER)
+	COMPARATOR(0, FIELD_TYPE_NUMBER  , 1, FIELD_TYPE_INTEGER)
+	COMPARATOR(0, FIELD_TYPE_DOUBLE  , 1, FIELD_TYPE_INTEGER)
+	COMPARATOR(0, FIELD_TYPE_UUID    , 1, FIELD_TYPE_INTEGER)
+	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_NUMBER)
+	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_NUMBER)
+	COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_NUMBER)
+	COMPARATOR(0, FIELD_TYPE_NUMBER  , 1, FIELD_TYPE_NUMBER)
+	COMPARATOR(0, FIELD_TYPE_DOUBLE  , 1, FIELD_TYPE_NUMBER)
+	COMPARATOR(0, FIELD_TYPE_UUID    , 1, FIELD_TYPE_NUMBER)
+	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_DOUBLE)
+	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_DOUBLE)
+	COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_DOUBLE)
+	COMPARATOR(0, FIELD_TYPE_NUMBER  , 1, FIELD_TYPE_DOUBLE)
+	COMPARATOR(0, FIELD_TYPE_DOUBLE  , 1, FIELD_TYPE_DOUBLE)
+	COMPARATOR(0, FIELD_TYPE_UUID    , 1, FIELD_TYPE_DOUBLE)
+	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_UUID)
+	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_UUID)
+	COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_UUID)
+	COMPARATOR(0, FIELD_TYPE_NUMBER  , 1, FIELD_TYPE_UUID)
+	COMPARATOR(0, FIELD_TYPE_DOUBLE  , 1, FIELD_TYPE_UUID)
+	COMPARATOR(0, FIELD_TYPE_UUID    , 1, FIELD_TYPE_UUID)
 	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_UNSIGNED)
 	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_UNSIGNED)
+	COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_UNSIGNED)
 	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_UNSIGNED)
 	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_UNSIGNED)
+	COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_UNSIGNED)
+	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_INTEGER , 2, FIELD_TYPE_UNSIGNED)
+	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_INTEGER , 2, FIELD_TYPE_UNSIGNED)
+	COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_INTEGER , 2, FIELD_TYPE_UNSIGNED)
 	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_STRING)
 	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_STRING)
+	COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_STRING)
 	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_STRING)
 	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_STRING)
+	COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_STRING)
+	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_INTEGER , 2, FIELD_TYPE_STRING)
+	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_INTEGER , 2, FIELD_TYPE_STRING)
+	COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_INTEGER , 2, FIELD_TYPE_STRING)
+	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_INTEGER)
+	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_INTEGER)
+	COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_INTEGER)
+	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_INTEGER)
+	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_INTEGER)
+	COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_INTEGER)
+	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_INTEGER , 2, FIELD_TYPE_INTEGER)
+	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_INTEGER , 2, FIELD_TYPE_INTEGER)
+	COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_INTEGER , 2, FIELD_TYPE_INTEGER)
 };
 
 #undef COMPARATOR
@@ -1172,8 +1277,16 @@ static const comparator_signature cmp_arr[] = {
 
 /* {{{ tuple_compare_with_key */
 
+/**
+ * Compare a tuple field with a key part. For all types but
+ * STRING this is the same as comparing two tuple fields.
+ */
 template <int TYPE>
-static inline int field_compare_with_key(const char **field, const char **key);
+static inline int
+field_compare_with_key(const char **field, const char **key)
+{
+	return field_compare<TYPE>(field, key);
+}
 
 template <>
 inline int
@@ -1197,7 +1310,10 @@ field_compare_with_key<FIELD_TYPE_STRING>(const char **field, const char **key)
 
 template <int TYPE>
 static inline int
-field_compare_with_key_and_next(const char **field_a, const char **field_b);
+field_compare_with_key_and_next(const char **field_a, const char **field_b)
+{
+	return field_compare_and_next<TYPE>(field_a, field_b);
+}
 
 template <>
 inline int
@@ -1338,17 +1454,78 @@ struct comparator_with_key_signature
 static const comparator_with_key_signature cmp_wk_arr[] = {
 	KEY_COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_UNSIGNED)
 	KEY_COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_UNSIGNED)
+	KEY_COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_UNSIGNED)
 	KEY_COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_UNSIGNED)
 	KEY_COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_UNSIGNED)
+	KEY_COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_UNSIGNED)
+	KEY_COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_INTEGER , 2, FIELD_TYPE_UNSIGNED)
+	KEY_COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_INTEGER , 2, FIELD_TYPE_UNSIGNED)
+	KEY_COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_INTEGER , 2, FIELD_TYPE_UNSIGNED)
 	KEY_COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_STRING)
 	KEY_COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_STRING)
+	KEY_COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_STRING)
 	KEY_COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_STRING)
 	KEY_COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_STRING)
+	KEY_COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_STRING)
+	KEY_COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_INTEGER , 2, FIELD_TYPE_STRING)
+	KEY_COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_INTEGER , 2, FIELD_TYPE_STRING)
+	KEY_COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_INTEGER , 2, FIELD_TYPE_STRING)
+	KEY_COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_INTEGER)
+	KEY_COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_INTEGER)
+	KEY_COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_INTEGER)
+	KEY_COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_INTEGER)
+	KEY_COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_INTEGER)
+	KEY_COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_INTEGER)
+	KEY_COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_INTEGER , 2, FIELD_TYPE_INTEGER)
+	KEY_COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_INTEGER , 2, FIELD_TYPE_INTEGER)
+	KEY_COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_INTEGER , 2, FIELD_TYPE_INTEGER)
+
+	KEY_COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_UNSIGNED)
+	KEY_COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_UNSIGNED)
+	KEY_COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_UNSIGNED)
+	KEY_COMPARATOR(0, FIELD_TYPE_NUMBER  , 1, FIELD_TYPE_UNSIGNED)
+	KEY_COMPARATOR(0, FIELD_TYPE_DOUBLE  , 1, FIELD_TYPE_UNSIGNED)
+	KEY_COMPARATOR(0, FIELD_TYPE_UUID    , 1, FIELD_TYPE_UNSIGNED)
+	KEY_COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_STRING)
+	KEY_COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_STRING)
+	KEY_COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_STRING)
+	KEY_COMPARATOR(0, FIELD_TYPE_NUMBER  , 1, FIELD_TYPE_STRING)
+	KEY_COMPARATOR(0, FIELD_TYPE_DOUBLE  , 1, FIELD_TYPE_STRING)
+	KEY_COMPARATOR(0, FIELD_TYPE_UUID    , 1, FIELD_TYPE_STRING)
+	KEY_COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_INTEGER)
+	KEY_COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_INTEGER)
+	KEY_COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_INTEGER)
+	KEY_COMPARATOR(0, FIELD_TYPE_NUMBER  , 1, FIELD_TYPE_INTEGER)
+	KEY_COMPARATOR(0, FIELD_TYPE_DOUBLE  , 1, FIELD_TYPE_INTEGER)
+	KEY_COMPARATOR(0, FIELD_TYPE_UUID    , 1, FIELD_TYPE_INTEGER)
+	KEY_COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_NUMBER)
+	KEY_COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_NUMBER)
+	KEY_COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_NUMBER)
+	KEY_COMPARATOR(0, FIELD_TYPE_NUMBER  , 1, FIELD_TYPE_NUMBER)
+	KEY_COMPARATOR(0, FIELD_TYPE_DOUBLE  , 1, FIELD_TYPE_NUMBER)
+	KEY_COMPARATOR(0, FIELD_TYPE_UUID    , 1, FIELD_TYPE_NUMBER)
+	KEY_COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_DOUBLE)
+	KEY_COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_DOUBLE)
+	KEY_COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_DOUBLE)
+	KEY_COMPARATOR(0, FIELD_TYPE_NUMBER  , 1, FIELD_TYPE_DOUBLE)
+	KEY_COMPARATOR(0, FIELD_TYPE_DOUBLE  , 1, FIELD_TYPE_DOUBLE)
+	KEY_COMPARATOR(0, FIELD_TYPE_UUID    , 1, FIELD_TYPE_DOUBLE)
+	KEY_COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_UUID)
+	KEY_COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_UUID)
+	KEY_COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_UUID)
+	KEY_COMPARATOR(0, FIELD_TYPE_NUMBER  , 1, FIELD_TYPE_UUID)
+	KEY_COMPARATOR(0, FIELD_TYPE_DOUBLE  , 1, FIELD_TYPE_UUID)
+	KEY_COMPARATOR(0, FIELD_TYPE_UUID    , 1, FIELD_TYPE_UUID)
 
 	KEY_COMPARATOR(1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_UNSIGNED)
 	KEY_COMPARATOR(1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_UNSIGNED)
+	KEY_COMPARATOR(1, FIELD_TYPE_INTEGER , 2, FIELD_TYPE_UNSIGNED)
 	KEY_COMPARATOR(1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_STRING)
 	KEY_COMPARATOR(1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_STRING)
+	KEY_COMPARATOR(1, FIELD_TYPE_INTEGER , 2, FIELD_TYPE_STRING)
+	KEY_COMPARATOR(1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_INTEGER)
+	KEY_COMPARATOR(1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_INTEGER)
+	KEY_COMPARATOR(1, FIELD_TYPE_INTEGER , 2, FIELD_TYPE_INTEGER)
 };
 
 /**
@@ -1442,6 +1619,245 @@ func_index_compare_with_key(struct tuple *tuple, hint_t tuple_hint,
 
 /* }}} tuple_compare_with_key */
 
+/* {{{ tuple_compare for nullable keys */
+
+/**
+ * Compare two fields of a nullable key. A missing field is
+ * treated as NULL. NULL is less than any other value. Two NULLs
+ * are equal, which is reported via @a was_null_met.
+ */
+template <int TYPE>
+static inline int
+field_compare_nullable(const char *field_a, const char *field_b,
+		       bool *was_null_met)
+{
+	bool a_is_null = field_a == NULL || mp_typeof(*field_a) == MP_NIL;
+	bool b_is_null = field_b == NULL || mp_typeof(*field_b) == MP_NIL;
+	if (a_is_null) {
+		if (!b_is_null)
+			return -1;
+		*was_null_met = true;
+		return 0;
+	}
+	if (b_is_null)
+		return 1;
+	return field_compare<TYPE>(&field_a, &field_b);
+}
+
+/**
+ * Compare a field of a nullable key with a key part. Same as
+ * field_compare_nullable(), but a key part can not be missing.
+ */
+template <int TYPE>
+static inline int
+field_compare_with_key_nullable(const char *field, const char *key)
+{
+	bool field_is_null = field == NULL || mp_typeof(*field) == MP_NIL;
+	if (field_is_null)
+		return mp_typeof(*key) == MP_NIL ? 0 : -1;
+	if (mp_typeof(*key) == MP_NIL)
+		return 1;
+	return field_compare_with_key<TYPE>(&field, &key);
+}
+
+namespace /* local symbols */ {
+
+template <int FLD_ID, int IDX, int TYPE, int ...MORE_TYPES>
+struct FieldCompareNullable {};
+
+/**
+ * Parts past unique_part_count are only compared if NULLs were
+ * met in the unique parts, as in tuple_compare_slowpath().
+ */
+template <int FLD_ID, int IDX, int TYPE, int IDX2, int TYPE2, int ...MORE_TYPES>
+struct FieldCompareNullable<FLD_ID, IDX, TYPE, IDX2, TYPE2, MORE_TYPES...>
+{
+	inline static int
+	compare(struct tuple *tuple_a, struct tuple *tuple_b,
+		struct tuple_format *format_a, struct tuple_format *format_b,
+		struct key_def *key_def, bool was_null_met)
+	{
+		const char *field_a = tuple_field_raw(format_a,
+						      tuple_data(tuple_a),
+						      tuple_field_map(tuple_a),
+						      IDX);
+		const char *field_b = tuple_field_raw(format_b,
+						      tuple_data(tuple_b),
+						      tuple_field_map(tuple_b),
+						      IDX);
+		int r = field_compare_nullable<TYPE>(field_a, field_b,
+						     &was_null_met);
+		if (r != 0)
+			return r;
+		if (FLD_ID + 1 == key_def->unique_part_count && !was_null_met)
+			return 0;
+		return FieldCompareNullable<FLD_ID + 1, IDX2, TYPE2,
+					    MORE_TYPES...>::
+			compare(tuple_a, tuple_b, format_a, format_b,
+				key_def, was_null_met);
+	}
+};
+
+template <int FLD_ID, int IDX, int TYPE>
+struct FieldCompareNullable<FLD_ID, IDX, TYPE>
+{
+	inline static int
+	compare(struct tuple *tuple_a, struct tuple *tuple_b,
+		struct tuple_format *format_a, struct tuple_format *format_b,
+		struct key_def *, bool was_null_met)
+	{
+		const char *field_a = tuple_field_raw(format_a,
+						      tuple_data(tuple_a),
+						      tuple_field_map(tuple_a),
+						      IDX);
+		const char *field_b = tuple_field_raw(format_b,
+						      tuple_data(tuple_b),
+						      tuple_field_map(tuple_b),
+						      IDX);
+		return field_compare_nullable<TYPE>(field_a, field_b,
+						    &was_null_met);
+	}
+};
+
+template <int IDX, int TYPE, int ...MORE_TYPES>
+struct TupleCompareNullable
+{
+	static int compare(struct tuple *tuple_a, hint_t tuple_a_hint,
+			   struct tuple *tuple_b, hint_t tuple_b_hint,
+			   struct key_def *key_def)
+	{
+		int rc = hint_cmp(tuple_a_hint, tuple_b_hint);
+		if (rc != 0)
+			return rc;
+		return FieldCompareNullable<0, IDX, TYPE, MORE_TYPES...>::
+			compare(tuple_a, tuple_b, tuple_format(tuple_a),
+				tuple_format(tuple_b), key_def, false);
+	}
+};
+
+template <int FLD_ID, int IDX, int TYPE, int ...MORE_TYPES>
+struct FieldCompareWithKeyNullable {};
+
+template <int FLD_ID, int IDX, int TYPE, int IDX2, int TYPE2, int ...MORE_TYPES>
+struct FieldCompareWithKeyNullable<FLD_ID, IDX, TYPE, IDX2, TYPE2,
+				   MORE_TYPES...>
+{
+	inline static int
+	compare(struct tuple *tuple, const char *key, uint32_t part_count,
+		struct tuple_format *format)
+	{
+		const char *field = tuple_field_raw(format, tuple_data(tuple),
+						    tuple_field_map(tuple),
+						    IDX);
+		int r = field_compare_with_key_nullable<TYPE>(field, key);
+		if (r != 0 || part_count == FLD_ID + 1)
+			return r;
+		mp_next(&key);
+		return FieldCompareWithKeyNullable<FLD_ID + 1, IDX2, TYPE2,
+						   MORE_TYPES...>::
+			compare(tuple, key, part_count, format);
+	}
+};
+
+template <int FLD_ID, int IDX, int TYPE>
+struct FieldCompareWithKeyNullable<FLD_ID, IDX, TYPE>
+{
+	inline static int
+	compare(struct tuple *tuple, const char *key, uint32_t,
+		struct tuple_format *format)
+	{
+		const char *field = tuple_field_raw(format, tuple_data(tuple),
+						    tuple_field_map(tuple),
+						    IDX);
+		return field_compare_with_key_nullable<TYPE>(field, key);
+	}
+};
+
+template <int IDX, int TYPE, int ...MORE_TYPES>
+struct TupleCompareWithKeyNullable
+{
+	static int
+	compare(struct tuple *tuple, hint_t tuple_hint,
+		const char *key, uint32_t part_count,
+		hint_t key_hint, struct key_def *)
+	{
+		/* Part count can be 0 in wildcard searches. */
+		if (part_count == 0)
+			return 0;
+		int rc = hint_cmp(tuple_hint, key_hint);
+		if (rc != 0)
+			return rc;
+		return FieldCompareWithKeyNullable<0, IDX, TYPE,
+						   MORE_TYPES...>::
+			compare(tuple, key, part_count, tuple_format(tuple));
+	}
+};
+
+} /* end of anonymous namespace */
+
+struct comparator_nullable_signature {
+	tuple_compare_t f;
+	tuple_compare_with_key_t f_wk;
+	uint32_t p[64];
+};
+
+#define NULLABLE_COMPARATOR(...) \
+	{ TupleCompareNullable<__VA_ARGS__>::compare, \
+	  TupleCompareWithKeyNullable<__VA_ARGS__>::compare, \
+	  { __VA_ARGS__, UINT32_MAX } },
+
+/**
+ * Shapes of nullable keys: a single part, and the cmp_def of a
+ * secondary index over one or two nullable fields followed by
+ * the primary key part.
+ */
+static const comparator_nullable_signature cmp_nullable_arr[] = {
+	NULLABLE_COMPARATOR(0, FIELD_TYPE_UNSIGNED)
+	NULLABLE_COMPARATOR(0, FIELD_TYPE_STRING)
+	NULLABLE_COMPARATOR(0, FIELD_TYPE_INTEGER)
+	NULLABLE_COMPARATOR(0, FIELD_TYPE_NUMBER)
+	NULLABLE_COMPARATOR(0, FIELD_TYPE_DOUBLE)
+	NULLABLE_COMPARATOR(0, FIELD_TYPE_DECIMAL)
+	NULLABLE_COMPARATOR(0, FIELD_TYPE_UUID)
+	NULLABLE_COMPARATOR(1, FIELD_TYPE_UNSIGNED)
+	NULLABLE_COMPARATOR(1, FIELD_TYPE_STRING)
+	NULLABLE_COMPARATOR(1, FIELD_TYPE_INTEGER)
+	NULLABLE_COMPARATOR(1, FIELD_TYPE_NUMBER)
+	NULLABLE_COMPARATOR(1, FIELD_TYPE_DOUBLE)
+	NULLABLE_COMPARATOR(1, FIELD_TYPE_UUID)
+	NULLABLE_COMPARATOR(1, FIELD_TYPE_UNSIGNED, 0, FIELD_TYPE_UNSIGNED)
+	NULLABLE_COMPARATOR(1, FIELD_TYPE_STRING  , 0, FIELD_TYPE_UNSIGNED)
+	NULLABLE_COMPARATOR(1, FIELD_TYPE_INTEGER , 0, FIELD_TYPE_UNSIGNED)
+	NULLABLE_COMPARATOR(1, FIELD_TYPE_NUMBER  , 0, FIELD_TYPE_UNSIGNED)
+	NULLABLE_COMPARATOR(1, FIELD_TYPE_DOUBLE  , 0, FIELD_TYPE_UNSIGNED)
+	NULLABLE_COMPARATOR(1, FIELD_TYPE_UUID    , 0, FIELD_TYPE_UNSIGNED)
+	NULLABLE_COMPARATOR(1, FIELD_TYPE_UNSIGNED, 0, FIELD_TYPE_STRING)
+	NULLABLE_COMPARATOR(1, FIELD_TYPE_STRING  , 0, FIELD_TYPE_STRING)
+	NULLABLE_COMPARATOR(1, FIELD_TYPE_INTEGER , 0, FIELD_TYPE_STRING)
+	NULLABLE_COMPARATOR(1, FIELD_TYPE_NUMBER  , 0, FIELD_TYPE_STRING)
+	NULLABLE_COMPARATOR(1, FIELD_TYPE_DOUBLE  , 0, FIELD_TYPE_STRING)
+	NULLABLE_COMPARATOR(1, FIELD_TYPE_UUID    , 0, FIELD_TYPE_STRING)
+	NULLABLE_COMPARATOR(1, FIELD_TYPE_UNSIGNED, 0, FIELD_TYPE_INTEGER)
+	NULLABLE_COMPARATOR(1, FIELD_TYPE_STRING  , 0, FIELD_TYPE_INTEGER)
+	NULLABLE_COMPARATOR(1, FIELD_TYPE_INTEGER , 0, FIELD_TYPE_INTEGER)
+	NULLABLE_COMPARATOR(1, FIELD_TYPE_NUMBER  , 0, FIELD_TYPE_INTEGER)
+	NULLABLE_COMPARATOR(1, FIELD_TYPE_DOUBLE  , 0, FIELD_TYPE_INTEGER)
+	NULLABLE_COMPARATOR(1, FIELD_TYPE_UUID    , 0, FIELD_TYPE_INTEGER)
+	NULLABLE_COMPARATOR(1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_UNSIGNED, 0, FIELD_TYPE_UNSIGNED)
+	NULLABLE_COMPARATOR(1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_UNSIGNED, 0, FIELD_TYPE_UNSIGNED)
+	NULLABLE_COMPARATOR(1, FIELD_TYPE_INTEGER , 2, FIELD_TYPE_UNSIGNED, 0, FIELD_TYPE_UNSIGNED)
+	NULLABLE_COMPARATOR(1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_STRING  , 0, FIELD_TYPE_UNSIGNED)
+	NULLABLE_COMPARATOR(1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_STRING  , 0, FIELD_TYPE_UNSIGNED)
+	NULLABLE_COMPARATOR(1, FIELD_TYPE_INTEGER , 2, FIELD_TYPE_STRING  , 0, FIELD_TYPE_UNSIGNED)
+	NULLABLE_COMPARATOR(1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_INTEGER , 0, FIELD_TYPE_UNSIGNED)
+	NULLABLE_COMPARATOR(1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_INTEGER , 0, FIELD_TYPE_UNSIGNED)
+	NULLABLE_COMPARATOR(1, FIELD_TYPE_INTEGER , 2, FIELD_TYPE_INTEGER , 0, FIELD_TYPE_UNSIGNED)
+};
+
+#undef NULLABLE_COMPARATOR
+
+/* }}} tuple_compare for nullable keys */
+
 /* {{{ tuple_hint */
 
 /**
@@ -1889,6 +2305,186 @@ key_hint_stub(struct tuple *tuple, struct key_def *key_def)
 	return HINT_NONE;
 }
 
+/**
+ * Multipart comparison hint (see HINT_LAYOUT_MULTIPART) has
+ * the following layout:
+ *
+ *     [       first part      |      second part      ]
+ *      <-- HINT_FIRST_BITS --> <-- HINT_SECOND_BITS -->
+ *
+ * The first key part must be an integer. If it is within
+ * [0, HINT_FIRST_MAX - 1), the first part of the hint stores it
+ * incremented by one, so it is exact and the rest of the hint
+ * is taken from the second key part. Otherwise, the first part
+ * of the hint stores 0 (for negative numbers) or HINT_FIRST_MAX
+ * (for large numbers) and the second part is zero, because
+ * ordering by the second key part makes no sense if the first
+ * key parts may differ.
+ *
+ * The second part of the hint is computed from the second key
+ * part so that it preserves the order:
+ *
+ *  - For an integer, it equals the number plus HINT_SECOND_BIAS
+ *    clamped to [0, HINT_SECOND_MAX]. Unsigned and signed numbers
+ *    are encoded in the same way so that the type of a key part
+ *    may be altered from unsigned to integer without rebuilding
+ *    the index.
+ *
+ *  - For a string, it is its first HINT_SECOND_BYTES bytes
+ *    (or the first bytes of the sort key if there's a collation).
+ *
+ * A hint can't be computed for a partial key, which doesn't
+ * contain both key parts, so HINT_NONE is used.
+ *
+ * Since the first part is never all ones when the second part
+ * is non-zero, a multipart hint never equals HINT_NONE.
+ */
+#define HINT_FIRST_BITS		24
+#define HINT_SECOND_BITS	(HINT_BITS - HINT_FIRST_BITS)
+#define HINT_SECOND_BYTES	(HINT_SECOND_BITS / CHAR_BIT)
+#define HINT_FIRST_MAX		((1ULL << HINT_FIRST_BITS) - 1)
+#define HINT_SECOND_MAX		((1ULL << HINT_SECOND_BITS) - 1)
+#define HINT_SECOND_BIAS	(1LL << (HINT_SECOND_BITS - 1))
+
+static inline uint64_t
+hint_second_int(const char *field)
+{
+	switch (mp_typeof(*field)) {
+	case MP_UINT:
+	{
+		uint64_t u = mp_decode_uint(&field);
+		return u >= (uint64_t)HINT_SECOND_BIAS ? HINT_SECOND_MAX :
+		       u + HINT_SECOND_BIAS;
+	}
+	case MP_INT:
+	{
+		int64_t i = mp_decode_int(&field);
+		return i <= -HINT_SECOND_BIAS ? 0 : i + HINT_SECOND_BIAS;
+	}
+	default:
+		unreachable();
+	}
+	return 0;
+}
+
+static inline uint64_t
+hint_second_str(const char *field, struct coll *coll)
+{
+	assert(mp_typeof(*field) == MP_STR);
+	uint32_t len = mp_decode_strl(&field);
+	char buf[HINT_SECOND_BYTES];
+	if (coll != NULL) {
+		len = coll->hint(field, len, buf, sizeof(buf), coll);
+		field = buf;
+	}
+	len = MIN(len, HINT_SECOND_BYTES);
+	uint64_t val = 0;
+	for (uint32_t i = 0; i < len; i++) {
+		val <<= CHAR_BIT;
+		val |= (unsigned char)field[i];
+	}
+	val <<= CHAR_BIT * (HINT_SECOND_BYTES - len);
+	return val;
+}
+
+template <enum field_type second_type>
+static inline hint_t
+field_hint_multipart(const char *first, const char *second,
+		     struct coll *second_coll)
+{
+	uint64_t val;
+	switch (mp_typeof(*first)) {
+	case MP_UINT:
+	{
+		uint64_t u = mp_decode_uint(&first);
+		if (u >= HINT_FIRST_MAX - 1)
+			return (hint_t)(HINT_FIRST_MAX << HINT_SECOND_BITS);
+		val = u + 1;
+		break;
+	}
+	case MP_INT:
+		return (hint_t)0;
+	default:
+		unreachable();
+		return HINT_NONE;
+	}
+	val <<= HINT_SECOND_BITS;
+	switch (second_type) {
+	case FIELD_TYPE_UNSIGNED:
+	case FIELD_TYPE_INTEGER:
+		val |= hint_second_int(second);
+		break;
+	case FIELD_TYPE_STRING:
+		val |= hint_second_str(second, second_coll);
+		break;
+	default:
+		unreachable();
+	}
+	return (hint_t)val;
+}
+
+template <enum field_type second_type>
+static hint_t
+key_hint_multipart(const char *key, uint32_t part_count,
+		   struct key_def *key_def)
+{
+	assert(key_def->hint_part_count == 2);
+	if (part_count < 2)
+		return HINT_NONE;
+	const char *second = key;
+	mp_next(&second);
+	return field_hint_multipart<second_type>(key, second,
+						 key_def->parts[1].coll);
+}
+
+template <enum field_type second_type>
+static hint_t
+tuple_hint_multipart(struct tuple *tuple, struct key_def *key_def)
+{
+	assert(key_def->hint_part_count == 2);
+	const char *first = tuple_field_by_part(tuple, &key_def->parts[0],
+						MULTIKEY_NONE);
+	const char *second = tuple_field_by_part(tuple, &key_def->parts[1],
+						 MULTIKEY_NONE);
+	assert(first != NULL && second != NULL);
+	return field_hint_multipart<second_type>(first, second,
+						 key_def->parts[1].coll);
+}
+
+/**
+ * Set multipart hint functions if the key definition allows
+ * it. Return false otherwise.
+ */
+static bool
+key_def_set_hint_func_multipart(struct key_def *def)
+{
+	if (def->part_count < 2)
+		return false;
+	const struct key_part *first = &def->parts[0];
+	const struct key_part *second = &def->parts[1];
+	if (key_part_is_nullable(first) || key_part_is_nullable(second))
+		return false;
+	if (first->type != FIELD_TYPE_UNSIGNED &&
+	    first->type != FIELD_TYPE_INTEGER)
+		return false;
+	switch (second->type) {
+	case FIELD_TYPE_UNSIGNED:
+	case FIELD_TYPE_INTEGER:
+		/* Both types are encoded in the same way. */
+		def->key_hint = key_hint_multipart<FIELD_TYPE_INTEGER>;
+		def->tuple_hint = tuple_hint_multipart<FIELD_TYPE_INTEGER>;
+		break;
+	case FIELD_TYPE_STRING:
+		def->key_hint = key_hint_multipart<FIELD_TYPE_STRING>;
+		def->tuple_hint = tuple_hint_multipart<FIELD_TYPE_STRING>;
+		break;
+	default:
+		return false;
+	}
+	def->hint_part_count = 2;
+	return true;
+}
+
 template<enum field_type type, bool is_nullable>
 static void
 key_def_set_hint_func(struct key_def *def)
@@ -1913,8 +2509,13 @@ key_def_set_hint_func(struct key_def *def)
 	if (def->is_multikey || def->for_func_index) {
 		def->key_hint = key_hint_stub;
 		def->tuple_hint = key_hint_stub;
+		def->hint_part_count = 0;
 		return;
 	}
+	if (def->hint_layout == HINT_LAYOUT_MULTIPART &&
+	    key_def_set_hint_func_multipart(def))
+		return;
+	def->hint_part_count = 1;
 	switch (def->parts->type) {
 	case FIELD_TYPE_BOOLEAN:
 		key_def_set_hint_func<FIELD_TYPE_BOOLEAN>(def);
@@ -1950,10 +2551,19 @@ key_def_set_hint_func(struct key_def *def)
 		/* Invalid key definition. */
 		def->key_hint = NULL;
 		def->tuple_hint = NULL;
+		def->hint_part_count = 0;
 		break;
 	}
 }
 
+void
+key_def_set_hint_layout(struct key_def *def, enum hint_layout layout)
+{
+	assert(layout < hint_layout_MAX);
+	def->hint_layout = layout;
+	key_def_set_hint_func(def);
+}
+
 /* }}} tuple_hint */
 
 static void
@@ -2029,6 +2639,31 @@ key_def_set_compare_func_plain(struct key_def *def)
 	}
 }
 
+template<bool has_optional_parts>
+static void
+key_def_set_compare_func_nullable(struct key_def *def)
+{
+	assert(def->is_nullable);
+	assert(has_optional_parts == def->has_optional_parts);
+	assert(!def->has_json_paths);
+	assert(!key_def_has_collation(def));
+
+	for (uint32_t k = 0; k < lengthof(cmp_nullable_arr); k++) {
+		const comparator_nullable_signature *sig = &cmp_nullable_arr[k];
+		uint32_t i = 0;
+		for (; i < def->part_count; i++)
+			if (def->parts[i].fieldno != sig->p[i * 2] ||
+			    def->parts[i].type != sig->p[i * 2 + 1])
+				break;
+		if (i == def->part_count && sig->p[i * 2] == UINT32_MAX) {
+			def->tuple_compare = sig->f;
+			def->tuple_compare_with_key = sig->f_wk;
+			return;
+		}
+	}
+	key_def_set_compare_func_plain<true, has_optional_parts>(def);
+}
+
 template<bool is_nullable, bool has_optional_parts>
 static void
 key_def_set_compare_func_json(struct key_def *def)
@@ -2067,6 +2702,11 @@ key_def_set_compare_func(struct key_def *def)
 	} else if (!key_def_has_collation(def) &&
 	    !def->is_nullable && !def->has_json_paths) {
 		key_def_set_compare_func_fast(def);
+	} else if (!key_def_has_collation(def) && !def->has_json_paths) {
+		if (def->has_optional_parts)
+			key_def_set_compare_func_nullable<true>(def);
+		else
+			key_def_set_compare_func_nullable<false>(def);
 	} else if (!def->has_json_paths) {
 		if (def->is_nullable && def->has_optional_parts) {
 			key_def_set_compare_func_plain<true, true>(def);
@@ -69,6 +69,24 @@ typedef uint64_t hint_t;
  */
 #define HINT_NONE ((hint_t)UINT64_MAX)
 
+/**
+ * Comparison hint layout, chosen per index.
+ */
+enum hint_layout {
+	/** The hint is computed from the first key part only. */
+	HINT_LAYOUT_FIRST_PART = 0,
+	/**
+	 * The two leading key parts are packed into the hint,
+	 * provided their types allow it, otherwise fall back on
+	 * HINT_LAYOUT_FIRST_PART. Useful when the first key part
+	 * has low cardinality, e.g. (status, id).
+	 */
+	HINT_LAYOUT_MULTIPART,
+	hint_layout_MAX,
+};
+
+extern const char *hint_layout_strs[];
+
 /**
  * Initialize comparator functions for the key_def.
  * @param key_def key definition
@@ -76,6 +94,13 @@ typedef uint64_t hint_t;
 void
 key_def_set_compare_func(struct key_def *def);
 
+/**
+ * Set the comparison hint layout of the key_def and update
+ * its hint functions accordingly.
+ */
+void
+key_def_set_hint_layout(struct key_def *def, enum hint_layout layout);
+
 #if defined(__cplusplus)
 } /* extern "C" */
 #endif /* defined(__cplusplus) */
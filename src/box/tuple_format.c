@@ -125,6 +125,96 @@ tuple_format_hash(struct tuple_format *format)
 	return PMurHash32_Result(h, carry, size);
 }
 
+/**
+ * Call @a cb for each part of the field map layout of a format:
+ * the offset slot and the path of every field that has an
+ * offset slot, followed by the field map size.
+ */
+static void
+tuple_format_field_map_layout_foreach(struct tuple_format *format,
+				      void (*cb)(const void *data,
+						 uint32_t size, void *arg),
+				      void *arg)
+{
+	struct tuple_field *f;
+	json_tree_foreach_entry_preorder(f, &format->fields.root,
+					 struct tuple_field, token) {
+		if (f->offset_slot == TUPLE_OFFSET_SLOT_NIL)
+			continue;
+		cb(&f->offset_slot, sizeof(f->offset_slot), arg);
+		/* The path from the field up to the root. */
+		for (struct json_token *token = &f->token;
+		     token->parent != NULL; token = token->parent) {
+			cb(&token->type, sizeof(token->type), arg);
+			if (token->type == JSON_TOKEN_STR) {
+				cb(&token->len, sizeof(token->len), arg);
+				cb(token->str, token->len, arg);
+			} else if (token->type == JSON_TOKEN_NUM) {
+				cb(&token->num, sizeof(token->num), arg);
+			}
+		}
+	}
+	cb(&format->field_map_size, sizeof(format->field_map_size), arg);
+}
+
+/** State of field map layout hashing. */
+struct tuple_format_field_map_hasher {
+	uint32_t h;
+	uint32_t carry;
+	uint32_t size;
+};
+
+static void
+tuple_format_field_map_hash_cb(const void *data, uint32_t size, void *arg)
+{
+	struct tuple_format_field_map_hasher *hasher = arg;
+	PMurHash32_Process(&hasher->h, &hasher->carry, data, size);
+	hasher->size += size;
+}
+
+static uint32_t
+tuple_format_field_map_hash(struct tuple_format *format)
+{
+	struct tuple_format_field_map_hasher hasher = {13, 0, 0};
+	tuple_format_field_map_layout_foreach(format,
+			tuple_format_field_map_hash_cb, &hasher);
+	return PMurHash32_Result(hasher.h, hasher.carry, hasher.size);
+}
+
+static void
+tuple_format_field_map_size_cb(const void *data, uint32_t size, void *arg)
+{
+	(void)data;
+	*(uint32_t *)arg += size;
+}
+
+static void
+tuple_format_field_map_copy_cb(const void *data, uint32_t size, void *arg)
+{
+	char **pos = arg;
+	memcpy(*pos, data, size);
+	*pos += size;
+}
+
+char *
+tuple_format_field_map_layout(struct tuple_format *format,
+			      struct region *region, uint32_t *size)
+{
+	*size = 0;
+	tuple_format_field_map_layout_foreach(format,
+			tuple_format_field_map_size_cb, size);
+	char *layout = region_alloc(region, *size);
+	if (layout == NULL) {
+		diag_set(OutOfMemory, *size, "region", "field map layout");
+		return NULL;
+	}
+	char *pos = layout;
+	tuple_format_field_map_layout_foreach(format,
+			tuple_format_field_map_copy_cb, &pos);
+	assert(pos == layout + *size);
+	return layout;
+}
+
 #define MH_SOURCE 1
 #define mh_name _tuple_format
 #define mh_key_t struct tuple_format *
@@ -538,6 +628,7 @@ tuple_format_create(struct tuple_format *format, struct key_def * const *keys,
 			bit_set(required_fields, field->id);
 	}
 	format->hash = tuple_format_hash(format);
+	format->field_map_hash = tuple_format_field_map_hash(format);
 	return 0;
 }
 
@@ -852,6 +943,58 @@ tuple_format1_can_store_format2_tuples(struct tuple_format *format1,
 	return true;
 }
 
+/**
+ * tuple_field_map_create() for a format without JSON paths.
+ * Fields are looked up by number and the tuple is walked in
+ * one pass, without the format tree iterator.
+ */
+static int
+tuple_field_map_create_plain(struct tuple_format *format, const char *tuple,
+			     bool validate, struct field_map_builder *builder)
+{
+	struct region *region = &fiber()->gc;
+	const char *pos = tuple;
+	uint32_t defined_field_count = mp_decode_array(&pos);
+	if (validate && format->exact_field_count > 0 &&
+	    format->exact_field_count != defined_field_count) {
+		diag_set(ClientError, ER_EXACT_FIELD_COUNT,
+			 (unsigned) defined_field_count,
+			 (unsigned) format->exact_field_count);
+		return -1;
+	}
+	uint32_t format_field_count = tuple_format_field_count(format);
+	uint32_t field_count = MIN(defined_field_count, format_field_count);
+	for (uint32_t i = 0; i < field_count; i++) {
+		struct tuple_field *field = tuple_format_field(format, i);
+		if (validate &&
+		    !field_mp_type_is_compatible(field->type, pos,
+					tuple_field_is_nullable(field))) {
+			diag_set(ClientError, ER_FIELD_TYPE,
+				 tuple_field_path(field),
+				 field_type_strs[field->type]);
+			return -1;
+		}
+		if (field->offset_slot != TUPLE_OFFSET_SLOT_NIL &&
+		    field_map_builder_set_slot(builder, field->offset_slot,
+					       pos - tuple, MULTIKEY_NONE,
+					       0, region) != 0)
+			return -1;
+		mp_next(&pos);
+	}
+	if (!validate)
+		return 0;
+	/* Fields missing in the tuple must be nullable. */
+	for (uint32_t i = field_count; i < format_field_count; i++) {
+		struct tuple_field *field = tuple_format_field(format, i);
+		if (!tuple_field_is_nullable(field)) {
+			diag_set(ClientError, ER_FIELD_MISSING,
+				 tuple_field_path(field));
+			return -1;
+		}
+	}
+	return 0;
+}
+
 /** @sa declaration for details. */
 int
 tuple_field_map_create(struct tuple_format *format, const char *tuple,
@@ -863,6 +1006,10 @@ tuple_field_map_create(struct tuple_format *format, const char *tuple,
 		return -1;
 	if (tuple_format_field_count(format) == 0)
 		return 0; /* Nothing to initialize */
+	if (format->fields_depth == 1) {
+		return tuple_field_map_create_plain(format, tuple, validate,
+						    builder);
+	}
 
 	uint32_t field_count;
 	struct tuple_format_iterator it;
@@ -174,6 +174,14 @@ struct tuple_format {
 	 * ephemeral spaces.
 	 */
 	uint32_t hash;
+	/**
+	 * Hash of the field map layout: paths of the fields
+	 * that have offset slots and the slot numbers. Formats
+	 * with different hashes can't share field maps, e.g.
+	 * the ones stored in vinyl run pages. Equal hashes may
+	 * collide, see tuple_format_field_map_layout().
+	 */
+	uint32_t field_map_hash;
 	/**
 	 * Counter that grows incrementally on space rebuild
 	 * used for caching offset slot in key_part, for more
@@ -344,6 +352,21 @@ tuple_format_new(struct tuple_format_vtab *vtab, void *engine,
 		 struct tuple_dictionary *dict, bool is_temporary,
 		 bool is_ephemeral);
 
+/**
+ * Encode the field map layout of a format, i.e. the paths of
+ * the fields that have offset slots and the slot numbers, on
+ * @a region. Tuples of formats with equal layouts can share
+ * field maps. See also tuple_format::field_map_hash.
+ * @param format Tuple format.
+ * @param region Region to allocate the layout on.
+ * @param[out] size Size of the layout.
+ *
+ * @retval Layout or NULL on memory error.
+ */
+char *
+tuple_format_field_map_layout(struct tuple_format *format,
+			      struct region *region, uint32_t *size);
+
 /**
  * Check, if @a format1 can store any tuples of @a format2. For
  * example, if a field is not nullable in format1 and the same
@@ -35,6 +35,8 @@
 #include "coll/coll.h"
 #include <math.h>
 
+const char *tuple_hash_func_strs[] = { "murmur", "mum64" };
+
 /* Tuple and key hasher */
 namespace {
 
@@ -42,6 +44,99 @@ enum {
 	HASH_SEED = 13U
 };
 
+/* {{{ TUPLE_HASH_MUM64 primitives */
+
+enum : uint64_t {
+	HASH64_P0 = 0xa0761d6478bd642fULL,
+	HASH64_P1 = 0xe7037ed1a0b428dbULL,
+	/* Seeds separating different kinds of field data. */
+	HASH64_SEED_STR = 1,
+	HASH64_SEED_RAW = 2,
+	HASH64_SEED_NEG = 3,
+	HASH64_SEED_DOUBLE = 4,
+};
+
+static inline uint64_t
+hash64_mum(uint64_t a, uint64_t b)
+{
+	return tuple_hash64_mum(a, b);
+}
+
+static inline uint64_t
+hash64_load8(const char *p)
+{
+	uint64_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline uint64_t
+hash64_load4(const char *p)
+{
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+/**
+ * Hash a byte string. Strings up to 16 bytes long, which are
+ * the most common in keys, are hashed without a loop, with at
+ * most two overlapping loads.
+ */
+static inline uint64_t
+hash64_bytes(const char *p, uint32_t len, uint64_t seed)
+{
+	const char *end = p + len;
+	seed ^= HASH64_P0;
+	for (; end - p > 16; p += 16) {
+		seed = hash64_mum(hash64_load8(p) ^ HASH64_P1,
+				  hash64_load8(p + 8) ^ seed);
+	}
+	uint32_t rest = end - p;
+	uint64_t a, b;
+	if (rest >= 8) {
+		a = hash64_load8(p);
+		b = hash64_load8(end - 8);
+	} else if (rest >= 4) {
+		a = hash64_load4(p);
+		b = hash64_load4(end - 4);
+	} else if (rest > 0) {
+		const unsigned char *u = (const unsigned char *)p;
+		a = ((uint64_t)u[0] << 16) | ((uint64_t)u[rest >> 1] << 8) |
+		    u[rest - 1];
+		b = 0;
+	} else {
+		a = b = 0;
+	}
+	return hash64_mum(HASH64_P1 ^ len,
+			  hash64_mum(a ^ HASH64_P1, b ^ seed));
+}
+
+/** Hash a non-negative integer. */
+static inline uint64_t
+hash64_uint(uint64_t v)
+{
+	return hash64_mum(v ^ HASH64_P0, HASH64_P1);
+}
+
+/** Hash a negative integer. */
+static inline uint64_t
+hash64_neg(int64_t v)
+{
+	return hash64_mum((uint64_t)v ^ HASH64_P0,
+			  HASH64_P1 ^ HASH64_SEED_NEG);
+}
+
+/** Hash MP_NIL, which is used for absent key parts. */
+static inline uint64_t
+hash64_nil(void)
+{
+	const char nil = 0xc0;
+	return hash64_bytes(&nil, 1, HASH64_SEED_RAW);
+}
+
+/* }}} */
+
 template <int TYPE>
 static inline uint32_t
 field_hash(uint32_t *ph, uint32_t *pcarry, const char **field)
@@ -183,6 +278,82 @@ struct TupleHash<FIELD_TYPE_UNSIGNED> {
 	}
 };
 
+template <int TYPE>
+static inline uint64_t
+field_hash64(const char **field)
+{
+	return tuple_hash64_field(field, NULL);
+}
+
+template <>
+inline uint64_t
+field_hash64<FIELD_TYPE_UNSIGNED>(const char **field)
+{
+	return hash64_uint(mp_decode_uint(field));
+}
+
+template <>
+inline uint64_t
+field_hash64<FIELD_TYPE_INTEGER>(const char **field)
+{
+	if (mp_typeof(**field) == MP_UINT)
+		return hash64_uint(mp_decode_uint(field));
+	int64_t v = mp_decode_int(field);
+	return v >= 0 ? hash64_uint(v) : hash64_neg(v);
+}
+
+template <>
+inline uint64_t
+field_hash64<FIELD_TYPE_STRING>(const char **field)
+{
+	uint32_t size;
+	const char *f = mp_decode_str(field, &size);
+	return hash64_bytes(f, size, HASH64_SEED_STR);
+}
+
+template <int ...TYPES> struct FieldHash64 {};
+
+template <int TYPE, int ...MORE_TYPES>
+struct FieldHash64<TYPE, MORE_TYPES...> {
+	static inline uint64_t hash(uint64_t h, const char **pfield)
+	{
+		h = tuple_hash64_mix(h, field_hash64<TYPE>(pfield));
+		return FieldHash64<MORE_TYPES...>::hash(h, pfield);
+	}
+};
+
+template <>
+struct FieldHash64<> {
+	static inline uint64_t hash(uint64_t h, const char **)
+	{
+		return h;
+	}
+};
+
+template <int ...TYPES>
+struct KeyHash64 {
+	static uint32_t hash(const char *key, struct key_def *)
+	{
+		uint64_t h = FieldHash64<TYPES...>::hash(TUPLE_HASH64_SEED,
+							  &key);
+		return tuple_hash64_result(h);
+	}
+};
+
+template <int ...TYPES>
+struct TupleHash64 {
+	static uint32_t hash(struct tuple *tuple, struct key_def *key_def)
+	{
+		assert(!key_def->is_multikey);
+		const char *field = tuple_field_by_part(tuple,
+						key_def->parts,
+						MULTIKEY_NONE);
+		uint64_t h = FieldHash64<TYPES...>::hash(TUPLE_HASH64_SEED,
+							  &field);
+		return tuple_hash64_result(h);
+	}
+};
+
 }; /* namespace { */
 
 #define HASHER(...) \
@@ -215,7 +386,38 @@ static const hasher_signature hash_arr[] = {
 	HASHER(FIELD_TYPE_STRING  , FIELD_TYPE_STRING  , FIELD_TYPE_STRING)
 };
 
+#define HASHER64(...) \
+	{ KeyHash64<__VA_ARGS__>::hash, TupleHash64<__VA_ARGS__>::hash, \
+		{ __VA_ARGS__, UINT32_MAX } },
+
+/**
+ * TUPLE_HASH_MUM64 hashers: field1 type, field2 type, ...
+ */
+static const hasher_signature hash64_arr[] = {
+	HASHER64(FIELD_TYPE_UNSIGNED)
+	HASHER64(FIELD_TYPE_STRING)
+	HASHER64(FIELD_TYPE_INTEGER)
+	HASHER64(FIELD_TYPE_UNSIGNED, FIELD_TYPE_UNSIGNED)
+	HASHER64(FIELD_TYPE_STRING  , FIELD_TYPE_UNSIGNED)
+	HASHER64(FIELD_TYPE_INTEGER , FIELD_TYPE_UNSIGNED)
+	HASHER64(FIELD_TYPE_UNSIGNED, FIELD_TYPE_STRING)
+	HASHER64(FIELD_TYPE_STRING  , FIELD_TYPE_STRING)
+	HASHER64(FIELD_TYPE_INTEGER , FIELD_TYPE_STRING)
+	HASHER64(FIELD_TYPE_UNSIGNED, FIELD_TYPE_INTEGER)
+	HASHER64(FIELD_TYPE_STRING  , FIELD_TYPE_INTEGER)
+	HASHER64(FIELD_TYPE_INTEGER , FIELD_TYPE_INTEGER)
+	HASHER64(FIELD_TYPE_UNSIGNED, FIELD_TYPE_UNSIGNED, FIELD_TYPE_UNSIGNED)
+	HASHER64(FIELD_TYPE_STRING  , FIELD_TYPE_UNSIGNED, FIELD_TYPE_UNSIGNED)
+	HASHER64(FIELD_TYPE_UNSIGNED, FIELD_TYPE_STRING  , FIELD_TYPE_UNSIGNED)
+	HASHER64(FIELD_TYPE_STRING  , FIELD_TYPE_STRING  , FIELD_TYPE_UNSIGNED)
+	HASHER64(FIELD_TYPE_UNSIGNED, FIELD_TYPE_UNSIGNED, FIELD_TYPE_STRING)
+	HASHER64(FIELD_TYPE_STRING  , FIELD_TYPE_UNSIGNED, FIELD_TYPE_STRING)
+	HASHER64(FIELD_TYPE_UNSIGNED, FIELD_TYPE_STRING  , FIELD_TYPE_STRING)
+	HASHER64(FIELD_TYPE_STRING  , FIELD_TYPE_STRING  , FIELD_TYPE_STRING)
+};
+
 #undef HASHER
+#undef HASHER64
 
 template <bool has_optional_parts, bool has_json_paths>
 uint32_t
@@ -224,10 +426,23 @@ tuple_hash_slowpath(struct tuple *tuple, struct key_def *key_def);
 uint32_t
 key_hash_slowpath(const char *key, struct key_def *key_def);
 
-void
-key_def_set_hash_func(struct key_def *key_def) {
+template <bool has_optional_parts, bool has_json_paths>
+uint32_t
+tuple_hash64_slowpath(struct tuple *tuple, struct key_def *key_def);
+
+uint32_t
+key_hash64_slowpath(const char *key, struct key_def *key_def);
+
+/**
+ * Look up pre-generated tuple_hash() and key_hash() for the
+ * key_def in the given hasher array.
+ */
+static bool
+key_def_set_hash_func_fast(struct key_def *key_def,
+			   const hasher_signature *arr, uint32_t arr_size)
+{
 	if (key_def->is_nullable || key_def->has_json_paths)
-		goto slowpath;
+		return false;
 	/*
 	 * Check that key_def defines sequential a key without holes
 	 * starting from **arbitrary** field.
@@ -235,31 +450,61 @@ key_def_set_hash_func(struct key_def *key_def) {
 	for (uint32_t i = 1; i < key_def->part_count; i++) {
 		if (key_def->parts[i - 1].fieldno + 1 !=
 		    key_def->parts[i].fieldno)
-			goto slowpath;
+			return false;
 	}
 	if (key_def_has_collation(key_def)) {
 		/* Precalculated comparators don't use collation */
-		goto slowpath;
+		return false;
 	}
-	/*
-	 * Try to find pre-generated tuple_hash() and key_hash()
-	 * implementations
-	 */
-	for (uint32_t k = 0; k < sizeof(hash_arr) / sizeof(hash_arr[0]); k++) {
+	for (uint32_t k = 0; k < arr_size; k++) {
 		uint32_t i = 0;
 		for (; i < key_def->part_count; i++) {
-			if (key_def->parts[i].type != hash_arr[k].p[i]) {
+			if (key_def->parts[i].type != arr[k].p[i]) {
 				break;
 			}
 		}
-		if (i == key_def->part_count && hash_arr[k].p[i] == UINT32_MAX){
-			key_def->tuple_hash = hash_arr[k].tf;
-			key_def->key_hash = hash_arr[k].kf;
-			return;
+		if (i == key_def->part_count && arr[k].p[i] == UINT32_MAX) {
+			key_def->tuple_hash = arr[k].tf;
+			key_def->key_hash = arr[k].kf;
+			return true;
 		}
 	}
+	return false;
+}
+
+static void
+key_def_set_hash64_func(struct key_def *key_def)
+{
+	if (key_def_set_hash_func_fast(key_def, hash64_arr,
+				       lengthof(hash64_arr)))
+		return;
+	if (key_def->has_optional_parts) {
+		if (key_def->has_json_paths)
+			key_def->tuple_hash = tuple_hash64_slowpath<true, true>;
+		else
+			key_def->tuple_hash = tuple_hash64_slowpath<true, false>;
+	} else {
+		if (key_def->has_json_paths)
+			key_def->tuple_hash = tuple_hash64_slowpath<false, true>;
+		else
+			key_def->tuple_hash = tuple_hash64_slowpath<false, false>;
+	}
+	key_def->key_hash = key_hash64_slowpath;
+}
 
-slowpath:
+void
+key_def_set_hash_func(struct key_def *key_def) {
+	if (key_def->hash_func == TUPLE_HASH_MUM64) {
+		key_def_set_hash64_func(key_def);
+		return;
+	}
+	assert(key_def->hash_func == TUPLE_HASH_MURMUR);
+	/*
+	 * Try to find pre-generated tuple_hash() and key_hash()
+	 * implementations
+	 */
+	if (key_def_set_hash_func_fast(key_def, hash_arr, lengthof(hash_arr)))
+		return;
 	if (key_def->has_optional_parts) {
 		if (key_def->has_json_paths)
 			key_def->tuple_hash = tuple_hash_slowpath<true, true>;
@@ -431,3 +676,131 @@ key_hash_slowpath(const char *key, struct key_def *key_def)
 
 	return PMurHash32_Result(h, carry, total_size);
 }
+
+void
+key_def_use_hash_func(struct key_def *def, enum tuple_hash_func func)
+{
+	assert(func < tuple_hash_func_MAX);
+	def->hash_func = func;
+	key_def_set_hash_func(def);
+}
+
+/* {{{ TUPLE_HASH_MUM64 */
+
+uint64_t
+tuple_hash64_field(const char **field, struct coll *coll)
+{
+	const char *f = *field;
+	switch (mp_typeof(**field)) {
+	case MP_UINT:
+		return hash64_uint(mp_decode_uint(field));
+	case MP_INT: {
+		int64_t v = mp_decode_int(field);
+		return v >= 0 ? hash64_uint(v) : hash64_neg(v);
+	}
+	case MP_STR: {
+		uint32_t size;
+		f = mp_decode_str(field, &size);
+		if (coll != NULL) {
+			uint32_t h = HASH_SEED;
+			uint32_t carry = 0;
+			size = coll->hash(f, size, &h, &carry, coll);
+			return hash64_uint(PMurHash32_Result(h, carry, size));
+		}
+		return hash64_bytes(f, size, HASH64_SEED_STR);
+	}
+	case MP_FLOAT:
+	case MP_DOUBLE: {
+		/*
+		 * Floating point numbers that can be stored as
+		 * integers must hash as integers so that we can
+		 * select integer values by floating point keys and
+		 * vice versa.
+		 */
+		double iptr;
+		double val = mp_typeof(**field) == MP_FLOAT ?
+			     mp_decode_float(field) :
+			     mp_decode_double(field);
+		if (isfinite(val) && modf(val, &iptr) == 0 &&
+		    val >= -exp2(63) && val < exp2(64)) {
+			if (val >= 0)
+				return hash64_uint((uint64_t)val);
+			return hash64_neg((int64_t)val);
+		}
+		uint64_t bits;
+		memcpy(&bits, &val, sizeof(bits));
+		return hash64_mum(bits ^ HASH64_P0,
+				  HASH64_P1 ^ HASH64_SEED_DOUBLE);
+	}
+	default:
+		/*
+		 * All other fields are hashed including MsgPack
+		 * format identifier, see tuple_hash_field().
+		 */
+		mp_next(field);
+		return hash64_bytes(f, *field - f, HASH64_SEED_RAW);
+	}
+}
+
+uint64_t
+tuple_hash64_key_part(struct tuple *tuple, struct key_part *part,
+		      int multikey_idx)
+{
+	const char *field = tuple_field_by_part(tuple, part, multikey_idx);
+	if (field == NULL)
+		return hash64_nil();
+	return tuple_hash64_field(&field, part->coll);
+}
+
+template <bool has_optional_parts, bool has_json_paths>
+uint32_t
+tuple_hash64_slowpath(struct tuple *tuple, struct key_def *key_def)
+{
+	assert(has_json_paths == key_def->has_json_paths);
+	assert(has_optional_parts == key_def->has_optional_parts);
+	assert(!key_def->is_multikey);
+	assert(!key_def->for_func_index);
+	uint64_t h = TUPLE_HASH64_SEED;
+	struct tuple_format *format = tuple_format(tuple);
+	const char *tuple_raw = tuple_data(tuple);
+	const uint32_t *field_map = tuple_field_map(tuple);
+	const char *end = (char *)tuple + tuple_size(tuple);
+	const char *field = NULL;
+	for (uint32_t part_id = 0; part_id < key_def->part_count; part_id++) {
+		struct key_part *part = &key_def->parts[part_id];
+		/*
+		 * Sequential parts are hashed without a field
+		 * lookup, see tuple_hash_slowpath().
+		 */
+		if (part_id == 0 || part[-1].fieldno + 1 != part->fieldno) {
+			if (has_json_paths) {
+				field = tuple_field_raw_by_part(format,
+						tuple_raw, field_map, part,
+						MULTIKEY_NONE);
+			} else {
+				field = tuple_field_raw(format, tuple_raw,
+						field_map, part->fieldno);
+			}
+		}
+		uint64_t field_hash;
+		if (has_optional_parts && (field == NULL || field >= end))
+			field_hash = hash64_nil();
+		else
+			field_hash = tuple_hash64_field(&field, part->coll);
+		h = tuple_hash64_mix(h, field_hash);
+	}
+	return tuple_hash64_result(h);
+}
+
+uint32_t
+key_hash64_slowpath(const char *key, struct key_def *key_def)
+{
+	uint64_t h = TUPLE_HASH64_SEED;
+	for (struct key_part *part = key_def->parts;
+	     part < key_def->parts + key_def->part_count; part++) {
+		h = tuple_hash64_mix(h, tuple_hash64_field(&key, part->coll));
+	}
+	return tuple_hash64_result(h);
+}
+
+/* }}} */
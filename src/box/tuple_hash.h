@@ -30,11 +30,111 @@
  * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
  * SUCH DAMAGE.
  */
+#include <stdint.h>
+
 #if defined(__cplusplus)
 extern "C" {
 #endif /* defined(__cplusplus) */
 
 struct key_def;
+struct key_part;
+struct tuple;
+struct coll;
+
+/**
+ * Tuple hash function, chosen per index. Hashes computed by
+ * different functions are not compatible so the function used
+ * to build a persistent structure (e.g. a vinyl bloom filter)
+ * must be stored along with it.
+ */
+enum tuple_hash_func {
+	/**
+	 * 32-bit PMurHash over the MsgPack of all key fields
+	 * processed as a single byte stream.
+	 */
+	TUPLE_HASH_MURMUR = 0,
+	/**
+	 * Each key field is hashed to a 64-bit value with a
+	 * multiply-fold (MUM) hash, integers and short strings
+	 * without a byte loop, and field hashes are then mixed
+	 * together. The result is folded to 32 bits.
+	 */
+	TUPLE_HASH_MUM64,
+	tuple_hash_func_MAX,
+};
+
+extern const char *tuple_hash_func_strs[];
+
+/** Initial value of a TUPLE_HASH_MUM64 running hash. */
+#define TUPLE_HASH64_SEED 13ULL
+
+/**
+ * Compute TUPLE_HASH_MUM64 hash of a tuple field and advance
+ * @a field past it.
+ * @param field - pointer to field data
+ * @param coll - collation to use for hashing strings or NULL
+ */
+uint64_t
+tuple_hash64_field(const char **field, struct coll *coll);
+
+/**
+ * Compute TUPLE_HASH_MUM64 hash of a key part, MP_NIL is
+ * hashed if the part is absent in the tuple.
+ */
+uint64_t
+tuple_hash64_key_part(struct tuple *tuple, struct key_part *part,
+		      int multikey_idx);
+
+/**
+ * Multiply two 64-bit numbers and fold the 128-bit product by
+ * xoring its halves. Hashes are persisted in bloom filters, so
+ * the fallback for compilers without 128-bit integers must give
+ * exactly the same result.
+ */
+static inline uint64_t
+tuple_hash64_mum(uint64_t a, uint64_t b)
+{
+#if defined(__SIZEOF_INT128__)
+	__uint128_t r = (__uint128_t)a * b;
+	return (uint64_t)r ^ (uint64_t)(r >> 64);
+#else
+	uint64_t a_lo = (uint32_t)a, a_hi = a >> 32;
+	uint64_t b_lo = (uint32_t)b, b_hi = b >> 32;
+	uint64_t lo_lo = a_lo * b_lo;
+	uint64_t hi_lo = a_hi * b_lo;
+	uint64_t lo_hi = a_lo * b_hi;
+	uint64_t hi_hi = a_hi * b_hi;
+	uint64_t cross = (lo_lo >> 32) + (uint32_t)hi_lo + lo_hi;
+	uint64_t hi = hi_hi + (hi_lo >> 32) + (cross >> 32);
+	uint64_t lo = (cross << 32) | (uint32_t)lo_lo;
+	return lo ^ hi;
+#endif
+}
+
+/**
+ * Mix a field hash into a TUPLE_HASH_MUM64 running hash.
+ * The result depends on the order of fields.
+ */
+static inline uint64_t
+tuple_hash64_mix(uint64_t h, uint64_t field_hash)
+{
+	return tuple_hash64_mum(h ^ 0x8ebc6af09c88c6e3ULL,
+				field_hash ^ 0x589965cc75374cc3ULL);
+}
+
+/** Fold a TUPLE_HASH_MUM64 running hash to the final value. */
+static inline uint32_t
+tuple_hash64_result(uint64_t h)
+{
+	return (uint32_t)(h ^ (h >> 32));
+}
+
+/**
+ * Set the hash function of the key_def and update its
+ * tuple_hash() and key_hash() accordingly.
+ */
+void
+key_def_use_hash_func(struct key_def *def, enum tuple_hash_func func);
 
 /**
  * Initialize tuple_hash() and key_hash() function for the key_def
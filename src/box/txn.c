@@ -33,6 +33,8 @@
 #include "tuple.h"
 #include "journal.h"
 #include <fiber.h>
+#include <clock.h>
+#include "trace.h"
 #include "xrow.h"
 #include "errinj.h"
 
@@ -642,7 +644,20 @@ txn_commit(struct txn *txn)
 	}
 
 	fiber_set_txn(fiber(), NULL);
-	if (journal_write(req) != 0) {
+	uint64_t wal_start = clock_ticks();
+	int rc = journal_write(req);
+	uint64_t wal_end = clock_ticks();
+	fiber()->storage.net.wal_ticks += wal_end - wal_start;
+	struct trace_record *trace = fiber()->storage.net.trace;
+	if (unlikely(trace != NULL)) {
+		trace_record_stamp(trace, TRACE_WAL_SUBMIT, wal_start);
+		trace_record_stamp(trace, TRACE_WAL_WRITE,
+				   req->write_start_ticks);
+		trace_record_stamp(trace, TRACE_WAL_DONE,
+				   req->write_end_ticks);
+		trace_record_stamp(trace, TRACE_WAL_WAKEUP, wal_end);
+	}
+	if (rc != 0) {
 		fiber_set_txn(fiber(), txn);
 		txn_rollback(txn);
 		txn_free(txn);
@@ -960,6 +960,9 @@ vinyl_index_def_change_requires_rebuild(struct index *index,
 			return true;
 	}
 	assert(old_cmp_def->is_multikey == new_cmp_def->is_multikey);
+	/* Comparison hints cached in memory must be recomputed. */
+	if (old_cmp_def->hint_part_count != new_cmp_def->hint_part_count)
+		return true;
 	return false;
 }
 
@@ -4481,6 +4484,8 @@ static const struct engine_vtab vinyl_engine_vtab = {
 	/* .create_space = */ vinyl_engine_create_space,
 	/* .prepare_join = */ vinyl_engine_prepare_join,
 	/* .join = */ vinyl_engine_join,
+	/* .split_join = */ generic_engine_split_join,
+	/* .join_stream = */ generic_engine_join_stream,
 	/* .complete_join = */ vinyl_engine_complete_join,
 	/* .begin = */ vinyl_engine_begin,
 	/* .begin_statement = */ vinyl_engine_begin_statement,
@@ -4524,6 +4529,7 @@ static const struct space_vtab vinyl_space_vtab = {
 	/* .build_index = */ vinyl_space_build_index,
 	/* .swap_index = */ vinyl_space_swap_index,
 	/* .prepare_alter = */ vinyl_space_prepare_alter,
+	/* .prepare_truncate = */ generic_space_prepare_truncate,
 	/* .invalidate = */ vinyl_space_invalidate,
 };
 
@@ -578,6 +578,9 @@ vy_page_info_decode(struct vy_page_info *page, const struct xrow_header *xrow,
 		case VY_PAGE_INFO_ROW_INDEX_OFFSET:
 			page->row_index_offset = mp_decode_uint(&pos);
 			break;
+		case VY_PAGE_INFO_FIELD_MAP_OFFSET:
+			page->field_map_offset = mp_decode_uint(&pos);
+			break;
 		default:
 			mp_next(&pos); /* unknown key, ignore */
 			break;
@@ -683,6 +686,33 @@ vy_run_info_decode(struct vy_run_info *run_info,
 			if (run_info->bloom == NULL)
 				return -1;
 			break;
+		case VY_RUN_INFO_BLOOM_VERSIONED: {
+			tmp = pos;
+			mp_next(&pos);
+			/*
+			 * A bloom filter is only an optimization, so
+			 * if we can't use it, load the run without it.
+			 */
+			if (mp_typeof(*tmp) != MP_ARRAY ||
+			    mp_decode_array(&tmp) != 2 ||
+			    mp_typeof(*tmp) != MP_UINT) {
+				say_warn("%s: ignoring bloom filter: "
+					 "invalid format", filename);
+				break;
+			}
+			uint64_t hash_func = mp_decode_uint(&tmp);
+			if (hash_func >= tuple_hash_func_MAX) {
+				say_warn("%s: ignoring bloom filter: "
+					 "unknown hash function %llu", filename,
+					 (unsigned long long)hash_func);
+				break;
+			}
+			run_info->bloom = tuple_bloom_decode(&tmp);
+			if (run_info->bloom == NULL)
+				return -1;
+			run_info->bloom->hash_func = hash_func;
+			break;
+		}
 		case VY_RUN_INFO_STMT_STAT:
 			vy_stmt_stat_decode(&run_info->stmt_stat, &pos);
 			break;
@@ -713,6 +743,8 @@ vy_page_new(const struct vy_page_info *page_info)
 	}
 	page->unpacked_size = page_info->unpacked_size;
 	page->row_count = page_info->row_count;
+	page->field_map_index = NULL;
+	page->field_maps = NULL;
 	page->row_index = calloc(page_info->row_count, sizeof(uint32_t));
 	if (page->row_index == NULL) {
 		diag_set(OutOfMemory, page_info->row_count * sizeof(uint32_t),
@@ -742,6 +774,7 @@ vy_page_delete(struct vy_page *page)
 	memset(data, '#', page->unpacked_size);
 	memset(page, '#', sizeof(*page));
 #endif /* !defined(NDEBUG) */
+	free(page->field_map_index);
 	free(row_index);
 	free(data);
 	free(page);
@@ -778,8 +811,11 @@ vy_page_stmt(struct vy_page *page, uint32_t stmt_no,
 	struct xrow_header xrow;
 	if (vy_page_xrow(page, stmt_no, &xrow) != 0)
 		return vy_entry_none();
+	const char *field_map = NULL;
+	if (page->field_map_index != NULL)
+		field_map = page->field_maps + page->field_map_index[stmt_no];
 	struct vy_entry entry;
-	entry.stmt = vy_stmt_decode(&xrow, format);
+	entry.stmt = vy_stmt_decode(&xrow, format, field_map);
 	if (entry.stmt == NULL)
 		return vy_entry_none();
 	entry.hint = vy_stmt_hint(entry.stmt, cmp_def);
@@ -839,6 +875,89 @@ vy_run_iterator_stop(struct vy_run_iterator *itr)
 	}
 }
 
+/**
+ * Decode statement field maps stored in a page. The field maps
+ * are only used if they were built for the format the page is
+ * read with, otherwise they are ignored. The field maps are
+ * referenced, not copied, so the row must be located in the
+ * page data.
+ */
+static int
+vy_page_field_map_decode(struct vy_page *page, struct xrow_header *xrow,
+			 struct tuple_format *format)
+{
+	assert(xrow->type == VY_RUN_FIELD_MAP);
+	const char *pos = xrow->body->iov_base;
+	uint32_t map_size = mp_decode_map(&pos);
+	uint32_t map_item;
+	uint32_t hash = 0;
+	const char *layout = NULL;
+	uint32_t layout_size = 0;
+	const char *data = NULL;
+	uint32_t size = 0;
+	for (map_item = 0; map_item < map_size; ++map_item) {
+		uint32_t key = mp_decode_uint(&pos);
+		switch (key) {
+		case VY_FIELD_MAP_HASH:
+			hash = mp_decode_uint(&pos);
+			break;
+		case VY_FIELD_MAP_LAYOUT:
+			layout = mp_decode_bin(&pos, &layout_size);
+			break;
+		case VY_FIELD_MAP_DATA:
+			data = mp_decode_bin(&pos, &size);
+			break;
+		default:
+			mp_next(&pos); /* unknown key, ignore */
+			break;
+		}
+	}
+	assert(pos == xrow->body->iov_base + xrow->body->iov_len);
+	if (data == NULL || layout == NULL ||
+	    hash != format->field_map_hash)
+		return 0;
+	/* Hashes may collide, compare the layouts themselves. */
+	uint32_t format_layout_size;
+	const char *format_layout = tuple_format_field_map_layout(format,
+				&fiber()->gc, &format_layout_size);
+	if (format_layout == NULL)
+		return -1;
+	if (layout_size != format_layout_size ||
+	    memcmp(layout, format_layout, layout_size) != 0)
+		return 0;
+	uint32_t *index = calloc(page->row_count, sizeof(uint32_t));
+	if (index == NULL) {
+		diag_set(OutOfMemory, page->row_count * sizeof(uint32_t),
+			 "malloc", "page->field_map_index");
+		return -1;
+	}
+	uint32_t slot_count = format->field_map_size / sizeof(uint32_t);
+	const char *end = data + size;
+	pos = data;
+	for (uint32_t i = 0; i < page->row_count; ++i) {
+		if (end - pos < (ptrdiff_t)sizeof(uint32_t))
+			goto error;
+		index[i] = pos - data;
+		uint32_t word_count = mp_load_u32(&pos);
+		/* DELETE statements are stored without field maps. */
+		if (word_count != 0 && word_count < slot_count)
+			goto error;
+		if ((uint64_t)(end - pos) <
+		    (uint64_t)word_count * sizeof(uint32_t))
+			goto error;
+		pos += word_count * sizeof(uint32_t);
+	}
+	if (pos != end)
+		goto error;
+	page->field_map_index = index;
+	page->field_maps = data;
+	return 0;
+error:
+	free(index);
+	diag_set(ClientError, ER_INVALID_RUN_FILE, "Wrong field map size");
+	return -1;
+}
+
 static int
 vy_row_index_decode(uint32_t *row_index, uint32_t row_count,
 		    struct xrow_header *xrow)
@@ -882,13 +1001,16 @@ vy_run_filename(struct vy_run *run)
 
 /**
  * Read a page requests from vinyl xlog data file.
+ * Statement field maps stored in the page are decoded for
+ * @a format.
  *
  * @retval 0 on success
  * @retval -1 on error, check diag
  */
 static int
 vy_page_read(struct vy_page *page, const struct vy_page_info *page_info,
-	     struct vy_run *run, ZSTD_DStream *zdctx)
+	     struct vy_run *run, struct tuple_format *format,
+	     ZSTD_DStream *zdctx)
 {
 	/* read xlog tx from xlog file */
 	size_t region_svp = region_used(&fiber()->gc);
@@ -940,6 +1062,22 @@ vy_page_read(struct vy_page *page, const struct vy_page_info *page_info,
 	}
 	if (vy_row_index_decode(page->row_index, page->row_count, &xrow) != 0)
 		goto error;
+	if (page_info->field_map_offset != 0) {
+		data_pos = page->data + page_info->field_map_offset;
+		data_end = page->data + page_info->row_index_offset;
+		if (xrow_header_decode(&xrow, &data_pos, data_end, true) == -1)
+			goto error;
+		if (xrow.type != VY_RUN_FIELD_MAP) {
+			diag_set(ClientError, ER_INVALID_RUN_FILE,
+				 tt_sprintf("Wrong field map type "
+					    "(expected %d, got %u)",
+					    VY_RUN_FIELD_MAP,
+					    (unsigned)xrow.type));
+			goto error;
+		}
+		if (vy_page_field_map_decode(page, &xrow, format) != 0)
+			goto error;
+	}
 	region_truncate(&fiber()->gc, region_svp);
 	ERROR_INJECT(ERRINJ_VY_READ_PAGE, {
 		diag_set(ClientError, ER_INJECTION, "vinyl page read");
@@ -983,7 +1121,8 @@ vy_page_read_cb(struct cbus_call_msg *base)
 	ZSTD_DStream *zdctx = vy_env_get_zdctx(task->run->env);
 	if (zdctx == NULL)
 		return -1;
-	if (vy_page_read(task->page, task->page_info, task->run, zdctx) != 0)
+	if (vy_page_read(task->page, task->page_info, task->run,
+			 task->format, zdctx) != 0)
 		return -1;
 	if (task->key.stmt != NULL) {
 		task->pos_in_page = vy_page_find_key(task->page, task->key,
@@ -1838,6 +1977,54 @@ vy_row_index_encode(const uint32_t *row_index, uint32_t row_count,
 	return 0;
 }
 
+/**
+ * Encode statement field maps of a page as xrow
+ *
+ * @param field_maps field maps
+ * @param size size of @a field_maps
+ * @param format format the field maps were built for
+ * @param[out] xrow xrow to fill.
+ * @retval 0 for success
+ * @retval -1 for error
+ */
+static int
+vy_field_map_encode(const char *field_maps, uint32_t size,
+		    struct tuple_format *format, struct xrow_header *xrow)
+{
+	memset(xrow, 0, sizeof(*xrow));
+	xrow->type = VY_RUN_FIELD_MAP;
+
+	uint32_t layout_size;
+	const char *layout = tuple_format_field_map_layout(format,
+					&fiber()->gc, &layout_size);
+	if (layout == NULL)
+		return -1;
+	size_t body_size = mp_sizeof_map(3) +
+			   mp_sizeof_uint(VY_FIELD_MAP_HASH) +
+			   mp_sizeof_uint(format->field_map_hash) +
+			   mp_sizeof_uint(VY_FIELD_MAP_LAYOUT) +
+			   mp_sizeof_bin(layout_size) +
+			   mp_sizeof_uint(VY_FIELD_MAP_DATA) +
+			   mp_sizeof_bin(size);
+	char *pos = region_alloc(&fiber()->gc, body_size);
+	if (pos == NULL) {
+		diag_set(OutOfMemory, body_size, "region", "field map");
+		return -1;
+	}
+	xrow->body->iov_base = pos;
+	pos = mp_encode_map(pos, 3);
+	pos = mp_encode_uint(pos, VY_FIELD_MAP_HASH);
+	pos = mp_encode_uint(pos, format->field_map_hash);
+	pos = mp_encode_uint(pos, VY_FIELD_MAP_LAYOUT);
+	pos = mp_encode_bin(pos, layout, layout_size);
+	pos = mp_encode_uint(pos, VY_FIELD_MAP_DATA);
+	pos = mp_encode_bin(pos, field_maps, size);
+	xrow->body->iov_len = (void *)pos - xrow->body->iov_base;
+	assert(xrow->body->iov_len == body_size);
+	xrow->bodycnt = 1;
+	return 0;
+}
+
 /**
  * Helper to extend run page info array
  */
@@ -1884,8 +2071,9 @@ vy_page_info_encode(const struct vy_page_info *page_info,
 
 	/* calc tuple size */
 	uint32_t size;
-	/* 3 items: page offset, size, and map */
-	size = mp_sizeof_map(6) +
+	/* The field map offset is optional. */
+	uint32_t map_size = page_info->field_map_offset != 0 ? 7 : 6;
+	size = mp_sizeof_map(map_size) +
 	       mp_sizeof_uint(VY_PAGE_INFO_OFFSET) +
 	       mp_sizeof_uint(page_info->offset) +
 	       mp_sizeof_uint(VY_PAGE_INFO_SIZE) +
@@ -1898,6 +2086,10 @@ vy_page_info_encode(const struct vy_page_info *page_info,
 	       mp_sizeof_uint(page_info->unpacked_size) +
 	       mp_sizeof_uint(VY_PAGE_INFO_ROW_INDEX_OFFSET) +
 	       mp_sizeof_uint(page_info->row_index_offset);
+	if (page_info->field_map_offset != 0) {
+		size += mp_sizeof_uint(VY_PAGE_INFO_FIELD_MAP_OFFSET) +
+			mp_sizeof_uint(page_info->field_map_offset);
+	}
 
 	char *pos = region_alloc(region, size);
 	if (pos == NULL) {
@@ -1908,7 +2100,7 @@ vy_page_info_encode(const struct vy_page_info *page_info,
 	memset(xrow, 0, sizeof(*xrow));
 	/* encode page */
 	xrow->body->iov_base = pos;
-	pos = mp_encode_map(pos, 6);
+	pos = mp_encode_map(pos, map_size);
 	pos = mp_encode_uint(pos, VY_PAGE_INFO_OFFSET);
 	pos = mp_encode_uint(pos, page_info->offset);
 	pos = mp_encode_uint(pos, VY_PAGE_INFO_SIZE);
@@ -1922,6 +2114,10 @@ vy_page_info_encode(const struct vy_page_info *page_info,
 	pos = mp_encode_uint(pos, page_info->unpacked_size);
 	pos = mp_encode_uint(pos, VY_PAGE_INFO_ROW_INDEX_OFFSET);
 	pos = mp_encode_uint(pos, page_info->row_index_offset);
+	if (page_info->field_map_offset != 0) {
+		pos = mp_encode_uint(pos, VY_PAGE_INFO_FIELD_MAP_OFFSET);
+		pos = mp_encode_uint(pos, page_info->field_map_offset);
+	}
 	xrow->body->iov_len = (void *)pos - xrow->body->iov_base;
 	xrow->bodycnt = 1;
 
@@ -1999,9 +2195,16 @@ vy_run_info_encode(const struct vy_run_info *run_info,
 		mp_sizeof_uint(run_info->max_lsn);
 	size += mp_sizeof_uint(VY_RUN_INFO_PAGE_COUNT) +
 		mp_sizeof_uint(run_info->page_count);
-	if (run_info->bloom != NULL)
+	if (run_info->bloom != NULL &&
+	    run_info->bloom->hash_func == TUPLE_HASH_MURMUR) {
 		size += mp_sizeof_uint(VY_RUN_INFO_BLOOM) +
 			tuple_bloom_size(run_info->bloom);
+	} else if (run_info->bloom != NULL) {
+		size += mp_sizeof_uint(VY_RUN_INFO_BLOOM_VERSIONED) +
+			mp_sizeof_array(2) +
+			mp_sizeof_uint(run_info->bloom->hash_func) +
+			tuple_bloom_size(run_info->bloom);
+	}
 	size += mp_sizeof_uint(VY_RUN_INFO_STMT_STAT) +
 		vy_stmt_stat_sizeof(&run_info->stmt_stat);
 
@@ -2026,9 +2229,15 @@ vy_run_info_encode(const struct vy_run_info *run_info,
 	pos = mp_encode_uint(pos, run_info->max_lsn);
 	pos = mp_encode_uint(pos, VY_RUN_INFO_PAGE_COUNT);
 	pos = mp_encode_uint(pos, run_info->page_count);
-	if (run_info->bloom != NULL) {
+	if (run_info->bloom != NULL &&
+	    run_info->bloom->hash_func == TUPLE_HASH_MURMUR) {
 		pos = mp_encode_uint(pos, VY_RUN_INFO_BLOOM);
 		pos = tuple_bloom_encode(run_info->bloom, pos);
+	} else if (run_info->bloom != NULL) {
+		pos = mp_encode_uint(pos, VY_RUN_INFO_BLOOM_VERSIONED);
+		pos = mp_encode_array(pos, 2);
+		pos = mp_encode_uint(pos, run_info->bloom->hash_func);
+		pos = tuple_bloom_encode(run_info->bloom, pos);
 	}
 	pos = mp_encode_uint(pos, VY_RUN_INFO_STMT_STAT);
 	pos = vy_stmt_stat_encode(&run_info->stmt_stat, pos);
@@ -2124,13 +2333,16 @@ vy_run_writer_create(struct vy_run_writer *writer, struct vy_run *run,
 	writer->bloom_fpr = bloom_fpr;
 	writer->no_compression = no_compression;
 	if (bloom_fpr < 1) {
-		writer->bloom = tuple_bloom_builder_new(key_def->part_count);
+		writer->bloom = tuple_bloom_builder_new(key_def->part_count,
+							key_def->hash_func);
 		if (writer->bloom == NULL)
 			return -1;
 	}
 	xlog_clear(&writer->data_xlog);
 	ibuf_create(&writer->row_index_buf, &cord()->slabc,
 		    4096 * sizeof(uint32_t));
+	ibuf_create(&writer->field_map_buf, &cord()->slabc,
+		    4096 * sizeof(uint32_t));
 	run->info.min_lsn = INT64_MAX;
 	run->info.max_lsn = -1;
 	assert(run->page_info == NULL);
@@ -2202,6 +2414,79 @@ vy_run_writer_start_page(struct vy_run_writer *writer,
 	return 0;
 }
 
+/**
+ * Check if tuples of two formats can share field maps. Field
+ * map hashes may collide, so the layouts are compared if the
+ * hashes are equal. A memory error is treated as a mismatch.
+ */
+static bool
+vy_field_map_format_equal(struct tuple_format *a, struct tuple_format *b)
+{
+	if (a == b)
+		return true;
+	if (a->field_map_hash != b->field_map_hash)
+		return false;
+	struct region *region = &fiber()->gc;
+	size_t region_svp = region_used(region);
+	uint32_t a_size, b_size;
+	const char *a_layout = tuple_format_field_map_layout(a, region,
+							     &a_size);
+	const char *b_layout = tuple_format_field_map_layout(b, region,
+							     &b_size);
+	bool is_equal = a_layout != NULL && b_layout != NULL &&
+			a_size == b_size &&
+			memcmp(a_layout, b_layout, a_size) == 0;
+	region_truncate(region, region_svp);
+	return is_equal;
+}
+
+/**
+ * Append the field map of @a stmt to the field maps of
+ * a current page. Field maps are only worth storing for
+ * statements that are expensive to parse, i.e. full tuples
+ * of a format with JSON path fields. If a page has statements
+ * of different field map layouts, which may happen after
+ * the space is altered, the page is written without field
+ * maps.
+ *
+ * @retval -1 Memory error.
+ * @retval  0 Success.
+ */
+static int
+vy_run_writer_add_field_map(struct vy_run_writer *writer,
+			    struct tuple *stmt)
+{
+	if (writer->iid != 0 || writer->no_field_map)
+		return 0;
+	uint32_t word_count = 0;
+	/* DELETE statements are stored as keys. */
+	if (vy_stmt_type(stmt) != IPROTO_DELETE) {
+		struct tuple_format *format = tuple_format(stmt);
+		if (writer->field_map_format == NULL &&
+		    format->fields_depth > 1) {
+			writer->field_map_format = format;
+		} else if (writer->field_map_format == NULL ||
+			   !vy_field_map_format_equal(writer->field_map_format,
+						      format)) {
+			writer->no_field_map = true;
+			return 0;
+		}
+		word_count = (stmt->data_offset - sizeof(struct vy_stmt)) /
+			     sizeof(uint32_t);
+	}
+	size_t size = (word_count + 1) * sizeof(uint32_t);
+	char *pos = ibuf_alloc(&writer->field_map_buf, size);
+	if (pos == NULL) {
+		diag_set(OutOfMemory, size, "ibuf", "field map");
+		return -1;
+	}
+	pos = mp_store_u32(pos, word_count);
+	const uint32_t *field_map = tuple_field_map(stmt);
+	for (uint32_t i = word_count; i > 0; i--)
+		pos = mp_store_u32(pos, field_map[-(int32_t)i]);
+	return 0;
+}
+
 /**
  * Write @a stmt into a current page.
  * @param writer Run writer.
@@ -2229,6 +2514,8 @@ vy_run_writer_write_to_page(struct vy_run_writer *writer, struct vy_entry entry)
 		return -1;
 	}
 	*offset = page->unpacked_size;
+	if (vy_run_writer_add_field_map(writer, entry.stmt) != 0)
+		return -1;
 	if (vy_run_dump_stmt(entry, &writer->data_xlog, page,
 			     writer->cmp_def, writer->iid == 0) != 0)
 		return -1;
@@ -2256,10 +2543,28 @@ vy_run_writer_end_page(struct vy_run_writer *writer)
 	       sizeof(uint32_t) * page->row_count);
 
 	struct xrow_header xrow;
+	ssize_t written;
+	/*
+	 * Field maps are written in a row of their own before
+	 * the row index. Older versions only look for rows via
+	 * the row index, so they never read it.
+	 */
+	if (writer->field_map_format != NULL && !writer->no_field_map) {
+		if (vy_field_map_encode(writer->field_map_buf.rpos,
+					ibuf_used(&writer->field_map_buf),
+					writer->field_map_format, &xrow) < 0)
+			return -1;
+		written = xlog_write_row(&writer->data_xlog, &xrow);
+		if (written < 0)
+			return -1;
+		page->field_map_offset = page->unpacked_size;
+		page->unpacked_size += written;
+	}
+
 	uint32_t *row_index = (uint32_t *)writer->row_index_buf.rpos;
 	if (vy_row_index_encode(row_index, page->row_count, &xrow) < 0)
 		return -1;
-	ssize_t written = xlog_write_row(&writer->data_xlog, &xrow);
+	written = xlog_write_row(&writer->data_xlog, &xrow);
 	if (written < 0)
 		return -1;
 	page->row_index_offset = page->unpacked_size;
@@ -2274,6 +2579,9 @@ vy_run_writer_end_page(struct vy_run_writer *writer)
 	run->info.page_count++;
 	vy_run_acct_page(run, page);
 	ibuf_reset(&writer->row_index_buf);
+	ibuf_reset(&writer->field_map_buf);
+	writer->field_map_format = NULL;
+	writer->no_field_map = false;
 	return 0;
 }
 
@@ -2315,6 +2623,7 @@ vy_run_writer_destroy(struct vy_run_writer *writer, bool reuse_fd)
 	if (writer->bloom != NULL)
 		tuple_bloom_builder_delete(writer->bloom);
 	ibuf_destroy(&writer->row_index_buf);
+	ibuf_destroy(&writer->field_map_buf);
 }
 
 int
@@ -2414,7 +2723,8 @@ vy_run_rebuild_index(struct vy_run *run, const char *dir,
 
 	struct tuple_bloom_builder *bloom_builder = NULL;
 	if (opts->bloom_fpr < 1) {
-		bloom_builder = tuple_bloom_builder_new(key_def->part_count);
+		bloom_builder = tuple_bloom_builder_new(key_def->part_count,
+							key_def->hash_func);
 		if (bloom_builder == NULL)
 			goto close_err;
 	}
@@ -2430,6 +2740,7 @@ vy_run_rebuild_index(struct vy_run *run, const char *dir,
 			goto close_err;
 		uint32_t page_row_count = 0;
 		uint64_t page_row_index_offset = 0;
+		uint64_t page_field_map_offset = 0;
 		uint64_t row_offset = xlog_cursor_tx_pos(&cursor);
 
 		struct xrow_header xrow;
@@ -2439,8 +2750,14 @@ vy_run_rebuild_index(struct vy_run *run, const char *dir,
 				row_offset = xlog_cursor_tx_pos(&cursor);
 				continue;
 			}
+			if (xrow.type == VY_RUN_FIELD_MAP) {
+				page_field_map_offset = row_offset;
+				row_offset = xlog_cursor_tx_pos(&cursor);
+				continue;
+			}
 			++page_row_count;
-			struct tuple *tuple = vy_stmt_decode(&xrow, format);
+			struct tuple *tuple = vy_stmt_decode(&xrow, format,
+							     NULL);
 			if (tuple == NULL)
 				goto close_err;
 			if (bloom_builder != NULL) {
@@ -2484,6 +2801,7 @@ vy_run_rebuild_index(struct vy_run *run, const char *dir,
 		info->size = next_page_offset - page_offset;
 		info->unpacked_size = xlog_cursor_tx_pos(&cursor);
 		info->row_index_offset = page_row_index_offset;
+		info->field_map_offset = page_field_map_offset;
 		++run->info.page_count;
 		vy_run_acct_page(run, info);
 
@@ -2585,7 +2903,8 @@ vy_slice_stream_read_page(struct vy_slice_stream *stream)
 	if (stream->page == NULL)
 		return -1;
 
-	if (vy_page_read(stream->page, page_info, run, zdctx) != 0) {
+	if (vy_page_read(stream->page, page_info, run, stream->format,
+			 zdctx) != 0) {
 		vy_page_delete(stream->page);
 		stream->page = NULL;
 		return -1;
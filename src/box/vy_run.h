@@ -109,6 +109,11 @@ struct vy_page_info {
 	hint_t min_key_hint;
 	/** Offset of the row index in the page. */
 	uint32_t row_index_offset;
+	/**
+	 * Offset of the statement field maps in the page,
+	 * 0 if the page has no field maps.
+	 */
+	uint32_t field_map_offset;
 };
 
 /**
@@ -295,6 +300,14 @@ struct vy_page {
 	uint32_t row_count;
 	/** Array of row offsets. */
 	uint32_t *row_index;
+	/**
+	 * Array of offsets of statement field maps in
+	 * @a field_maps or NULL if the page has no field maps
+	 * usable with the format the page was read with.
+	 */
+	uint32_t *field_map_index;
+	/** Field maps of the page statements, in @a data. */
+	const char *field_maps;
 	/** Pointer to the page data. */
 	char *data;
 };
@@ -622,6 +635,22 @@ struct vy_run_writer {
 	struct tuple_bloom_builder *bloom;
 	/** Buffer of a current page row offsets. */
 	struct ibuf row_index_buf;
+	/**
+	 * Buffer of a current page statement field maps.
+	 * Field maps are stored only in primary index runs of
+	 * spaces with JSON path indexes, so that a statement
+	 * read from disk needn't be parsed to find its indexed
+	 * fields.
+	 */
+	struct ibuf field_map_buf;
+	/**
+	 * Format of the field maps of a current page or NULL
+	 * if no statement with a field map has been written
+	 * to the page yet.
+	 */
+	struct tuple_format *field_map_format;
+	/** Set if a current page is written without field maps. */
+	bool no_field_map;
 	/**
 	 * Remember a last written statement to use it as a source
 	 * of max key of a finished run.
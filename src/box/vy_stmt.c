@@ -293,6 +293,51 @@ vy_key_dup(const char *key)
 	return res;
 }
 
+/**
+ * Check that a field map read from disk is consistent with the
+ * format and the tuple data: field offsets point into the data
+ * and multikey extents lie within the field map.
+ */
+static bool
+vy_stmt_field_map_is_valid(struct tuple_format *format,
+			   const uint32_t *field_map, uint32_t field_map_size,
+			   uint32_t data_size)
+{
+	uint32_t word_count = field_map_size / sizeof(uint32_t);
+	uint32_t slot_count = format->field_map_size / sizeof(uint32_t);
+	if (word_count < slot_count)
+		return false;
+	struct tuple_field *field;
+	json_tree_foreach_entry_preorder(field, &format->fields.root,
+					 struct tuple_field, token) {
+		if (field->offset_slot == TUPLE_OFFSET_SLOT_NIL)
+			continue;
+		int32_t offset = (int32_t)field_map[field->offset_slot];
+		if (offset >= 0) {
+			if ((uint32_t)offset >= data_size)
+				return false;
+			continue;
+		}
+		if (!field->is_multikey_part)
+			return false;
+		/* An extent: the number of offsets followed by them. */
+		uint64_t pos = -(int64_t)offset;
+		if (pos % sizeof(uint32_t) != 0)
+			return false;
+		pos /= sizeof(uint32_t);
+		if (pos <= slot_count || pos > word_count)
+			return false;
+		const uint32_t *extent = field_map - pos;
+		if (extent[0] >= pos - slot_count)
+			return false;
+		for (uint32_t i = 1; i <= extent[0]; i++) {
+			if (extent[i] >= data_size)
+				return false;
+		}
+	}
+	return true;
+}
+
 /**
  * Create a statement without type and with reserved space for operations.
  * Operations can be saved in the space available by @param extra.
@@ -301,7 +346,8 @@ vy_key_dup(const char *key)
 static struct tuple *
 vy_stmt_new_with_ops(struct tuple_format *format, const char *tuple_begin,
 		     const char *tuple_end, struct iovec *ops,
-		     int op_count, enum iproto_type type)
+		     int op_count, enum iproto_type type,
+		     const char *field_map)
 {
 	mp_tuple_assert(tuple_begin, tuple_end);
 
@@ -327,11 +373,24 @@ vy_stmt_new_with_ops(struct tuple_format *format, const char *tuple_begin,
 	 * a run so we skip tuple validation here. This is OK as
 	 * tuples inserted into a space are validated explicitly
 	 * with tuple_validate() anyway.
+	 *
+	 * If the field map was stored along with the statement,
+	 * use it instead of parsing the tuple, but check that it
+	 * can't make us read beyond the statement.
 	 */
 	struct field_map_builder builder;
-	if (tuple_field_map_create(format, tuple_begin, false, &builder) != 0)
-		goto end;
-	uint32_t field_map_size = field_map_build_size(&builder);
+	uint32_t field_map_size = 0;
+	if (field_map != NULL) {
+		field_map_size = mp_load_u32(&field_map) * sizeof(uint32_t);
+		if (field_map_size < format->field_map_size)
+			field_map = NULL;
+	}
+	if (field_map == NULL) {
+		if (tuple_field_map_create(format, tuple_begin, false,
+					   &builder) != 0)
+			goto end;
+		field_map_size = field_map_build_size(&builder);
+	}
 	/*
 	 * Allocate stmt. Offsets: one per key part + offset of the
 	 * statement end.
@@ -345,7 +404,21 @@ vy_stmt_new_with_ops(struct tuple_format *format, const char *tuple_begin,
 	/* Copy MsgPack data */
 	char *raw = (char *) tuple_data(stmt);
 	char *wpos = raw;
-	field_map_build(&builder, wpos - field_map_size);
+	if (field_map != NULL) {
+		uint32_t *words = (uint32_t *)(wpos - field_map_size);
+		for (uint32_t i = 0; i < field_map_size / sizeof(uint32_t); i++)
+			words[i] = mp_load_u32(&field_map);
+		if (!vy_stmt_field_map_is_valid(format, (uint32_t *)wpos,
+						field_map_size, mpsize)) {
+			diag_set(ClientError, ER_INVALID_RUN_FILE,
+				 "Invalid field map");
+			tuple_unref(stmt);
+			stmt = NULL;
+			goto end;
+		}
+	} else {
+		field_map_build(&builder, wpos - field_map_size);
+	}
 	memcpy(wpos, tuple_begin, mpsize);
 	wpos += mpsize;
 	for (struct iovec *op = ops, *end = ops + op_count;
@@ -365,7 +438,7 @@ vy_stmt_new_upsert(struct tuple_format *format, const char *tuple_begin,
 		   uint32_t ops_cnt)
 {
 	return vy_stmt_new_with_ops(format, tuple_begin, tuple_end,
-				    operations, ops_cnt, IPROTO_UPSERT);
+				    operations, ops_cnt, IPROTO_UPSERT, NULL);
 }
 
 struct tuple *
@@ -373,7 +446,7 @@ vy_stmt_new_replace(struct tuple_format *format, const char *tuple_begin,
 		    const char *tuple_end)
 {
 	return vy_stmt_new_with_ops(format, tuple_begin, tuple_end,
-				    NULL, 0, IPROTO_REPLACE);
+				    NULL, 0, IPROTO_REPLACE, NULL);
 }
 
 struct tuple *
@@ -381,7 +454,7 @@ vy_stmt_new_insert(struct tuple_format *format, const char *tuple_begin,
 		   const char *tuple_end)
 {
 	return vy_stmt_new_with_ops(format, tuple_begin, tuple_end,
-				    NULL, 0, IPROTO_INSERT);
+				    NULL, 0, IPROTO_INSERT, NULL);
 }
 
 struct tuple *
@@ -389,7 +462,7 @@ vy_stmt_new_delete(struct tuple_format *format, const char *tuple_begin,
 		   const char *tuple_end)
 {
 	return vy_stmt_new_with_ops(format, tuple_begin, tuple_end,
-				    NULL, 0, IPROTO_DELETE);
+				    NULL, 0, IPROTO_DELETE, NULL);
 }
 
 struct tuple *
@@ -708,7 +781,8 @@ vy_stmt_encode_secondary(struct tuple *value, struct key_def *cmp_def,
 }
 
 struct tuple *
-vy_stmt_decode(struct xrow_header *xrow, struct tuple_format *format)
+vy_stmt_decode(struct xrow_header *xrow, struct tuple_format *format,
+	       const char *field_map)
 {
 	struct vy_stmt_env *env = format->engine;
 	struct request request;
@@ -723,19 +797,20 @@ vy_stmt_decode(struct xrow_header *xrow, struct tuple_format *format)
 		/* Always use key format for DELETE statements. */
 		stmt = vy_stmt_new_with_ops(env->key_format,
 					    request.key, request.key_end,
-					    NULL, 0, IPROTO_DELETE);
+					    NULL, 0, IPROTO_DELETE, NULL);
 		break;
 	case IPROTO_INSERT:
 	case IPROTO_REPLACE:
 		stmt = vy_stmt_new_with_ops(format, request.tuple,
 					    request.tuple_end,
-					    NULL, 0, request.type);
+					    NULL, 0, request.type, field_map);
 		break;
 	case IPROTO_UPSERT:
 		ops.iov_base = (char *)request.ops;
 		ops.iov_len = request.ops_end - request.ops;
-		stmt = vy_stmt_new_upsert(format, request.tuple,
-					  request.tuple_end, &ops, 1);
+		stmt = vy_stmt_new_with_ops(format, request.tuple,
+					    request.tuple_end, &ops, 1,
+					    IPROTO_UPSERT, field_map);
 		break;
 	default:
 		/* TODO: report filename. */
@@ -668,11 +668,17 @@ vy_stmt_encode_secondary(struct tuple *value, struct key_def *cmp_def,
 /**
  * Reconstruct vinyl tuple info and data from xrow
  *
+ * If @a field_map is not NULL, it points to the field map of
+ * the statement stored in a run page (the number of 32-bit
+ * words followed by the words, see VY_FIELD_MAP_DATA),
+ * which is used instead of parsing the statement.
+ *
  * @retval stmt on success
  * @retval NULL on error
  */
 struct tuple *
-vy_stmt_decode(struct xrow_header *xrow, struct tuple_format *format);
+vy_stmt_decode(struct xrow_header *xrow, struct tuple_format *format,
+	       const char *field_map);
 
 /**
  * Format a statement into string.
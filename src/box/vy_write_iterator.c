@@ -34,8 +34,8 @@
 #include "vy_upsert.h"
 #include "fiber.h"
 
-#define HEAP_FORWARD_DECLARATION
-#include "salad/heap.h"
+#define LOSER_TREE_FORWARD_DECLARATION
+#include "salad/loser_tree.h"
 
 /**
  * Merge source of a write iterator. Represents a mem or a run.
@@ -43,21 +43,10 @@
 struct vy_write_src {
 	/* Link in vy_write_iterator::src_list */
 	struct rlist in_src_list;
-	/* Node in vy_write_iterator::src_heap */
-	struct heap_node heap_node;
+	/* Node in vy_write_iterator::src_tree */
+	struct loser_tree_node tree_node;
 	/* Current tuple in the source (with minimal key and maximal LSN) */
 	struct vy_entry entry;
-	/**
-	 * If this flag is set, this is a so called "virtual"
-	 * source. A virtual source does not stand for any mem or
-	 * run, but represents a delimiter between the current key
-	 * and the next one. There is a special rule used by the
-	 * write iterator heap when comparing with a virtual
-	 * source. Such source is greater than any source with
-	 * the same key and less than any source with a greater
-	 * key, regardless of LSN.
-	 */
-	bool is_end_of_key;
 	/** An iterator over the source */
 	union {
 		struct vy_slice_stream slice_stream;
@@ -67,13 +56,14 @@ struct vy_write_src {
 };
 
 static bool
-heap_less(heap_t *heap, struct vy_write_src *src1, struct vy_write_src *src2);
+tree_less(loser_tree_t *tree, struct vy_write_src *src1,
+	  struct vy_write_src *src2);
 
-#define HEAP_NAME vy_source_heap
-#define HEAP_LESS heap_less
-#define heap_value_t struct vy_write_src
-#define heap_value_attr heap_node
-#include "salad/heap.h"
+#define LOSER_TREE_NAME vy_source_tree
+#define LOSER_TREE_LESS tree_less
+#define loser_tree_value_t struct vy_write_src
+#define loser_tree_value_attr tree_node
+#include "salad/loser_tree.h"
 
 /**
  * A sequence of versions of a key, sorted by LSN in ascending order.
@@ -166,8 +156,12 @@ struct vy_write_iterator {
 	struct vy_stmt_stream base;
 	/* List of all sources of the iterator */
 	struct rlist src_list;
-	/* A heap to order the sources, newest LSN at heap top. */
-	heap_t src_heap;
+	/*
+	 * A tournament tree to order the sources, newest LSN at
+	 * the top. Advancing the top source costs log2(k)
+	 * comparisons, which matters for compaction of many runs.
+	 */
+	loser_tree_t src_tree;
 	/** Index key definition used to store statements on disk. */
 	struct key_def *cmp_def;
 	/* There is no LSM tree level older than the one we're writing to. */
@@ -216,26 +210,22 @@ struct vy_write_iterator {
 };
 
 /**
- * Comparator of the heap. Put newer LSNs first, unless
- * it's a virtual source (is_end_of_key).
+ * Comparator of the tree. Put newer LSNs first.
  */
 static bool
-heap_less(heap_t *heap, struct vy_write_src *src1, struct vy_write_src *src2)
+tree_less(loser_tree_t *tree, struct vy_write_src *src1,
+	  struct vy_write_src *src2)
 {
 	struct vy_write_iterator *stream =
-		container_of(heap, struct vy_write_iterator, src_heap);
+		container_of(tree, struct vy_write_iterator, src_tree);
 
 	int cmp = vy_entry_compare(src1->entry, src2->entry, stream->cmp_def);
 	if (cmp != 0)
 		return cmp < 0;
 
-	/**
-	 * Keys are equal, order by LSN, descending.
-	 * Virtual sources use 0 for LSN, so they are ordered
-	 * last automatically.
-	 */
-	int64_t lsn1 = src1->is_end_of_key  ? 0 : vy_stmt_lsn(src1->entry.stmt);
-	int64_t lsn2 = src2->is_end_of_key  ? 0 : vy_stmt_lsn(src2->entry.stmt);
+	/** Keys are equal, order by LSN, descending. */
+	int64_t lsn1 = vy_stmt_lsn(src1->entry.stmt);
+	int64_t lsn2 = vy_stmt_lsn(src2->entry.stmt);
 	if (lsn1 != lsn2)
 		return lsn1 > lsn2;
 
@@ -265,9 +255,8 @@ vy_write_iterator_new_src(struct vy_write_iterator *stream)
 			 "malloc", "vinyl write stream");
 		return NULL;
 	}
-	heap_node_create(&res->heap_node);
+	loser_tree_node_create(&res->tree_node);
 	res->entry = vy_entry_none();
-	res->is_end_of_key = false;
 	rlist_add(&stream->src_list, &res->in_src_list);
 	return res;
 }
@@ -279,7 +268,6 @@ vy_write_iterator_delete_src(struct vy_write_iterator *stream,
 			     struct vy_write_src *src)
 {
 	(void)stream;
-	assert(!src->is_end_of_key);
 	if (src->stream.iface->close != NULL)
 		src->stream.iface->close(&src->stream);
 	rlist_del(&src->in_src_list);
@@ -288,7 +276,7 @@ vy_write_iterator_delete_src(struct vy_write_iterator *stream,
 
 /**
  * Start iteration in the given source, retrieve the first tuple,
- * and add the source to the write iterator heap.
+ * and add the source to the write iterator tree.
  *
  * @return 0 - success, not 0 - error.
  */
@@ -305,10 +293,10 @@ vy_write_iterator_add_src(struct vy_write_iterator *stream,
 	if (rc != 0 || src->entry.stmt == NULL)
 		goto stop;
 
-	rc = vy_source_heap_insert(&stream->src_heap, src);
+	rc = vy_source_tree_insert(&stream->src_tree, src);
 	if (rc != 0) {
 		diag_set(OutOfMemory, sizeof(void *),
-			 "malloc", "vinyl write stream heap");
+			 "malloc", "vinyl write stream tree");
 		goto stop;
 	}
 	return 0;
@@ -319,15 +307,15 @@ stop:
 }
 
 /**
- * Remove a source from the heap and stop iteration.
+ * Remove a source from the tree and stop iteration.
  */
 static void
 vy_write_iterator_remove_src(struct vy_write_iterator *stream,
 			   struct vy_write_src *src)
 {
-	if (heap_node_is_stray(&src->heap_node))
+	if (loser_tree_node_is_stray(&src->tree_node))
 		return; /* already removed */
-	vy_source_heap_delete(&stream->src_heap, src);
+	vy_source_tree_delete(&stream->src_tree, src);
 	if (src->stream.iface->stop != NULL)
 		src->stream.iface->stop(&src->stream);
 }
@@ -380,7 +368,7 @@ vy_write_iterator_new(struct key_def *cmp_def, bool is_primary,
 	assert(count == 0);
 
 	stream->base.iface = &vy_slice_stream_iface;
-	vy_source_heap_create(&stream->src_heap);
+	vy_source_tree_create(&stream->src_tree);
 	rlist_create(&stream->src_list);
 	stream->cmp_def = cmp_def;
 	stream->is_primary = is_primary;
@@ -462,7 +450,7 @@ vy_write_iterator_close(struct vy_stmt_stream *vstream)
 	struct vy_write_src *src, *tmp;
 	rlist_foreach_entry_safe(src, &stream->src_list, in_src_list, tmp)
 		vy_write_iterator_delete_src(stream, src);
-	vy_source_heap_destroy(&stream->src_heap);
+	vy_source_tree_destroy(&stream->src_tree);
 	free(stream);
 }
 
@@ -506,13 +494,13 @@ vy_write_iterator_new_slice(struct vy_stmt_stream *vstream,
 static NODISCARD int
 vy_write_iterator_merge_step(struct vy_write_iterator *stream)
 {
-	struct vy_write_src *src = vy_source_heap_top(&stream->src_heap);
+	struct vy_write_src *src = vy_source_tree_top(&stream->src_tree);
 	assert(src != NULL);
 	int rc = src->stream.iface->next(&src->stream, &src->entry);
 	if (rc != 0)
 		return rc;
 	if (src->entry.stmt != NULL)
-		vy_source_heap_update(&stream->src_heap, src);
+		vy_source_tree_update(&stream->src_tree, src);
 	else
 		vy_write_iterator_remove_src(stream, src);
 	return 0;
@@ -673,30 +661,20 @@ vy_write_iterator_build_history(struct vy_write_iterator *stream,
 	*is_first_insert = false;
 	assert(stream->stmt_i == -1);
 	assert(stream->deferred_delete.stmt == NULL);
-	struct vy_write_src *src = vy_source_heap_top(&stream->src_heap);
+	struct vy_write_src *src = vy_source_tree_top(&stream->src_tree);
 	if (src == NULL)
 		return 0; /* no more data */
 	/* Search must have been started already. */
 	assert(src->entry.stmt != NULL);
 	/*
-	 * A virtual source instance which represents the end on
-	 * the current key in the source heap. It is greater
-	 * than any statement on the current key and less than
-	 * any statement on the next key.
-	 * The moment we get this source from the heap we know
-	 * that there are no statements that there are no more
-	 * statements for the current key.
+	 * The current key. The moment the top source has
+	 * a different key we know that there are no more
+	 * statements for the current key: the tree puts all
+	 * versions of a key before the next key.
 	 */
-	struct vy_write_src end_of_key_src;
-	end_of_key_src.is_end_of_key = true;
-	end_of_key_src.entry = src->entry;
-	int rc = vy_source_heap_insert(&stream->src_heap, &end_of_key_src);
-	if (rc) {
-		diag_set(OutOfMemory, sizeof(void *),
-			 "malloc", "vinyl write stream heap");
-		return rc;
-	}
-	vy_stmt_ref_if_possible(src->entry.stmt);
+	struct vy_entry key = src->entry;
+	vy_stmt_ref_if_possible(key.stmt);
+	int rc = 0;
 	/*
 	 * For each pair (merge_until_lsn, current_rv_lsn] build
 	 * a history in the corresponding read view.
@@ -792,11 +770,11 @@ next_lsn:
 		rc = vy_write_iterator_merge_step(stream);
 		if (rc != 0)
 			break;
-		src = vy_source_heap_top(&stream->src_heap);
-		assert(src != NULL);
-		assert(src->entry.stmt != NULL);
-		if (src->is_end_of_key)
+		src = vy_source_tree_top(&stream->src_tree);
+		if (src == NULL ||
+		    vy_entry_compare(src->entry, key, stream->cmp_def) != 0)
 			break;
+		assert(src->entry.stmt != NULL);
 	}
 
 	/*
@@ -810,8 +788,7 @@ next_lsn:
 		stream->deferred_delete = vy_entry_none();
 	}
 
-	vy_source_heap_delete(&stream->src_heap, &end_of_key_src);
-	vy_stmt_unref_if_possible(end_of_key_src.entry.stmt);
+	vy_stmt_unref_if_possible(key.stmt);
 	return rc;
 }
 
@@ -1106,7 +1083,7 @@ vy_write_iterator_next(struct vy_stmt_stream *vstream, struct vy_entry *ret)
 		 * DELETE or it consisted only from optimized
 		 * updates. Then try to get the next key.
 		 */
-		if (count != 0 || stream->src_heap.size == 0)
+		if (count != 0 || stream->src_tree.size == 0)
 			break;
 	}
 	/* Again try to get the statement, after calling next_key(). */
@@ -43,6 +43,10 @@
 #include "cbus.h"
 #include "coio_task.h"
 #include "replication.h"
+#include "latency.h"
+#include "clock.h"
+#include "trace.h"
+#include "info/info.h"
 
 enum {
 	/**
@@ -167,6 +171,14 @@ struct wal_writer
 	 * Used for replication relays.
 	 */
 	struct rlist watchers;
+	/**
+	 * Time a batch waits in the queue to the WAL thread.
+	 * Collected in the WAL thread and read by tx without
+	 * synchronization.
+	 */
+	struct latency queue_latency;
+	/** Time it takes to write a batch to disk. */
+	struct latency write_latency;
 };
 
 struct wal_msg {
@@ -182,6 +194,14 @@ struct wal_msg {
 	struct stailq rollback;
 	/** vclock after the batch processed. */
 	struct vclock vclock;
+	/** When the batch was created, in clock_ticks(). */
+	uint64_t start_ticks;
+	/**
+	 * When the WAL thread started and finished writing
+	 * the batch.
+	 */
+	uint64_t write_start_ticks;
+	uint64_t write_end_ticks;
 };
 
 /**
@@ -220,6 +240,9 @@ wal_msg_create(struct wal_msg *batch)
 	stailq_create(&batch->commit);
 	stailq_create(&batch->rollback);
 	vclock_create(&batch->vclock);
+	batch->start_ticks = clock_ticks();
+	batch->write_start_ticks = 0;
+	batch->write_end_ticks = 0;
 }
 
 static struct wal_msg *
@@ -363,6 +386,13 @@ tx_complete_batch(struct cmsg *msg)
 	}
 	/* Update the tx vclock to the latest written by wal. */
 	vclock_copy(&replicaset.vclock, &batch->vclock);
+	if (unlikely(trace_is_enabled())) {
+		struct journal_entry *entry;
+		stailq_foreach_entry(entry, &batch->commit, fifo) {
+			entry->write_start_ticks = batch->write_start_ticks;
+			entry->write_end_ticks = batch->write_end_ticks;
+		}
+	}
 	tx_schedule_queue(&batch->commit);
 	mempool_free(&writer->msg_pool, container_of(msg, struct wal_msg, base));
 }
@@ -443,6 +473,10 @@ wal_writer_create(struct wal_writer *writer, enum wal_mode wal_mode,
 
 	mempool_create(&writer->msg_pool, &cord()->slabc,
 		       sizeof(struct wal_msg));
+
+	if (latency_create(&writer->queue_latency) != 0 ||
+	    latency_create(&writer->write_latency) != 0)
+		panic("failed to allocate WAL latency statistics");
 }
 
 /** Destroy a WAL writer structure. */
@@ -450,6 +484,8 @@ static void
 wal_writer_destroy(struct wal_writer *writer)
 {
 	xdir_destroy(&writer->wal_dir);
+	latency_destroy(&writer->queue_latency);
+	latency_destroy(&writer->write_latency);
 }
 
 /** WAL writer thread routine. */
@@ -587,6 +623,42 @@ wal_free(void)
 	wal_writer_destroy(writer);
 }
 
+void
+wal_latency_stat(struct info_handler *h)
+{
+	struct wal_writer *writer = &wal_writer_singleton;
+	info_table_begin(h, "WAL");
+	latency_info_append(h, "queue", &writer->queue_latency);
+	latency_info_append(h, "write", &writer->write_latency);
+	info_table_end(h);
+}
+
+static int
+wal_reset_stat_f(struct cbus_call_msg *msg)
+{
+	(void)msg;
+	struct wal_writer *writer = &wal_writer_singleton;
+	latency_reset(&writer->queue_latency);
+	latency_reset(&writer->write_latency);
+	return 0;
+}
+
+void
+wal_reset_stat(void)
+{
+	struct wal_writer *writer = &wal_writer_singleton;
+	/*
+	 * The histograms are updated by the WAL thread, so
+	 * reset them there. The call can't fail, as the timeout
+	 * is infinite and the fiber can't be cancelled.
+	 */
+	struct cbus_call_msg msg;
+	bool cancellable = fiber_set_cancellable(false);
+	cbus_call(&writer->wal_pipe, &writer->tx_prio_pipe, &msg,
+		  wal_reset_stat_f, NULL, TIMEOUT_INFINITY);
+	fiber_set_cancellable(cancellable);
+}
+
 struct wal_vclock_msg {
     struct cbus_call_msg base;
     struct vclock vclock;
@@ -1010,6 +1082,14 @@ wal_write_to_disk(struct cmsg *msg)
 	struct vclock vclock_diff;
 	vclock_create(&vclock_diff);
 
+	uint64_t start_ticks = clock_ticks();
+	wal_msg->write_start_ticks = start_ticks;
+	if (start_ticks > wal_msg->start_ticks) {
+		latency_collect(&writer->queue_latency,
+				clock_ticks_to_sec(start_ticks -
+						   wal_msg->start_ticks));
+	}
+
 	ERROR_INJECT_SLEEP(ERRINJ_WAL_DELAY);
 
 	if (writer->is_in_rollback) {
@@ -1081,6 +1161,14 @@ wal_write_to_disk(struct cmsg *msg)
 	if (rc < 0)
 		goto done;
 
+	/*
+	 * With wal_mode = 'fsync' the file is opened with O_SYNC,
+	 * so this includes syncing the data to disk.
+	 */
+	wal_msg->write_end_ticks = clock_ticks();
+	latency_collect(&writer->write_latency,
+			clock_ticks_to_sec(wal_msg->write_end_ticks -
+					   start_ticks));
 	writer->checkpoint_wal_size += rc;
 	last_committed = stailq_last(&wal_msg->commit);
 	vclock_merge(&writer->vclock, &vclock_diff);
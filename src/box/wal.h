@@ -179,6 +179,20 @@ wal_atfork();
 enum wal_mode
 wal_mode();
 
+struct info_handler;
+
+/**
+ * Append WAL latency percentiles to an info handler: the time
+ * a batch of transactions waits for the WAL thread and the time
+ * it takes to write it to disk.
+ */
+void
+wal_latency_stat(struct info_handler *h);
+
+/** Reset WAL latency statistics. */
+void
+wal_reset_stat(void);
+
 /**
  * Wait until all submitted writes are successfully flushed
  * to disk. Returns 0 on success, -1 if write failed.
@@ -321,6 +321,58 @@ xlog_meta_parse(struct xlog_meta *meta, const char **data,
 	return 0;
 }
 
+int
+xlog_meta_rewrite_instance_uuid(const char *filename,
+				const struct tt_uuid *instance_uuid)
+{
+	int fd = open(filename, O_RDWR);
+	if (fd < 0) {
+		diag_set(SystemError, "failed to open file '%s'", filename);
+		return -1;
+	}
+	char buf[XLOG_META_LEN_MAX];
+	ssize_t len = pread(fd, buf, sizeof(buf), 0);
+	if (len < 0) {
+		diag_set(SystemError, "failed to read file '%s'", filename);
+		goto fail;
+	}
+	const char *end = (const char *)memmem(buf, len, "\n\n", 2);
+	if (end == NULL) {
+		diag_set(XlogError, "%s: failed to parse xlog meta", filename);
+		goto fail;
+	}
+	/*
+	 * The UUID has a fixed length so it can be replaced
+	 * without moving the rest of the file.
+	 */
+	static const char key[] = "\n" INSTANCE_UUID_KEY ": ";
+	const char *pos = (const char *)memmem(buf, end - buf,
+					       key, strlen(key));
+	if (pos == NULL) {
+		/* No instance UUID in the file. */
+		close(fd);
+		return 0;
+	}
+	pos += strlen(key);
+	if (end - pos < UUID_STR_LEN || pos[UUID_STR_LEN] != '\n') {
+		diag_set(XlogError, "%s: can't parse instance UUID", filename);
+		goto fail;
+	}
+	if (pwrite(fd, tt_uuid_str(instance_uuid), UUID_STR_LEN,
+		   pos - buf) != UUID_STR_LEN) {
+		diag_set(SystemError, "failed to write file '%s'", filename);
+		goto fail;
+	}
+	if (close(fd) != 0) {
+		diag_set(SystemError, "failed to close file '%s'", filename);
+		return -1;
+	}
+	return 0;
+fail:
+	close(fd);
+	return -1;
+}
+
 /* struct xlog }}} */
 
 /* {{{ struct xdir */
@@ -1413,7 +1465,8 @@ xlog_sync(struct xlog *l)
 			say_syserror("%s: dup() failed", l->filename);
 			return -1;
 		}
-		eio_fsync(fd, 0, sync_cb, (void *) (intptr_t) fd);
+		/* Don't let WAL wait behind user file I/O. */
+		eio_fsync(fd, EIO_PRI_MAX, sync_cb, (void *) (intptr_t) fd);
 	} else if (fsync(l->fd) < 0) {
 		say_syserror("%s: fsync failed", l->filename);
 		return -1;
@@ -1943,6 +1996,15 @@ xlog_cursor_next(struct xlog_cursor *cursor,
 	return 0;
 }
 
+void
+xlog_cursor_reset(struct xlog_cursor *cursor, off_t pos)
+{
+	assert(cursor->state == XLOG_CURSOR_ACTIVE);
+	assert(cursor->fd >= 0);
+	ibuf_reset(&cursor->rbuf);
+	cursor->read_offset = pos;
+}
+
 int
 xlog_cursor_openfd(struct xlog_cursor *i, int fd, const char *name)
 {
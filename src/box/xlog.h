@@ -325,6 +325,18 @@ xlog_meta_create(struct xlog_meta *meta, const char *filetype,
 		 const struct vclock *vclock,
 		 const struct vclock *prev_vclock);
 
+/**
+ * Replace the instance UUID stored in the meta of file
+ * @a filename in place. A file without instance UUID is
+ * left intact.
+ *
+ * @retval 0 success
+ * @retval -1 error, check diag
+ */
+int
+xlog_meta_rewrite_instance_uuid(const char *filename,
+				const struct tt_uuid *instance_uuid);
+
 /* }}} */
 
 /**
@@ -797,6 +809,18 @@ xlog_cursor_tx_pos(struct xlog_cursor *cursor)
 {
 	return xlog_tx_cursor_pos(&cursor->tx_cursor);
 }
+
+/**
+ * Reposition a cursor at the given file offset, which must be
+ * a tx boundary, e.g. one returned by xlog_cursor_pos() of
+ * another cursor reading the same file. The cursor must not
+ * be inside a tx. Buffered data is discarded.
+ *
+ * @param cursor xlog cursor
+ * @param pos file offset to continue reading from
+ */
+void
+xlog_cursor_reset(struct xlog_cursor *cursor, off_t pos);
 /* }}} */
 
 /** {{{ miscellaneous log io functions. */
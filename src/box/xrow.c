@@ -40,10 +40,12 @@
 #include "tt_static.h"
 #include "error.h"
 #include "mp_error.h"
+#include "mp_scan.h"
 #include "vclock.h"
 #include "scramble.h"
 #include "iproto_constants.h"
 #include "mpstream/mpstream.h"
+#include "crc32.h"
 
 static_assert(IPROTO_DATA < 0x7f && IPROTO_METADATA < 0x7f &&
 	      IPROTO_SQL_INFO < 0x7f, "encoded IPROTO_BODY keys must fit into "\
@@ -705,14 +707,14 @@ error:
 	uint32_t size = mp_decode_map(&data);
 	for (uint32_t i = 0; i < size; i++) {
 		if (! iproto_dml_body_has_key(data, end)) {
-			if (mp_check(&data, end) != 0 ||
-			    mp_check(&data, end) != 0)
+			if (mp_scan_check(&data, end) != 0 ||
+			    mp_scan_check(&data, end) != 0)
 				goto error;
 			continue;
 		}
 		uint64_t key = mp_decode_uint(&data);
 		const char *value = data;
-		if (mp_check(&data, end) ||
+		if (mp_scan_check(&data, end) ||
 		    key >= IPROTO_KEY_MAX ||
 		    iproto_key_type[key] != mp_typeof(*value))
 			goto error;
@@ -1223,25 +1225,32 @@ err:
 int
 xrow_encode_register(struct xrow_header *row,
 		     const struct tt_uuid *instance_uuid,
-		     const struct vclock *vclock)
+		     const struct vclock *vclock, bool from_checkpoint)
 {
 	memset(row, 0, sizeof(*row));
-	size_t size = mp_sizeof_map(2) +
+	size_t size = mp_sizeof_map(3) +
 		      mp_sizeof_uint(IPROTO_INSTANCE_UUID) +
 		      mp_sizeof_str(UUID_STR_LEN) +
 		      mp_sizeof_uint(IPROTO_VCLOCK) +
-		      mp_sizeof_vclock_ignore0(vclock);
+		      mp_sizeof_vclock_ignore0(vclock) +
+		      mp_sizeof_uint(IPROTO_FROM_CHECKPOINT) +
+		      mp_sizeof_bool(from_checkpoint);
 	char *buf = (char *) region_alloc(&fiber()->gc, size);
 	if (buf == NULL) {
 		diag_set(OutOfMemory, size, "region_alloc", "buf");
 		return -1;
 	}
 	char *data = buf;
-	data = mp_encode_map(data, 2);
+	/* Older masters don't know the flag, only send it if set. */
+	data = mp_encode_map(data, from_checkpoint ? 3 : 2);
 	data = mp_encode_uint(data, IPROTO_INSTANCE_UUID);
 	data = xrow_encode_uuid(data, instance_uuid);
 	data = mp_encode_uint(data, IPROTO_VCLOCK);
 	data = mp_encode_vclock_ignore0(data, vclock);
+	if (from_checkpoint) {
+		data = mp_encode_uint(data, IPROTO_FROM_CHECKPOINT);
+		data = mp_encode_bool(data, true);
+	}
 	assert(data <= buf + size);
 	row->body[0].iov_base = buf;
 	row->body[0].iov_len = (data - buf);
@@ -1404,7 +1413,8 @@ id_filter_decode_err:		xrow_on_decode_err(data, end, ER_INVALID_MSGPACK,
 }
 
 int
-xrow_encode_join(struct xrow_header *row, const struct tt_uuid *instance_uuid)
+xrow_encode_join(struct xrow_header *row, const struct tt_uuid *instance_uuid,
+		 uint32_t stream_count)
 {
 	memset(row, 0, sizeof(*row));
 
@@ -1415,10 +1425,14 @@ xrow_encode_join(struct xrow_header *row, const struct tt_uuid *instance_uuid)
 		return -1;
 	}
 	char *data = buf;
-	data = mp_encode_map(data, 1);
+	data = mp_encode_map(data, stream_count > 1 ? 2 : 1);
 	data = mp_encode_uint(data, IPROTO_INSTANCE_UUID);
 	/* Greet the remote replica with our replica UUID */
 	data = xrow_encode_uuid(data, instance_uuid);
+	if (stream_count > 1) {
+		data = mp_encode_uint(data, IPROTO_JOIN_STREAMS);
+		data = mp_encode_uint(data, stream_count);
+	}
 	assert(data <= buf + size);
 
 	row->body[0].iov_base = buf;
@@ -1428,6 +1442,442 @@ xrow_encode_join(struct xrow_header *row, const struct tt_uuid *instance_uuid)
 	return 0;
 }
 
+int
+xrow_encode_join_response(struct xrow_header *row, const struct vclock *vclock,
+			  uint32_t stream_count)
+{
+	memset(row, 0, sizeof(*row));
+	size_t size = XROW_BODY_LEN_MAX + mp_sizeof_vclock_ignore0(vclock);
+	char *buf = (char *) region_alloc(&fiber()->gc, size);
+	if (buf == NULL) {
+		diag_set(OutOfMemory, size, "region_alloc", "buf");
+		return -1;
+	}
+	char *data = buf;
+	data = mp_encode_map(data, stream_count > 1 ? 2 : 1);
+	data = mp_encode_uint(data, IPROTO_VCLOCK);
+	data = mp_encode_vclock_ignore0(data, vclock);
+	if (stream_count > 1) {
+		data = mp_encode_uint(data, IPROTO_JOIN_STREAMS);
+		data = mp_encode_uint(data, stream_count);
+	}
+	assert(data <= buf + size);
+	row->body[0].iov_base = buf;
+	row->body[0].iov_len = (data - buf);
+	row->bodycnt = 1;
+	row->type = IPROTO_OK;
+	return 0;
+}
+
+/**
+ * Encode JOIN STREAM row, with the number of rows sent over
+ * the stream unless @a row_count is NULL.
+ */
+static int
+xrow_encode_join_stream_impl(struct xrow_header *row,
+			     const struct tt_uuid *instance_uuid,
+			     uint32_t stream_id, const uint64_t *row_count)
+{
+	memset(row, 0, sizeof(*row));
+	size_t size = XROW_BODY_LEN_MAX;
+	char *buf = (char *) region_alloc(&fiber()->gc, size);
+	if (buf == NULL) {
+		diag_set(OutOfMemory, size, "region_alloc", "buf");
+		return -1;
+	}
+	char *data = buf;
+	data = mp_encode_map(data, row_count != NULL ? 3 : 2);
+	data = mp_encode_uint(data, IPROTO_INSTANCE_UUID);
+	data = xrow_encode_uuid(data, instance_uuid);
+	data = mp_encode_uint(data, IPROTO_JOIN_STREAM_ID);
+	data = mp_encode_uint(data, stream_id);
+	if (row_count != NULL) {
+		data = mp_encode_uint(data, IPROTO_JOIN_STREAM_ROWS);
+		data = mp_encode_uint(data, *row_count);
+	}
+	assert(data <= buf + size);
+	row->body[0].iov_base = buf;
+	row->body[0].iov_len = (data - buf);
+	row->bodycnt = 1;
+	row->type = IPROTO_JOIN_STREAM;
+	return 0;
+}
+
+int
+xrow_encode_join_stream(struct xrow_header *row,
+			const struct tt_uuid *instance_uuid, uint32_t stream_id)
+{
+	return xrow_encode_join_stream_impl(row, instance_uuid, stream_id,
+					    NULL);
+}
+
+int
+xrow_encode_join_stream_rows(struct xrow_header *row,
+			     const struct tt_uuid *instance_uuid,
+			     uint32_t stream_id, uint64_t row_count)
+{
+	return xrow_encode_join_stream_impl(row, instance_uuid, stream_id,
+					    &row_count);
+}
+
+int
+xrow_decode_join_streams(struct xrow_header *row,
+			 struct tt_uuid *instance_uuid, struct vclock *vclock,
+			 uint32_t *stream_id, uint32_t *stream_count,
+			 uint64_t *row_count)
+{
+	if (stream_id != NULL)
+		*stream_id = 0;
+	if (stream_count != NULL)
+		*stream_count = 1;
+	if (row_count != NULL)
+		*row_count = 0;
+	if (row->bodycnt == 0) {
+		diag_set(ClientError, ER_INVALID_MSGPACK, "request body");
+		return -1;
+	}
+	assert(row->bodycnt == 1);
+	const char * const data = (const char *) row->body[0].iov_base;
+	const char *end = data + row->body[0].iov_len;
+	const char *d = data;
+	if (mp_check(&d, end) != 0 || mp_typeof(*data) != MP_MAP) {
+		xrow_on_decode_err(data, end, ER_INVALID_MSGPACK,
+				   "request body");
+		return -1;
+	}
+	d = data;
+	uint32_t map_size = mp_decode_map(&d);
+	for (uint32_t i = 0; i < map_size; i++) {
+		if (mp_typeof(*d) != MP_UINT) {
+			mp_next(&d); /* key */
+			mp_next(&d); /* value */
+			continue;
+		}
+		uint64_t key = mp_decode_uint(&d);
+		switch (key) {
+		case IPROTO_INSTANCE_UUID:
+			if (instance_uuid == NULL)
+				goto skip;
+			if (xrow_decode_uuid(&d, instance_uuid) != 0) {
+				xrow_on_decode_err(data, end, ER_INVALID_MSGPACK,
+						   "UUID");
+				return -1;
+			}
+			break;
+		case IPROTO_VCLOCK:
+			if (vclock == NULL)
+				goto skip;
+			if (mp_decode_vclock_ignore0(&d, vclock) != 0) {
+				xrow_on_decode_err(data, end, ER_INVALID_MSGPACK,
+						   "invalid VCLOCK");
+				return -1;
+			}
+			break;
+		case IPROTO_JOIN_STREAM_ID:
+			if (stream_id == NULL)
+				goto skip;
+			if (mp_typeof(*d) != MP_UINT) {
+				xrow_on_decode_err(data, end, ER_INVALID_MSGPACK,
+						   "invalid JOIN_STREAM_ID");
+				return -1;
+			}
+			*stream_id = mp_decode_uint(&d);
+			break;
+		case IPROTO_JOIN_STREAMS:
+			if (stream_count == NULL)
+				goto skip;
+			if (mp_typeof(*d) != MP_UINT) {
+				xrow_on_decode_err(data, end, ER_INVALID_MSGPACK,
+						   "invalid JOIN_STREAMS");
+				return -1;
+			}
+			*stream_count = mp_decode_uint(&d);
+			if (*stream_count == 0)
+				*stream_count = 1;
+			break;
+		case IPROTO_JOIN_STREAM_ROWS:
+			if (row_count == NULL)
+				goto skip;
+			if (mp_typeof(*d) != MP_UINT) {
+				xrow_on_decode_err(data, end, ER_INVALID_MSGPACK,
+						   "invalid JOIN_STREAM_ROWS");
+				return -1;
+			}
+			*row_count = mp_decode_uint(&d);
+			break;
+		default: skip:
+			mp_next(&d); /* value */
+		}
+	}
+	return 0;
+}
+
+int
+xrow_decode_register(struct xrow_header *row, struct tt_uuid *instance_uuid,
+		     struct vclock *vclock, bool *from_checkpoint)
+{
+	if (xrow_decode_subscribe(row, NULL, instance_uuid, vclock, NULL,
+				  NULL, NULL) != 0)
+		return -1;
+	*from_checkpoint = false;
+	const char *d = (const char *) row->body[0].iov_base;
+	const char *end = d + row->body[0].iov_len;
+	/* The body has been checked by xrow_decode_subscribe(). */
+	uint32_t map_size = mp_decode_map(&d);
+	for (uint32_t i = 0; i < map_size; i++) {
+		if (mp_typeof(*d) != MP_UINT) {
+			mp_next(&d); /* key */
+			mp_next(&d); /* value */
+			continue;
+		}
+		if (mp_decode_uint(&d) != IPROTO_FROM_CHECKPOINT) {
+			mp_next(&d); /* value */
+			continue;
+		}
+		if (mp_typeof(*d) != MP_BOOL) {
+			xrow_on_decode_err(row->body[0].iov_base, end,
+					   ER_INVALID_MSGPACK,
+					   "invalid FROM_CHECKPOINT flag");
+			return -1;
+		}
+		*from_checkpoint = mp_decode_bool(&d);
+	}
+	return 0;
+}
+
+int
+xrow_encode_fetch_checkpoint(struct xrow_header *row,
+			     const struct tt_uuid *instance_uuid,
+			     const struct vclock *vclock,
+			     const char *file_name, uint64_t offset)
+{
+	memset(row, 0, sizeof(*row));
+	size_t size = XROW_BODY_LEN_MAX;
+	if (vclock != NULL)
+		size += mp_sizeof_vclock_ignore0(vclock);
+	if (file_name != NULL)
+		size += mp_sizeof_str(strlen(file_name));
+	char *buf = (char *) region_alloc(&fiber()->gc, size);
+	if (buf == NULL) {
+		diag_set(OutOfMemory, size, "region_alloc", "buf");
+		return -1;
+	}
+	char *data = buf;
+	data = mp_encode_map(data, (instance_uuid != NULL) +
+			     (vclock != NULL) + (file_name != NULL) * 2);
+	if (instance_uuid != NULL) {
+		data = mp_encode_uint(data, IPROTO_INSTANCE_UUID);
+		data = xrow_encode_uuid(data, instance_uuid);
+	}
+	if (vclock != NULL) {
+		data = mp_encode_uint(data, IPROTO_VCLOCK);
+		data = mp_encode_vclock_ignore0(data, vclock);
+	}
+	if (file_name != NULL) {
+		data = mp_encode_uint(data, IPROTO_FILE_NAME);
+		data = mp_encode_str(data, file_name, strlen(file_name));
+		data = mp_encode_uint(data, IPROTO_FILE_OFFSET);
+		data = mp_encode_uint(data, offset);
+	}
+	assert(data <= buf + size);
+	row->body[0].iov_base = buf;
+	row->body[0].iov_len = (data - buf);
+	row->bodycnt = 1;
+	row->type = IPROTO_FETCH_CHECKPOINT;
+	return 0;
+}
+
+int
+xrow_decode_fetch_checkpoint(struct xrow_header *row,
+			     struct tt_uuid *instance_uuid,
+			     struct vclock *vclock,
+			     const char **file_name, uint32_t *file_name_len,
+			     uint64_t *offset)
+{
+	*instance_uuid = uuid_nil;
+	*file_name = NULL;
+	*file_name_len = 0;
+	*offset = 0;
+	if (row->bodycnt == 0)
+		return 0;
+	assert(row->bodycnt == 1);
+	const char * const data = (const char *) row->body[0].iov_base;
+	const char *end = data + row->body[0].iov_len;
+	const char *d = data;
+	if (mp_check(&d, end) != 0 || mp_typeof(*data) != MP_MAP) {
+		xrow_on_decode_err(data, end, ER_INVALID_MSGPACK,
+				   "request body");
+		return -1;
+	}
+	d = data;
+	uint32_t map_size = mp_decode_map(&d);
+	for (uint32_t i = 0; i < map_size; i++) {
+		if (mp_typeof(*d) != MP_UINT) {
+			mp_next(&d); /* key */
+			mp_next(&d); /* value */
+			continue;
+		}
+		uint64_t key = mp_decode_uint(&d);
+		switch (key) {
+		case IPROTO_INSTANCE_UUID:
+			if (xrow_decode_uuid(&d, instance_uuid) != 0) {
+				xrow_on_decode_err(data, end, ER_INVALID_MSGPACK,
+						   "UUID");
+				return -1;
+			}
+			break;
+		case IPROTO_VCLOCK:
+			if (mp_decode_vclock_ignore0(&d, vclock) != 0) {
+				xrow_on_decode_err(data, end, ER_INVALID_MSGPACK,
+						   "invalid VCLOCK");
+				return -1;
+			}
+			break;
+		case IPROTO_FILE_NAME:
+			if (mp_typeof(*d) != MP_STR) {
+				xrow_on_decode_err(data, end, ER_INVALID_MSGPACK,
+						   "invalid FILE_NAME");
+				return -1;
+			}
+			*file_name = mp_decode_str(&d, file_name_len);
+			break;
+		case IPROTO_FILE_OFFSET:
+			if (mp_typeof(*d) != MP_UINT) {
+				xrow_on_decode_err(data, end, ER_INVALID_MSGPACK,
+						   "invalid FILE_OFFSET");
+				return -1;
+			}
+			*offset = mp_decode_uint(&d);
+			break;
+		default:
+			mp_next(&d); /* value */
+		}
+	}
+	return 0;
+}
+
+int
+xrow_encode_checkpoint_files(struct xrow_header *row,
+			     const struct vclock *vclock,
+			     const char *files, size_t files_size)
+{
+	memset(row, 0, sizeof(*row));
+	size_t size = XROW_BODY_LEN_MAX + mp_sizeof_vclock_ignore0(vclock);
+	char *buf = (char *) region_alloc(&fiber()->gc, size);
+	if (buf == NULL) {
+		diag_set(OutOfMemory, size, "region_alloc", "buf");
+		return -1;
+	}
+	char *data = buf;
+	data = mp_encode_map(data, 2);
+	data = mp_encode_uint(data, IPROTO_VCLOCK);
+	data = mp_encode_vclock_ignore0(data, vclock);
+	data = mp_encode_uint(data, IPROTO_DATA);
+	assert(data <= buf + size);
+	row->body[0].iov_base = buf;
+	row->body[0].iov_len = (data - buf);
+	row->body[1].iov_base = (void *) files;
+	row->body[1].iov_len = files_size;
+	row->bodycnt = 2;
+	row->type = IPROTO_OK;
+	return 0;
+}
+
+int
+xrow_encode_file_chunk(struct xrow_header *row, uint64_t offset,
+		       const char *data, uint32_t size)
+{
+	memset(row, 0, sizeof(*row));
+	size_t buf_size = XROW_BODY_LEN_MAX;
+	char *buf = (char *) region_alloc(&fiber()->gc, buf_size);
+	if (buf == NULL) {
+		diag_set(OutOfMemory, buf_size, "region_alloc", "buf");
+		return -1;
+	}
+	char *d = buf;
+	d = mp_encode_map(d, 3);
+	d = mp_encode_uint(d, IPROTO_FILE_OFFSET);
+	d = mp_encode_uint(d, offset);
+	d = mp_encode_uint(d, IPROTO_FILE_CRC32);
+	d = mp_encode_uint(d, crc32_calc(0, data, size));
+	d = mp_encode_uint(d, IPROTO_DATA);
+	d = mp_encode_binl(d, size);
+	assert(d <= buf + buf_size);
+	/* Chunk data is sent as is, without copying. */
+	row->body[0].iov_base = buf;
+	row->body[0].iov_len = (d - buf);
+	row->body[1].iov_base = (void *) data;
+	row->body[1].iov_len = size;
+	row->bodycnt = 2;
+	row->type = IPROTO_OK;
+	return 0;
+}
+
+int
+xrow_decode_file_chunk(struct xrow_header *row, uint64_t *offset,
+		       const char **data, uint32_t *size)
+{
+	if (row->bodycnt == 0) {
+		diag_set(ClientError, ER_INVALID_MSGPACK, "request body");
+		return -1;
+	}
+	assert(row->bodycnt == 1);
+	const char * const body = (const char *) row->body[0].iov_base;
+	const char *end = body + row->body[0].iov_len;
+	const char *d = body;
+	if (mp_check(&d, end) != 0 || mp_typeof(*body) != MP_MAP) {
+		xrow_on_decode_err(body, end, ER_INVALID_MSGPACK,
+				   "packet body");
+		return -1;
+	}
+	bool has_offset = false, has_crc32 = false;
+	uint64_t crc32 = 0;
+	*data = NULL;
+	*size = 0;
+	d = body;
+	uint32_t map_size = mp_decode_map(&d);
+	for (uint32_t i = 0; i < map_size; i++) {
+		if (mp_typeof(*d) != MP_UINT) {
+			mp_next(&d); /* key */
+			mp_next(&d); /* value */
+			continue;
+		}
+		uint64_t key = mp_decode_uint(&d);
+		switch (key) {
+		case IPROTO_FILE_OFFSET:
+			if (mp_typeof(*d) != MP_UINT)
+				goto err;
+			*offset = mp_decode_uint(&d);
+			has_offset = true;
+			break;
+		case IPROTO_FILE_CRC32:
+			if (mp_typeof(*d) != MP_UINT)
+				goto err;
+			crc32 = mp_decode_uint(&d);
+			has_crc32 = true;
+			break;
+		case IPROTO_DATA:
+			if (mp_typeof(*d) != MP_BIN)
+				goto err;
+			*data = mp_decode_bin(&d, size);
+			break;
+		default:
+			mp_next(&d); /* value */
+		}
+	}
+	if (!has_offset || !has_crc32 || *data == NULL)
+		goto err;
+	if (crc32_calc(0, *data, *size) != crc32) {
+		diag_set(ClientError, ER_PROTOCOL,
+			 "checkpoint file chunk checksum mismatch");
+		return -1;
+	}
+	return 0;
+err:
+	xrow_on_decode_err(body, end, ER_INVALID_MSGPACK, "file chunk");
+	return -1;
+}
+
 int
 xrow_encode_vclock(struct xrow_header *row, const struct vclock *vclock)
 {
@@ -306,6 +306,8 @@ xrow_encode_vote(struct xrow_header *row);
  * @param[out] Row.
  * @param instance_uuid Instance uuid.
  * @param vclock Replication clock.
+ * @param from_checkpoint Whether the instance was bootstrapped
+ *        from checkpoint files of the master.
  *
  * @retval 0 Success.
  * @retval -1 Memory error.
@@ -313,7 +315,7 @@ xrow_encode_vote(struct xrow_header *row);
 int
 xrow_encode_register(struct xrow_header *row,
 		     const struct tt_uuid *instance_uuid,
-		     const struct vclock *vclock);
+		     const struct vclock *vclock, bool from_checkpoint);
 
 /**
  * Encode SUBSCRIBE command.
@@ -359,26 +361,146 @@ xrow_decode_subscribe(struct xrow_header *row, struct tt_uuid *replicaset_uuid,
  * Encode JOIN command.
  * @param[out] row Row to encode into.
  * @param instance_uuid.
+ * @param stream_count Number of data streams to request.
  *
  * @retval  0 Success.
  * @retval -1 Memory error.
  */
 int
-xrow_encode_join(struct xrow_header *row, const struct tt_uuid *instance_uuid);
+xrow_encode_join(struct xrow_header *row, const struct tt_uuid *instance_uuid,
+		 uint32_t stream_count);
+
+/**
+ * Decode a request or a response of a parallel JOIN. Any of
+ * the output arguments may be NULL.
+ * @param row Row to decode.
+ * @param[out] instance_uuid Instance uuid, not set if absent.
+ * @param[out] vclock Vclock, not set if absent.
+ * @param[out] stream_id Stream number, 0 if absent.
+ * @param[out] stream_count Number of streams, 1 if absent.
+ * @param[out] row_count Number of rows sent over a stream,
+ *             0 if absent.
+ *
+ * @retval  0 Success.
+ * @retval -1 Memory or format error.
+ */
+int
+xrow_decode_join_streams(struct xrow_header *row,
+			 struct tt_uuid *instance_uuid, struct vclock *vclock,
+			 uint32_t *stream_id, uint32_t *stream_count,
+			 uint64_t *row_count);
 
 /**
  * Decode JOIN command.
  * @param row Row to decode.
  * @param[out] instance_uuid.
+ * @param[out] stream_count Number of data streams requested.
  *
  * @retval  0 Success.
  * @retval -1 Memory or format error.
  */
 static inline int
-xrow_decode_join(struct xrow_header *row, struct tt_uuid *instance_uuid)
+xrow_decode_join(struct xrow_header *row, struct tt_uuid *instance_uuid,
+		 uint32_t *stream_count)
 {
-	return xrow_decode_subscribe(row, NULL, instance_uuid, NULL, NULL, NULL,
-				     NULL);
+	return xrow_decode_join_streams(row, instance_uuid, NULL, NULL,
+					stream_count, NULL);
+}
+
+/**
+ * Encode a response to JOIN command.
+ * @param[out] row Row to encode into.
+ * @param vclock Vclock of the read view sent to the replica.
+ * @param stream_count Number of data streams granted.
+ *
+ * @retval  0 Success.
+ * @retval -1 Memory error.
+ */
+int
+xrow_encode_join_response(struct xrow_header *row, const struct vclock *vclock,
+			  uint32_t stream_count);
+
+/**
+ * Decode a response to JOIN command.
+ * @param row Row to decode.
+ * @param[out] vclock Vclock of the read view.
+ * @param[out] stream_count Number of data streams granted.
+ *
+ * @retval  0 Success.
+ * @retval -1 Memory or format error.
+ */
+static inline int
+xrow_decode_join_response(struct xrow_header *row, struct vclock *vclock,
+			  uint32_t *stream_count)
+{
+	return xrow_decode_join_streams(row, NULL, vclock, NULL, stream_count,
+					NULL);
+}
+
+/**
+ * Encode JOIN STREAM command, which opens an extra data stream
+ * of a parallel JOIN.
+ * @param[out] row Row to encode into.
+ * @param instance_uuid Uuid of the joining instance.
+ * @param stream_id Stream number.
+ *
+ * @retval  0 Success.
+ * @retval -1 Memory error.
+ */
+int
+xrow_encode_join_stream(struct xrow_header *row,
+			const struct tt_uuid *instance_uuid, uint32_t stream_id);
+
+/**
+ * Decode JOIN STREAM command.
+ * @param row Row to decode.
+ * @param[out] instance_uuid Uuid of the joining instance.
+ * @param[out] stream_id Stream number.
+ *
+ * @retval  0 Success.
+ * @retval -1 Memory or format error.
+ */
+static inline int
+xrow_decode_join_stream(struct xrow_header *row, struct tt_uuid *instance_uuid,
+			uint32_t *stream_id)
+{
+	return xrow_decode_join_streams(row, instance_uuid, NULL, stream_id,
+					NULL, NULL);
+}
+
+/**
+ * Encode JOIN STREAM row the master sends over the JOIN
+ * connection to tell how many rows it has sent over an extra
+ * stream.
+ * @param[out] row Row to encode into.
+ * @param instance_uuid Uuid of the joining instance.
+ * @param stream_id Stream number.
+ * @param row_count Number of rows sent over the stream.
+ *
+ * @retval  0 Success.
+ * @retval -1 Memory error.
+ */
+int
+xrow_encode_join_stream_rows(struct xrow_header *row,
+			     const struct tt_uuid *instance_uuid,
+			     uint32_t stream_id, uint64_t row_count);
+
+/**
+ * Decode JOIN STREAM row with the number of rows sent over
+ * an extra stream.
+ * @param row Row to decode.
+ * @param[out] stream_id Stream number.
+ * @param[out] row_count Number of rows sent over the stream.
+ *
+ * @retval  0 Success.
+ * @retval -1 Memory or format error.
+ */
+static inline int
+xrow_decode_join_stream_rows(struct xrow_header *row, uint32_t *stream_id,
+			     uint64_t *row_count)
+{
+	return xrow_decode_join_streams(row, NULL, NULL, stream_id, NULL,
+					row_count);
 }
 
 /**
@@ -386,16 +508,98 @@ xrow_decode_join(struct xrow_header *row, struct tt_uuid *instance_uuid)
  * @param row Row to decode.
  * @param[out] instance_uuid Instance uuid.
  * @param[out] vclock Instance vclock.
+ * @param[out] from_checkpoint Whether the instance was
+ *             bootstrapped from checkpoint files.
  * @retval 0 Success.
  * @retval -1 Memory or format error.
  */
-static inline int
+int
 xrow_decode_register(struct xrow_header *row, struct tt_uuid *instance_uuid,
-		     struct vclock *vclock)
-{
-	return xrow_decode_subscribe(row, NULL, instance_uuid, vclock, NULL,
-				     NULL, NULL);
-}
+		     struct vclock *vclock, bool *from_checkpoint);
+
+/**
+ * Encode FETCH CHECKPOINT command.
+ * @param[out] row Row to encode into.
+ * @param instance_uuid UUID of the fetching instance or NULL.
+ * @param vclock Vclock of the checkpoint to fetch or NULL
+ *               to fetch the last checkpoint.
+ * @param file_name Name of the checkpoint file to fetch or
+ *                  NULL to fetch the list of checkpoint files.
+ * @param offset Offset to fetch the file from.
+ *
+ * @retval  0 Success.
+ * @retval -1 Memory error.
+ */
+int
+xrow_encode_fetch_checkpoint(struct xrow_header *row,
+			     const struct tt_uuid *instance_uuid,
+			     const struct vclock *vclock,
+			     const char *file_name, uint64_t offset);
+
+/**
+ * Decode FETCH CHECKPOINT command.
+ * @param row Row to decode.
+ * @param[out] instance_uuid Instance UUID, nil if absent.
+ * @param[out] vclock Checkpoint vclock, not set if absent.
+ * @param[out] file_name File name, NULL if absent.
+ * @param[out] file_name_len Length of the file name.
+ * @param[out] offset File offset.
+ *
+ * @retval  0 Success.
+ * @retval -1 Memory or format error.
+ */
+int
+xrow_decode_fetch_checkpoint(struct xrow_header *row,
+			     struct tt_uuid *instance_uuid,
+			     struct vclock *vclock,
+			     const char **file_name, uint32_t *file_name_len,
+			     uint64_t *offset);
+
+/**
+ * Encode the list of checkpoint files (a response to FETCH
+ * CHECKPOINT command without a file name).
+ * @param[out] row Row to encode into.
+ * @param vclock Checkpoint vclock.
+ * @param files MsgPack array of [name, size] pairs.
+ * @param files_size Size of @a files.
+ *
+ * @retval  0 Success.
+ * @retval -1 Memory error.
+ */
+int
+xrow_encode_checkpoint_files(struct xrow_header *row,
+			     const struct vclock *vclock,
+			     const char *files, size_t files_size);
+
+/**
+ * Encode a checkpoint file chunk (a response to FETCH
+ * CHECKPOINT command). The chunk is sent along with its CRC32.
+ * An empty chunk marks the end of the file.
+ * @param[out] row Row to encode into.
+ * @param offset Offset of the chunk in the file.
+ * @param data Chunk data.
+ * @param size Chunk size.
+ *
+ * @retval  0 Success.
+ * @retval -1 Memory error.
+ */
+int
+xrow_encode_file_chunk(struct xrow_header *row, uint64_t offset,
+		       const char *data, uint32_t size);
+
+/**
+ * Decode a checkpoint file chunk and check its CRC32.
+ * @param row Row to decode.
+ * @param[out] offset Offset of the chunk in the file.
+ * @param[out] data Chunk data.
+ * @param[out] size Chunk size.
+ *
+ * @retval  0 Success.
+ * @retval -1 Format error or checksum mismatch.
+ */
+int
+xrow_decode_file_chunk(struct xrow_header *row, uint64_t *offset,
+		       const char **data, uint32_t *size);
 
 /**
  * Encode end of stream command (a response to JOIN command).
@@ -815,9 +1019,10 @@ xrow_decode_ballot_xc(struct xrow_header *row, struct ballot *ballot)
 static inline void
 xrow_encode_register_xc(struct xrow_header *row,
 		       const struct tt_uuid *instance_uuid,
-		       const struct vclock *vclock)
+		       const struct vclock *vclock, bool from_checkpoint)
 {
-	if (xrow_encode_register(row, instance_uuid, vclock) != 0)
+	if (xrow_encode_register(row, instance_uuid, vclock,
+				 from_checkpoint) != 0)
 		diag_raise();
 }
 
@@ -851,26 +1056,140 @@ xrow_decode_subscribe_xc(struct xrow_header *row,
 /** @copydoc xrow_encode_join. */
 static inline void
 xrow_encode_join_xc(struct xrow_header *row,
-		    const struct tt_uuid *instance_uuid)
+		    const struct tt_uuid *instance_uuid, uint32_t stream_count)
 {
-	if (xrow_encode_join(row, instance_uuid) != 0)
+	if (xrow_encode_join(row, instance_uuid, stream_count) != 0)
 		diag_raise();
 }
 
 /** @copydoc xrow_decode_join. */
 static inline void
-xrow_decode_join_xc(struct xrow_header *row, struct tt_uuid *instance_uuid)
+xrow_decode_join_xc(struct xrow_header *row, struct tt_uuid *instance_uuid,
+		    uint32_t *stream_count)
+{
+	if (xrow_decode_join(row, instance_uuid, stream_count) != 0)
+		diag_raise();
+}
+
+/** @copydoc xrow_encode_join_response. */
+static inline void
+xrow_encode_join_response_xc(struct xrow_header *row,
+			     const struct vclock *vclock,
+			     uint32_t stream_count)
+{
+	if (xrow_encode_join_response(row, vclock, stream_count) != 0)
+		diag_raise();
+}
+
+/** @copydoc xrow_decode_join_response. */
+static inline void
+xrow_decode_join_response_xc(struct xrow_header *row, struct vclock *vclock,
+			     uint32_t *stream_count)
+{
+	if (xrow_decode_join_response(row, vclock, stream_count) != 0)
+		diag_raise();
+}
+
+/** @copydoc xrow_encode_join_stream. */
+static inline void
+xrow_encode_join_stream_xc(struct xrow_header *row,
+			   const struct tt_uuid *instance_uuid,
+			   uint32_t stream_id)
 {
-	if (xrow_decode_join(row, instance_uuid) != 0)
+	if (xrow_encode_join_stream(row, instance_uuid, stream_id) != 0)
+		diag_raise();
+}
+
+/** @copydoc xrow_decode_join_stream. */
+static inline void
+xrow_decode_join_stream_xc(struct xrow_header *row,
+			   struct tt_uuid *instance_uuid, uint32_t *stream_id)
+{
+	if (xrow_decode_join_stream(row, instance_uuid, stream_id) != 0)
+		diag_raise();
+}
+
+/** @copydoc xrow_encode_join_stream_rows. */
+static inline void
+xrow_encode_join_stream_rows_xc(struct xrow_header *row,
+				const struct tt_uuid *instance_uuid,
+				uint32_t stream_id, uint64_t row_count)
+{
+	if (xrow_encode_join_stream_rows(row, instance_uuid, stream_id,
+					 row_count) != 0)
+		diag_raise();
+}
+
+/** @copydoc xrow_decode_join_stream_rows. */
+static inline void
+xrow_decode_join_stream_rows_xc(struct xrow_header *row, uint32_t *stream_id,
+				uint64_t *row_count)
+{
+	if (xrow_decode_join_stream_rows(row, stream_id, row_count) != 0)
 		diag_raise();
 }
 
 /** @copydoc xrow_decode_register. */
 static inline void
 xrow_decode_register_xc(struct xrow_header *row, struct tt_uuid *instance_uuid,
-			struct vclock *vclock)
+			struct vclock *vclock, bool *from_checkpoint)
+{
+	if (xrow_decode_register(row, instance_uuid, vclock,
+				 from_checkpoint) != 0)
+		diag_raise();
+}
+
+/** @copydoc xrow_encode_fetch_checkpoint. */
+static inline void
+xrow_encode_fetch_checkpoint_xc(struct xrow_header *row,
+				const struct tt_uuid *instance_uuid,
+				const struct vclock *vclock,
+				const char *file_name, uint64_t offset)
+{
+	if (xrow_encode_fetch_checkpoint(row, instance_uuid, vclock,
+					 file_name, offset) != 0)
+		diag_raise();
+}
+
+/** @copydoc xrow_decode_fetch_checkpoint. */
+static inline void
+xrow_decode_fetch_checkpoint_xc(struct xrow_header *row,
+				struct tt_uuid *instance_uuid,
+				struct vclock *vclock,
+				const char **file_name,
+				uint32_t *file_name_len, uint64_t *offset)
+{
+	if (xrow_decode_fetch_checkpoint(row, instance_uuid, vclock,
+					 file_name, file_name_len,
+					 offset) != 0)
+		diag_raise();
+}
+
+/** @copydoc xrow_encode_checkpoint_files. */
+static inline void
+xrow_encode_checkpoint_files_xc(struct xrow_header *row,
+				const struct vclock *vclock,
+				const char *files, size_t files_size)
+{
+	if (xrow_encode_checkpoint_files(row, vclock, files, files_size) != 0)
+		diag_raise();
+}
+
+/** @copydoc xrow_encode_file_chunk. */
+static inline void
+xrow_encode_file_chunk_xc(struct xrow_header *row, uint64_t offset,
+			  const char *data, uint32_t size)
+{
+	if (xrow_encode_file_chunk(row, offset, data, size) != 0)
+		diag_raise();
+}
+
+/** @copydoc xrow_decode_file_chunk. */
+static inline void
+xrow_decode_file_chunk_xc(struct xrow_header *row, uint64_t *offset,
+			  const char **data, uint32_t *size)
 {
-	if (xrow_decode_register(row, instance_uuid, vclock) != 0)
+	if (xrow_decode_file_chunk(row, offset, data, size) != 0)
 		diag_raise();
 }
 
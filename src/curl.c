@@ -220,7 +220,8 @@ curl_multi_sock_cb(CURL *easy, curl_socket_t fd, int what, void *envp,
 
 
 int
-curl_env_create(struct curl_env *env, long max_conns, long max_total_conns)
+curl_env_create(struct curl_env *env, long max_conns, long max_total_conns,
+		long max_host_conns)
 {
 	memset(env, 0, sizeof(*env));
 	mempool_create(&env->sock_pool, &cord()->slabc,
@@ -245,8 +246,17 @@ curl_env_create(struct curl_env *env, long max_conns, long max_total_conns)
 	curl_multi_setopt(env->multi, CURLMOPT_MAXCONNECTS, max_conns);
 #if LIBCURL_VERSION_NUM >= 0x071e00
 	curl_multi_setopt(env->multi, CURLMOPT_MAX_TOTAL_CONNECTIONS, max_total_conns);
+	curl_multi_setopt(env->multi, CURLMOPT_MAX_HOST_CONNECTIONS, max_host_conns);
 #else
 	(void) max_total_conns;
+	(void) max_host_conns;
+#endif
+#if LIBCURL_VERSION_NUM >= 0x072b00
+	/*
+	 * Let requests to the same host share one HTTP/2
+	 * connection. HTTP/1.x transfers are not affected.
+	 */
+	curl_multi_setopt(env->multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
 #endif
 
 	return 0;
@@ -260,6 +270,9 @@ void
 curl_env_destroy(struct curl_env *env)
 {
 	assert(env);
+	for (int i = 0; i < env->easy_cache_count; i++)
+		curl_easy_cleanup(env->easy_cache[i]);
+	env->easy_cache_count = 0;
 	if (env->multi != NULL)
 		curl_multi_cleanup(env->multi);
 
@@ -267,9 +280,14 @@ curl_env_destroy(struct curl_env *env)
 }
 
 int
-curl_request_create(struct curl_request *curl_request)
+curl_request_create(struct curl_request *curl_request, struct curl_env *env)
 {
-	curl_request->easy = curl_easy_init();
+	if (env->easy_cache_count > 0) {
+		curl_request->easy = env->easy_cache[--env->easy_cache_count];
+		++env->stat.easy_handles_reused;
+	} else {
+		curl_request->easy = curl_easy_init();
+	}
 	if (curl_request->easy == NULL) {
 		diag_set(OutOfMemory, 0, "curl", "easy");
 		return -1;
@@ -281,10 +299,21 @@ curl_request_create(struct curl_request *curl_request)
 }
 
 void
-curl_request_destroy(struct curl_request *curl_request)
+curl_request_destroy(struct curl_request *curl_request, struct curl_env *env)
 {
-	if (curl_request->easy != NULL)
-		curl_easy_cleanup(curl_request->easy);
+	if (curl_request->easy != NULL) {
+		if (env->easy_cache_count < CURL_EASY_CACHE_SIZE) {
+			/*
+			 * Drop the options of the finished request, but
+			 * keep the handle caches.
+			 */
+			curl_easy_reset(curl_request->easy);
+			env->easy_cache[env->easy_cache_count++] =
+				curl_request->easy;
+		} else {
+			curl_easy_cleanup(curl_request->easy);
+		}
+	}
 	fiber_cond_destroy(&curl_request->cond);
 }
 
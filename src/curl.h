@@ -46,6 +46,13 @@ struct curl_stat {
 	uint64_t sockets_added;
 	uint64_t sockets_deleted;
 	uint64_t active_requests;
+	/** Requests which got an easy handle from the cache. */
+	uint64_t easy_handles_reused;
+};
+
+enum {
+	/** Max number of idle easy handles kept for reuse. */
+	CURL_EASY_CACHE_SIZE = 64,
 };
 
 /**
@@ -58,6 +65,14 @@ struct curl_env {
 	struct mempool sock_pool;
 	/** libev timer watcher. */
 	struct ev_timer timer_event;
+	/**
+	 * Idle easy handles of finished requests. Reusing them
+	 * saves the allocation and keeps their DNS and TLS
+	 * session caches warm.
+	 */
+	CURL *easy_cache[CURL_EASY_CACHE_SIZE];
+	/** Number of handles in easy_cache. */
+	int easy_cache_count;
 	/** Statistics. */
 	struct curl_stat stat;
 };
@@ -83,11 +98,16 @@ struct curl_request {
  * @brief Create a new CURL environment
  * @param env pointer to a structure to initialize
  * @param max_conn The maximum number of entries in connection cache
+ * @param max_total_conns The maximum number of active connections
+ * @param max_host_conns The maximum number of active connections
+ *        to a single host, 0 means unlimited. Requests above the
+ *        limit are queued until a connection is free.
  * @retval 0 on success
  * @retval -1 on error, check diag
  */
 int
-curl_env_create(struct curl_env *env, long max_conns, long max_total_conns);
+curl_env_create(struct curl_env *env, long max_conns, long max_total_conns,
+		long max_host_conns);
 
 /**
  * Destroy HTTP client environment
@@ -97,20 +117,23 @@ void
 curl_env_destroy(struct curl_env *env);
 
 /**
- * Initialize a new CURL request
+ * Initialize a new CURL request, reusing a cached easy handle
+ * if there is one.
  * @param curl_request request
+ * @param env environment
  * @retval  0 success
  * @retval -1 error, check diag
  */
 int
-curl_request_create(struct curl_request *curl_request);
+curl_request_create(struct curl_request *curl_request, struct curl_env *env);
 
 /**
- * Cleanup CURL request
+ * Cleanup CURL request, return its easy handle to the cache
  * @param curl_request request
+ * @param env environment
  */
 void
-curl_request_destroy(struct curl_request *curl_request);
+curl_request_destroy(struct curl_request *curl_request, struct curl_env *env);
 
 /**
  * Execute CURL request
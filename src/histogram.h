@@ -96,6 +96,13 @@ histogram_percentile(struct histogram *hist, int pct);
 int64_t
 histogram_percentile_lower(struct histogram *hist, int pct);
 
+/**
+ * Same as histogram_percentile(), but the rank is given in
+ * per mille, e.g. 999 for the 99.9th percentile.
+ */
+int64_t
+histogram_permille(struct histogram *hist, int permille);
+
 /**
  * Print string representation of a histogram.
  */
@@ -85,13 +85,15 @@ curl_easy_header_cb(char *buffer, size_t size, size_t nitems, void *ctx)
 }
 
 int
-httpc_env_create(struct httpc_env *env, int max_conns, int max_total_conns)
+httpc_env_create(struct httpc_env *env, int max_conns, int max_total_conns,
+		 int max_host_conns)
 {
 	memset(env, 0, sizeof(*env));
 	mempool_create(&env->req_pool, &cord()->slabc,
 			sizeof(struct httpc_request));
 
-	return curl_env_create(&env->curl_env, max_conns, max_total_conns);
+	return curl_env_create(&env->curl_env, max_conns, max_total_conns,
+			       max_host_conns);
 }
 
 void
@@ -121,7 +123,7 @@ httpc_request_new(struct httpc_env *env, const char *method,
 	region_create(&req->resp_headers, &cord()->slabc);
 	region_create(&req->resp_body, &cord()->slabc);
 
-	if (curl_request_create(&req->curl_request) != 0)
+	if (curl_request_create(&req->curl_request, &env->curl_env) != 0)
 		return NULL;
 
 	if (strcmp(method, "GET") == 0) {
@@ -169,7 +171,7 @@ httpc_request_delete(struct httpc_request *req)
 	if (req->headers != NULL)
 		curl_slist_free_all(req->headers);
 
-	curl_request_destroy(&req->curl_request);
+	curl_request_destroy(&req->curl_request, &req->env->curl_env);
 
 	ibuf_destroy(&req->body);
 	region_destroy(&req->resp_headers);
@@ -377,6 +379,26 @@ httpc_set_accept_encoding(struct httpc_request *req, const char *encoding)
 #endif
 }
 
+int
+httpc_set_http2(struct httpc_request *req)
+{
+#if LIBCURL_VERSION_NUM >= 0x072f00
+	if (curl_easy_setopt(req->curl_request.easy, CURLOPT_HTTP_VERSION,
+			     CURL_HTTP_VERSION_2TLS) != CURLE_OK) {
+		diag_set(IllegalParams, "libcurl was built without HTTP/2 "
+			 "support");
+		return -1;
+	}
+	curl_easy_setopt(req->curl_request.easy, CURLOPT_PIPEWAIT, 1L);
+	return 0;
+#else
+	(void) req;
+	diag_set(IllegalParams, "HTTP/2 is not supported, please upgrade "
+		 "libcurl to 7.47.0 and rebuild");
+	return -1;
+#endif
+}
+
 int
 httpc_execute(struct httpc_request *req, double timeout)
 {
@@ -407,6 +429,11 @@ httpc_execute(struct httpc_request *req, double timeout)
 	long longval = 0;
 	switch (req->curl_request.code) {
 	case CURLE_OK:
+		curl_easy_getinfo(req->curl_request.easy, CURLINFO_NUM_CONNECTS, &longval);
+		if (longval == 0)
+			++env->stat.connections_reused;
+		else
+			env->stat.connections_opened += longval;
 		curl_easy_getinfo(req->curl_request.easy, CURLINFO_RESPONSE_CODE, &longval);
 		req->status = (int) longval;
 
@@ -54,6 +54,10 @@ struct httpc_stat {
 	uint64_t http_other_responses;
 	uint64_t failed_requests;
 	uint64_t active_requests;
+	/** Connections established to complete requests. */
+	uint64_t connections_opened;
+	/** Requests served over an already open connection. */
+	uint64_t connections_reused;
 };
 
 /**
@@ -72,11 +76,15 @@ struct httpc_env {
  * @brief Creates  new HTTP client environment
  * @param env pointer to a structure to initialize
  * @param max_conn The maximum number of entries in connection cache
+ * @param max_total_conns The maximum number of active connections
+ * @param max_host_conns The maximum number of active connections
+ *        to a single host, 0 means unlimited
  * @retval 0 on success
  * @retval -1 on error, check diag
  */
 int
-httpc_env_create(struct httpc_env *ctx, int max_conns, int max_total_conns);
+httpc_env_create(struct httpc_env *ctx, int max_conns, int max_total_conns,
+		 int max_host_conns);
 
 /**
  * Destroy HTTP client environment
@@ -402,6 +410,18 @@ httpc_set_follow_location(struct httpc_request *req, long follow);
 void
 httpc_set_accept_encoding(struct httpc_request *req, const char *encoding);
 
+/**
+ * Prefer HTTP/2 for the request: negotiate it over TLS and
+ * multiplex the request onto an existing HTTP/2 connection to
+ * the same host instead of opening a new one.
+ * @param req request
+ * @retval 0 on success
+ * @retval -1 libcurl was built without HTTP/2 support, check diag
+ * @see https://curl.haxx.se/libcurl/c/CURLOPT_PIPEWAIT.html
+ */
+int
+httpc_set_http2(struct httpc_request *req);
+
 /**
  * This function does async HTTP request
  * @param request - reference to request object with filled fields
@@ -30,38 +30,46 @@
  */
 #include "latency.h"
 
+#include <assert.h>
 #include <stdint.h>
 
 #include "histogram.h"
+#include "info/info.h"
 #include "trivia/util.h"
 
 enum {
-	USEC_PER_MSEC		= 1000,
 	USEC_PER_SEC		= 1000000,
 };
 
+/**
+ * Latency buckets are log-linear, like in HDR histograms: every
+ * power of two range of microseconds is split into a number of
+ * equal sub-buckets, so the error of a percentile is bounded
+ * by 1 / LATENCY_SUB_BUCKETS of its value from 1us to 16s.
+ */
+enum {
+	LATENCY_SUB_BUCKETS_LOG	= 3,
+	LATENCY_SUB_BUCKETS	= 1 << LATENCY_SUB_BUCKETS_LOG,
+	LATENCY_MAX_LOG		= 24,
+	LATENCY_BUCKETS		= LATENCY_SUB_BUCKETS *
+				  (LATENCY_MAX_LOG - LATENCY_SUB_BUCKETS_LOG + 1),
+};
+
 int
 latency_create(struct latency *latency)
 {
-	enum { US = 1, MS = USEC_PER_MSEC, S = USEC_PER_SEC };
-	static int64_t buckets[] = {
-		  1 * US,   2 * US,   3 * US,   4 * US,   5 * US,   6 * US,
-		  7 * US,   8 * US,   9 * US,
-		 10 * US,  20 * US,  30 * US,  40 * US,  50 * US,  60 * US,
-		 70 * US,  80 * US,  90 * US,
-		100 * US, 200 * US, 300 * US, 400 * US, 500 * US, 600 * US,
-		700 * US, 800 * US, 900 * US,
-		  1 * MS,   2 * MS,   3 * MS,   4 * MS,   5 * MS,   6 * MS,
-		  7 * MS,   8 * MS,   9 * MS,
-		 10 * MS,  20 * MS,  30 * MS,  40 * MS,  50 * MS,  60 * MS,
-		 70 * MS,  80 * MS,  90 * MS,
-		100 * MS, 200 * MS, 300 * MS, 400 * MS, 500 * MS, 600 * MS,
-		700 * MS, 800 * MS, 900 * MS,
-		  1 * S,    2 * S,    3 * S,    4 * S,    5 * S,    6 * S,
-		  7 * S,    8 * S,    9 * S,   10 * S,
-	};
+	int64_t buckets[LATENCY_BUCKETS];
+	size_t n_buckets = 0;
+	for (int i = 1; i <= LATENCY_SUB_BUCKETS; i++)
+		buckets[n_buckets++] = i;
+	for (int log = LATENCY_SUB_BUCKETS_LOG; log < LATENCY_MAX_LOG; log++) {
+		int64_t step = 1LL << (log - LATENCY_SUB_BUCKETS_LOG);
+		for (int i = 1; i <= LATENCY_SUB_BUCKETS; i++)
+			buckets[n_buckets++] = (1LL << log) + i * step;
+	}
+	assert(n_buckets == LATENCY_BUCKETS);
 
-	latency->histogram = histogram_new(buckets, lengthof(buckets));
+	latency->histogram = histogram_new(buckets, n_buckets);
 	if (latency->histogram == NULL)
 		return -1;
 
@@ -92,6 +100,23 @@ latency_collect(struct latency *latency, double value)
 double
 latency_get(struct latency *latency, int pct)
 {
-	int64_t value_usec = histogram_percentile(latency->histogram, pct);
+	return latency_get_permille(latency, pct * 10);
+}
+
+double
+latency_get_permille(struct latency *latency, int permille)
+{
+	int64_t value_usec = histogram_permille(latency->histogram, permille);
 	return (double)value_usec / USEC_PER_SEC;
 }
+
+void
+latency_info_append(struct info_handler *h, const char *name,
+		    struct latency *latency)
+{
+	info_table_begin(h, name);
+	info_append_double(h, "p50", latency_get_permille(latency, 500));
+	info_append_double(h, "p99", latency_get_permille(latency, 990));
+	info_append_double(h, "p999", latency_get_permille(latency, 999));
+	info_table_end(h);
+}
@@ -32,6 +32,7 @@
  */
 
 struct histogram;
+struct info_handler;
 
 /**
  * Latency counter.
@@ -77,4 +78,19 @@ latency_collect(struct latency *latency, double value);
 double
 latency_get(struct latency *latency, int pct);
 
+/**
+ * Same as latency_get(), but the rank is given in per mille,
+ * e.g. 999 for the 99.9th percentile.
+ */
+double
+latency_get_permille(struct latency *latency, int permille);
+
+/**
+ * Append p50, p99 and p999 of a latency counter to an info
+ * handler, as a table with the given name.
+ */
+void
+latency_info_append(struct info_handler *h, const char *name,
+		    struct latency *latency);
+
 #endif /* TARANTOOL_LATENCY_H_INCLUDED */
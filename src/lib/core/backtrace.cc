@@ -45,6 +45,7 @@
 
 #ifdef ENABLE_BACKTRACE
 #include <libunwind.h>
+#include <dlfcn.h>
 
 #include "small/region.h"
 #include "small/static.h"
@@ -433,6 +434,32 @@ out:
 	free(demangle_buf);
 }
 
+#ifndef TARGET_OS_DARWIN
+int
+backtrace_collect_ip(void **frames, int size)
+{
+	return unw_backtrace(frames, size);
+}
+
+const char *
+backtrace_ip_name(void *ip)
+{
+	static __thread char *demangle_buf = NULL;
+	static __thread size_t demangle_buf_len = 0;
+	Dl_info info;
+	if (dladdr(ip, &info) == 0 || info.dli_sname == NULL)
+		return NULL;
+	int demangle_status;
+	char *cxxname = abi::__cxa_demangle(info.dli_sname, demangle_buf,
+					    &demangle_buf_len,
+					    &demangle_status);
+	if (cxxname == NULL)
+		return info.dli_sname;
+	demangle_buf = cxxname;
+	return cxxname;
+}
+#endif /* TARGET_OS_DARWIN */
+
 void
 print_backtrace()
 {
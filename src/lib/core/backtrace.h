@@ -52,6 +52,25 @@ backtrace_foreach(backtrace_cb cb, coro_context *coro_ctx, void *cb_ctx);
 void
 backtrace_proc_cache_clear();
 
+#ifndef TARGET_OS_DARWIN
+/**
+ * Save return addresses of the current call stack to @a frames,
+ * innermost first, at most @a size of them. Async-signal-safe.
+ * @return the number of saved addresses.
+ */
+int
+backtrace_collect_ip(void **frames, int size);
+
+/**
+ * Return the name of the function a code address saved by
+ * backtrace_collect_ip() belongs to, or NULL if it is unknown,
+ * e.g. if the function isn't exported. The name is valid until
+ * the next call.
+ */
+const char *
+backtrace_ip_name(void *ip);
+#endif /* TARGET_OS_DARWIN */
+
 #endif /* ENABLE_BACKTRACE */
 
 #if defined(__cplusplus)
@@ -31,6 +31,7 @@
 #include "cbus.h"
 
 #include <limits.h>
+#include <pmatomic.h>
 #include "fiber.h"
 #include "trigger.h"
 
@@ -87,6 +88,66 @@ static void
 cpipe_flush_cb(ev_loop * /* loop */, struct ev_async *watcher,
 	       int /* events */);
 
+void
+cbus_endpoint_fetch(struct cbus_endpoint *endpoint, struct stailq *output)
+{
+	struct stailq_entry *item =
+		pm_atomic_exchange_explicit(&endpoint->output, NULL,
+					    pm_memory_order_acquire);
+	/*
+	 * The stack has the most recently pushed message on top,
+	 * rebuild it in the order the messages were pushed.
+	 */
+	struct stailq fifo;
+	stailq_create(&fifo);
+	while (item != NULL) {
+		struct stailq_entry *next = item->next;
+		stailq_add(&fifo, item);
+		item = next;
+	}
+	stailq_concat(output, &fifo);
+}
+
+bool
+cbus_endpoint_has_output(struct cbus_endpoint *endpoint)
+{
+	return pm_atomic_load_explicit(&endpoint->output,
+				       pm_memory_order_relaxed) != NULL;
+}
+
+/**
+ * Push a batch of messages to the endpoint output stack.
+ * Lock-free, may be called by many producers concurrently.
+ * The batch is emptied.
+ *
+ * The messages are linked in the reverse order before being
+ * published, so that cbus_endpoint_fetch() gets them back in
+ * the order they were queued. A producer never pops from the
+ * stack, hence the CAS loop is not prone to ABA.
+ *
+ * @retval true if the output was empty before the push and
+ *         the consumer needs to be woken up.
+ */
+static bool
+cbus_endpoint_push(struct cbus_endpoint *endpoint, struct stailq *batch)
+{
+	assert(!stailq_empty(batch));
+	/* The first message will be at the bottom of the batch. */
+	struct stailq_entry *bottom = stailq_first(batch);
+	stailq_reverse(batch);
+	struct stailq_entry *top = stailq_first(batch);
+	struct stailq_entry *head =
+		pm_atomic_load_explicit(&endpoint->output,
+					pm_memory_order_relaxed);
+	do {
+		bottom->next = head;
+	} while (!pm_atomic_compare_exchange_weak_explicit(
+			&endpoint->output, &head, top,
+			pm_memory_order_release, pm_memory_order_relaxed));
+	stailq_create(batch);
+	return head == NULL;
+}
+
 void
 cpipe_create(struct cpipe *pipe, const char *consumer)
 {
@@ -156,18 +217,19 @@ cpipe_destroy(struct cpipe *pipe)
 	 * delivered.
 	 */
 	tt_pthread_mutex_lock(&endpoint->mutex);
+	/* Add the pipe shutdown message as the last one. */
+	stailq_add_tail_entry(&pipe->input, poison, msg.fifo);
 	/* Flush input */
-	stailq_concat(&endpoint->output, &pipe->input);
+	cbus_endpoint_push(endpoint, &pipe->input);
 	pipe->n_input = 0;
-	/* Add the pipe shutdown message as the last one. */
-	stailq_add_tail_entry(&endpoint->output, poison, msg.fifo);
 	/* Count statistics */
 	rmean_collect(cbus.stats, CBUS_STAT_EVENTS, 1);
 	/*
 	 * Keep the lock for the duration of ev_async_send():
 	 * this will avoid a race condition between
 	 * ev_async_send() and execution of the poison
-	 * message, after which the endpoint may disappear.
+	 * message, after which the endpoint may disappear
+	 * (see cbus_endpoint_destroy()).
 	 */
 	ev_async_send(endpoint->consumer, &endpoint->async);
 	tt_pthread_mutex_unlock(&endpoint->mutex);
@@ -227,7 +289,8 @@ cbus_endpoint_create(struct cbus_endpoint *endpoint, const char *name,
 	endpoint->n_pipes = 0;
 	fiber_cond_create(&endpoint->cond);
 	tt_pthread_mutex_init(&endpoint->mutex, NULL);
-	stailq_create(&endpoint->output);
+	pm_atomic_store_explicit(&endpoint->output, NULL,
+				 pm_memory_order_relaxed);
 	ev_async_init(&endpoint->async,
 		      (void (*)(ev_loop *, struct ev_async *, int)) fetch_cb);
 	endpoint->async.data = fetch_data;
@@ -261,14 +324,15 @@ cbus_endpoint_destroy(struct cbus_endpoint *endpoint,
 	while (true) {
 		if (process_cb)
 			process_cb(endpoint);
-		if (endpoint->n_pipes == 0 && stailq_empty(&endpoint->output))
+		if (endpoint->n_pipes == 0 &&
+		    !cbus_endpoint_has_output(endpoint))
 			break;
 		 fiber_cond_wait(&endpoint->cond);
 	}
 
 	/*
-	 * Pipe flush func can still lock mutex, so just lock and unlock
-	 * it.
+	 * cpipe_destroy() can still hold the mutex while sending
+	 * the wakeup, so just lock and unlock it.
 	 */
 	tt_pthread_mutex_lock(&endpoint->mutex);
 	tt_pthread_mutex_unlock(&endpoint->mutex);
@@ -290,8 +354,6 @@ cpipe_flush_cb(ev_loop *loop, struct ev_async *watcher, int events)
 		return;
 
 	trigger_run(&pipe->on_flush, pipe);
-	/* Trigger task processing when the queue becomes non-empty. */
-	bool output_was_empty;
 
 	/*
 	 * We need to set a thread cancellation guard, because
@@ -304,12 +366,13 @@ cpipe_flush_cb(ev_loop *loop, struct ev_async *watcher, int events)
 	int old_cancel_state;
 	tt_pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_cancel_state);
 
-	tt_pthread_mutex_lock(&endpoint->mutex);
-	output_was_empty = stailq_empty(&endpoint->output);
-	/** Flush input */
-	stailq_concat(&endpoint->output, &pipe->input);
-	tt_pthread_mutex_unlock(&endpoint->mutex);
-
+	/*
+	 * Trigger task processing when the queue becomes
+	 * non-empty. No need to wake up the consumer otherwise:
+	 * it hasn't fetched the previous batch yet and will
+	 * get this one along with it.
+	 */
+	bool output_was_empty = cbus_endpoint_push(endpoint, &pipe->input);
 	pipe->n_input = 0;
 	if (output_was_empty) {
 		/* Count statistics */
@@ -657,14 +720,67 @@ cbus_process(struct cbus_endpoint *endpoint)
 		cmsg_deliver(msg);
 }
 
+#if defined(__x86_64__) || defined(__i386__)
+#define cbus_cpu_relax() __builtin_ia32_pause()
+#else
+#define cbus_cpu_relax() __asm__ __volatile__("" ::: "memory")
+#endif
+
+enum {
+	/**
+	 * Max number of times cbus_loop() polls the endpoint
+	 * before going to sleep on the async watcher.
+	 */
+	CBUS_LOOP_SPIN_MAX = 256,
+};
+
+/**
+ * Poll the endpoint output for at most @a spin iterations.
+ * Return true if a message arrived meanwhile.
+ */
+static bool
+cbus_endpoint_spin(struct cbus_endpoint *endpoint, int spin)
+{
+	for (int i = 0; i < spin; i++) {
+		if (cbus_endpoint_has_output(endpoint))
+			return true;
+		cbus_cpu_relax();
+	}
+	return cbus_endpoint_has_output(endpoint);
+}
+
 void
 cbus_loop(struct cbus_endpoint *endpoint)
 {
+	/*
+	 * Under a steady message flow a new batch usually
+	 * arrives shortly after the previous one has been
+	 * processed, so it's cheaper to poll the endpoint for a
+	 * while than to park on the async watcher. The spin budget
+	 * adapts: it grows while polling pays off and shrinks to
+	 * zero when the bus is idle, so that an idle consumer
+	 * doesn't burn CPU.
+	 *
+	 * Spinning only saves parking: the event loop must still
+	 * run after each batch, otherwise socket watchers, pipe
+	 * flushes and other fibers of the cord would starve under
+	 * a steady message flow.
+	 */
+	int spin = 0;
 	while (true) {
 		cbus_process(endpoint);
 		if (fiber_is_cancelled())
 			break;
+		if (spin > 0 && cbus_endpoint_spin(endpoint, spin)) {
+			spin = MIN(spin * 2, CBUS_LOOP_SPIN_MAX);
+			/* Run one event loop iteration without polling wait. */
+			fiber_sleep(0);
+			continue;
+		}
+		spin = spin > 0 ? spin / 2 : 0;
 		fiber_yield();
+		if (spin == 0)
+			spin = 1;
 	}
 }
 
@@ -258,10 +258,21 @@ struct cbus_endpoint {
 	char name[FIBER_NAME_MAX];
 	/** Member of cbus->endpoints */
 	struct rlist in_cbus;
-	/** The lock around the pipe. */
+	/**
+	 * The lock serializing cpipe_destroy() with endpoint
+	 * destruction. It is never taken on the message delivery
+	 * path.
+	 */
 	pthread_mutex_t mutex;
-	/** A queue with incoming messages. */
-	struct stailq output;
+	/**
+	 * Incoming messages, a lock-free LIFO stack linked via
+	 * cmsg::fifo. Producers push a whole flushed batch with
+	 * a single CAS, so it is multi-producer safe. The consumer
+	 * grabs everything with an atomic exchange and reverses
+	 * the chain, which restores the per-producer FIFO order.
+	 * Must only be accessed with atomic primitives.
+	 */
+	struct stailq_entry *output;
 	/** Consumer cord loop */
 	ev_loop *consumer;
 	/** Async to notify the consumer */
@@ -275,13 +286,15 @@ struct cbus_endpoint {
 /**
  * Fetch incomming messages to output
  */
-static inline void
-cbus_endpoint_fetch(struct cbus_endpoint *endpoint, struct stailq *output)
-{
-	tt_pthread_mutex_lock(&endpoint->mutex);
-	stailq_concat(output, &endpoint->output);
-	tt_pthread_mutex_unlock(&endpoint->mutex);
-}
+void
+cbus_endpoint_fetch(struct cbus_endpoint *endpoint, struct stailq *output);
+
+/**
+ * Return true if there are messages pushed to the endpoint
+ * and not fetched yet. May be called from any cord.
+ */
+bool
+cbus_endpoint_has_output(struct cbus_endpoint *endpoint);
 
 /** Initialize the global singleton bus. */
 void
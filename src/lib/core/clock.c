@@ -30,7 +30,14 @@
  */
 #include "clock.h"
 
+#include <stdbool.h>
+
 #include "trivia/util.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#define HAVE_CLOCK_TSC 1
+#endif
 double
 clock_realtime(void)
 {
@@ -108,3 +115,87 @@ clock_thread64(void)
 	return (uint64_t) clock() * 1000000000 / CLOCKS_PER_SEC;
 #endif
 }
+
+enum clock_ticks_source {
+	CLOCK_TICKS_UNKNOWN = 0,
+	CLOCK_TICKS_MONOTONIC,
+	CLOCK_TICKS_TSC,
+};
+
+/** Where clock_ticks() come from, set on first use. */
+static int clock_ticks_source = CLOCK_TICKS_UNKNOWN;
+/**
+ * Length of a clock_ticks() tick, in nanoseconds. Accessed
+ * atomically, because any thread may do the calibration.
+ */
+static double clock_ns_per_tick = 1;
+
+#if defined(HAVE_CLOCK_TSC)
+/** True if the CPU time stamp counter doesn't depend on P/C-states. */
+static bool
+clock_tsc_is_invariant(void)
+{
+	unsigned eax, ebx, ecx, edx;
+	if (__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) == 0 ||
+	    eax < 0x80000007)
+		return false;
+	__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+	return (edx & (1 << 8)) != 0;
+}
+#endif /* defined(HAVE_CLOCK_TSC) */
+
+/**
+ * Choose the source of clock_ticks() and measure the tick length
+ * against CLOCK_MONOTONIC. Takes a millisecond, done only once.
+ * Threads that happen to race here calculate nearly the same
+ * tick length, and readers see one of them.
+ */
+static int
+clock_ticks_calibrate(void)
+{
+	int source = CLOCK_TICKS_MONOTONIC;
+#if defined(HAVE_CLOCK_TSC)
+	if (clock_tsc_is_invariant()) {
+		uint64_t ns_start = clock_monotonic64();
+		uint64_t tsc_start = __builtin_ia32_rdtsc();
+		uint64_t ns_end;
+		do {
+			ns_end = clock_monotonic64();
+		} while (ns_end - ns_start < 1000000);
+		uint64_t tsc_end = __builtin_ia32_rdtsc();
+		if (tsc_end > tsc_start) {
+			double ns_per_tick = (double)(ns_end - ns_start) /
+					     (tsc_end - tsc_start);
+			__atomic_store(&clock_ns_per_tick, &ns_per_tick,
+				       __ATOMIC_RELAXED);
+			source = CLOCK_TICKS_TSC;
+		}
+	}
+#endif /* defined(HAVE_CLOCK_TSC) */
+	__atomic_store_n(&clock_ticks_source, source, __ATOMIC_RELEASE);
+	return source;
+}
+
+uint64_t
+clock_ticks(void)
+{
+	int source = __atomic_load_n(&clock_ticks_source, __ATOMIC_ACQUIRE);
+	if (unlikely(source == CLOCK_TICKS_UNKNOWN))
+		source = clock_ticks_calibrate();
+#if defined(HAVE_CLOCK_TSC)
+	if (source == CLOCK_TICKS_TSC)
+		return __builtin_ia32_rdtsc();
+#endif /* defined(HAVE_CLOCK_TSC) */
+	return clock_monotonic64();
+}
+
+double
+clock_ticks_to_sec(uint64_t ticks)
+{
+	if (__atomic_load_n(&clock_ticks_source, __ATOMIC_ACQUIRE) ==
+	    CLOCK_TICKS_UNKNOWN)
+		clock_ticks_calibrate();
+	double ns_per_tick;
+	__atomic_load(&clock_ns_per_tick, &ns_per_tick, __ATOMIC_RELAXED);
+	return ticks * ns_per_tick / 1e9;
+}
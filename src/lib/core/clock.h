@@ -52,6 +52,17 @@ uint64_t clock_thread64(void);
 
 /** \endcond public */
 
+/**
+ * A cheap monotonic timestamp for measuring short intervals,
+ * in ticks of an unspecified length. Reads the CPU time stamp
+ * counter if it is invariant, i.e. runs at a constant rate on
+ * all cores, falls back on CLOCK_MONOTONIC otherwise.
+ */
+uint64_t clock_ticks(void);
+
+/** Convert a difference of two clock_ticks() to seconds. */
+double clock_ticks_to_sec(uint64_t ticks);
+
 #if defined(__cplusplus)
 } /* extern "C" */
 #endif /* defined(__cplusplus) */
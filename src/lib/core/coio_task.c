@@ -243,7 +243,16 @@ coio_task_execute(struct coio_task *task, double timeout)
 	assert(task->fiber == fiber());
 
 	eio_submit(&task->base);
-	fiber_yield_timeout(timeout);
+	/*
+	 * The fiber may be woken up before the task is complete,
+	 * e.g. by fiber.wakeup(), keep waiting then.
+	 */
+	ev_tstamp deadline = ev_monotonic_now(loop()) + timeout;
+	while (!task->complete && !fiber_is_cancelled()) {
+		if (fiber_yield_timeout(timeout))
+			break;
+		timeout = deadline - ev_monotonic_now(loop());
+	}
 	if (!task->complete) {
 		/* timed out or cancelled. */
 		task->fiber = NULL;
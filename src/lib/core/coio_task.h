@@ -35,6 +35,7 @@
 
 #include <sys/types.h> /* ssize_t */
 #include <stdarg.h>
+#include <assert.h>
 
 #include "third_party/tarantool_eio.h"
 #include "diag.h"
@@ -47,6 +48,12 @@ extern "C" {
  * Asynchronous IO Tasks (libeio wrapper)
  *
  * Yield the current fiber until a created task is complete.
+ *
+ * Each thread submits tasks to its own queue (see
+ * eio_queue_stat() for queue statistics), a worker thread
+ * serves one of the queues and steals tasks from the others
+ * when it is empty. High priority tasks have a queue of their
+ * own, see coio_task_set_priority().
  */
 
 void coio_init(void);
@@ -105,6 +112,23 @@ coio_task_create(struct coio_task *task, coio_task_cb func,
 void
 coio_task_destroy(struct coio_task *task);
 
+/**
+ * Set priority of a coio task, from EIO_PRI_MIN to EIO_PRI_MAX.
+ * Tasks submitted from the same thread are executed in order of
+ * their priority, EIO_PRI_DEFAULT is used unless set. Tasks of
+ * a priority above EIO_PRI_DEFAULT go to a queue shared by all
+ * threads, which workers serve before the others.
+ *
+ * @param task coio task.
+ * @param pri priority.
+ */
+static inline void
+coio_task_set_priority(struct coio_task *task, int pri)
+{
+	assert(pri >= EIO_PRI_MIN && pri <= EIO_PRI_MAX);
+	task->base.pri = pri;
+}
+
 /**
  * Execute a coio task in a worker thread.
  *
@@ -112,7 +136,8 @@ coio_task_destroy(struct coio_task *task);
  * @param timeout timeout in seconds.
  * @retval 0  the task completed successfully. Check the result
  *            code in task->base.result and free the task.
- * @retval -1 timeout or the waiting fiber was cancelled (check diag);
+ * @retval -1 timeout or the waiting fiber was cancelled (check diag),
+ *            a spurious wakeup of the fiber doesn't stop waiting;
  *            the caller should not free the task, it
  *            will be freed when it's finished in the timeout
  *            callback.
@@ -266,6 +266,11 @@ enum {
 	FIBER_STACK_SIZE_DEFAULT = 524288,
 	/* Stack size watermark in bytes. */
 	FIBER_STACK_SIZE_WATERMARK = 65536,
+	/*
+	 * Number of dead fibers with a dirty stack which are
+	 * released together.
+	 */
+	FIBER_DIRTY_STACK_MAX = 16,
 };
 
 /** Default fiber attributes */
@@ -842,7 +847,6 @@ fiber_recycle(struct fiber *fiber)
 	/* no pending wakeup */
 	assert(rlist_empty(&fiber->state));
 	bool has_custom_stack = fiber->flags & FIBER_CUSTOM_STACK;
-	fiber_stack_recycle(fiber);
 	fiber_reset(fiber);
 	fiber->name[0] = '\0';
 	fiber->f = NULL;
@@ -851,10 +855,17 @@ fiber_recycle(struct fiber *fiber)
 	unregister_fid(fiber);
 	fiber->fid = 0;
 	region_free(&fiber->gc);
+	struct cord *cord = cord();
 	if (!has_custom_stack) {
-		rlist_move_entry(&cord()->dead, fiber, link);
+		rlist_move_entry(&cord->dead, fiber, link);
+		fiber_stack_recycle(fiber);
+	} else if (cord->dead_custom_count < FIBER_CUSTOM_STACK_CACHE_MAX) {
+		rlist_move_entry(&cord->dead_custom, fiber, link);
+		cord->dead_custom_count++;
+		fiber_stack_recycle(fiber);
 	} else {
-		fiber_destroy(cord(), fiber);
+		fiber_destroy(cord, fiber);
+		cord->cache_stat.destroyed++;
 	}
 }
 
@@ -984,17 +995,12 @@ stack_put_watermark(void *addr)
 }
 
 /**
- * Free stack memory above the watermark when a fiber is recycled.
- * To avoid a pointless syscall invocation in case the fiber hasn't
- * touched memory above the watermark, we only call madvise() if
- * the fiber has overwritten a poison value.
+ * Free stack memory above the watermark and put the poison
+ * values back.
  */
 static void
-fiber_stack_recycle(struct fiber *fiber)
+fiber_stack_release(struct fiber *fiber)
 {
-	if (fiber->stack_watermark == NULL ||
-	    stack_has_watermark(fiber->stack_watermark))
-		return;
 	/*
 	 * When dropping pages make sure the page containing
 	 * the watermark isn't touched since we're updating
@@ -1016,6 +1022,77 @@ fiber_stack_recycle(struct fiber *fiber)
 	 */
 	fiber_madvise(start, end - start, MADV_DONTNEED);
 	stack_put_watermark(fiber->stack_watermark);
+	fiber->stack_is_dirty = false;
+	cord()->cache_stat.stack_releases++;
+}
+
+/**
+ * Release dirty stacks of the dead fibers of a list. They
+ * tend to be at the head of the list since it is LIFO.
+ */
+static void
+fiber_stack_release_list(struct cord *cord, struct rlist *list)
+{
+	struct fiber *fiber;
+	rlist_foreach_entry(fiber, list, link) {
+		if (cord->dirty_stack_count == 0)
+			break;
+		if (fiber->stack_is_dirty) {
+			fiber_stack_release(fiber);
+			cord->dirty_stack_count--;
+		}
+	}
+}
+
+/**
+ * Release all dirty stacks of dead fibers. Called by the idle
+ * watcher of the cord, see fiber_stack_recycle().
+ */
+static void
+fiber_stack_release_dirty(ev_loop *loop, ev_idle *watcher, int revents)
+{
+	(void)revents;
+	struct cord *cord = cord();
+	fiber_stack_release_list(cord, &cord->dead);
+	fiber_stack_release_list(cord, &cord->dead_custom);
+	assert(cord->dirty_stack_count == 0);
+	ev_idle_stop(loop, watcher);
+}
+
+/**
+ * Account the stack of a fiber put to the dead list. To avoid
+ * a pointless syscall invocation in case the fiber hasn't
+ * touched memory above the watermark, the stack is considered
+ * dirty only if the fiber has overwritten a poison value.
+ *
+ * A dirty stack isn't released right away: if a new fiber is
+ * needed soon, it reuses the stack with its pages still mapped.
+ * Once more than FIBER_DIRTY_STACK_MAX of them pile up in the
+ * dead lists, e.g. after a burst of requests, they are released
+ * with madvise() in a batch as soon as the event loop is idle.
+ */
+static void
+fiber_stack_recycle(struct fiber *fiber)
+{
+	if (fiber->stack_watermark == NULL)
+		return;
+	if (!fiber->stack_is_dirty &&
+	    stack_has_watermark(fiber->stack_watermark))
+		return;
+	fiber->stack_is_dirty = true;
+	struct cord *cord = cord();
+	if (++cord->dirty_stack_count > FIBER_DIRTY_STACK_MAX)
+		ev_idle_start(loop(), &cord->stack_release_event);
+}
+
+/**
+ * Account the stack of a fiber taken from the dead list.
+ */
+static void
+fiber_stack_reuse(struct fiber *fiber)
+{
+	if (fiber->stack_is_dirty)
+		cord()->dirty_stack_count--;
 }
 
 /**
@@ -1026,8 +1103,8 @@ fiber_stack_watermark_create(struct fiber *fiber)
 {
 	assert(fiber->stack_watermark == NULL);
 
-	/* No tracking on custom stacks for simplicity. */
-	if (fiber->flags & FIBER_CUSTOM_STACK)
+	/* Nothing to release on a stack below the watermark. */
+	if (fiber->stack_size <= FIBER_STACK_SIZE_WATERMARK)
 		return;
 
 	/*
@@ -1062,6 +1139,12 @@ fiber_stack_recycle(struct fiber *fiber)
 	(void)fiber;
 }
 
+static void
+fiber_stack_reuse(struct fiber *fiber)
+{
+	(void)fiber;
+}
+
 static void
 fiber_stack_watermark_create(struct fiber *fiber)
 {
@@ -1166,6 +1249,31 @@ fiber_stack_create(struct fiber *fiber, struct slab_cache *slabc,
 	return 0;
 }
 
+/**
+ * Take a dead fiber with a stack suitable for the given
+ * attributes from the cache.
+ */
+static struct fiber *
+fiber_cache_get(struct cord *cord, const struct fiber_attr *fiber_attr)
+{
+	struct fiber *fiber;
+	if (!(fiber_attr->flags & FIBER_CUSTOM_STACK)) {
+		if (rlist_empty(&cord->dead))
+			return NULL;
+		fiber = rlist_first_entry(&cord->dead, struct fiber, link);
+		fiber_stack_reuse(fiber);
+		return fiber;
+	}
+	rlist_foreach_entry(fiber, &cord->dead_custom, link) {
+		if (fiber->stack_size_requested == fiber_attr->stack_size) {
+			cord->dead_custom_count--;
+			fiber_stack_reuse(fiber);
+			return fiber;
+		}
+	}
+	return NULL;
+}
+
 struct fiber *
 fiber_new_ex(const char *name, const struct fiber_attr *fiber_attr,
 	     fiber_func f)
@@ -1174,12 +1282,12 @@ fiber_new_ex(const char *name, const struct fiber_attr *fiber_attr,
 	struct fiber *fiber = NULL;
 	assert(fiber_attr != NULL);
 
-	/* Now we can not reuse fiber if custom attribute was set */
-	if (!(fiber_attr->flags & FIBER_CUSTOM_STACK) &&
-	    !rlist_empty(&cord->dead)) {
-		fiber = rlist_first_entry(&cord->dead,
-					  struct fiber, link);
+	fiber = fiber_cache_get(cord, fiber_attr);
+	if (fiber != NULL) {
 		rlist_move_entry(&cord->alive, fiber, link);
+		/* Restore FIBER_CUSTOM_STACK cleared by fiber_reset(). */
+		fiber->flags = fiber_attr->flags;
+		cord->cache_stat.reused++;
 	} else {
 		fiber = (struct fiber *)
 			mempool_alloc(&cord->fiber_mempool);
@@ -1195,6 +1303,7 @@ fiber_new_ex(const char *name, const struct fiber_attr *fiber_attr,
 			mempool_free(&cord->fiber_mempool, fiber);
 			return NULL;
 		}
+		fiber->stack_size_requested = fiber_attr->stack_size;
 		coro_create(&fiber->ctx, fiber_loop, NULL,
 			    fiber->stack, fiber->stack_size);
 
@@ -1207,6 +1316,7 @@ fiber_new_ex(const char *name, const struct fiber_attr *fiber_attr,
 		fiber->flags = fiber_attr->flags;
 
 		rlist_add_entry(&cord->alive, fiber, link);
+		cord->cache_stat.created++;
 	}
 
 	fiber->f = f;
@@ -1275,6 +1385,22 @@ fiber_destroy_all(struct cord *cord)
 	while (!rlist_empty(&cord->dead))
 		fiber_destroy(cord, rlist_first_entry(&cord->dead,
 						      struct fiber, link));
+	while (!rlist_empty(&cord->dead_custom))
+		fiber_destroy(cord, rlist_first_entry(&cord->dead_custom,
+						      struct fiber, link));
+	cord->dead_custom_count = 0;
+	cord->dirty_stack_count = 0;
+}
+
+void
+fiber_cache_stat(struct fiber_cache_stat *stat)
+{
+	struct cord *cord = cord();
+	*stat = cord->cache_stat;
+	stat->cached = cord->dead_custom_count;
+	struct fiber *fiber;
+	rlist_foreach_entry(fiber, &cord->dead, link)
+		stat->cached++;
 }
 
 #if ENABLE_FIBER_TOP
@@ -1372,6 +1498,10 @@ cord_create(struct cord *cord, const char *name)
 	rlist_create(&cord->alive);
 	rlist_create(&cord->ready);
 	rlist_create(&cord->dead);
+	rlist_create(&cord->dead_custom);
+	cord->dead_custom_count = 0;
+	cord->dirty_stack_count = 0;
+	memset(&cord->cache_stat, 0, sizeof(cord->cache_stat));
 	cord->fiber_registry = mh_i32ptr_new();
 
 	/* sched fiber is not present in alive/ready/dead list. */
@@ -1392,6 +1522,9 @@ cord_create(struct cord *cord, const char *name)
 	ev_async_init(&cord->wakeup_event, fiber_schedule_wakeup);
 
 	ev_idle_init(&cord->idle_event, fiber_schedule_idle);
+#ifdef HAVE_MADV_DONTNEED
+	ev_idle_init(&cord->stack_release_event, fiber_stack_release_dirty);
+#endif
 
 #if ENABLE_FIBER_TOP
 	/* fiber.top() currently works only for the main thread. */
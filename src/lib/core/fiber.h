@@ -165,6 +165,30 @@ enum {
 	FIBER_DEFAULT_FLAGS = FIBER_IS_CANCELLABLE
 };
 
+enum {
+	/**
+	 * Max number of dead fibers with a custom stack size
+	 * cached in a cord for reuse.
+	 */
+	FIBER_CUSTOM_STACK_CACHE_MAX = 32,
+};
+
+/**
+ * Statistics of fiber creation and reuse in a cord.
+ */
+struct fiber_cache_stat {
+	/** Fibers created with a new stack. */
+	uint64_t created;
+	/** Fibers taken from the cache of dead fibers. */
+	uint64_t reused;
+	/** Dead fibers destroyed since the cache is full. */
+	uint64_t destroyed;
+	/** Fiber stacks returned to OS with madvise(). */
+	uint64_t stack_releases;
+	/** Dead fibers in the cache now. */
+	uint64_t cached;
+};
+
 /** \cond public */
 
 /**
@@ -414,6 +438,7 @@ struct txn;
 struct credentials;
 struct lua_State;
 struct ipc_wait_pad;
+struct trace_record;
 
 struct fiber {
 	coro_context ctx;
@@ -433,9 +458,20 @@ struct fiber {
 	 * penalty if there are no tasks eager for stack.
 	 */
 	void *stack_watermark;
+	/**
+	 * True if the stack has been used above the watermark
+	 * since it was last released with madvise(). Dead fibers
+	 * with such stacks are released in batches.
+	 */
+	bool stack_is_dirty;
 #endif
 	/** Coro stack size. */
 	size_t stack_size;
+	/**
+	 * Stack size requested on fiber creation. A cached fiber
+	 * with a custom stack is reused only for the same size.
+	 */
+	size_t stack_size_requested;
 	/** Valgrind stack id. */
 	unsigned int stack_id;
 	/* A garbage-collected memory pool. */
@@ -504,10 +540,14 @@ struct fiber {
 			int ref;
 		} lua;
 		/**
-		 * Iproto sync.
+		 * Iproto sync, the time the current request
+		 * has waited for WAL, in clock_ticks(), and its
+		 * trace record if the request is traced.
 		 */
 		struct {
 			uint64_t sync;
+			uint64_t wal_ticks;
+			struct trace_record *trace;
 		} net;
 	} storage;
 	/** An object to wait for incoming message or a reader. */
@@ -556,6 +596,26 @@ struct cord {
 	struct rlist ready;
 	/** A cache of dead fibers for reuse */
 	struct rlist dead;
+	/**
+	 * A cache of dead fibers with a custom stack size, see
+	 * FIBER_CUSTOM_STACK_CACHE_MAX.
+	 */
+	struct rlist dead_custom;
+	/** Number of fibers in the dead_custom list. */
+	uint32_t dead_custom_count;
+	/**
+	 * Number of fibers in the dead and dead_custom lists
+	 * with a dirty stack.
+	 */
+	uint32_t dirty_stack_count;
+	/**
+	 * An idle watcher releasing dirty stacks of dead fibers
+	 * when the event loop has nothing else to do, so that
+	 * madvise() calls stay off the request path.
+	 */
+	ev_idle stack_release_event;
+	/** Fiber creation and reuse statistics. */
+	struct fiber_cache_stat cache_stat;
 	/** A watcher to have a single async event for all ready fibers.
 	 * This technique is necessary to be able to suspend
 	 * a single fiber on a few watchers (for example,
@@ -724,6 +784,13 @@ typedef int (*fiber_stat_cb)(struct fiber *f, void *ctx);
 int
 fiber_stat(fiber_stat_cb cb, void *cb_ctx);
 
+/**
+ * Get fiber creation and reuse statistics of the current
+ * cord.
+ */
+void
+fiber_cache_stat(struct fiber_cache_stat *stat);
+
 #if ENABLE_FIBER_TOP
 bool
 fiber_top_is_enabled();
@@ -0,0 +1,618 @@
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY AUTHORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * AUTHORS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "profiler.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "diag.h"
+
+static profiler_frame_request_f profiler_frame_request = NULL;
+static const char *profiler_api_prefix = NULL;
+
+void
+profiler_set_frame_request(profiler_frame_request_f cb,
+			   const char *api_prefix)
+{
+	profiler_frame_request = cb;
+	profiler_api_prefix = api_prefix;
+}
+
+#if ENABLE_PROFILER
+
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <time.h>
+#include <ucontext.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "backtrace.h"
+#include "fiber.h"
+#include "assoc.h"
+#include "trivia/util.h"
+
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+enum {
+	/** Number of samples in a ring, a power of two. */
+	PROFILER_RING_SIZE = 256,
+	/**
+	 * How deep the interrupted function may be in the
+	 * stack saved by the signal handler.
+	 */
+	PROFILER_HANDLER_FRAMES_MAX = 8,
+};
+
+/** How often the ring is drained, in seconds. */
+static const double PROFILER_DRAIN_PERIOD = 0.1;
+
+struct profiler_sample {
+	/** Number of saved C frames. */
+	int frame_count;
+	/** Return addresses, innermost first. */
+	void *frames[PROFILER_FRAMES_MAX];
+	/** Language frame name, empty if none. */
+	char frame_name[PROFILER_FRAME_NAME_MAX];
+};
+
+/** A distinct stack and the number of its samples. */
+struct profiler_stack {
+	/** Next stack with the same hash. */
+	struct profiler_stack *next;
+	uint64_t count;
+	/** Language frame name or NULL. */
+	char *frame_name;
+	int frame_count;
+	void *frames[0];
+};
+
+struct profiler {
+	/** Timer sending SIGPROF to the cord thread. */
+	timer_t timer;
+	/** Drains the ring in the cord event loop. */
+	struct ev_timer drain_timer;
+	bool is_running;
+	/**
+	 * Index of the next sample to write. Advanced by the
+	 * signal handler.
+	 */
+	unsigned head;
+	/** Index of the next sample to drain. */
+	unsigned tail;
+	/**
+	 * The last sample if the signal handler has requested
+	 * a language frame for it, NULL otherwise. The sample
+	 * isn't drained until it gets the frame or the next
+	 * sample is taken.
+	 */
+	struct profiler_sample *pending;
+	struct profiler_stat stat;
+	/**
+	 * Distinct stacks, by a hash of the frames. Stacks with
+	 * colliding hashes are chained.
+	 */
+	struct mh_i64ptr_t *stacks;
+	struct profiler_sample ring[PROFILER_RING_SIZE];
+};
+
+/** The profiler of the current cord. */
+static __thread struct profiler *cord_profiler = NULL;
+
+/** Return the program counter of an interrupted thread. */
+static void *
+profiler_context_pc(void *context)
+{
+	ucontext_t *uc = (ucontext_t *)context;
+#if defined(__x86_64__)
+	return (void *)uc->uc_mcontext.gregs[REG_RIP];
+#elif defined(__aarch64__)
+	return (void *)uc->uc_mcontext.pc;
+#else
+	(void)uc;
+	return NULL;
+#endif
+}
+
+/** SIGPROF handler: save the stack of the interrupted code. */
+static void
+profiler_signal_cb(int signo, siginfo_t *info, void *context)
+{
+	(void)signo;
+	(void)info;
+	struct profiler *p = cord_profiler;
+	if (p == NULL || !p->is_running)
+		return;
+	int saved_errno = errno;
+	unsigned head = p->head;
+	if (head - __atomic_load_n(&p->tail, __ATOMIC_ACQUIRE) >=
+	    PROFILER_RING_SIZE) {
+		p->stat.dropped++;
+		goto out;
+	}
+	struct profiler_sample *sample =
+		&p->ring[head & (PROFILER_RING_SIZE - 1)];
+	sample->frame_count = backtrace_collect_ip(sample->frames,
+						   PROFILER_FRAMES_MAX);
+	/* Cut off the frames of the handler itself. */
+	void *pc = profiler_context_pc(context);
+	for (int i = 0; i < sample->frame_count &&
+			i < PROFILER_HANDLER_FRAMES_MAX; i++) {
+		if (sample->frames[i] != pc)
+			continue;
+		sample->frame_count -= i;
+		memmove(sample->frames, sample->frames + i,
+			sample->frame_count * sizeof(sample->frames[0]));
+		break;
+	}
+	sample->frame_name[0] = '\0';
+	struct profiler_sample *pending = NULL;
+	if (profiler_frame_request != NULL && profiler_frame_request())
+		pending = sample;
+	__atomic_store_n(&p->pending, pending, __ATOMIC_RELEASE);
+	p->stat.samples++;
+	__atomic_store_n(&p->head, head + 1, __ATOMIC_RELEASE);
+out:
+	errno = saved_errno;
+}
+
+void
+profiler_set_frame(const char *name)
+{
+	struct profiler *p = cord_profiler;
+	if (p == NULL)
+		return;
+	struct profiler_sample *sample =
+		__atomic_exchange_n(&p->pending, NULL, __ATOMIC_ACQ_REL);
+	if (sample != NULL) {
+		snprintf(sample->frame_name, PROFILER_FRAME_NAME_MAX,
+			 "%s", name);
+	}
+}
+
+/** FNV-1a hash of a sample. */
+static uint64_t
+profiler_sample_hash(struct profiler_sample *sample)
+{
+	uint64_t h = 14695981039346656037ULL;
+	const unsigned char *data = (const unsigned char *)sample->frames;
+	size_t size = sample->frame_count * sizeof(sample->frames[0]);
+	for (size_t i = 0; i < size; i++)
+		h = (h ^ data[i]) * 1099511628211ULL;
+	for (const char *c = sample->frame_name; *c != '\0'; c++)
+		h = (h ^ (unsigned char)*c) * 1099511628211ULL;
+	return h;
+}
+
+/** Check if a sample has the same frames as a stack. */
+static bool
+profiler_stack_equal(struct profiler_stack *stack,
+		     struct profiler_sample *sample)
+{
+	const char *name = stack->frame_name != NULL ?
+			   stack->frame_name : "";
+	return stack->frame_count == sample->frame_count &&
+	       memcmp(stack->frames, sample->frames,
+		      sample->frame_count * sizeof(sample->frames[0])) == 0 &&
+	       strcmp(name, sample->frame_name) == 0;
+}
+
+/** Count a sample in the table of distinct stacks. */
+static void
+profiler_account(struct profiler *p, struct profiler_sample *sample)
+{
+	uint64_t hash = profiler_sample_hash(sample);
+	mh_int_t k = mh_i64ptr_find(p->stacks, hash, NULL);
+	struct profiler_stack *head = NULL;
+	if (k != mh_end(p->stacks)) {
+		head = (struct profiler_stack *)
+			mh_i64ptr_node(p->stacks, k)->val;
+		for (struct profiler_stack *stack = head; stack != NULL;
+		     stack = stack->next) {
+			if (profiler_stack_equal(stack, sample)) {
+				stack->count++;
+				return;
+			}
+		}
+	}
+	size_t size = sizeof(struct profiler_stack) +
+		      sample->frame_count * sizeof(sample->frames[0]);
+	struct profiler_stack *stack = (struct profiler_stack *)malloc(size);
+	if (stack == NULL)
+		goto oom;
+	stack->frame_name = NULL;
+	if (sample->frame_name[0] != '\0') {
+		stack->frame_name = strdup(sample->frame_name);
+		if (stack->frame_name == NULL)
+			goto oom_stack;
+	}
+	stack->next = head;
+	stack->count = 1;
+	stack->frame_count = sample->frame_count;
+	memcpy(stack->frames, sample->frames,
+	       sample->frame_count * sizeof(sample->frames[0]));
+	if (head != NULL) {
+		/* A hash collision, chain the new stack. */
+		mh_i64ptr_node(p->stacks, k)->val = stack;
+	} else {
+		struct mh_i64ptr_node_t node = { hash, stack };
+		if (mh_i64ptr_put(p->stacks, &node, NULL,
+				  NULL) == mh_end(p->stacks))
+			goto oom_name;
+	}
+	p->stat.stacks++;
+	return;
+oom_name:
+	free(stack->frame_name);
+oom_stack:
+	free(stack);
+oom:
+	p->stat.dropped++;
+}
+
+/** Move samples from the ring to the table of distinct stacks. */
+static void
+profiler_drain(struct profiler *p)
+{
+	unsigned head = __atomic_load_n(&p->head, __ATOMIC_ACQUIRE);
+	struct profiler_sample *pending =
+		__atomic_load_n(&p->pending, __ATOMIC_ACQUIRE);
+	while (p->tail != head) {
+		struct profiler_sample *sample =
+			&p->ring[p->tail & (PROFILER_RING_SIZE - 1)];
+		if (sample == pending)
+			break;
+		profiler_account(p, sample);
+		__atomic_store_n(&p->tail, p->tail + 1, __ATOMIC_RELEASE);
+	}
+}
+
+static void
+profiler_drain_cb(ev_loop *loop, struct ev_timer *watcher, int revents)
+{
+	(void)loop;
+	(void)revents;
+	profiler_drain((struct profiler *)watcher->data);
+}
+
+static void
+profiler_clear_stacks(struct profiler *p)
+{
+	mh_int_t k;
+	mh_foreach(p->stacks, k) {
+		struct profiler_stack *stack = (struct profiler_stack *)
+			mh_i64ptr_node(p->stacks, k)->val;
+		while (stack != NULL) {
+			struct profiler_stack *next = stack->next;
+			free(stack->frame_name);
+			free(stack);
+			stack = next;
+		}
+	}
+	mh_i64ptr_clear(p->stacks);
+}
+
+static pthread_once_t profiler_signal_once = PTHREAD_ONCE_INIT;
+static int profiler_signal_errno = 0;
+
+static void
+profiler_install_signal_handler(void)
+{
+	struct sigaction sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_sigaction = profiler_signal_cb;
+	sa.sa_flags = SA_SIGINFO | SA_RESTART;
+	sigemptyset(&sa.sa_mask);
+	if (sigaction(SIGPROF, &sa, NULL) != 0)
+		profiler_signal_errno = errno;
+}
+
+/** Create the profiler of the current cord. */
+static struct profiler *
+profiler_new(void)
+{
+	struct profiler *p = (struct profiler *)calloc(1, sizeof(*p));
+	if (p == NULL) {
+		diag_set(OutOfMemory, sizeof(*p), "calloc", "profiler");
+		return NULL;
+	}
+	p->stacks = mh_i64ptr_new();
+	if (p->stacks == NULL) {
+		free(p);
+		diag_set(OutOfMemory, sizeof(*p->stacks), "mh_i64ptr_new",
+			 "profiler stacks");
+		return NULL;
+	}
+	ev_timer_init(&p->drain_timer, profiler_drain_cb,
+		      PROFILER_DRAIN_PERIOD, PROFILER_DRAIN_PERIOD);
+	p->drain_timer.data = p;
+	return p;
+}
+
+int
+profiler_start(double interval)
+{
+	if (interval <= 0) {
+		diag_set(IllegalParams, "profiler interval must be positive");
+		return -1;
+	}
+	pthread_once(&profiler_signal_once, profiler_install_signal_handler);
+	if (profiler_signal_errno != 0) {
+		errno = profiler_signal_errno;
+		diag_set(SystemError, "failed to set SIGPROF handler");
+		return -1;
+	}
+	if (cord_profiler == NULL) {
+		cord_profiler = profiler_new();
+		if (cord_profiler == NULL)
+			return -1;
+	}
+	struct profiler *p = cord_profiler;
+	if (p->is_running) {
+		diag_set(IllegalParams, "profiler is already running");
+		return -1;
+	}
+	struct sigevent sev;
+	memset(&sev, 0, sizeof(sev));
+	sev.sigev_notify = SIGEV_THREAD_ID;
+	sev.sigev_signo = SIGPROF;
+	sev.sigev_notify_thread_id = syscall(SYS_gettid);
+	if (timer_create(CLOCK_THREAD_CPUTIME_ID, &sev, &p->timer) != 0) {
+		diag_set(SystemError, "failed to create profiler timer");
+		return -1;
+	}
+	profiler_clear_stacks(p);
+	memset(&p->stat, 0, sizeof(p->stat));
+	p->head = p->tail = 0;
+	p->pending = NULL;
+	__atomic_store_n(&p->is_running, true, __ATOMIC_RELEASE);
+
+	struct itimerspec its;
+	its.it_interval.tv_sec = (time_t)interval;
+	its.it_interval.tv_nsec = (interval - its.it_interval.tv_sec) * 1e9;
+	if (its.it_interval.tv_sec == 0 && its.it_interval.tv_nsec == 0)
+		its.it_interval.tv_nsec = 1;
+	its.it_value = its.it_interval;
+	if (timer_settime(p->timer, 0, &its, NULL) != 0) {
+		diag_set(SystemError, "failed to start profiler timer");
+		p->is_running = false;
+		timer_delete(p->timer);
+		return -1;
+	}
+	/* Cord threads start with all signals blocked. */
+	sigset_t set;
+	sigemptyset(&set);
+	sigaddset(&set, SIGPROF);
+	pthread_sigmask(SIG_UNBLOCK, &set, NULL);
+	ev_timer_start(cord()->loop, &p->drain_timer);
+	return 0;
+}
+
+void
+profiler_stop(void)
+{
+	struct profiler *p = cord_profiler;
+	if (p == NULL || !p->is_running)
+		return;
+	timer_delete(p->timer);
+	__atomic_store_n(&p->is_running, false, __ATOMIC_RELEASE);
+	ev_timer_stop(cord()->loop, &p->drain_timer);
+	p->pending = NULL;
+	profiler_drain(p);
+}
+
+bool
+profiler_is_running(void)
+{
+	return cord_profiler != NULL && cord_profiler->is_running;
+}
+
+void
+profiler_stat(struct profiler_stat *stat)
+{
+	if (cord_profiler == NULL) {
+		memset(stat, 0, sizeof(*stat));
+		return;
+	}
+	profiler_drain(cord_profiler);
+	*stat = cord_profiler->stat;
+}
+
+/** Append a string to a folded stack. */
+static int
+profiler_fold_append(char **buf, size_t *size, size_t *used,
+		     const char *str)
+{
+	size_t len = strlen(str);
+	/* A separator and the terminating zero. */
+	if (*used + len + 2 > *size) {
+		size_t new_size = MAX(*size * 2, *used + len + 2);
+		char *new_buf = (char *)realloc(*buf, new_size);
+		if (new_buf == NULL) {
+			diag_set(OutOfMemory, new_size, "realloc",
+				 "profiler stack");
+			return -1;
+		}
+		*buf = new_buf;
+		*size = new_size;
+	}
+	if (*used > 0)
+		(*buf)[(*used)++] = ';';
+	memcpy(*buf + *used, str, len + 1);
+	*used += len;
+	return 0;
+}
+
+/** Print a frame name or its address if the name is unknown. */
+static const char *
+profiler_frame_name(void *ip, char *buf, size_t size)
+{
+	const char *name = backtrace_ip_name(ip);
+	if (name != NULL)
+		return name;
+	snprintf(buf, size, "%p", ip);
+	return buf;
+}
+
+/**
+ * Fold a stack to a string, from the outermost frame. The
+ * language frame follows the innermost language API frame,
+ * or the innermost frame if there are none.
+ */
+static int
+profiler_fold(struct profiler_stack *stack, char **buf, size_t *size)
+{
+	char addr[32];
+	int api_frame = 0;
+	if (stack->frame_name != NULL && profiler_api_prefix != NULL) {
+		size_t prefix_len = strlen(profiler_api_prefix);
+		for (int i = 0; i < stack->frame_count; i++) {
+			const char *name = backtrace_ip_name(stack->frames[i]);
+			if (name != NULL &&
+			    strncmp(name, profiler_api_prefix,
+				    prefix_len) == 0) {
+				api_frame = i;
+				break;
+			}
+		}
+	}
+	size_t used = 0;
+	if (*size > 0)
+		(*buf)[0] = '\0';
+	for (int i = stack->frame_count - 1; i >= 0; i--) {
+		const char *name = profiler_frame_name(stack->frames[i], addr,
+						       sizeof(addr));
+		if (profiler_fold_append(buf, size, &used, name) != 0)
+			return -1;
+		if (i == api_frame && stack->frame_name != NULL &&
+		    profiler_fold_append(buf, size, &used,
+					 stack->frame_name) != 0)
+			return -1;
+	}
+	return 0;
+}
+
+int
+profiler_dump(profiler_dump_f cb, void *ctx)
+{
+	struct profiler *p = cord_profiler;
+	if (p == NULL)
+		return 0;
+	profiler_drain(p);
+	char *buf = NULL;
+	size_t size = 0;
+	int rc = 0;
+	mh_int_t k;
+	mh_foreach(p->stacks, k) {
+		struct profiler_stack *stack = (struct profiler_stack *)
+			mh_i64ptr_node(p->stacks, k)->val;
+		for (; stack != NULL && rc == 0; stack = stack->next) {
+			if (stack->frame_count == 0 &&
+			    stack->frame_name == NULL)
+				continue;
+			rc = profiler_fold(stack, &buf, &size);
+			if (rc == 0)
+				rc = cb(buf, stack->count, ctx);
+		}
+		if (rc != 0)
+			break;
+	}
+	free(buf);
+	return rc;
+}
+
+void
+profiler_free(void)
+{
+	struct profiler *p = cord_profiler;
+	if (p == NULL)
+		return;
+	profiler_stop();
+	profiler_clear_stacks(p);
+	mh_i64ptr_delete(p->stacks);
+	free(p);
+	cord_profiler = NULL;
+}
+
+#else /* !ENABLE_PROFILER */
+
+void
+profiler_set_frame(const char *name)
+{
+	(void)name;
+}
+
+int
+profiler_start(double interval)
+{
+	if (interval <= 0) {
+		diag_set(IllegalParams, "profiler interval must be positive");
+		return -1;
+	}
+	diag_set(IllegalParams, "profiler is not supported on this platform");
+	return -1;
+}
+
+void
+profiler_stop(void)
+{
+}
+
+bool
+profiler_is_running(void)
+{
+	return false;
+}
+
+void
+profiler_stat(struct profiler_stat *stat)
+{
+	memset(stat, 0, sizeof(*stat));
+}
+
+int
+profiler_dump(profiler_dump_f cb, void *ctx)
+{
+	(void)cb;
+	(void)ctx;
+	return 0;
+}
+
+void
+profiler_free(void)
+{
+}
+
+#endif /* ENABLE_PROFILER */
@@ -0,0 +1,163 @@
+#ifndef TARANTOOL_LIB_CORE_PROFILER_H_INCLUDED
+#define TARANTOOL_LIB_CORE_PROFILER_H_INCLUDED
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY AUTHORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * AUTHORS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "trivia/config.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * The profiler samples call stacks with a signal sent by a
+ * per-thread timer and unwinds them with libunwind, so it is
+ * available only on Linux with backtraces enabled.
+ */
+#if defined(ENABLE_BACKTRACE) && defined(__linux__)
+#define ENABLE_PROFILER 1
+#else
+#define ENABLE_PROFILER 0
+#endif
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+/**
+ * Sampling CPU profiler. Each cord may run its own profiler:
+ * a timer measuring the CPU time of the cord thread interrupts
+ * it with SIGPROF, and the signal handler saves the call stack
+ * of the running code to a ring buffer. The ring is drained
+ * into a table of distinct stacks by a timer in the cord event
+ * loop and before the stacks are dumped.
+ *
+ * An embedded language, such as Lua, may attach its current
+ * frame to a sample: the signal handler calls the frame request
+ * callback, and once the language reaches a safe point it hands
+ * the frame name over with profiler_set_frame(). In a folded
+ * stack the language frame follows the innermost C function of
+ * the language API, the one that has called into its VM.
+ *
+ * Functions are named by the dynamic symbol table, so functions
+ * which aren't exported are shown by address.
+ */
+
+enum {
+	/** Max number of C frames saved in a sample. */
+	PROFILER_FRAMES_MAX = 64,
+	/** Max length of a language frame name, with '\0'. */
+	PROFILER_FRAME_NAME_MAX = 128,
+};
+
+/**
+ * A callback invoked by the signal handler to request the
+ * current language frame. Must be async-signal-safe.
+ * Returns true if the frame will be passed with
+ * profiler_set_frame().
+ */
+typedef bool
+(*profiler_frame_request_f)(void);
+
+/** Profiler statistics of the current cord. */
+struct profiler_stat {
+	/** Samples taken since the profiler was started. */
+	uint64_t samples;
+	/** Samples dropped because the ring was full. */
+	uint64_t dropped;
+	/** Number of distinct stacks collected. */
+	uint64_t stacks;
+};
+
+/**
+ * A callback for profiler_dump(): @a stack is a folded stack,
+ * function names from the outermost one separated by ';',
+ * @a count is the number of samples with this stack.
+ */
+typedef int
+(*profiler_dump_f)(const char *stack, uint64_t count, void *ctx);
+
+/**
+ * Set the language frame request callback, shared by all
+ * cords. NULL disables language frames. @a api_prefix is the
+ * common prefix of the language API function names.
+ */
+void
+profiler_set_frame_request(profiler_frame_request_f cb,
+			   const char *api_prefix);
+
+/**
+ * Attach a language frame name to the last sample of the
+ * current cord, if it has requested one. Not async-signal-safe.
+ */
+void
+profiler_set_frame(const char *name);
+
+/**
+ * Start sampling the current cord every @a interval seconds
+ * of its CPU time. Stacks collected by a previous run are
+ * discarded.
+ * @retval 0 Success.
+ * @retval -1 Error, the diag is set.
+ */
+int
+profiler_start(double interval);
+
+/**
+ * Stop sampling the current cord. Collected stacks are kept
+ * until the next start. Does nothing if it isn't running.
+ */
+void
+profiler_stop(void);
+
+/** Return true if the profiler of the current cord is running. */
+bool
+profiler_is_running(void);
+
+/** Get statistics of the profiler of the current cord. */
+void
+profiler_stat(struct profiler_stat *stat);
+
+/**
+ * Call @a cb for each distinct stack collected by the profiler
+ * of the current cord. Stops if @a cb returns non-zero and
+ * returns its result.
+ */
+int
+profiler_dump(profiler_dump_f cb, void *ctx);
+
+/** Free the profiler of the current cord. */
+void
+profiler_free(void);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_LIB_CORE_PROFILER_H_INCLUDED */
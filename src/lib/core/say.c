@@ -32,6 +32,7 @@
 #include "fiber.h"
 #include "errinj.h"
 #include "tt_static.h"
+#include "tt_pthread.h"
 
 #include <errno.h>
 #include <stdarg.h>
@@ -42,7 +43,11 @@
 #include <sys/types.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <time.h>
 #include <syslog.h>
+#include <sys/uio.h>
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <arpa/inet.h>
@@ -643,6 +648,7 @@ log_create(struct log *log, const char *init_str, int nonblock)
 	log->format_func = NULL;
 	log->level = S_INFO;
 	log->rotating_threads = 0;
+	log->is_async = false;
 	fiber_cond_create(&log->rotate_cond);
 	ev_async_init(&log->log_async, log_rotate_async_cb);
 	setvbuf(stderr, NULL, _IONBF, 0);
@@ -738,6 +744,14 @@ fail:
 	panic("failed to initialize logging subsystem");
 }
 
+int
+say_logger_async_init(enum say_async_overflow overflow)
+{
+	if (log_default != &log_std)
+		return 0;
+	return log_async_start(log_default, overflow);
+}
+
 void
 say_logger_free()
 {
@@ -1061,6 +1075,434 @@ write_to_syslog(struct log *log, int total)
 	}
 }
 
+/**
+ * Asynchronous logger
+ */
+
+enum {
+	/** Size of a per-thread ring of formatted records. */
+	SAY_RING_SIZE = 256 * 1024,
+	/** Length of a record telling the reader to wrap. */
+	SAY_RING_WRAP = UINT32_MAX,
+	/** Max number of records written with one writev(). */
+	SAY_ASYNC_IOV_MAX = 64,
+	/** How long to wait for a non-blocking fd, milliseconds. */
+	SAY_ASYNC_POLL_TIMEOUT = 1000,
+};
+
+/** How often the logger thread looks into the rings, seconds. */
+static const double SAY_ASYNC_PERIOD = 0.01;
+
+/**
+ * A single producer single consumer ring of formatted records.
+ * Every thread writing to the asynchronous log owns one, the
+ * logger thread is the only reader. A record is a 4-byte length
+ * followed by the text and padded to 8 bytes, so a record which
+ * does not fit before the end of the ring can always put a wrap
+ * marker there and start over from the beginning.
+ */
+struct say_ring {
+	/** Write position, advanced by the owner thread only. */
+	uint64_t head;
+	/** Read position, advanced by the logger thread only. */
+	uint64_t tail;
+	/** Set when the owner thread has exited. */
+	bool is_orphan;
+	/** Link in say_async.rings. */
+	struct rlist in_rings;
+	char data[SAY_RING_SIZE];
+};
+
+/** The logger thread. There is at most one asynchronous log. */
+static struct {
+	/** Log being written, NULL if the thread is not running. */
+	struct log *log;
+	/** Overflow policy of the log. */
+	enum say_async_overflow overflow;
+	pthread_t thread;
+	/**
+	 * Protects the list of rings and serializes draining,
+	 * which may block in write.
+	 */
+	pthread_mutex_t drain_mutex;
+	/** All registered rings. */
+	struct rlist rings;
+	/** Protects the condition variables and the flags below. */
+	pthread_mutex_t mutex;
+	/** Wakes the logger thread up before the period ends. */
+	pthread_cond_t wakeup_cond;
+	/** Broadcast after each pass for blocked writers. */
+	pthread_cond_t space_cond;
+	/** Set if wakeup_cond has been signalled. */
+	bool is_signalled;
+	/** Set when the logger thread is asked to exit. */
+	bool is_stopping;
+	/** Number of records dropped on overflow. */
+	uint64_t dropped;
+	/** Number of dropped records already reported. */
+	uint64_t dropped_reported;
+} say_async = {
+	.drain_mutex = PTHREAD_MUTEX_INITIALIZER,
+	.rings = RLIST_HEAD_INITIALIZER(say_async.rings),
+	.mutex = PTHREAD_MUTEX_INITIALIZER,
+	.wakeup_cond = PTHREAD_COND_INITIALIZER,
+	.space_cond = PTHREAD_COND_INITIALIZER,
+};
+
+/** Ring of the current thread, created on the first write. */
+static __thread struct say_ring *say_ring_self;
+
+/** Lets the logger thread know that the owner has exited. */
+static pthread_key_t say_ring_key;
+static pthread_once_t say_ring_key_once = PTHREAD_ONCE_INIT;
+
+static const char *say_async_overflow_strs[] = {
+	[SAY_OVERFLOW_BLOCK] = "block",
+	[SAY_OVERFLOW_DROP] = "drop",
+	[SAY_OVERFLOW_COUNTER] = "counter",
+	[say_async_overflow_MAX] = "unknown"
+};
+
+enum say_async_overflow
+say_async_overflow_by_name(const char *name)
+{
+	return STR2ENUM(say_async_overflow, name);
+}
+
+static inline size_t
+say_record_size(uint32_t len)
+{
+	return (sizeof(len) + len + 7) & ~(size_t)7;
+}
+
+static void
+say_ring_key_dtor(void *arg)
+{
+	struct say_ring *ring = (struct say_ring *) arg;
+	tt_pthread_mutex_lock(&say_async.drain_mutex);
+	if (say_async.log != NULL) {
+		/* The logger thread frees it once it is drained. */
+		ring->is_orphan = true;
+	} else {
+		rlist_del_entry(ring, in_rings);
+		free(ring);
+	}
+	tt_pthread_mutex_unlock(&say_async.drain_mutex);
+}
+
+static void
+say_ring_key_create(void)
+{
+	tt_pthread_key_create(&say_ring_key, say_ring_key_dtor);
+}
+
+static struct say_ring *
+say_ring_new(void)
+{
+	struct say_ring *ring = (struct say_ring *) malloc(sizeof(*ring));
+	if (ring == NULL)
+		return NULL;
+	ring->head = 0;
+	ring->tail = 0;
+	ring->is_orphan = false;
+	tt_pthread_once(&say_ring_key_once, say_ring_key_create);
+	tt_pthread_mutex_lock(&say_async.drain_mutex);
+	rlist_add_tail_entry(&say_async.rings, ring, in_rings);
+	tt_pthread_mutex_unlock(&say_async.drain_mutex);
+	tt_pthread_setspecific(say_ring_key, ring);
+	say_ring_self = ring;
+	return ring;
+}
+
+/**
+ * Write a batch of records, like the synchronous logger give up
+ * on errors other than a full non-blocking fd.
+ */
+static void
+say_async_writev(int fd, struct iovec *iov, int iovcnt)
+{
+	while (iovcnt > 0) {
+		ssize_t n = writev(fd, iov, iovcnt);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno != EAGAIN && errno != EWOULDBLOCK)
+				return;
+			struct pollfd pfd = { .fd = fd, .events = POLLOUT };
+			if (poll(&pfd, 1, SAY_ASYNC_POLL_TIMEOUT) <= 0)
+				return;
+			continue;
+		}
+		while (iovcnt > 0 && (size_t) n >= iov->iov_len) {
+			n -= iov->iov_len;
+			iov++;
+			iovcnt--;
+		}
+		if (iovcnt > 0) {
+			iov->iov_base = (char *) iov->iov_base + n;
+			iov->iov_len -= n;
+		}
+	}
+}
+
+/** Write out all records of a ring available at the moment. */
+static void
+say_ring_drain(struct say_ring *ring, int fd)
+{
+	struct iovec iov[SAY_ASYNC_IOV_MAX];
+	uint64_t tail = ring->tail;
+	uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+	while (tail != head) {
+		int iovcnt = 0;
+		while (tail != head && iovcnt < SAY_ASYNC_IOV_MAX) {
+			size_t offset = tail % SAY_RING_SIZE;
+			uint32_t len = *(uint32_t *) (ring->data + offset);
+			if (len == SAY_RING_WRAP) {
+				tail += SAY_RING_SIZE - offset;
+				continue;
+			}
+			iov[iovcnt].iov_base = ring->data + offset + sizeof(len);
+			iov[iovcnt].iov_len = len;
+			iovcnt++;
+			tail += say_record_size(len);
+		}
+		say_async_writev(fd, iov, iovcnt);
+		__atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+	}
+}
+
+/** Drain all rings, must be called under drain_mutex. */
+static void
+say_async_drain(void)
+{
+	int fd = say_async.log->fd;
+	struct say_ring *ring, *tmp;
+	rlist_foreach_entry_safe(ring, &say_async.rings, in_rings, tmp) {
+		say_ring_drain(ring, fd);
+		if (ring->is_orphan &&
+		    ring->tail == __atomic_load_n(&ring->head,
+						  __ATOMIC_ACQUIRE)) {
+			rlist_del_entry(ring, in_rings);
+			free(ring);
+		}
+	}
+}
+
+/** Write out records queued so far, called on a fatal error. */
+static void
+say_async_flush(void)
+{
+	if (pthread_equal(pthread_self(), say_async.thread))
+		return;
+	tt_pthread_mutex_lock(&say_async.drain_mutex);
+	if (say_async.log != NULL)
+		say_async_drain();
+	tt_pthread_mutex_unlock(&say_async.drain_mutex);
+}
+
+static void
+say_async_wakeup(void)
+{
+	tt_pthread_mutex_lock(&say_async.mutex);
+	__atomic_store_n(&say_async.is_signalled, true, __ATOMIC_RELAXED);
+	tt_pthread_cond_signal(&say_async.wakeup_cond);
+	tt_pthread_mutex_unlock(&say_async.mutex);
+}
+
+/**
+ * Wait until the ring has room for a record ending at @a end.
+ * @retval false the logger thread has stopped.
+ */
+static bool
+say_ring_wait(struct say_ring *ring, uint64_t end)
+{
+	bool is_running = true;
+	tt_pthread_mutex_lock(&say_async.mutex);
+	__atomic_store_n(&say_async.is_signalled, true, __ATOMIC_RELAXED);
+	tt_pthread_cond_signal(&say_async.wakeup_cond);
+	while (end - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) >
+	       SAY_RING_SIZE) {
+		if (say_async.is_stopping) {
+			is_running = false;
+			break;
+		}
+		tt_pthread_cond_wait(&say_async.space_cond, &say_async.mutex);
+	}
+	tt_pthread_mutex_unlock(&say_async.mutex);
+	return is_running;
+}
+
+/**
+ * Asynchronous logger: put the record formatted in buf into the
+ * ring of the current thread.
+ */
+static void
+write_to_ring(struct log *log, int level, int total)
+{
+	assert(log->is_async);
+	assert(total >= 0);
+	struct say_ring *ring = say_ring_self;
+	if (level == S_FATAL || (ring == NULL &&
+				 (ring = say_ring_new()) == NULL)) {
+		/*
+		 * The process is about to die or there is no
+		 * memory for a ring: write what is queued and
+		 * then the record itself.
+		 */
+		say_async_flush();
+		write_to_file(log, total);
+		return;
+	}
+	uint32_t len = MIN(total, SAY_BUF_LEN_MAX - 1);
+	size_t size = say_record_size(len);
+	uint64_t head = ring->head;
+	size_t offset = head % SAY_RING_SIZE;
+	size_t skip = offset + size > SAY_RING_SIZE ?
+		      SAY_RING_SIZE - offset : 0;
+	uint64_t end = head + skip + size;
+	uint64_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+	if (end - tail > SAY_RING_SIZE) {
+		if (say_async.overflow != SAY_OVERFLOW_BLOCK) {
+			__atomic_add_fetch(&say_async.dropped, 1,
+					   __ATOMIC_RELAXED);
+			return;
+		}
+		if (!say_ring_wait(ring, end)) {
+			write_to_file(log, total);
+			return;
+		}
+		tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+	}
+	if (skip != 0) {
+		*(uint32_t *) (ring->data + offset) = SAY_RING_WRAP;
+		offset = 0;
+	}
+	memcpy(ring->data + offset + sizeof(len), buf, len);
+	*(uint32_t *) (ring->data + offset) = len;
+	__atomic_store_n(&ring->head, end, __ATOMIC_RELEASE);
+	/*
+	 * Do not wait for the period to end if the ring is
+	 * getting full.
+	 */
+	if (end - tail > SAY_RING_SIZE / 2 &&
+	    !__atomic_load_n(&say_async.is_signalled, __ATOMIC_RELAXED))
+		say_async_wakeup();
+}
+
+/** Log the number of records dropped since the last report. */
+static void
+say_async_report_dropped(void)
+{
+	if (say_async.overflow != SAY_OVERFLOW_COUNTER)
+		return;
+	uint64_t dropped = __atomic_load_n(&say_async.dropped,
+					   __ATOMIC_RELAXED);
+	if (dropped == say_async.dropped_reported)
+		return;
+	log_say(say_async.log, S_WARN, __FILE__, __LINE__, NULL,
+		"%llu log records dropped because the logger is too slow",
+		(unsigned long long) (dropped - say_async.dropped_reported));
+	say_async.dropped_reported = dropped;
+}
+
+static void *
+say_async_f(void *arg)
+{
+	(void) arg;
+	bool is_stopping = false;
+	while (!is_stopping) {
+		tt_pthread_mutex_lock(&say_async.mutex);
+		if (!say_async.is_signalled && !say_async.is_stopping) {
+			struct timespec ts;
+			clock_gettime(CLOCK_REALTIME, &ts);
+			double deadline = ts.tv_sec + ts.tv_nsec / 1e9 +
+					  SAY_ASYNC_PERIOD;
+			ts.tv_sec = (time_t) deadline;
+			ts.tv_nsec = (deadline - ts.tv_sec) * 1e9;
+			tt_pthread_cond_timedwait(&say_async.wakeup_cond,
+						  &say_async.mutex, &ts);
+		}
+		__atomic_store_n(&say_async.is_signalled, false,
+				 __ATOMIC_RELAXED);
+		is_stopping = say_async.is_stopping;
+		tt_pthread_mutex_unlock(&say_async.mutex);
+
+		say_async_report_dropped();
+		tt_pthread_mutex_lock(&say_async.drain_mutex);
+		say_async_drain();
+		tt_pthread_mutex_unlock(&say_async.drain_mutex);
+
+		tt_pthread_mutex_lock(&say_async.mutex);
+		tt_pthread_cond_broadcast(&say_async.space_cond);
+		tt_pthread_mutex_unlock(&say_async.mutex);
+	}
+	return NULL;
+}
+
+int
+log_async_start(struct log *log, enum say_async_overflow overflow)
+{
+	assert(!log->is_async);
+	assert(overflow < say_async_overflow_MAX);
+	if (log->type != SAY_LOGGER_FILE && log->type != SAY_LOGGER_PIPE &&
+	    log->type != SAY_LOGGER_STDERR) {
+		diag_set(IllegalParams, "asynchronous logging is supported "
+			 "for file, pipe and stderr loggers only");
+		return -1;
+	}
+	if (say_async.log != NULL) {
+		diag_set(IllegalParams, "another log is asynchronous");
+		return -1;
+	}
+	say_async.overflow = overflow;
+	say_async.is_stopping = false;
+	say_async.is_signalled = false;
+	say_async.dropped_reported = say_async.dropped;
+	tt_pthread_mutex_lock(&say_async.drain_mutex);
+	say_async.log = log;
+	tt_pthread_mutex_unlock(&say_async.drain_mutex);
+	if (tt_pthread_create(&say_async.thread, NULL,
+			      say_async_f, NULL) != 0) {
+		tt_pthread_mutex_lock(&say_async.drain_mutex);
+		say_async.log = NULL;
+		tt_pthread_mutex_unlock(&say_async.drain_mutex);
+		diag_set(SystemError, "failed to create logger thread");
+		return -1;
+	}
+	log->is_async = true;
+	return 0;
+}
+
+void
+log_async_stop(struct log *log)
+{
+	if (!log->is_async)
+		return;
+	assert(say_async.log == log);
+	/*
+	 * New records go straight to the fd, the ones already
+	 * queued are written by the last pass of the thread.
+	 */
+	log->is_async = false;
+	tt_pthread_mutex_lock(&say_async.mutex);
+	say_async.is_stopping = true;
+	tt_pthread_cond_signal(&say_async.wakeup_cond);
+	tt_pthread_mutex_unlock(&say_async.mutex);
+	tt_pthread_join(say_async.thread, NULL);
+	tt_pthread_mutex_lock(&say_async.drain_mutex);
+	say_async.log = NULL;
+	tt_pthread_mutex_unlock(&say_async.drain_mutex);
+	tt_pthread_mutex_lock(&say_async.mutex);
+	tt_pthread_cond_broadcast(&say_async.space_cond);
+	tt_pthread_mutex_unlock(&say_async.mutex);
+}
+
+uint64_t
+log_async_dropped(void)
+{
+	return __atomic_load_n(&say_async.dropped, __ATOMIC_RELAXED);
+}
+
 /** Loggers }}} */
 
 /*
@@ -1208,6 +1650,7 @@ void
 log_destroy(struct log *log)
 {
 	assert(log != NULL);
+	log_async_stop(log);
 	while(log->rotating_threads > 0)
 		fiber_cond_wait(&log->rotate_cond);
 	pm_atomic_store(&log->type, SAY_LOGGER_BOOT);
@@ -1235,7 +1678,10 @@ log_vsay(struct log *log, int level, const char *filename, int line,
 	case SAY_LOGGER_FILE:
 	case SAY_LOGGER_PIPE:
 	case SAY_LOGGER_STDERR:
-		write_to_file(log, total);
+		if (log->is_async)
+			write_to_ring(log, level, total);
+		else
+			write_to_file(log, total);
 		break;
 	case SAY_LOGGER_SYSLOG:
 		write_to_syslog(log, total);
@@ -134,6 +134,23 @@ enum syslog_facility {
 	syslog_facility_MAX,
 };
 
+/**
+ * What an asynchronous log does with a record when the ring
+ * of the writing thread is full.
+ */
+enum say_async_overflow {
+	/** Wait until the logger thread frees some space. */
+	SAY_OVERFLOW_BLOCK,
+	/** Throw the record away. */
+	SAY_OVERFLOW_DROP,
+	/**
+	 * Throw the record away and log the number of dropped
+	 * records once the logger thread catches up.
+	 */
+	SAY_OVERFLOW_COUNTER,
+	say_async_overflow_MAX,
+};
+
 struct log;
 
 typedef int (*log_format_func_t)(struct log *log, char *buf, int len, int level,
@@ -175,6 +192,11 @@ struct log {
 	int rotating_threads;
 	enum syslog_facility syslog_facility;
 	struct rlist in_log_list;
+	/**
+	 * True if records are passed to the logger thread
+	 * instead of being written by the calling thread.
+	 */
+	bool is_async;
 };
 
 /**
@@ -191,6 +213,32 @@ log_create(struct log *log, const char *init_str, int nonblock);
 void
 log_destroy(struct log *log);
 
+/**
+ * Switch a log to the asynchronous mode: a thread formats a
+ * record into its own lock-free ring and a dedicated logger
+ * thread writes the rings out in batches. Only file, pipe and
+ * stderr logs are supported, and only one log can be
+ * asynchronous at a time.
+ *
+ * @param log		log to switch
+ * @param overflow	what to do when a ring is full
+ * @return 0 on success, -1 on error, the error is saved in
+ * the diagnostics area
+ */
+int
+log_async_start(struct log *log, enum say_async_overflow overflow);
+
+/**
+ * Write out all queued records, stop the logger thread and
+ * switch the log back to synchronous writes.
+ */
+void
+log_async_stop(struct log *log);
+
+/** Number of records dropped by the asynchronous log so far. */
+uint64_t
+log_async_dropped(void);
+
 /** Perform log write. */
 int
 log_say(struct log *log, int level, const char *filename,
@@ -261,6 +309,14 @@ say_set_log_format(enum say_format format);
 enum say_format
 say_format_by_name(const char *format);
 
+/**
+ * Return overflow policy by name.
+ *
+ * @retval say_async_overflow_MAX on error
+ */
+enum say_async_overflow
+say_async_overflow_by_name(const char *name);
+
 struct ev_loop;
 struct ev_signal;
 
@@ -274,6 +330,14 @@ say_logger_init(const char *init_str,
 		const char *log_format,
 		int background);
 
+/**
+ * Switch the default logger to the asynchronous mode. Must be
+ * called after daemonizing, since the logger thread does not
+ * survive fork().
+ */
+int
+say_logger_async_init(enum say_async_overflow overflow);
+
 /** Free default logger */
 void
 say_logger_free();
@@ -0,0 +1,334 @@
+/*
+ * *No header guard*: the header is allowed to be included twice
+ * with different sets of defines.
+ */
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <assert.h>
+
+/**
+ * A tournament (loser) tree for k-way merging.
+ *
+ * Every value lives in a leaf, every internal node remembers the
+ * leaf that lost the match played there, and the overall winner
+ * is kept apart. When the key of the winner changes, or the winner
+ * is deleted, only the matches on the path from its leaf to the
+ * root are replayed, which takes log2(k) comparisons, while a
+ * binary heap needs up to 2 * log2(k) to sift a node down.
+ *
+ * Unlike a heap, the tree can only replay the path of the winner.
+ * Inserting a value or deleting a value other than the winner
+ * marks the tree for a rebuild, which costs k - 1 comparisons
+ * and happens on the next call to top(). So the tree suits a
+ * merge, where all sources are added before the first value is
+ * fetched and then the winner is advanced or deleted.
+ *
+ * Usage is the same as of salad/heap.h:
+ *
+ * #define LOSER_TREE_NAME my_tree
+ * #define LOSER_TREE_LESS(tree, a, b) my_value_less(a, b)
+ * #define loser_tree_value_t struct my_value
+ * #define loser_tree_value_attr in_tree
+ * #include "salad/loser_tree.h"
+ *
+ * where struct my_value has a struct loser_tree_node in_tree
+ * member. Define LOSER_TREE_FORWARD_DECLARATION before the
+ * include to get the structures only.
+ */
+#ifndef LOSER_TREE_FORWARD_DECLARATION
+
+#ifndef LOSER_TREE_NAME
+#error "LOSER_TREE_NAME must be defined"
+#endif
+
+#ifndef LOSER_TREE_LESS
+#error "LOSER_TREE_LESS must be defined"
+#endif
+
+#ifndef loser_tree_value_t
+#error "loser_tree_value_t must be defined"
+#endif
+
+#ifndef loser_tree_value_attr
+#error "loser_tree_value_attr must be defined"
+#endif
+
+#ifndef CONCAT3
+#define CONCAT3_R(a, b, c) a##b##c
+#define CONCAT3(a, b, c) CONCAT3_R(a, b, c)
+#endif
+
+#ifndef LOSER_TREE
+#define LOSER_TREE(name) CONCAT3(LOSER_TREE_NAME, _, name)
+#endif
+
+#endif /* LOSER_TREE_FORWARD_DECLARATION */
+
+#ifndef LOSER_TREE_STRUCTURES /* Include guard for structures */
+
+#define LOSER_TREE_STRUCTURES
+
+enum {
+	LOSER_TREE_INITIAL_CAPACITY = 8,
+	LOSER_TREE_STRAY_LEAF = UINT32_MAX,
+};
+
+typedef struct loser_tree {
+	/** Values, NULL for a deleted one. */
+	struct loser_tree_node **leaves;
+	/**
+	 * Leaves lost at internal nodes 1..leaf_count - 1, the
+	 * node N has children 2N and 2N + 1, the leaf L is the
+	 * child number leaf_count + L. The winner is at 0.
+	 */
+	uint32_t *losers;
+	/** Number of leaves, including deleted ones. */
+	uint32_t leaf_count;
+	/** Number of allocated leaves. */
+	uint32_t capacity;
+	/** Number of values in the tree. */
+	uint32_t size;
+	/** Set if losers have to be rebuilt. */
+	bool is_dirty;
+} loser_tree_t;
+
+/** Tree entry structure. */
+struct loser_tree_node {
+	/** Leaf of the node or LOSER_TREE_STRAY_LEAF. */
+	uint32_t leaf;
+};
+
+/** Initialize a tree node with default values. */
+static inline void
+loser_tree_node_create(struct loser_tree_node *node)
+{
+	node->leaf = LOSER_TREE_STRAY_LEAF;
+}
+
+/** Check if a tree node does not belong to any tree. */
+static inline bool
+loser_tree_node_is_stray(const struct loser_tree_node *node)
+{
+	return node->leaf == LOSER_TREE_STRAY_LEAF;
+}
+
+#endif /* LOSER_TREE_STRUCTURES */
+
+#ifndef LOSER_TREE_FORWARD_DECLARATION
+
+#ifndef container_of
+#define container_of(ptr, type, member) ({ \
+	const typeof( ((type *)0)->member  ) *__mptr = (ptr); \
+	(type *)( (char *)__mptr - offsetof(type,member)  );})
+#endif
+
+#define node_to_value(n) container_of(n, loser_tree_value_t, \
+				      loser_tree_value_attr)
+#define value_to_node(v) (&(v)->loser_tree_value_attr)
+
+/** Initialize an empty tree. */
+static inline void
+LOSER_TREE(create)(loser_tree_t *tree)
+{
+	tree->leaves = NULL;
+	tree->losers = NULL;
+	tree->leaf_count = 0;
+	tree->capacity = 0;
+	tree->size = 0;
+	tree->is_dirty = false;
+}
+
+/** Free the tree, the values are not touched. */
+static inline void
+LOSER_TREE(destroy)(loser_tree_t *tree)
+{
+	free(tree->leaves);
+	free(tree->losers);
+}
+
+/**
+ * Return true if the value in leaf @a a goes before the one in
+ * leaf @a b. Deleted leaves go after everything.
+ */
+static inline bool
+LOSER_TREE(beats)(loser_tree_t *tree, uint32_t a, uint32_t b)
+{
+	struct loser_tree_node *node_a = tree->leaves[a];
+	struct loser_tree_node *node_b = tree->leaves[b];
+	if (node_b == NULL)
+		return true;
+	if (node_a == NULL)
+		return false;
+	return !LOSER_TREE_LESS(tree, node_to_value(node_b),
+				node_to_value(node_a));
+}
+
+/** Replay matches on the path from the winner to the root. */
+static inline void
+LOSER_TREE(replay)(loser_tree_t *tree)
+{
+	uint32_t winner = tree->losers[0];
+	for (uint32_t i = (winner + tree->leaf_count) / 2; i > 0; i /= 2) {
+		uint32_t loser = tree->losers[i];
+		if (!LOSER_TREE(beats)(tree, winner, loser)) {
+			tree->losers[i] = winner;
+			winner = loser;
+		}
+	}
+	tree->losers[0] = winner;
+}
+
+/**
+ * Play all matches. A leaf climbs up until it loses or finds
+ * an internal node no one has reached yet and waits there for
+ * a contender from the other subtree.
+ */
+static inline void
+LOSER_TREE(build)(loser_tree_t *tree)
+{
+	uint32_t count = tree->leaf_count;
+	for (uint32_t i = 1; i < count; i++)
+		tree->losers[i] = LOSER_TREE_STRAY_LEAF;
+	for (uint32_t leaf = 0; leaf < count; leaf++) {
+		uint32_t winner = leaf;
+		uint32_t i = (leaf + count) / 2;
+		for (; i > 0; i /= 2) {
+			uint32_t loser = tree->losers[i];
+			if (loser == LOSER_TREE_STRAY_LEAF) {
+				tree->losers[i] = winner;
+				break;
+			}
+			if (!LOSER_TREE(beats)(tree, winner, loser)) {
+				tree->losers[i] = winner;
+				winner = loser;
+			}
+		}
+		if (i == 0)
+			tree->losers[0] = winner;
+	}
+	tree->is_dirty = false;
+}
+
+/** Return the min value or NULL if the tree is empty. */
+static inline loser_tree_value_t *
+LOSER_TREE(top)(loser_tree_t *tree)
+{
+	if (tree->size == 0)
+		return NULL;
+	if (tree->is_dirty)
+		LOSER_TREE(build)(tree);
+	struct loser_tree_node *node = tree->leaves[tree->losers[0]];
+	assert(node != NULL);
+	return node_to_value(node);
+}
+
+/**
+ * Add a value to the tree.
+ * @retval 0 success
+ * @retval -1 memory error
+ */
+static inline int
+LOSER_TREE(insert)(loser_tree_t *tree, loser_tree_value_t *value)
+{
+	struct loser_tree_node *node = value_to_node(value);
+	assert(loser_tree_node_is_stray(node));
+	if (tree->leaf_count == tree->capacity) {
+		uint32_t capacity = tree->capacity == 0 ?
+				    LOSER_TREE_INITIAL_CAPACITY :
+				    tree->capacity * 2;
+		struct loser_tree_node **leaves = (struct loser_tree_node **)
+			realloc(tree->leaves, capacity * sizeof(*leaves));
+		if (leaves == NULL)
+			return -1;
+		tree->leaves = leaves;
+		uint32_t *losers = (uint32_t *)
+			realloc(tree->losers, capacity * sizeof(*losers));
+		if (losers == NULL)
+			return -1;
+		tree->losers = losers;
+		tree->capacity = capacity;
+	}
+	node->leaf = tree->leaf_count++;
+	tree->leaves[node->leaf] = node;
+	tree->size++;
+	tree->is_dirty = true;
+	return 0;
+}
+
+/**
+ * Restore the order after the key of a value has changed. Cheap
+ * if the value is the min one.
+ */
+static inline void
+LOSER_TREE(update)(loser_tree_t *tree, loser_tree_value_t *value)
+{
+	struct loser_tree_node *node = value_to_node(value);
+	assert(!loser_tree_node_is_stray(node));
+	if (!tree->is_dirty && tree->losers[0] == node->leaf)
+		LOSER_TREE(replay)(tree);
+	else
+		tree->is_dirty = true;
+}
+
+/**
+ * Delete a value from the tree. Cheap if the value is the min
+ * one.
+ */
+static inline void
+LOSER_TREE(delete)(loser_tree_t *tree, loser_tree_value_t *value)
+{
+	struct loser_tree_node *node = value_to_node(value);
+	assert(!loser_tree_node_is_stray(node));
+	assert(tree->leaves[node->leaf] == node);
+	tree->leaves[node->leaf] = NULL;
+	tree->size--;
+	if (!tree->is_dirty && tree->losers[0] == node->leaf)
+		LOSER_TREE(replay)(tree);
+	else
+		tree->is_dirty = true;
+	node->leaf = LOSER_TREE_STRAY_LEAF;
+}
+
+#undef node_to_value
+#undef value_to_node
+#undef loser_tree_value_t
+#undef loser_tree_value_attr
+
+#endif /* LOSER_TREE_FORWARD_DECLARATION */
+
+#undef LOSER_TREE_FORWARD_DECLARATION
+#undef LOSER_TREE_NAME
+#undef LOSER_TREE_LESS
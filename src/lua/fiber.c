@@ -841,6 +841,28 @@ lbox_fiber_stall(struct lua_State *L)
 	return 0;
 }
 
+/**
+ * Return fiber creation and reuse statistics.
+ */
+static int
+lbox_fiber_stat(struct lua_State *L)
+{
+	struct fiber_cache_stat stat;
+	fiber_cache_stat(&stat);
+	lua_createtable(L, 0, 5);
+	lua_pushnumber(L, stat.created);
+	lua_setfield(L, -2, "created");
+	lua_pushnumber(L, stat.reused);
+	lua_setfield(L, -2, "reused");
+	lua_pushnumber(L, stat.destroyed);
+	lua_setfield(L, -2, "destroyed");
+	lua_pushnumber(L, stat.stack_releases);
+	lua_setfield(L, -2, "stack_releases");
+	lua_pushnumber(L, stat.cached);
+	lua_setfield(L, -2, "cached");
+	return 1;
+}
+
 static const struct luaL_Reg lbox_fiber_meta [] = {
 	{"id", lbox_fiber_id},
 	{"name", lbox_fiber_name},
@@ -858,6 +880,7 @@ static const struct luaL_Reg lbox_fiber_meta [] = {
 
 static const struct luaL_Reg fiberlib[] = {
 	{"info", lbox_fiber_info},
+	{"stat", lbox_fiber_stat},
 #if ENABLE_FIBER_TOP
 	{"top", lbox_fiber_top},
 	{"top_enable", lbox_fiber_top_enable},
@@ -263,6 +263,13 @@ luaT_httpc_request(lua_State *L)
 		httpc_set_no_proxy(req, lua_tostring(L, -1));
 	lua_pop(L, 1);
 
+	lua_getfield(L, 5, "http2");
+	if (lua_toboolean(L, -1) && httpc_set_http2(req) != 0) {
+		httpc_request_delete(req);
+		return luaT_error(L);
+	}
+	lua_pop(L, 1);
+
 	long keepalive_idle = 0;
 	long keepalive_interval = 0;
 
@@ -388,6 +395,14 @@ luaT_httpc_stat(lua_State *L)
 			ctx->stat.http_other_responses);
 	lua_add_key_u64(L, "failed_requests",
 			(uint64_t) ctx->stat.failed_requests);
+	lua_add_key_u64(L, "connections_opened",
+			ctx->stat.connections_opened);
+	lua_add_key_u64(L, "connections_reused",
+			ctx->stat.connections_reused);
+	lua_add_key_u64(L, "easy_handles_reused",
+			ctx->curl_env.stat.easy_handles_reused);
+	lua_add_key_u64(L, "easy_handles_idle",
+			(uint64_t) ctx->curl_env.easy_cache_count);
 
 	return 1;
 }
@@ -402,7 +417,9 @@ luaT_httpc_new(lua_State *L)
 
 	long max_conns = luaL_checklong(L, 1);
 	long max_total_conns = luaL_checklong(L, 2);
-	if (httpc_env_create(ctx, max_conns, max_total_conns) != 0)
+	long max_host_conns = luaL_optlong(L, 3, 0);
+	if (httpc_env_create(ctx, max_conns, max_total_conns,
+			     max_host_conns) != 0)
 		return luaT_error(L);
 
 	luaL_getmetatable(L, DRIVER_LUA_UDATA_NAME);
@@ -43,6 +43,8 @@ local curl_mt
 --
 --  max_connections -  Maximum number of entries in the connection cache
 --  max_total_connections -  Maximum number of active connections
+--  max_host_connections -  Maximum number of active connections to
+--      a single host, requests above the limit wait for a free one
 --
 --  Returns:
 --  curl object or raise error()
@@ -54,8 +56,10 @@ local http_new = function(opts)
 
     opts.max_connections = opts.max_connections or -1
     opts.max_total_connections = opts.max_total_connections or 0
+    opts.max_host_connections = opts.max_host_connections or 0
 
-    local curl = driver.new(opts.max_connections, opts.max_total_connections)
+    local curl = driver.new(opts.max_connections, opts.max_total_connections,
+                            opts.max_host_connections)
     return setmetatable({ curl = curl, }, curl_mt )
 end
 
@@ -299,6 +303,9 @@ end
 --      accept_encoding - enables automatic decompression of HTTP
 --          responses;
 --
+--      http2 - prefer HTTP/2 over TLS and share one connection
+--          between concurrent requests to the same host;
+--
 --  Returns:
 --      {
 --          status=NUMBER,
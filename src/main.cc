@@ -54,6 +54,7 @@
 #include "cbus.h"
 #include "coio_task.h"
 #include <crc32.h>
+#include <mp_scan.h>
 #include "memory.h"
 #include <say.h>
 #include <rmean.h>
@@ -572,6 +573,17 @@ load_cfg()
 	if (background)
 		daemonize();
 
+	/* The logger thread would not survive daemonizing. */
+	if (cfg_getb("log_async") == 1) {
+		const char *name = cfg_gets("log_async_overflow");
+		enum say_async_overflow overflow = name == NULL ?
+			SAY_OVERFLOW_BLOCK : say_async_overflow_by_name(name);
+		if (say_logger_async_init(overflow) != 0) {
+			diag_log();
+			panic("failed to start the logger thread");
+		}
+	}
+
 	/*
 	 * after (optional) daemonising to avoid confusing messages with
 	 * different pids
@@ -816,6 +828,7 @@ main(int argc, char **argv)
 	random_init();
 
 	crc32_init();
+	mp_scan_init();
 	memory_init();
 
 	main_argc = argc;
@@ -0,0 +1,255 @@
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY AUTHORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * AUTHORS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "mp_scan.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <msgpuck.h>
+
+#include "trivia/config.h"
+#include "trivia/util.h"
+#include "cpu_feature.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+/**
+ * Count values encoded in a single byte at the beginning of
+ * a buffer of at least mp_scan_run_size bytes.
+ */
+typedef uint32_t
+(*mp_scan_run_f)(const char *data);
+
+/** Vectorized implementation or NULL to use the scalar one. */
+static mp_scan_run_f mp_scan_run = NULL;
+/** Number of bytes mp_scan_run looks at. */
+static ptrdiff_t mp_scan_run_size = 0;
+
+/** The best implementation supported by the CPU. */
+static mp_scan_run_f mp_scan_run_best = NULL;
+static ptrdiff_t mp_scan_run_best_size = 0;
+
+/**
+ * Positive and negative fixint, nil, false and true are the
+ * only values encoded in a single byte.
+ */
+static inline bool
+mp_scan_is_single_byte(uint8_t c)
+{
+	return (int8_t)c > -33 || c == 0xc0 || (c | 1) == 0xc3;
+}
+
+#if defined(__x86_64__)
+
+static uint32_t
+mp_scan_run_sse2(const char *data)
+{
+	__m128i b = _mm_loadu_si128((const __m128i *)data);
+	__m128i fixint = _mm_cmpgt_epi8(b, _mm_set1_epi8(-33));
+	__m128i nil = _mm_cmpeq_epi8(b, _mm_set1_epi8((char)0xc0));
+	__m128i boolean = _mm_cmpeq_epi8(_mm_or_si128(b, _mm_set1_epi8(1)),
+					 _mm_set1_epi8((char)0xc3));
+	uint32_t mask = _mm_movemask_epi8(_mm_or_si128(fixint,
+					  _mm_or_si128(nil, boolean)));
+	/* The mask has 16 bits, so ~mask is never zero. */
+	return __builtin_ctz(~mask);
+}
+
+#if defined(HAVE_CPUID)
+
+__attribute__((target("avx2")))
+static uint32_t
+mp_scan_run_avx2(const char *data)
+{
+	__m256i b = _mm256_loadu_si256((const __m256i *)data);
+	__m256i fixint = _mm256_cmpgt_epi8(b, _mm256_set1_epi8(-33));
+	__m256i nil = _mm256_cmpeq_epi8(b, _mm256_set1_epi8((char)0xc0));
+	__m256i boolean =
+		_mm256_cmpeq_epi8(_mm256_or_si256(b, _mm256_set1_epi8(1)),
+				  _mm256_set1_epi8((char)0xc3));
+	uint32_t mask = _mm256_movemask_epi8(_mm256_or_si256(fixint,
+					     _mm256_or_si256(nil, boolean)));
+	return mask == UINT32_MAX ? 32 : __builtin_ctz(~mask);
+}
+
+#endif /* defined(HAVE_CPUID) */
+#endif /* defined(__x86_64__) */
+
+void
+mp_scan_init(void)
+{
+#if defined(__x86_64__)
+	/* SSE2 is a part of the x86_64 baseline. */
+	mp_scan_run_best = mp_scan_run_sse2;
+	mp_scan_run_best_size = 16;
+#if defined(HAVE_CPUID)
+	if (avx2_enabled_cpu()) {
+		mp_scan_run_best = mp_scan_run_avx2;
+		mp_scan_run_best_size = 32;
+	}
+#endif
+#endif
+	mp_scan_set_scalar(false);
+}
+
+void
+mp_scan_set_scalar(bool is_scalar)
+{
+	mp_scan_run = is_scalar ? NULL : mp_scan_run_best;
+	mp_scan_run_size = is_scalar ? 0 : mp_scan_run_best_size;
+}
+
+int
+mp_scan_check(const char **data, const char *end)
+{
+	const char *pos = *data;
+	/* Number of values left to check. */
+	uint64_t k = 1;
+	while (k > 0) {
+		if (pos >= end)
+			return 1;
+		uint8_t c = (uint8_t)*pos;
+		if (mp_scan_is_single_byte(c)) {
+			uint64_t n = 1;
+			if (mp_scan_run != NULL && k > 1 &&
+			    end - pos >= mp_scan_run_size) {
+				n = mp_scan_run(pos);
+				n = MIN(n, k);
+			}
+			pos += n;
+			k -= n;
+			continue;
+		}
+		pos++;
+		k--;
+		uint64_t len;
+		if (c <= 0x8f) {
+			/* fixmap */
+			k += 2 * (c & 0x0f);
+			continue;
+		} else if (c <= 0x9f) {
+			/* fixarray */
+			k += c & 0x0f;
+			continue;
+		} else if (c <= 0xbf) {
+			/* fixstr */
+			len = c & 0x1f;
+			goto skip;
+		}
+		switch (c) {
+		case 0xc4: /* bin 8 */
+		case 0xd9: /* str 8 */
+		case 0xc7: /* ext 8 */
+			if (end - pos < 1)
+				return 1;
+			len = mp_load_u8(&pos) + (c == 0xc7);
+			break;
+		case 0xc5: /* bin 16 */
+		case 0xda: /* str 16 */
+		case 0xc8: /* ext 16 */
+			if (end - pos < 2)
+				return 1;
+			len = mp_load_u16(&pos) + (c == 0xc8);
+			break;
+		case 0xc6: /* bin 32 */
+		case 0xdb: /* str 32 */
+		case 0xc9: /* ext 32 */
+			if (end - pos < 4)
+				return 1;
+			len = (uint64_t)mp_load_u32(&pos) + (c == 0xc9);
+			break;
+		case 0xcc: /* uint 8 */
+		case 0xd0: /* int 8 */
+			len = 1;
+			break;
+		case 0xcd: /* uint 16 */
+		case 0xd1: /* int 16 */
+			len = 2;
+			break;
+		case 0xca: /* float */
+		case 0xce: /* uint 32 */
+		case 0xd2: /* int 32 */
+			len = 4;
+			break;
+		case 0xcb: /* double */
+		case 0xcf: /* uint 64 */
+		case 0xd3: /* int 64 */
+			len = 8;
+			break;
+		case 0xd4: /* fixext 1 */
+			len = 2;
+			break;
+		case 0xd5: /* fixext 2 */
+			len = 3;
+			break;
+		case 0xd6: /* fixext 4 */
+			len = 5;
+			break;
+		case 0xd7: /* fixext 8 */
+			len = 9;
+			break;
+		case 0xd8: /* fixext 16 */
+			len = 17;
+			break;
+		case 0xdc: /* array 16 */
+			if (end - pos < 2)
+				return 1;
+			k += mp_load_u16(&pos);
+			continue;
+		case 0xdd: /* array 32 */
+			if (end - pos < 4)
+				return 1;
+			k += mp_load_u32(&pos);
+			continue;
+		case 0xde: /* map 16 */
+			if (end - pos < 2)
+				return 1;
+			k += 2 * (uint64_t)mp_load_u16(&pos);
+			continue;
+		case 0xdf: /* map 32 */
+			if (end - pos < 4)
+				return 1;
+			k += 2 * (uint64_t)mp_load_u32(&pos);
+			continue;
+		default:
+			/* 0xc1 is never used. */
+			return 1;
+		}
+skip:
+		if ((uint64_t)(end - pos) < len)
+			return 1;
+		pos += len;
+	}
+	*data = pos;
+	return 0;
+}
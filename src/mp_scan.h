@@ -0,0 +1,77 @@
+#ifndef TARANTOOL_MP_SCAN_H_INCLUDED
+#define TARANTOOL_MP_SCAN_H_INCLUDED
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY AUTHORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * AUTHORS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stdbool.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+/**
+ * MsgPack validator, a drop-in replacement for mp_check().
+ *
+ * Tuples often have long runs of values encoded in a single
+ * byte: small integers, nil and booleans. The validator skips
+ * such runs with SIMD instructions, up to 32 values at a time,
+ * and decodes other headers one by one as mp_check() does.
+ */
+
+/**
+ * Select the fastest implementation supported by the CPU.
+ * Until this is called, a scalar implementation is used.
+ */
+void
+mp_scan_init(void);
+
+/**
+ * Use the scalar implementation even if the CPU supports
+ * a vectorized one. For testing.
+ */
+void
+mp_scan_set_scalar(bool is_scalar);
+
+/**
+ * Check that @a data points to a valid MsgPack value which
+ * fits in [@a data, @a end) and advance @a data past it.
+ *
+ * @retval 0 the value is valid
+ * @retval 1 the value is truncated or malformed, @a data
+ *           is undefined
+ */
+int
+mp_scan_check(const char **data, const char *end);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_MP_SCAN_H_INCLUDED */
@@ -582,8 +582,35 @@ local function test_concurrent(test, url, opts)
     test:ok(ok_active, "no active requests")
 end
 
+local function test_connection_pool(test, url, opts)
+    test:plan(5)
+    local http = client.new({max_host_connections = 1})
+    local keepalive = merge(opts, {keepalive_idle = 30,
+                                   keepalive_interval = 60})
+    local num_req = 5
+    local ch = fiber.channel(num_req)
+    for _ = 1, num_req do
+        fiber.create(function()
+            ch:put(http:get(url, keepalive).status)
+        end)
+    end
+    local ok = true
+    for _ = 1, num_req do
+        if ch:get() ~= 200 then
+            ok = false
+        end
+    end
+    test:ok(ok, "all requests are ok")
+    local st = http:stat()
+    test:is(st.connections_opened, 1, "one connection to the host")
+    test:is(st.connections_reused, num_req - 1, "the connection is reused")
+    local r = http:get(url, keepalive)
+    test:is(r.status, 200, "request with a cached easy handle")
+    test:is(http:stat().easy_handles_reused, 1, "easy handle is reused")
+end
+
 function run_tests(test, sock_family, sock_addr)
-    test:plan(11)
+    test:plan(12)
     local server, url, opts = start_server(test, sock_family, sock_addr)
     test:test("http.client", test_http_client, url, opts)
     test:test("http.client headers redefine", test_http_client_headers_redefine,
@@ -594,6 +621,7 @@ function run_tests(test, sock_family, sock_addr)
     test:test("request_headers", test_request_headers, url, opts)
     test:test("headers", test_headers, url, opts)
     test:test("special methods", test_special_methods, url, opts)
+    test:test("connection pool", test_connection_pool, url, opts)
     if sock_family == 'AF_UNIX' and jit.os ~= "Linux" then
         --
         -- BSD-based operating systems (including OS X) will fail
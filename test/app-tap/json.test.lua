@@ -22,7 +22,7 @@ end
 
 tap.test("json", function(test)
     local serializer = require('json')
-    test:plan(40)
+    test:plan(46)
 
     test:test("unsigned", common.test_unsigned, serializer)
     test:test("signed", common.test_signed, serializer)
@@ -125,6 +125,36 @@ tap.test("json", function(test)
     serializer.cfg({encode_max_depth = orig_encode_max_depth,
                     encode_deep_as_nil = orig_encode_deep_as_nil})
 
+    --
+    -- Word-at-a-time string scanning and integer formatting.
+    --
+    local long = string.rep('abcdefgh', 4) .. '"\\/\n\1\127' ..
+                 string.rep('x', 13)
+    test:is(serializer.encode(long), '"' .. string.rep('abcdefgh', 4) ..
+            '\\"\\\\\\/\\n\\u0001\\u007f' .. string.rep('x', 13) .. '"',
+            'long string encoding')
+    test:is(serializer.decode(serializer.encode(long)), long,
+            'long string decoding')
+    test:is(serializer.encode({-9223372036854775808LL, 18446744073709551615ULL,
+                               0, -1, 1234567890}),
+            '[-9223372036854775808,18446744073709551615,0,-1,1234567890]',
+            'integer encoding')
+
+    --
+    -- json.decode_to_msgpack() transcodes JSON into MsgPack.
+    --
+    local msgpack = require('msgpack')
+    test:is(serializer.decode_to_msgpack('[1,{"a":-1},"s",true,2.5]'),
+            msgpack.encode({1, {a = -1}, 's', true, 2.5}),
+            'decode_to_msgpack')
+    local big = {}
+    for i = 1, 20 do big[i] = {i} end
+    test:is_deeply(msgpack.decode(serializer.decode_to_msgpack(
+                   serializer.encode(big))), big,
+                   'decode_to_msgpack with a large container')
+    test:ok(not pcall(serializer.decode_to_msgpack, '[1,'),
+            'decode_to_msgpack error')
+
     --
     -- gh-3316: Make sure that line number is printed in the error
     -- message.
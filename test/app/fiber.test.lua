@@ -737,3 +737,12 @@ con = require('net.box').connect(box.cfg.listen)
 pcall(con.eval, con, 'fiber.cancel(fiber.self())')
 con:eval('fiber.sleep(0) return "Ok"')
 box.schema.user.revoke('guest', 'execute', 'universe')
+
+-- Fiber creation and reuse statistics.
+stat = fiber.stat()
+f = fiber.new(function() end)
+f:set_joinable(true)
+f:join()
+new_stat = fiber.stat()
+new_stat.created + new_stat.reused > stat.created + stat.reused
+new_stat.cached > 0
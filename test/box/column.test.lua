@@ -0,0 +1,73 @@
+test_run = require('test_run').new()
+
+-- Column engine requires a format of non-nullable scalar fields.
+box.schema.space.create('test', {engine = 'column'})
+box.schema.space.create('test', {engine = 'column', format = {{'a', 'array'}}})
+box.schema.space.create('test', {engine = 'column', format = {{'a', 'unsigned', is_nullable = true}}})
+
+format = {{'id', 'unsigned'}, {'delta', 'integer'}, {'price', 'double'}, {'city', 'string'}, {'ok', 'boolean'}}
+s = box.schema.space.create('test', {engine = 'column', format = format})
+
+-- Column engine doesn't support indexes.
+s:create_index('pk')
+
+-- Aggregates of an empty space.
+s:aggregate('count')
+s:aggregate('min', 'delta')
+s:aggregate('sum', 'price')
+
+s:insert{1, -5, 1.5, 'Berlin', true}
+s:insert{2, 10, 2.5, 'Paris', false}
+s:replace{3, 7, 4.25, 'Berlin', true}
+s:bsize() > 0
+
+s:aggregate('count')
+s:aggregate('sum', 'id')
+s:aggregate('sum', 2)
+s:aggregate('min', 'delta')
+s:aggregate('max', 'delta')
+s:aggregate('sum', 'price')
+s:aggregate('max', 'price')
+s:aggregate('min', 'city')
+s:aggregate('max', 'city')
+s:aggregate('min', 'ok')
+s:aggregate('max', 'ok')
+
+-- Errors.
+s:aggregate('avg', 'id')
+s:aggregate('sum', 'city')
+s:aggregate('sum', 'ok')
+s:aggregate('sum', 'foo')
+s:aggregate('sum', 6)
+s:insert{4, 1, 1, 'Rome', true}
+s:insert{4, 1, 1.5, 'Rome', true, 'extra'}
+box.space._space:aggregate('count')
+
+-- Column engine doesn't support delete/update/upsert/truncate.
+box.internal.delete(s.id, 0, {1})
+box.internal.update(s.id, 0, {1}, {})
+box.internal.upsert(s.id, {1}, {})
+s:truncate()
+
+-- Rolled back rows are not visible to aggregates.
+box.begin() s:insert{4, 100, 8.5, 'Rome', true} box.rollback()
+s:aggregate('count')
+s:aggregate('sum', 'delta')
+s:aggregate('max', 'city')
+
+-- Field types can't be changed if there's data.
+s:format({{'id', 'unsigned'}, {'delta', 'integer'}, {'price', 'double'}, {'city', 'string'}, {'ok', 'unsigned'}})
+s:format({{'key', 'unsigned'}, {'delta', 'integer'}, {'price', 'double'}, {'city', 'string'}, {'ok', 'boolean'}})
+s:aggregate('sum', 'key')
+
+-- Data survives restart, both from the checkpoint and the WAL.
+box.snapshot()
+s:insert{4, 20, 0.25, 'Amsterdam', false}
+test_run:cmd('restart server default')
+s = box.space.test
+s:aggregate('count')
+s:aggregate('sum', 'delta')
+s:aggregate('sum', 'price')
+s:aggregate('min', 'city')
+
+s:drop()
@@ -0,0 +1,61 @@
+test_run = require('test_run').new()
+fiber = require('fiber')
+
+--
+-- Background expiration of memtx tuples.
+--
+format = {{'id', 'unsigned'}, {'exp', 'number'}}
+s = box.schema.space.create('test', {expire_field = 'exp', format = format})
+_ = s:create_index('pk')
+_ = s:create_index('exp', {parts = {'exp'}, unique = false})
+now = fiber.time()
+for i = 1, 300 do s:insert{i, now - i} end
+for i = 301, 310 do s:insert{i, now + 3600} end
+test_run:wait_cond(function() return s:expire_stat().expired == 300 end, 10)
+s:count()
+s.index.pk:min()[1]
+s:expire_stat().pending
+s:drop()
+
+-- Tuples without expiration time are kept.
+format = {{'id', 'unsigned'}, {'exp', 'number', is_nullable = true}}
+s = box.schema.space.create('test', {expire_field = 2, format = format})
+_ = s:create_index('pk')
+_ = s:create_index('exp', {parts = {{2, 'number', is_nullable = true}}, unique = false})
+_ = s:insert{1, box.NULL}
+_ = s:insert{2, fiber.time() - 1}
+test_run:wait_cond(function() return s:expire_stat().expired == 1 end, 10)
+s:select{}
+s:drop()
+
+-- A scalar index part on the expire field works too.
+format = {{'id', 'unsigned'}, {'exp', 'number'}}
+s = box.schema.space.create('test', {expire_field = 2, format = format})
+_ = s:create_index('pk')
+_ = s:create_index('exp', {parts = {{2, 'scalar'}}, unique = false})
+_ = s:insert{1, fiber.time() - 1}
+_ = s:insert{2, fiber.time() + 3600}
+test_run:wait_cond(function() return s:expire_stat().expired == 1 end, 10)
+s:count()
+s:select{}[1][1]
+s:drop()
+
+-- No expiration without an index on the expire field.
+s = box.schema.space.create('test', {expire_field = 2, format = format})
+_ = s:create_index('pk')
+_ = s:insert{1, fiber.time() - 1}
+fiber.sleep(1.5)
+s:count()
+s:expire_stat().pending
+s:drop()
+
+-- Errors.
+box.schema.space.create('test', {expire_field = 'x'})
+box.schema.space.create('test', {engine = 'vinyl', expire_field = 1})
+box.schema.space.create('test', {expire_field = 1})
+box.schema.space.create('test', {expire_field = 3, format = format})
+s = box.schema.space.create('test', {expire_field = 2, format = format})
+s:format({{'id', 'unsigned'}, {'exp', 'string'}})
+_ = s:create_index('pk')
+s:create_index('exp', {parts = {{2, 'number', sort_order = 'desc'}}, unique = false})
+s:drop()
@@ -2,6 +2,8 @@
 #include "module.h"
 
 #include <stdio.h>
+#include <pthread.h>
+#include <unistd.h>
 #include <msgpuck.h>
 
 int
@@ -289,3 +291,52 @@ test_return_mp(box_function_ctx_t *ctx, const char *args, const char *args_end)
 	rc = box_return_tuple(ctx, tuple);
 	return rc;
 }
+
+/*
+ * Return the sum of UINT arguments and an id of the thread
+ * the function is executed in.
+ */
+static int
+sum_and_thread(box_function_ctx_t *ctx, const char *args,
+	       const char *args_end)
+{
+	(void) args_end;
+	uint64_t sum = 0;
+	uint32_t arg_count = mp_decode_array(&args);
+	for (uint32_t i = 0; i < arg_count; i++) {
+		if (mp_typeof(*args) != MP_UINT) {
+			return box_error_set(__FILE__, __LINE__, ER_PROC_C,
+					     "%s", "invalid argument");
+		}
+		sum += mp_decode_uint(&args);
+	}
+	char buf[16];
+	char *pos = mp_encode_uint(buf, sum);
+	int rc = box_return_mp(ctx, buf, pos);
+	if (rc != 0)
+		return rc;
+	pos = mp_encode_uint(buf, (uint64_t) pthread_self());
+	return box_return_mp(ctx, buf, pos);
+}
+
+int
+sum(box_function_ctx_t *ctx, const char *args, const char *args_end)
+{
+	return sum_and_thread(ctx, args, args_end);
+}
+
+int
+sum_threadsafe(box_function_ctx_t *ctx, const char *args,
+	       const char *args_end)
+{
+	return sum_and_thread(ctx, args, args_end);
+}
+
+/* Same as sum_threadsafe, but sleeps for 0.1 s before returning. */
+int
+sleep_threadsafe(box_function_ctx_t *ctx, const char *args,
+		 const char *args_end)
+{
+	usleep(100000);
+	return sum_and_thread(ctx, args, args_end);
+}
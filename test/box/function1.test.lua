@@ -396,3 +396,36 @@ box.schema.func.drop("SUM")
 box.schema.func.create('test', {body = "function(tuple) return tuple end", is_deterministic = true, opts = {is_multikey = true}})
 box.func['test'].is_multikey == true
 box.func['test']:drop()
+
+-- C functions executed in a worker thread
+box.schema.func.create('function1.sum', {language = "C"})
+box.schema.func.create('function1.sum_threadsafe', {language = "C", opts = {is_threadsafe = true}})
+box.space._func.index.name:get{'function1.sum_threadsafe'}.opts
+res, tx_thread = box.func['function1.sum']:call({1, 2, 3})
+res
+res, thread = box.func['function1.sum_threadsafe']:call({1, 2, 3})
+res
+thread ~= tx_thread
+box.func['function1.sum_threadsafe']:call({1, 'x'})
+(box.func['function1.sum_threadsafe']:call({}))
+-- Functions called in a transaction are executed in TX.
+box.begin() res, thread = box.func['function1.sum_threadsafe']:call({4}) box.commit()
+res
+thread == tx_thread
+box.schema.user.grant('guest', 'execute', 'function', 'function1.sum_threadsafe')
+c = net.connect(box.cfg.listen)
+(c:call('function1.sum_threadsafe', {5, 6}))
+c:close()
+-- A spurious wakeup doesn't abort the call.
+box.schema.func.create('function1.sleep_threadsafe', {language = "C", opts = {is_threadsafe = true}})
+res = nil
+f = fiber.new(function() res = box.func['function1.sleep_threadsafe']:call({7, 8}) end)
+f:set_joinable(true)
+fiber.sleep(0.01)
+f:wakeup()
+f:join()
+res
+box.schema.func.drop('function1.sleep_threadsafe')
+box.schema.func.drop('function1.sum')
+box.schema.func.drop('function1.sum_threadsafe')
+box.schema.func.create('threadsafe', {body = "function() return 1 end", opts = {is_threadsafe = true}})
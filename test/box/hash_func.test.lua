@@ -0,0 +1,45 @@
+test_run = require('test_run').new()
+ffi = require('ffi')
+
+--
+-- Tuple hash function of HASH indexes.
+--
+s = box.schema.space.create('test')
+pk = s:create_index('pk', {type = 'hash', parts = {{1, 'unsigned'}}, hash_func = 'mum64'})
+sk = s:create_index('sk', {type = 'hash', parts = {{2, 'string'}, {3, 'integer'}}, hash_func = 'mum64'})
+nk = s:create_index('nk', {type = 'hash', parts = {{4, 'number'}}, hash_func = 'mum64'})
+box.space._index:get{s.id, pk.id}[5].hash_func
+box.space._index:get{s.id, nk.id}[5].hash_func
+
+for i = 1, 10 do s:insert{i, 'str' .. i, -i, i + 0.5} end
+pk:get{5}
+pk:get{11}
+sk:get{'str7', -7}
+sk:get{'str7', 7}
+nk:get{3.5}
+nk:get{4}
+
+-- Integral floating point numbers hash as integers.
+_ = s:insert{11, 'x', 0, 12}
+nk:get{ffi.new('double', 12)}
+s:insert{12, 'y', 0, ffi.new('double', 12)}
+
+-- Changing the hash function requires rebuild.
+pk:alter({hash_func = 'murmur'})
+box.space._index:get{s.id, pk.id}[5].hash_func
+s.index.pk:get{5}
+s.index.pk:count()
+
+box.snapshot()
+test_run:cmd('restart server default')
+s = box.space.test
+s.index.pk:get{5}
+s.index.sk:get{'str7', -7}
+s.index.nk:get{12}
+
+box.space._index:insert{s.id, 10, 'bad', 'hash', {hash_func = 'foo'}, {{1, 'unsigned'}}}
+-- Only HASH indexes hash keys in memtx.
+s:create_index('tree', {parts = {{2, 'string'}}, hash_func = 'mum64'})
+s:create_index('bitset', {type = 'bitset', parts = {{2, 'string'}}, unique = false, hash_func = 'mum64'})
+
+s:drop()
@@ -0,0 +1,107 @@
+fio = require('fio')
+msgpack = require('msgpack')
+
+function write(name, data) local f = fio.open(name, {'O_CREAT', 'O_WRONLY', 'O_TRUNC'}, tonumber('644', 8)) f:write(data) f:close() end
+
+format = {{'id', 'unsigned'}, {'name', 'string'}, {'score', 'number', is_nullable = true}}
+s = box.schema.space.create('test', {format = format})
+_ = s:create_index('pk')
+_ = s:create_index('name', {parts = {'name'}, unique = false})
+
+--
+-- CSV, unsorted, with a header and quoted fields.
+--
+write('load.csv', 'id,name,score\n3,c,1.5\n1,"a, ""quoted""",10\r\n2,"multi\nline",\n')
+box.load(s, 'load.csv', {skip_header = true, checkpoint = false})
+s:get(1)
+s:get(3)
+s:get(2)[2] == 'multi\nline'
+s:get(2)[3]
+s.index.name:select('c')
+s:insert{4, 'd'}
+s:truncate()
+
+--
+-- Errors leave the space empty.
+--
+write('load.csv', '1,a\n2,b\nx,c\n')
+box.load(s, 'load.csv', {checkpoint = false})
+write('load.csv', '1,a\n2,b\n1,c\n')
+box.load(s, 'load.csv', {checkpoint = false})
+write('load.csv', '1,a\n2,"b\n')
+box.load(s, 'load.csv', {checkpoint = false})
+write('load.csv', '1\n')
+box.load(s, 'load.csv', {checkpoint = false})
+s:count()
+box.load(s, 'no_such_file.csv')
+box.load(s)
+box.load(s, 'load.csv', {format = 'json'})
+box.load(s, 'load.csv', {delimiter = ';;'})
+
+--
+-- A non-empty space.
+--
+s:insert{1, 'a'}
+box.load(s, 'load.csv')
+s:truncate()
+
+--
+-- MsgPack stream and a custom delimiter.
+--
+write('load.msgpack', msgpack.encode({1, 'a'}) .. msgpack.encode({2, 'b', 0.5}))
+box.load(s.id, 'load.msgpack', {format = 'msgpack'})
+s:select()
+s:truncate()
+write('load.msgpack', msgpack.encode({1, 'a'}) .. msgpack.encode(2))
+box.load(s, 'load.msgpack', {format = 'msgpack'})
+write('load.csv', '1;a\n2;b\n')
+box.load(s, 'load.csv', {delimiter = ';'})
+s:select()
+
+--
+-- Unique secondary keys are checked.
+--
+s:truncate()
+_ = s:create_index('uname', {parts = {'name'}})
+write('load.csv', '1,a\n2,a\n')
+box.load(s, 'load.csv', {checkpoint = false})
+s:count()
+s.index.uname:count()
+s:drop()
+
+--
+-- A failed load is rolled back only from the indexes the tuples
+-- got into.
+--
+h = box.schema.space.create('test_hash', {format = format})
+_ = h:create_index('pk')
+_ = h:create_index('name', {type = 'hash', parts = {'name'}})
+write('load.csv', '1,a\n2,b\n3,a\n4,c\n')
+box.load(h, 'load.csv', {checkpoint = false})
+h:count()
+h.index.name:count()
+h:drop()
+
+--
+-- Loading requires write access to the space.
+--
+a = box.schema.space.create('access', {format = format})
+_ = a:create_index('pk')
+box.schema.user.create('load_user')
+box.session.su('load_user', box.load, a, 'load.csv')
+a:count()
+box.schema.user.drop('load_user')
+a:drop()
+
+--
+-- Only memtx spaces are supported, out of transactions.
+--
+v = box.schema.space.create('vinyl', {engine = 'vinyl'})
+_ = v:create_index('pk')
+box.load(v, 'load.csv')
+v:drop()
+box.begin() ok, err = pcall(box.load, 1, 'load.csv') box.rollback()
+tostring(err)
+
+fio.unlink('load.csv')
+fio.unlink('load.msgpack')
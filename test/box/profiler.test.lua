@@ -0,0 +1,39 @@
+test_run = require('test_run').new()
+profiler = box.profiler
+
+-- The profiler is only built with backtraces on Linux.
+supported = pcall(profiler.start, {interval = 0.001})
+profiler.stat().running == supported
+test_run:cmd("setopt delimiter ';'")
+function burn(duration)
+    local deadline = os.clock() + duration
+    local x = 0
+    while os.clock() < deadline do
+        x = x + 1
+    end
+    return x
+end;
+test_run:cmd("setopt delimiter ''");
+-- Hooks don't fire in compiled traces.
+jit.off(burn)
+_ = burn(0.3)
+profiler.stop()
+stat = profiler.stat()
+stat.running
+not supported or stat.samples > 0
+not supported or stat.stacks > 0
+not supported or stat.stacks <= stat.samples
+
+dump = profiler.dump()
+not supported or dump:match('^[^\n]+ %d+\n') ~= nil
+not supported or dump:find('burn@') ~= nil
+-- Stopping twice is fine.
+profiler.stop()
+
+-- A restart resets the stacks.
+supported == pcall(profiler.start)
+profiler.stop()
+not supported or profiler.stat().samples < stat.samples
+
+profiler.start({interval = 0})
+profiler.start({interval = 'fast'})
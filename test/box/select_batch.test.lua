@@ -0,0 +1,31 @@
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+_ = s:create_index('sk', {parts = {2, 'string'}, unique = false})
+for i = 1, 5 do s:insert{i, 'v' .. (i % 2)} end
+
+b = s:select_batch()
+type(b)
+#b
+b[1]
+b[5]
+b[6]
+b[0]
+b:field(2, 1)
+b:field(2, 2)
+b:field(2, 3)
+b:field(6, 1)
+b:totable()
+b
+t = {}
+for i, tuple in b:pairs() do t[i] = tuple[1] end
+t
+
+s:select_batch(3, {iterator = 'GE', limit = 2})
+s:select_batch({}, {offset = 4})
+s.index.sk:select_batch('v1')
+#s.index.sk:select_batch('v2')
+box.internal.select_batch()
+
+b = nil
+collectgarbage('collect')
+s:drop()
@@ -38,6 +38,12 @@ box.stat.SELECT.total
 for _ in space:pairs() do end
 box.stat.SELECT.total
 
+-- coio thread pool queues
+coio = box.stat.coio()
+#coio.queues > 0
+coio.queues[1].executed <= coio.queues[1].submitted
+coio.high_priority.pending >= 0
+
 -- reset
 box.stat.reset()
 box.stat.INSERT.total
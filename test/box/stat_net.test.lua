@@ -33,6 +33,16 @@ box.stat.net.REQUESTS.total > 0
 box.stat.net.CONNECTIONS.current
 box.stat.net.REQUESTS.current
 
+-- latency
+latency = box.stat.latency()
+latency.SELECT.total.p50 > 0
+latency.SELECT.total.p999 >= latency.SELECT.total.p50
+latency.SELECT.queue.p50 > 0
+latency.SELECT.tx.p50 > 0
+latency.WAL.write.p50 > 0
+box.stat.net.LATENCY.p999 >= box.stat.net.LATENCY.p50
+box.stat.net().LATENCY.p50 > 0
+
 WAIT_COND_TIMEOUT = 10
 
 cn1:close()
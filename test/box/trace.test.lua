@@ -0,0 +1,47 @@
+json = require('json')
+net = require('net.box')
+
+space = box.schema.space.create('test')
+_ = space:create_index('pk')
+box.schema.user.grant('guest', 'read,write', 'space', 'test')
+
+box.trace.start({rate = 2})
+box.trace.start({size = 0})
+box.trace.start({rate = 'all'})
+box.trace.dump()
+
+box.trace.start({rate = 1, size = 16})
+conn = net.connect(box.cfg.listen)
+conn.space.test:insert{1}
+conn.space.test:select{}
+box.trace.stop()
+-- Requests are not traced after stop.
+conn.space.test:insert{2}
+
+test_run = require('test_run').new()
+test_run:cmd("setopt delimiter ';'")
+function spans(type)
+    local names = {}
+    for _, e in ipairs(json.decode(box.trace.dump()).traceEvents) do
+        if e.cat == type and e.ph == 'X' and e.dur >= 0 then
+            names[e.name] = (names[e.name] or 0) + 1
+        end
+    end
+    return names
+end;
+test_run:cmd("setopt delimiter ''");
+s = spans('INSERT')
+s['request'], s['tx queue'], s['tx'], s['net queue']
+s['wal queue'], s['wal write'], s['wal wakeup']
+s = spans('SELECT')
+s['request'] >= 1, s['wal write']
+
+-- The ring keeps only the latest records.
+box.trace.start({rate = 1, size = 2})
+for i = 1, 10 do conn.space.test:replace{i} end
+box.trace.stop()
+s = spans('REPLACE')
+s['request'], s['wal write']
+
+conn:close()
+space:drop()
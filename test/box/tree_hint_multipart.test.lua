@@ -0,0 +1,65 @@
+--
+-- Multipart comparison hints for TREE indexes.
+--
+s = box.schema.space.create('test')
+pk = s:create_index('pk', {parts = {{1, 'unsigned'}, {2, 'integer'}}, hint = 'multipart'})
+sk = s:create_index('sk', {parts = {{3, 'unsigned'}, {4, 'string'}}, unique = false, hint = 'multipart'})
+-- Falls back on the first part hint for unsupported types.
+fk = s:create_index('fk', {parts = {{4, 'string'}, {1, 'unsigned'}}, unique = false, hint = 'multipart'})
+dk = s:create_index('dk', {parts = {{1, 'unsigned'}, {2, 'integer'}}, unique = false})
+
+pk:stat().hint.layout
+pk:stat().hint.part_count
+sk:stat().hint.part_count
+fk:stat().hint.part_count
+dk:stat().hint.layout
+dk:stat().hint.part_count
+
+_ = s:insert{0, -100, 1, 'b'}
+_ = s:insert{0, 100, 1, 'a'}
+_ = s:insert{1, 2, 0, 'abcdef'}
+_ = s:insert{1, 1, 0, 'abcdeg'}
+_ = s:insert{1, -1, 0, 'abcde'}
+_ = s:insert{1, 1099511627776, 2, 'x'}
+_ = s:insert{1, 1099511627775, 2, 'x'}
+_ = s:insert{1, -1099511627776, 2, 'y'}
+_ = s:insert{16777214, 3, 3, ''}
+_ = s:insert{16777214, 2, 3, ''}
+_ = s:insert{16777215, 1, 3, ''}
+_ = s:insert{1000000000000, 0, 3, ''}
+
+pk:select()
+pk:select({1})
+pk:select({1, 1})
+pk:select({1, 1}, {iterator = 'GT'})
+pk:select({16777214, 2}, {iterator = 'LE'})
+sk:select()
+sk:select({0, 'abcdeg'}, {iterator = 'LT'})
+sk:select({2, 'x'})
+fk:select({'x'})
+
+-- Hint statistics are sampled.
+for i = 1, 1000 do pk:get({1, 1}) end
+pk:stat().hint.resolved + pk:stat().hint.unresolved > 0
+box.stat.reset()
+pk:stat().hint.resolved + pk:stat().hint.unresolved
+
+-- Changing the hint layout requires rebuild.
+dk:alter({hint = 'multipart'})
+s.index.dk:stat().hint.layout
+s.index.dk:stat().hint.part_count
+s.index.dk:select({1})
+
+-- Snapshot recovery.
+box.snapshot()
+test_run = require('test_run').new()
+test_run:cmd('restart server default')
+s = box.space.test
+s.index.pk:stat().hint.layout
+s.index.pk:select({1, 1}, {iterator = 'GE'})
+
+box.space._index:insert{s.id, 10, 'bad', 'tree', {hint = 'foo'}, {{1, 'unsigned'}}}
+-- Only TREE indexes support hint layouts.
+s:create_index('hash', {type = 'hash', hint = 'multipart'})
+s:create_index('bitset', {type = 'bitset', parts = {3, 'unsigned'}, unique = false, hint = 'multipart'})
+s:drop()
@@ -536,3 +536,13 @@ msgpackffi.decode(msgpackffi.encode(t))
 t:bsize()
 
 msgpack.cfg({encode_max_depth = max_depth, encode_deep_as_nil = deep_as_nil})
+
+--
+-- tuple:tojson() encodes MsgPack into JSON directly.
+--
+t:tojson()
+box.tuple.new({1, -1, 1.5, 'a"b', true, box.NULL, {x = {1, 2}}}):tojson()
+json = require('json')
+json.decode(box.tuple.new({1, {x = 'y'}}):tojson())
+decimal = require('decimal')
+box.tuple.new({decimal.new('1.25')}):tojson()
@@ -0,0 +1,50 @@
+test_run = require('test_run').new()
+engine = test_run:get_cfg('engine')
+
+--
+-- The applier reads and decodes rows in a separate thread and
+-- passes them to tx in batches. Check that transactions of any
+-- size are applied in order and that an error stops the applier
+-- only after the transactions received before it are applied.
+--
+box.schema.user.grant('guest', 'replication')
+s = box.schema.space.create('test', {engine = engine})
+_ = s:create_index('pk')
+
+test_run:cmd("create server replica with rpl_master=default, script='replication/replica.lua'")
+test_run:cmd("start server replica")
+test_run:cmd("stop server replica")
+
+-- Single-statement transactions.
+for i = 1, 1000 do s:replace{i, i} end
+-- Multi-statement transactions.
+for i = 1, 100 do box.begin() for j = 1, 10 do s:replace{i * 10 + j, i} end box.commit() end
+-- A transaction larger than a batch.
+pad = string.rep('x', 1024)
+box.begin() for i = 2001, 4000 do s:replace{i, i, pad} end box.commit()
+
+test_run:cmd("start server replica")
+test_run:wait_lsn('replica', 'default')
+test_run:cmd("switch replica")
+box.space.test:count()
+box.space.test:get{1000}
+box.space.test:get{1010}
+box.space.test:get{4000}[2]
+box.info.replication[1].upstream.status
+
+box.space.test:insert{5000}
+test_run:cmd("switch default")
+box.begin() s:insert{4999} s:insert{4998} box.commit()
+s:insert{5000, 1}
+test_run:cmd("switch replica")
+test_run:wait_upstream(1, {status = 'stopped', message_re = "Duplicate key exists in unique index 'pk' in space 'test'"})
+box.space.test:get{4998}
+box.space.test:get{4999}
+
+test_run:cmd("switch default")
+test_run:cmd("stop server replica")
+test_run:cmd("cleanup server replica")
+test_run:cmd("delete server replica")
+test_run:cleanup_cluster()
+s:drop()
+box.schema.user.revoke('guest', 'replication')
@@ -0,0 +1,47 @@
+test_run = require('test_run').new()
+engine = test_run:get_cfg('engine')
+
+--
+-- A replica with replication_fetch_checkpoint bootstraps from
+-- the files of the last checkpoint of the master instead of
+-- joining row by row. Rows written after the checkpoint are
+-- fetched on registration.
+--
+s = box.schema.space.create('test', {engine = engine})
+_ = s:create_index('pk')
+for i = 1, 100 do s:insert{i} end
+box.snapshot()
+for i = 101, 110 do s:insert{i} end
+
+box.schema.user.grant('guest', 'replication')
+
+test_run:cmd('create server replica with rpl_master=default, script="replication/replica_fetch_checkpoint.lua"')
+test_run:cmd('start server replica')
+test_run:cmd('switch replica')
+
+box.info.id > 1
+box.space.test:count()
+fio = require('fio')
+#fio.glob(fio.pathjoin(box.cfg.memtx_dir, '*.inprogress'))
+
+test_run:cmd('switch default')
+for i = 111, 120 do s:insert{i} end
+test_run:wait_lsn('replica', 'default')
+test_run:cmd('switch replica')
+box.space.test:count()
+
+-- The replica restarts from its own files.
+test_run:cmd('switch default')
+test_run:cmd('restart server replica')
+test_run:cmd('switch replica')
+box.space.test:count()
+
+test_run:cmd('switch default')
+test_run:cmd('stop server replica')
+test_run:cmd('cleanup server replica')
+test_run:cmd('delete server replica')
+test_run:cleanup_cluster()
+
+box.schema.user.revoke('guest', 'replication')
+s:drop()
+box.snapshot()
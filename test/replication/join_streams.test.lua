@@ -0,0 +1,69 @@
+test_run = require('test_run').new()
+engine = test_run:get_cfg('engine')
+
+--
+-- A replica with replication_join_streams > 1 receives the
+-- initial data of user spaces over several connections.
+--
+for i = 1, 6 do box.schema.space.create('test' .. i, {engine = engine}) end
+for i = 1, 6 do box.space['test' .. i]:create_index('pk') end
+for i = 1, 6 do box.space['test' .. i]:create_index('sk', {parts = {2, 'unsigned'}}) end
+for i = 1, 6 do for j = 1, i * 100 do box.space['test' .. i]:insert{j, i * 1000 + j} end end
+
+box.schema.user.grant('guest', 'replication')
+
+test_run:cmd('create server replica with rpl_master=default, script="replication/replica_join_streams.lua"')
+test_run:cmd('start server replica')
+test_run:cmd('switch replica')
+
+box.info.id > 1
+count = {}
+for i = 1, 6 do count[i] = box.space['test' .. i]:count() end
+count
+box.space.test6.index.sk:get{6600}
+
+test_run:cmd('switch default')
+test_run:grep_log('replica', 'receiving initial data over 4 streams') ~= nil
+for i = 1, 6 do box.space['test' .. i]:insert{0, i * 1000} end
+test_run:wait_lsn('replica', 'default')
+test_run:cmd('switch replica')
+box.space.test1.index.sk:get{1000}
+
+test_run:cmd('switch default')
+test_run:cmd('stop server replica')
+test_run:cmd('cleanup server replica')
+test_run:cmd('delete server replica')
+test_run:cleanup_cluster()
+
+--
+-- If the replica fails to attach to an extra stream, the
+-- master sends the stream data over the JOIN connection once
+-- replication_disconnect_timeout has passed.
+--
+replication_timeout = box.cfg.replication_timeout
+box.cfg{replication_timeout = 0.1}
+box.error.injection.set('ERRINJ_RELAY_JOIN_STREAM', true)
+
+test_run:cmd('create server replica with rpl_master=default, script="replication/replica_join_streams.lua"')
+test_run:cmd('start server replica')
+test_run:cmd('switch replica')
+
+box.info.id > 1
+count = {}
+for i = 1, 6 do count[i] = box.space['test' .. i]:count() end
+count
+box.space.test6.index.sk:get{6600}
+
+test_run:cmd('switch default')
+test_run:grep_log('replica', 'failed to attach to join stream') ~= nil
+test_run:grep_log('default', "hasn't attached to join stream") ~= nil
+
+box.error.injection.set('ERRINJ_RELAY_JOIN_STREAM', false)
+box.cfg{replication_timeout = replication_timeout}
+test_run:cmd('stop server replica')
+test_run:cmd('cleanup server replica')
+test_run:cmd('delete server replica')
+test_run:cleanup_cluster()
+
+box.schema.user.revoke('guest', 'replication')
+for i = 1, 6 do box.space['test' .. i]:drop() end
@@ -0,0 +1,11 @@
+#!/usr/bin/env tarantool
+
+box.cfg({
+    listen                       = os.getenv("LISTEN"),
+    replication                  = os.getenv("MASTER"),
+    replication_fetch_checkpoint = true,
+    memtx_memory                 = 107374182,
+    replication_timeout          = 0.1,
+})
+
+require('console').listen(os.getenv('ADMIN'))
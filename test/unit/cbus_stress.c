@@ -3,11 +3,13 @@
 #include <stddef.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <time.h>
 
 #include "memory.h"
 #include "fiber.h"
 #include "cbus.h"
+#include "clock.h"
 #include "unit.h"
 
 /*
@@ -363,10 +365,219 @@ main_func(va_list ap)
 	return 0;
 }
 
+/* {{{ Benchmarks */
+
+/* Number of threads pushing messages to one endpoint. */
+static const int bench_producer_count = 4;
+
+/* Number of messages sent by each producer thread. */
+static const int bench_msg_count = 100000;
+
+/* Number of messages a producer flushes at once. */
+static const int bench_batch_size = 64;
+
+/* Number of round trips done to measure latency. */
+static const int bench_call_count = 10000;
+
+/* Print the benchmark results to stderr if set. */
+static bool bench_verbose = false;
+
+struct bench_producer {
+	char name[32];
+	struct cord cord;
+	/* Preallocated messages so as not to measure malloc. */
+	struct cmsg *msgs;
+};
+
+/* Number of messages received by the main thread. */
+static int bench_received;
+/* Fiber waiting for all messages to be received. */
+static struct fiber *bench_fiber;
+
+static void
+bench_msg_cb(struct cmsg *cmsg)
+{
+	(void)cmsg;
+	if (++bench_received == bench_producer_count * bench_msg_count)
+		fiber_wakeup(bench_fiber);
+}
+
+static int
+bench_producer_f(va_list ap)
+{
+	struct bench_producer *p = va_arg(ap, struct bench_producer *);
+	static const struct cmsg_hop route[] = {
+		{ bench_msg_cb, NULL }
+	};
+	struct cpipe pipe;
+	cpipe_create(&pipe, "main");
+	for (int i = 0; i < bench_msg_count; i++) {
+		cmsg_init(&p->msgs[i], route);
+		cpipe_push_input(&pipe, &p->msgs[i]);
+		if ((i + 1) % bench_batch_size == 0) {
+			cpipe_flush_input(&pipe);
+			fiber_sleep(0);
+		}
+	}
+	/* Flushes the rest of the input. */
+	cpipe_destroy(&pipe);
+	return 0;
+}
+
+/*
+ * Many threads push messages to the main thread endpoint
+ * concurrently, which exercises the multi-producer path of
+ * the endpoint queue.
+ */
+static void
+bench_throughput(void)
+{
+	struct bench_producer *producers =
+		calloc(bench_producer_count, sizeof(*producers));
+	assert(producers != NULL);
+
+	bench_received = 0;
+	bench_fiber = fiber();
+	double start = clock_monotonic();
+	for (int i = 0; i < bench_producer_count; i++) {
+		struct bench_producer *p = &producers[i];
+		snprintf(p->name, sizeof(p->name), "producer_%d", i);
+		p->msgs = calloc(bench_msg_count, sizeof(*p->msgs));
+		assert(p->msgs != NULL);
+		if (cord_costart(&p->cord, p->name, bench_producer_f, p) != 0)
+			unreachable();
+	}
+	while (bench_received < bench_producer_count * bench_msg_count)
+		fiber_yield();
+	double elapsed = clock_monotonic() - start;
+
+	for (int i = 0; i < bench_producer_count; i++) {
+		if (cord_join(&producers[i].cord) != 0)
+			unreachable();
+		free(producers[i].msgs);
+	}
+	free(producers);
+
+	if (bench_verbose) {
+		fprintf(stderr, "throughput: %d producers, %.0f msg/s\n",
+			bench_producer_count, bench_received / elapsed);
+	}
+}
+
+struct bench_echo {
+	struct cord cord;
+	/* Pipe from the echo thread to the main thread. */
+	struct cpipe main_pipe;
+};
+
+static int
+bench_echo_f(va_list ap)
+{
+	struct bench_echo *echo = va_arg(ap, struct bench_echo *);
+	cpipe_create(&echo->main_pipe, "main");
+	struct cbus_endpoint endpoint;
+	cbus_endpoint_create(&endpoint, "echo", fiber_schedule_cb, fiber());
+	cbus_loop(&endpoint);
+	cbus_endpoint_destroy(&endpoint, cbus_process);
+	cpipe_destroy(&echo->main_pipe);
+	return 0;
+}
+
+static int
+bench_call_f(struct cbus_call_msg *msg)
+{
+	(void)msg;
+	return 0;
+}
+
+/*
+ * Measure the round trip time of a cbus_call() to another
+ * thread, i.e. the latency of two message hand-offs.
+ */
+static void
+bench_latency(void)
+{
+	struct bench_echo echo;
+	if (cord_costart(&echo.cord, "echo", bench_echo_f, &echo) != 0)
+		unreachable();
+	struct cpipe echo_pipe;
+	cpipe_create(&echo_pipe, "echo");
+
+	double start = clock_monotonic();
+	for (int i = 0; i < bench_call_count; i++) {
+		struct cbus_call_msg msg;
+		int rc = cbus_call(&echo_pipe, &echo.main_pipe, &msg,
+				   bench_call_f, NULL, TIMEOUT_INFINITY);
+		assert(rc == 0);
+		(void)rc;
+	}
+	double elapsed = clock_monotonic() - start;
+
+	cbus_stop_loop(&echo_pipe);
+	cpipe_destroy(&echo_pipe);
+	if (cord_join(&echo.cord) != 0)
+		unreachable();
+
+	if (bench_verbose) {
+		fprintf(stderr, "latency: %.2f us per round trip\n",
+			elapsed / bench_call_count * 1e6);
+	}
+}
+
+static int
+bench_loop_f(va_list ap)
+{
+	(void)ap;
+	struct cbus_endpoint endpoint;
+	cbus_endpoint_create(&endpoint, "main", fiber_schedule_cb, fiber());
+	cbus_loop(&endpoint);
+	cbus_endpoint_destroy(&endpoint, cbus_process);
+	return 0;
+}
+
+static int
+bench_func(va_list ap)
+{
+	(void)ap;
+	struct fiber *loop_fiber = fiber_new("bench_loop", bench_loop_f);
+	assert(loop_fiber != NULL);
+	fiber_set_joinable(loop_fiber, true);
+	fiber_start(loop_fiber);
+
+	bench_throughput();
+	bench_latency();
+
+	fiber_cancel(loop_fiber);
+	fiber_join(loop_fiber);
+
+	ev_break(loop(), EVBREAK_ALL);
+	return 0;
+}
+
+static void
+bench(void)
+{
+	header();
+
+	struct fiber *f = fiber_new("bench", bench_func);
+	assert(f != NULL);
+	fiber_wakeup(f);
+	ev_run(loop(), 0);
+
+	footer();
+}
+
+/* }}} Benchmarks */
+
 int
-main()
+main(int argc, char **argv)
 {
 	srand(time(NULL));
+	/*
+	 * Benchmark numbers vary from run to run so they are
+	 * only printed on demand and not checked by the test.
+	 */
+	bench_verbose = argc > 1 && strcmp(argv[1], "--bench") == 0;
 
 	memory_init();
 	fiber_init(fiber_c_invoke);
@@ -381,6 +592,8 @@ main()
 
 	footer();
 
+	bench();
+
 	cbus_free();
 	fiber_free();
 	memory_free();
@@ -58,6 +58,13 @@ coio_test_wakeup(va_list ap)
 	return 0;
 }
 
+static int
+coio_test_task(struct coio_task *task)
+{
+	(void)task;
+	return 0;
+}
+
 static int
 test_call_f(va_list ap)
 {
@@ -102,6 +109,38 @@ test_getaddrinfo(void)
 	footer();
 }
 
+static void
+test_queue_stat(void)
+{
+	header();
+	plan(3);
+	enum { CALL_COUNT = 10 };
+	struct eio_queue_stat before, after;
+	eio_queue_stat(eio_queue(), &before);
+	for (int i = 0; i < CALL_COUNT; i++)
+		coio_call(coio_test_wakeup);
+	eio_queue_stat(eio_queue(), &after);
+	ok(after.submitted - before.submitted == CALL_COUNT &&
+	   after.executed - before.executed == CALL_COUNT,
+	   "queue stat: requests are executed");
+	ok(after.pending == 0 && after.wait_max >= before.wait_max,
+	   "queue stat: queue is empty");
+
+	/* High priority tasks go to the shared queue. */
+	eio_queue_stat(eio_nqueues(), &before);
+	struct coio_task task;
+	coio_task_create(&task, coio_test_task, NULL);
+	coio_task_set_priority(&task, EIO_PRI_MAX);
+	fail_unless(coio_task_execute(&task, TIMEOUT_INFINITY) == 0);
+	coio_task_destroy(&task);
+	eio_queue_stat(eio_nqueues(), &after);
+	ok(after.submitted - before.submitted == 1 &&
+	   after.executed - before.executed == 1,
+	   "queue stat: high priority queue");
+	check_plan();
+	footer();
+}
+
 static int
 main_f(va_list ap)
 {
@@ -121,6 +160,7 @@ main_f(va_list ap)
 	fiber_join(call_fiber);
 
 	test_getaddrinfo();
+	test_queue_stat();
 
 	ev_break(loop(), EVBREAK_ALL);
 	return 0;
@@ -0,0 +1,331 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "unit.h"              /* plan, header, footer, ok */
+#include "memory.h"            /* memory_init() */
+#include "fiber.h"             /* fiber_init() */
+#include "msgpuck.h"
+#include "trivia/util.h"
+#include "box/column_store.h"
+
+enum { ROW_COUNT = 3 * COLUMN_GROUP_SIZE + 100 };
+
+static const enum column_type all_types[] = {
+	COLUMN_UNSIGNED, COLUMN_INTEGER, COLUMN_DOUBLE,
+	COLUMN_STRING, COLUMN_BOOLEAN, COLUMN_UNSIGNED,
+};
+
+/** Encode the i-th row of the all_types table. */
+static const char *
+all_types_row(char *buf, uint64_t i, const char **end)
+{
+	char str[16];
+	snprintf(str, sizeof(str), "s%d", (int)(i % 10));
+	char *pos = mp_encode_array(buf, lengthof(all_types));
+	pos = mp_encode_uint(pos, i);
+	if (i % 2 != 0)
+		pos = mp_encode_int(pos, -(int64_t)i);
+	else
+		pos = mp_encode_uint(pos, i);
+	pos = mp_encode_double(pos, i * 0.5);
+	pos = mp_encode_str(pos, str, strlen(str));
+	pos = mp_encode_bool(pos, i % 3 == 0);
+	/* Long runs of equal values, encoded on sealing. */
+	pos = mp_encode_uint(pos, i / 1000);
+	*end = pos;
+	return buf;
+}
+
+static uint64_t
+aggregate_u(struct column_table *table, uint32_t column,
+	    enum column_aggregate_op op)
+{
+	struct column_value v;
+	if (column_table_aggregate(table, column, op, &v) != 0 ||
+	    v.type != COLUMN_UNSIGNED || v.is_null)
+		return UINT64_MAX;
+	return v.u;
+}
+
+static void
+test_aggregate(void)
+{
+	header();
+	struct column_table *table = column_table_new(all_types,
+						      lengthof(all_types));
+	fail_if(table == NULL);
+	char buf[128];
+	int64_t k_sum = 0, k_min = 0;
+	uint64_t r_sum = 0;
+	double d_sum = 0;
+	for (uint64_t i = 0; i < ROW_COUNT; i++) {
+		const char *end;
+		const char *row = all_types_row(buf, i, &end);
+		uint64_t rowid;
+		fail_if(column_table_append(table, row, end, &rowid) != 0);
+		fail_if(rowid != i);
+		int64_t k = i % 2 != 0 ? -(int64_t)i : (int64_t)i;
+		k_sum += k;
+		k_min = MIN(k_min, k);
+		r_sum += i / 1000;
+		d_sum += i * 0.5;
+	}
+	uint64_t n = ROW_COUNT;
+	ok(aggregate_u(table, 0, COLUMN_AGGREGATE_COUNT) == n, "count");
+	ok(aggregate_u(table, 0, COLUMN_AGGREGATE_SUM) == n * (n - 1) / 2,
+	   "sum of unsigned");
+	ok(aggregate_u(table, 0, COLUMN_AGGREGATE_MAX) == n - 1,
+	   "max of unsigned");
+
+	struct column_value v;
+	column_table_aggregate(table, 1, COLUMN_AGGREGATE_SUM, &v);
+	ok(v.type == COLUMN_INTEGER && v.i == k_sum, "sum of integer");
+	column_table_aggregate(table, 1, COLUMN_AGGREGATE_MIN, &v);
+	ok(v.type == COLUMN_INTEGER && v.i == k_min, "min of integer");
+	column_table_aggregate(table, 2, COLUMN_AGGREGATE_SUM, &v);
+	ok(v.type == COLUMN_DOUBLE && v.d == d_sum, "sum of double");
+
+	struct column_value min, max;
+	column_table_aggregate(table, 3, COLUMN_AGGREGATE_MIN, &min);
+	column_table_aggregate(table, 3, COLUMN_AGGREGATE_MAX, &max);
+	ok(min.str.len == 2 && memcmp(min.str.data, "s0", 2) == 0 &&
+	   max.str.len == 2 && memcmp(max.str.data, "s9", 2) == 0,
+	   "min and max of string");
+	column_table_aggregate(table, 4, COLUMN_AGGREGATE_MIN, &min);
+	column_table_aggregate(table, 4, COLUMN_AGGREGATE_MAX, &max);
+	ok(!min.b && max.b, "min and max of boolean");
+	ok(column_table_aggregate(table, 3, COLUMN_AGGREGATE_SUM, &v) != 0,
+	   "sum of string is an error");
+
+	struct column_group *group = table->groups[0];
+	ok(group->is_sealed && group->chunks[5].run_count > 0 &&
+	   group->chunks[0].run_count == 0 &&
+	   group->chunks[2].run_count == 0, "full group is encoded");
+	ok(table->sealed_count == 3 && !table->groups[3]->is_sealed,
+	   "open group is not encoded");
+	ok(aggregate_u(table, 5, COLUMN_AGGREGATE_SUM) == r_sum,
+	   "sum of encoded");
+
+	/* Delete rows from an encoded group and from the open one. */
+	uint64_t deleted[] = {0, 1, 2, 1500, 1501, ROW_COUNT - 1};
+	uint64_t u_sum = n * (n - 1) / 2;
+	for (uint32_t i = 0; i < lengthof(deleted); i++) {
+		column_table_delete(table, deleted[i]);
+		u_sum -= deleted[i];
+		r_sum -= deleted[i] / 1000;
+	}
+	column_table_delete(table, 0);
+	n -= lengthof(deleted);
+	ok(aggregate_u(table, 0, COLUMN_AGGREGATE_COUNT) == n,
+	   "count after delete");
+	ok(aggregate_u(table, 0, COLUMN_AGGREGATE_SUM) == u_sum,
+	   "sum after delete");
+	ok(aggregate_u(table, 5, COLUMN_AGGREGATE_SUM) == r_sum,
+	   "sum of encoded after delete");
+	ok(aggregate_u(table, 0, COLUMN_AGGREGATE_MIN) == 3 &&
+	   aggregate_u(table, 0, COLUMN_AGGREGATE_MAX) == ROW_COUNT - 2,
+	   "min and max after delete");
+
+	column_table_unref(table);
+	footer();
+}
+
+static void
+test_bad_row(void)
+{
+	header();
+	const enum column_type types[] = {COLUMN_INTEGER, COLUMN_STRING};
+	struct column_table *table = column_table_new(types, 2);
+	fail_if(table == NULL);
+	char buf[64];
+	uint64_t rowid;
+	char *end = mp_encode_array(buf, 2);
+	end = mp_encode_str(end, "a", 1);
+	end = mp_encode_str(end, "b", 1);
+	ok(column_table_append(table, buf, end, &rowid) != 0 &&
+	   table->row_count == 0, "field type mismatch");
+	end = mp_encode_array(buf, 1);
+	end = mp_encode_int(end, -1);
+	ok(column_table_append(table, buf, end, &rowid) != 0 &&
+	   table->row_count == 0, "field count mismatch");
+	end = mp_encode_array(buf, 2);
+	end = mp_encode_double(end, 1.5);
+	end = mp_encode_str(end, "b", 1);
+	ok(column_table_append(table, buf, end, &rowid) != 0 &&
+	   table->row_count == 0, "double in integer column");
+	column_table_unref(table);
+	footer();
+}
+
+static void
+test_overflow(void)
+{
+	header();
+	const enum column_type types[] = {COLUMN_UNSIGNED, COLUMN_INTEGER};
+	struct column_table *table = column_table_new(types, 2);
+	fail_if(table == NULL);
+	char buf[64];
+	uint64_t rowid;
+	for (int i = 0; i < 2; i++) {
+		char *end = mp_encode_array(buf, 2);
+		end = mp_encode_uint(end, UINT64_MAX);
+		end = mp_encode_int(end, INT64_MIN);
+		fail_if(column_table_append(table, buf, end, &rowid) != 0);
+	}
+	struct column_value v;
+	column_table_aggregate(table, 0, COLUMN_AGGREGATE_SUM, &v);
+	ok(v.type == COLUMN_DOUBLE && v.d == 2 * (double)UINT64_MAX,
+	   "sum of unsigned above UINT64_MAX");
+	column_table_aggregate(table, 1, COLUMN_AGGREGATE_SUM, &v);
+	ok(v.type == COLUMN_DOUBLE && v.d == 2 * (double)INT64_MIN,
+	   "sum of integer below INT64_MIN");
+	column_table_delete(table, 1);
+	column_table_aggregate(table, 1, COLUMN_AGGREGATE_SUM, &v);
+	ok(v.type == COLUMN_INTEGER && v.i == INT64_MIN,
+	   "sum of integer is INT64_MIN");
+	column_table_unref(table);
+	footer();
+}
+
+static void
+test_big_integer(void)
+{
+	header();
+	const enum column_type types[] = {COLUMN_INTEGER};
+	struct column_table *table = column_table_new(types, 1);
+	fail_if(table == NULL);
+	char buf[64];
+	uint64_t rowid;
+	for (uint64_t i = 0; i < COLUMN_GROUP_SIZE; i++) {
+		char *end = mp_encode_array(buf, 1);
+		if (i == 1)
+			end = mp_encode_uint(end, UINT64_MAX);
+		else
+			end = mp_encode_int(end, -1);
+		fail_if(column_table_append(table, buf, end, &rowid) != 0);
+	}
+	ok(table->groups[0]->is_sealed &&
+	   table->groups[0]->chunks[0].run_count == 0,
+	   "chunk with big integers is not encoded");
+	struct column_value v;
+	column_table_aggregate(table, 0, COLUMN_AGGREGATE_SUM, &v);
+	ok(v.type == COLUMN_UNSIGNED &&
+	   v.u == UINT64_MAX - (COLUMN_GROUP_SIZE - 1),
+	   "sum of big integers");
+	column_table_aggregate(table, 0, COLUMN_AGGREGATE_MIN, &v);
+	bool is_min_ok = v.type == COLUMN_INTEGER && v.i == -1;
+	column_table_aggregate(table, 0, COLUMN_AGGREGATE_MAX, &v);
+	ok(is_min_ok && v.type == COLUMN_UNSIGNED && v.u == UINT64_MAX,
+	   "min and max of big integers");
+
+	char *end = mp_encode_array(buf, 1);
+	end = mp_encode_uint(end, (uint64_t)INT64_MAX + 1);
+	fail_if(column_table_append(table, buf, end, &rowid) != 0);
+	struct column_view view;
+	fail_if(column_view_create(&view, table) != 0);
+	const char *data;
+	uint32_t size;
+	uint64_t i = 0;
+	bool is_ok = true;
+	while (column_view_next(&view, &data, &size) == 0 && data != NULL) {
+		mp_decode_array(&data);
+		if (i == 1 || i == COLUMN_GROUP_SIZE) {
+			uint64_t expected = i == 1 ? UINT64_MAX :
+					    (uint64_t)INT64_MAX + 1;
+			is_ok = is_ok && mp_typeof(*data) == MP_UINT &&
+				mp_decode_uint(&data) == expected;
+		} else {
+			is_ok = is_ok && mp_typeof(*data) == MP_INT &&
+				mp_decode_int(&data) == -1;
+		}
+		i++;
+	}
+	ok(is_ok && i == COLUMN_GROUP_SIZE + 1,
+	   "view returns big integers");
+	column_view_destroy(&view);
+	column_table_unref(table);
+	footer();
+}
+
+static const char *
+view_row_str(uint64_t i)
+{
+	return i < 2000 ? "x" : "y";
+}
+
+/** Check that a view returns rows i = 0..count - 1 except skip. */
+static bool
+view_check(struct column_view *view, uint64_t count, uint64_t skip)
+{
+	uint64_t i = 0;
+	const char *data;
+	uint32_t size;
+	while (column_view_next(view, &data, &size) == 0 && data != NULL) {
+		if (i == skip)
+			i++;
+		if (mp_decode_array(&data) != 2 ||
+		    mp_decode_uint(&data) != i)
+			return false;
+		uint32_t len;
+		const char *str = mp_decode_str(&data, &len);
+		if (len != 1 || *str != *view_row_str(i))
+			return false;
+		i++;
+	}
+	return data == NULL && i == count;
+}
+
+static void
+test_view(void)
+{
+	header();
+	const enum column_type types[] = {COLUMN_UNSIGNED, COLUMN_STRING};
+	struct column_table *table = column_table_new(types, 2);
+	fail_if(table == NULL);
+	char buf[64];
+	uint64_t rowid;
+	struct column_view view;
+	for (uint64_t i = 0; i < COLUMN_GROUP_SIZE + 1; i++) {
+		if (i == COLUMN_GROUP_SIZE - 1)
+			fail_if(column_view_create(&view, table) != 0);
+		char *end = mp_encode_array(buf, 2);
+		end = mp_encode_uint(end, i);
+		end = mp_encode_str(end, view_row_str(i), 1);
+		fail_if(column_table_append(table, buf, end, &rowid) != 0);
+	}
+	ok(!table->groups[0]->is_sealed,
+	   "sealing is deferred while a view is open");
+	column_table_delete(table, 5);
+	ok(view_check(&view, COLUMN_GROUP_SIZE - 1, UINT64_MAX),
+	   "view returns rows as of its creation");
+	column_view_destroy(&view);
+	ok(table->groups[0]->is_sealed &&
+	   table->groups[0]->chunks[1].run_count == 2,
+	   "group is sealed when the view is destroyed");
+
+	fail_if(column_view_create(&view, table) != 0);
+	ok(view_check(&view, COLUMN_GROUP_SIZE + 1, 5),
+	   "view decodes encoded chunks");
+	column_view_destroy(&view);
+	column_table_unref(table);
+	footer();
+}
+
+int
+main(void)
+{
+	memory_init();
+	fiber_init(fiber_c_invoke);
+
+	plan(30);
+	test_aggregate();
+	test_bad_row();
+	test_overflow();
+	test_big_integer();
+	test_view();
+	int rc = check_plan();
+
+	fiber_free();
+	memory_free();
+	return rc;
+}
@@ -12,6 +12,18 @@ noop_f(va_list ap)
 	return 0;
 }
 
+static int
+stack_use_f(va_list ap)
+{
+	(void)ap;
+	/* Go deep enough to overwrite the stack watermark. */
+	size_t size = 80 << 10;
+	volatile char *buf = alloca(size);
+	for (size_t i = 0; i < size; i++)
+		buf[i] = 0;
+	return 0;
+}
+
 static int
 main_f(va_list ap)
 {
@@ -21,7 +33,7 @@ main_f(va_list ap)
 	struct fiber *fiber;
 
 	header();
-	plan(6);
+	plan(8);
 
 	/*
 	 * Set non-default stack size to prevent reusing of an
@@ -61,13 +73,59 @@ main_f(va_list ap)
 	ok(diag_get() != NULL, "madvise: diag is armed after error");
 
 	/*
-	 * Check if we leak on fiber destruction.
-	 * We will print an error and result get
-	 * compared by testing engine.
+	 * Check that a dead fiber with a custom stack is cached
+	 * and reused for the same stack size.
 	 */
 	fiber_attr_delete(fiber_attr);
 	fiber_attr = fiber_attr_new();
 	fiber_attr->flags |= FIBER_CUSTOM_STACK;
+	fiber_attr->stack_size = 96 << 10;
+
+	struct fiber_cache_stat stat_before, stat_after;
+	fiber_cache_stat(&stat_before);
+	for (int i = 0; i < 2; i++) {
+		fiber = fiber_new_ex("test_reuse", fiber_attr, noop_f);
+		fail_unless(fiber != NULL);
+		fiber_set_joinable(fiber, true);
+		fiber_start(fiber);
+		fiber_join(fiber);
+	}
+	fiber_cache_stat(&stat_after);
+	ok(stat_after.created == stat_before.created + 1 &&
+	   stat_after.reused == stat_before.reused + 1,
+	   "fiber with custom stack is reused");
+
+	/*
+	 * Fill the cache of fibers with a custom stack so that
+	 * the next one is destroyed on recycle. The fillers use
+	 * their stacks above the watermark, so the cached stacks
+	 * are released once the event loop is idle.
+	 */
+	fiber_attr->stack_size = 128 << 10;
+	struct fiber *fillers[FIBER_CUSTOM_STACK_CACHE_MAX];
+	for (int i = 0; i < FIBER_CUSTOM_STACK_CACHE_MAX; i++) {
+		fillers[i] = fiber_new_ex("test_filler", fiber_attr,
+					  stack_use_f);
+		fail_unless(fillers[i] != NULL);
+		fiber_set_joinable(fillers[i], true);
+	}
+	fiber_cache_stat(&stat_before);
+	for (int i = 0; i < FIBER_CUSTOM_STACK_CACHE_MAX; i++) {
+		fiber_start(fillers[i]);
+		fiber_join(fillers[i]);
+	}
+	fiber_cache_stat(&stat_after);
+	fail_unless(stat_after.stack_releases == stat_before.stack_releases);
+	fiber_sleep(0.01);
+	fiber_cache_stat(&stat_after);
+	ok(stat_after.stack_releases > stat_before.stack_releases,
+	   "dirty custom stacks are released when idle");
+
+	/*
+	 * Check if we leak on fiber destruction.
+	 * We will print an error and result get
+	 * compared by testing engine.
+	 */
 	fiber_attr->stack_size = 64 << 10;
 
 	diag_clear(diag_get());
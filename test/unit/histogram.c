@@ -167,6 +167,19 @@ test_percentile(void)
 		fail_if(result_lo != expected_lo);
 	}
 
+	for (int permille = 990; permille < 1000; permille++) {
+		int64_t val = data[data_len * permille / 1000];
+		int64_t expected = max;
+		for (size_t b = 0; b < n_buckets; b++) {
+			if (buckets[b] >= val) {
+				expected = buckets[b];
+				break;
+			}
+		}
+		int64_t result = histogram_permille(hist, permille);
+		fail_if(result != expected);
+	}
+
 	histogram_delete(hist);
 	free(data);
 	free(buckets);
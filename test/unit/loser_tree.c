@@ -0,0 +1,226 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "trivia/util.h"
+#include "unit.h"
+#include "clock.h"
+
+#define LOSER_TREE_FORWARD_DECLARATION
+#include "salad/loser_tree.h"
+#define HEAP_FORWARD_DECLARATION
+#include "salad/heap.h"
+
+/**
+ * A source of a merge: a sorted array of values. It is a tree
+ * and a heap node at the same time to compare the two.
+ */
+struct source {
+	const uint32_t *values;
+	uint32_t count;
+	uint32_t pos;
+	struct loser_tree_node in_tree;
+	struct heap_node in_heap;
+};
+
+/** Number of comparisons done, to check the log2(k) bound. */
+static uint64_t cmp_count;
+
+static inline bool
+source_less(const struct source *a, const struct source *b)
+{
+	cmp_count++;
+	return a->values[a->pos] < b->values[b->pos];
+}
+
+#define LOSER_TREE_NAME test_tree
+#define LOSER_TREE_LESS(tree, a, b) source_less(a, b)
+#define loser_tree_value_t struct source
+#define loser_tree_value_attr in_tree
+#include "salad/loser_tree.h"
+
+#define HEAP_NAME test_heap
+#define HEAP_LESS(heap, a, b) source_less(a, b)
+#define heap_value_t struct source
+#define heap_value_attr in_heap
+#include "salad/heap.h"
+
+static int
+cmp_uint32(const void *a, const void *b)
+{
+	uint32_t l = *(const uint32_t *)a;
+	uint32_t r = *(const uint32_t *)b;
+	return l < r ? -1 : l > r;
+}
+
+/**
+ * Fill @a k sources with @a total random values in all and
+ * return the values.
+ */
+static uint32_t *
+sources_new(struct source *sources, uint32_t k, uint32_t total)
+{
+	uint32_t *values = malloc(total * sizeof(*values));
+	uint32_t *counts = calloc(k, sizeof(*counts));
+	for (uint32_t i = 0; i < total; i++)
+		counts[rand() % k]++;
+	uint32_t offset = 0;
+	uint32_t value = 0;
+	for (uint32_t i = 0; i < k; i++) {
+		sources[i].values = values + offset;
+		sources[i].count = counts[i];
+		sources[i].pos = 0;
+		loser_tree_node_create(&sources[i].in_tree);
+		heap_node_create(&sources[i].in_heap);
+		for (uint32_t j = 0; j < counts[i]; j++) {
+			/* Duplicates within and across sources. */
+			value += rand() % 3;
+			values[offset++] = value % 1000;
+		}
+		qsort(values + offset - counts[i], counts[i],
+		      sizeof(*values), cmp_uint32);
+	}
+	free(counts);
+	return values;
+}
+
+/**
+ * Merge the sources with a loser tree, deleting the source
+ * @a victim in the middle of the merge, and check that the
+ * output is sorted and complete.
+ */
+static void
+test_merge(uint32_t k, uint32_t total, int victim)
+{
+	struct source *sources = malloc(k * sizeof(*sources));
+	uint32_t *values = sources_new(sources, k, total);
+	loser_tree_t tree;
+	test_tree_create(&tree);
+	for (uint32_t i = 0; i < k; i++) {
+		if (sources[i].count > 0)
+			test_tree_insert(&tree, &sources[i]);
+	}
+	uint32_t expected = total;
+	uint32_t count = 0;
+	uint32_t prev = 0;
+	bool is_sorted = true;
+	struct source *src;
+	while ((src = test_tree_top(&tree)) != NULL) {
+		uint32_t value = src->values[src->pos];
+		if (value < prev)
+			is_sorted = false;
+		prev = value;
+		count++;
+		if (++src->pos == src->count)
+			test_tree_delete(&tree, src);
+		else
+			test_tree_update(&tree, src);
+		if (count == total / 2 && victim >= 0 &&
+		    !loser_tree_node_is_stray(&sources[victim].in_tree)) {
+			struct source *v = &sources[victim];
+			expected -= v->count - v->pos;
+			test_tree_delete(&tree, v);
+		}
+	}
+	ok(is_sorted && count == expected && tree.size == 0,
+	   "k = %u%s", k, victim >= 0 ? ", delete a source" : "");
+	test_tree_destroy(&tree);
+	free(values);
+	free(sources);
+}
+
+/* {{{ Benchmark */
+
+/* Number of values merged per measurement. */
+enum { BENCH_VALUE_COUNT = 4000000 };
+
+static void
+bench_case(uint32_t k)
+{
+	struct source *sources = malloc(k * sizeof(*sources));
+	uint32_t *values = sources_new(sources, k, BENCH_VALUE_COUNT);
+
+	loser_tree_t tree;
+	test_tree_create(&tree);
+	for (uint32_t i = 0; i < k; i++)
+		test_tree_insert(&tree, &sources[i]);
+	cmp_count = 0;
+	double start = clock_monotonic();
+	struct source *src;
+	while ((src = test_tree_top(&tree)) != NULL) {
+		if (++src->pos == src->count)
+			test_tree_delete(&tree, src);
+		else
+			test_tree_update(&tree, src);
+	}
+	double tree_time = clock_monotonic() - start;
+	uint64_t tree_cmp = cmp_count;
+	test_tree_destroy(&tree);
+
+	heap_t heap;
+	test_heap_create(&heap);
+	for (uint32_t i = 0; i < k; i++) {
+		sources[i].pos = 0;
+		test_heap_insert(&heap, &sources[i]);
+	}
+	cmp_count = 0;
+	start = clock_monotonic();
+	while ((src = test_heap_top(&heap)) != NULL) {
+		if (++src->pos == src->count)
+			test_heap_delete(&heap, src);
+		else
+			test_heap_update(&heap, src);
+	}
+	double heap_time = clock_monotonic() - start;
+	uint64_t heap_cmp = cmp_count;
+	test_heap_destroy(&heap);
+
+	fprintf(stderr, "k = %4u: loser tree %5.2f cmp %5.1f ns, "
+		"heap %5.2f cmp %5.1f ns\n", k,
+		(double)tree_cmp / BENCH_VALUE_COUNT,
+		tree_time * 1e9 / BENCH_VALUE_COUNT,
+		(double)heap_cmp / BENCH_VALUE_COUNT,
+		heap_time * 1e9 / BENCH_VALUE_COUNT);
+	free(values);
+	free(sources);
+}
+
+static void
+bench(void)
+{
+	static const uint32_t ks[] = {2, 8, 16, 50, 100, 200, 1000};
+	for (uint32_t i = 0; i < lengthof(ks); i++)
+		bench_case(ks[i]);
+}
+
+/* }}} Benchmark */
+
+int
+main(int argc, char **argv)
+{
+	srand(179);
+	plan(9);
+	header();
+
+	test_merge(1, 100, -1);
+	test_merge(2, 1000, -1);
+	test_merge(3, 1000, -1);
+	test_merge(7, 1000, -1);
+	test_merge(64, 10000, -1);
+	test_merge(200, 10000, -1);
+	test_merge(1, 100, 0);
+	test_merge(5, 1000, 3);
+	test_merge(100, 10000, 42);
+
+	footer();
+	int rc = check_plan();
+	/*
+	 * Benchmark numbers vary from run to run so they are
+	 * only printed on demand and not checked by the test.
+	 */
+	if (argc > 1 && strcmp(argv[1], "--bench") == 0)
+		bench();
+	return rc;
+}
@@ -0,0 +1,174 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <msgpuck.h>
+
+#include "mp_scan.h"
+#include "unit.h"
+#include "trivia/util.h"
+
+enum { BUF_SIZE = 1 << 16, VALUE_COUNT = 1000 };
+
+static char buf[BUF_SIZE];
+
+/** Encode a random value, favoring single-byte ones. */
+static char *
+gen_value(char *data, int depth)
+{
+	int r = rand() % (depth < 3 ? 12 : 7);
+	switch (r) {
+	case 0:
+	case 1:
+		return mp_encode_uint(data, rand() % 128);
+	case 2:
+		return mp_encode_int(data, -1 - rand() % 32);
+	case 3:
+		return rand() % 2 ? mp_encode_nil(data) :
+		       mp_encode_bool(data, rand() % 2);
+	case 4:
+		return mp_encode_uint(data, rand() * 1000ULL);
+	case 5:
+		return mp_encode_double(data, rand() / 3.0);
+	case 6: {
+		char str[300];
+		uint32_t len = rand() % sizeof(str);
+		memset(str, 'x', len);
+		return rand() % 2 ? mp_encode_str(data, str, len) :
+		       mp_encode_bin(data, str, len);
+	}
+	case 7:
+	case 8:
+	case 9: {
+		uint32_t size = rand() % 70;
+		data = mp_encode_array(data, size);
+		for (uint32_t i = 0; i < size; i++)
+			data = gen_value(data, depth + 1);
+		return data;
+	}
+	case 10: {
+		uint32_t size = rand() % 5;
+		data = mp_encode_map(data, size);
+		for (uint32_t i = 0; i < 2 * size; i++)
+			data = gen_value(data, depth + 1);
+		return data;
+	}
+	default: {
+		char ext[20];
+		uint32_t len = rand() % sizeof(ext);
+		memset(ext, 0, len);
+		return mp_encode_ext(data, 1, ext, len);
+	}
+	}
+}
+
+/** Check that mp_scan_check() agrees with mp_check(). */
+static bool
+check_same(const char *data, const char *end)
+{
+	const char *scan_end = data;
+	const char *check_end = data;
+	int rc = mp_scan_check(&scan_end, end);
+	if (rc != mp_check(&check_end, end))
+		return false;
+	return rc != 0 || scan_end == check_end;
+}
+
+static void
+test_scan(bool is_scalar)
+{
+	header();
+	plan(3);
+	mp_scan_set_scalar(is_scalar);
+	srand(1);
+
+	bool valid_ok = true, truncated_ok = true;
+	for (int i = 0; i < VALUE_COUNT; i++) {
+		char *end = gen_value(buf, 0);
+		assert(end <= buf + sizeof(buf));
+		const char *data = buf;
+		if (mp_scan_check(&data, end) != 0 || data != end)
+			valid_ok = false;
+		for (char *cut = buf; cut < end; cut++) {
+			if (!check_same(buf, cut))
+				truncated_ok = false;
+		}
+	}
+	ok(valid_ok, "valid values");
+	ok(truncated_ok, "truncated values");
+
+	/*
+	 * A long run of single-byte values must not be
+	 * consumed past the end of the array.
+	 */
+	char *end = mp_encode_array(buf, 100);
+	for (int i = 0; i < 100; i++)
+		end = mp_encode_uint(end, i);
+	char *array_end = end;
+	for (int i = 0; i < 50; i++)
+		end = mp_encode_nil(end);
+	const char *data = buf;
+	bool run_ok = mp_scan_check(&data, end) == 0 && data == array_end;
+	/* The reserved byte inside a run. */
+	buf[70] = (char)0xc1;
+	data = buf;
+	run_ok = run_ok && mp_scan_check(&data, end) != 0;
+	ok(run_ok, "run of single-byte values");
+
+	check_plan();
+	footer();
+}
+
+/**
+ * Check one value with both implementations, they must
+ * agree on any input.
+ */
+static bool
+check_scalar_vs_vector(const char *data, const char *end)
+{
+	const char *scalar_end = data;
+	const char *vector_end = data;
+	mp_scan_set_scalar(true);
+	int scalar_rc = mp_scan_check(&scalar_end, end);
+	mp_scan_set_scalar(false);
+	int vector_rc = mp_scan_check(&vector_end, end);
+	return scalar_rc == vector_rc &&
+	       (scalar_rc != 0 || scalar_end == vector_end);
+}
+
+static void
+test_corrupted(void)
+{
+	header();
+	plan(1);
+	srand(2);
+
+	bool is_ok = true;
+	for (int i = 0; i < VALUE_COUNT; i++) {
+		char *end = gen_value(buf, 0);
+		for (int j = 0; j < 3; j++) {
+			buf[rand() % (end - buf)] = rand();
+			if (!check_scalar_vs_vector(buf, end))
+				is_ok = false;
+		}
+	}
+	ok(is_ok, "corrupted values");
+
+	check_plan();
+	footer();
+}
+
+int
+main(void)
+{
+	header();
+	plan(3);
+	mp_scan_init();
+
+	test_scan(true);
+	test_scan(false);
+	test_corrupted();
+
+	footer();
+	return check_plan();
+}
@@ -150,6 +150,66 @@ test_log_rotate()
 	tt_pthread_mutex_unlock(&mutex);
 }
 
+enum {
+	ASYNC_THREADS = 4,
+	ASYNC_LINES = 20000,
+};
+
+static struct log async_log;
+
+static void *
+async_writer_f(void *arg)
+{
+	int id = (int)(intptr_t) arg;
+	for (int i = 0; i < ASYNC_LINES; i++)
+		log_say(&async_log, S_INFO, NULL, 0, NULL,
+			"async %d %d", id, i);
+	return NULL;
+}
+
+/**
+ * Write from several threads to an asynchronous log and count
+ * lines found in the file. Lines of one thread must keep their
+ * order.
+ */
+static int
+test_log_async(const char *path, enum say_async_overflow overflow,
+	       bool *is_ordered)
+{
+	log_create(&async_log, path, false);
+	log_set_format(&async_log, say_format_plain);
+	if (log_async_start(&async_log, overflow) != 0)
+		return -1;
+	pthread_t threads[ASYNC_THREADS];
+	for (int i = 0; i < ASYNC_THREADS; i++)
+		tt_pthread_create(&threads[i], NULL, async_writer_f,
+				  (void *)(intptr_t) i);
+	for (int i = 0; i < ASYNC_THREADS; i++)
+		tt_pthread_join(threads[i], NULL);
+	log_destroy(&async_log);
+
+	int last[ASYNC_THREADS];
+	for (int i = 0; i < ASYNC_THREADS; i++)
+		last[i] = -1;
+	*is_ordered = true;
+	int count = 0;
+	char line[1024];
+	FILE *f = fopen(path, "r");
+	while (fgets(line, sizeof(line), f) != NULL) {
+		const char *msg = strstr(line, "async ");
+		int id, i;
+		if (msg == NULL || sscanf(msg, "async %d %d", &id, &i) != 2)
+			continue;
+		if (i <= last[id])
+			*is_ordered = false;
+		last[id] = i;
+		count++;
+	}
+	fclose(f);
+	unlink(path);
+	return count;
+}
+
 static int
 main_f(va_list ap)
 {
@@ -168,7 +228,7 @@ int main()
 	fiber_init(fiber_c_invoke);
 	say_logger_init("/dev/null", S_INFO, 0, "plain", 0);
 
-	plan(33);
+	plan(35);
 
 #define PARSE_LOGGER_TYPE(input, rc) \
 	ok(parse_logger_type(input) == rc, "%s", input)
@@ -234,6 +294,18 @@ int main()
 	}
 	log_destroy(&test_log);
 
+	char async_filename[30];
+	sprintf(async_filename, "%s/async.log", tmp_dir);
+	bool is_ordered;
+	int count = test_log_async(async_filename, SAY_OVERFLOW_BLOCK,
+				   &is_ordered);
+	ok(count == ASYNC_THREADS * ASYNC_LINES && is_ordered,
+	   "async, block on overflow");
+	count = test_log_async(async_filename, SAY_OVERFLOW_DROP,
+			       &is_ordered);
+	ok(count + log_async_dropped() == ASYNC_THREADS * ASYNC_LINES &&
+	   is_ordered, "async, drop on overflow");
+
 	coio_init();
 	coio_enable();
 
@@ -0,0 +1,338 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "unit.h"              /* plan, header, footer, ok */
+#include "memory.h"            /* memory_init() */
+#include "fiber.h"             /* fiber_init() */
+#include "clock.h"             /* clock_monotonic() */
+#include "decimal.h"           /* decimal_from_string() */
+#include "mp_decimal.h"        /* mp_encode_decimal() */
+#include "uuid/mp_uuid.h"      /* mp_encode_uuid() */
+#include "msgpuck.h"
+#include "box/tuple.h"         /* tuple_init(), tuple_new() */
+#include "box/key_def.h"       /* key_def_new(), tuple_compare() */
+
+enum { MAX_PARTS = 3, MAX_TUPLES = 4 };
+
+/**
+ * A key shape and a set of tuples sorted in strictly ascending
+ * order according to it. Values are given as strings and are
+ * encoded according to the part type, "nil" stands for NULL.
+ */
+struct compare_case {
+	const char *name;
+	uint32_t part_count;
+	enum field_type types[MAX_PARTS];
+	uint32_t tuple_count;
+	const char *values[MAX_TUPLES][MAX_PARTS];
+};
+
+static const struct compare_case cases[] = {
+	{"integer", 1, {FIELD_TYPE_INTEGER}, 4,
+	 {{"-100"}, {"-1"}, {"0"}, {"42"}}},
+	{"number", 1, {FIELD_TYPE_NUMBER}, 4,
+	 {{"-2"}, {"-1.5"}, {"1"}, {"1.25"}}},
+	{"double", 1, {FIELD_TYPE_DOUBLE}, 3,
+	 {{"-3.5"}, {"0.5"}, {"1e10"}}},
+	{"decimal", 1, {FIELD_TYPE_DECIMAL}, 3,
+	 {{"-1.1"}, {"0.001"}, {"12345678901234567890.5"}}},
+	{"uuid", 1, {FIELD_TYPE_UUID}, 3,
+	 {{"00000000-0000-0000-0000-000000000001"},
+	  {"0a0b0c0d-0000-0000-0000-000000000000"},
+	  {"f0000000-0000-0000-0000-000000000000"}}},
+	{"integer, string", 2, {FIELD_TYPE_INTEGER, FIELD_TYPE_STRING}, 4,
+	 {{"-5", "b"}, {"1", "a"}, {"1", "ab"}, {"7", ""}}},
+	{"uuid, unsigned", 2, {FIELD_TYPE_UUID, FIELD_TYPE_UNSIGNED}, 3,
+	 {{"00000000-0000-0000-0000-000000000001", "10"},
+	  {"00000000-0000-0000-0000-000000000001", "11"},
+	  {"00000000-0000-0000-0000-000000000002", "0"}}},
+	{"double, integer", 2, {FIELD_TYPE_DOUBLE, FIELD_TYPE_INTEGER}, 3,
+	 {{"-0.5", "3"}, {"2.5", "-3"}, {"2.5", "3"}}},
+	{"string, integer, unsigned", 3,
+	 {FIELD_TYPE_STRING, FIELD_TYPE_INTEGER, FIELD_TYPE_UNSIGNED}, 4,
+	 {{"a", "-1", "5"}, {"a", "0", "1"}, {"a", "0", "2"}, {"b", "-9", "0"}}},
+};
+
+static char *
+encode_value(char *data, enum field_type type, const char *value)
+{
+	if (strcmp(value, "nil") == 0)
+		return mp_encode_nil(data);
+	switch (type) {
+	case FIELD_TYPE_UNSIGNED:
+		return mp_encode_uint(data, strtoull(value, NULL, 10));
+	case FIELD_TYPE_INTEGER: {
+		long long v = strtoll(value, NULL, 10);
+		return v < 0 ? mp_encode_int(data, v) :
+			       mp_encode_uint(data, v);
+	}
+	case FIELD_TYPE_NUMBER:
+		if (strchr(value, '.') != NULL)
+			return mp_encode_double(data, strtod(value, NULL));
+		return encode_value(data, FIELD_TYPE_INTEGER, value);
+	case FIELD_TYPE_DOUBLE:
+		return mp_encode_double(data, strtod(value, NULL));
+	case FIELD_TYPE_STRING:
+		return mp_encode_str(data, value, strlen(value));
+	case FIELD_TYPE_DECIMAL: {
+		decimal_t dec;
+		decimal_t *rc = decimal_from_string(&dec, value);
+		assert(rc != NULL);
+		(void)rc;
+		return mp_encode_decimal(data, &dec);
+	}
+	case FIELD_TYPE_UUID: {
+		struct tt_uuid uuid;
+		int rc = tt_uuid_from_string(value, &uuid);
+		assert(rc == 0);
+		(void)rc;
+		return mp_encode_uuid(data, &uuid);
+	}
+	default:
+		unreachable();
+		return data;
+	}
+}
+
+/** Encode key parts of a case row without an array header. */
+static char *
+encode_key(char *data, const struct compare_case *c, uint32_t row)
+{
+	for (uint32_t i = 0; i < c->part_count; i++)
+		data = encode_value(data, c->types[i], c->values[row][i]);
+	return data;
+}
+
+static struct tuple *
+case_tuple_new(const struct compare_case *c, uint32_t row)
+{
+	char buf[256];
+	char *data = mp_encode_array(buf, c->part_count);
+	data = encode_key(data, c, row);
+	assert(data <= buf + sizeof(buf));
+	struct tuple *tuple = tuple_new(tuple_format_runtime, buf, data);
+	assert(tuple != NULL);
+	tuple_ref(tuple);
+	return tuple;
+}
+
+static struct key_def *
+case_key_def_new(const struct compare_case *c, bool is_nullable)
+{
+	struct key_part_def parts[MAX_PARTS];
+	for (uint32_t i = 0; i < c->part_count; i++) {
+		parts[i] = key_part_def_default;
+		parts[i].fieldno = i;
+		parts[i].type = c->types[i];
+		parts[i].is_nullable = is_nullable;
+		parts[i].nullable_action = is_nullable ?
+					   ON_CONFLICT_ACTION_NONE :
+					   ON_CONFLICT_ACTION_DEFAULT;
+	}
+	struct key_def *def = key_def_new(parts, c->part_count, false);
+	assert(def != NULL);
+	return def;
+}
+
+static int
+sign(int v)
+{
+	return v < 0 ? -1 : v > 0;
+}
+
+/**
+ * Check that every pair of case tuples and every tuple-key
+ * pair compare as their positions in the case do.
+ */
+static void
+test_case(const struct compare_case *c, bool is_nullable)
+{
+	struct key_def *def = case_key_def_new(c, is_nullable);
+	struct tuple *tuples[MAX_TUPLES];
+	for (uint32_t i = 0; i < c->tuple_count; i++)
+		tuples[i] = case_tuple_new(c, i);
+	bool cmp_ok = true, cmp_wk_ok = true;
+	for (uint32_t i = 0; i < c->tuple_count; i++) {
+		for (uint32_t j = 0; j < c->tuple_count; j++) {
+			int expected = sign((int)i - (int)j);
+			if (sign(tuple_compare(tuples[i], HINT_NONE,
+					       tuples[j], HINT_NONE,
+					       def)) != expected)
+				cmp_ok = false;
+			char key[256];
+			encode_key(key, c, j);
+			if (sign(tuple_compare_with_key(tuples[i], HINT_NONE,
+							key, c->part_count,
+							HINT_NONE,
+							def)) != expected)
+				cmp_wk_ok = false;
+		}
+	}
+	const char *mode = is_nullable ? "nullable" : "not nullable";
+	ok(cmp_ok, "%s, %s: tuple_compare", c->name, mode);
+	ok(cmp_wk_ok, "%s, %s: tuple_compare_with_key", c->name, mode);
+	for (uint32_t i = 0; i < c->tuple_count; i++)
+		tuple_unref(tuples[i]);
+	key_def_delete(def);
+}
+
+/**
+ * Cases for the cmp_def of a unique secondary index over a
+ * nullable field 1 with the primary key in field 0. Values are
+ * given as {secondary, primary}. Tuples with NULL secondary
+ * parts are ordered by the primary part.
+ */
+static const struct compare_case nullable_cases[] = {
+	{"nullable integer, unsigned", 2,
+	 {FIELD_TYPE_INTEGER, FIELD_TYPE_UNSIGNED}, 4,
+	 {{"nil", "1"}, {"nil", "2"}, {"-1", "0"}, {"3", "1"}}},
+	{"nullable string, integer", 2,
+	 {FIELD_TYPE_STRING, FIELD_TYPE_INTEGER}, 4,
+	 {{"nil", "-1"}, {"nil", "5"}, {"", "7"}, {"a", "-3"}}},
+	{"nullable double, string", 2,
+	 {FIELD_TYPE_DOUBLE, FIELD_TYPE_STRING}, 3,
+	 {{"nil", "a"}, {"-0.5", "a"}, {"2.5", ""}}},
+};
+
+static struct tuple *
+nullable_case_tuple_new(const struct compare_case *c, uint32_t row)
+{
+	char buf[256];
+	char *data = mp_encode_array(buf, 2);
+	data = encode_value(data, c->types[1], c->values[row][1]);
+	data = encode_value(data, c->types[0], c->values[row][0]);
+	assert(data <= buf + sizeof(buf));
+	struct tuple *tuple = tuple_new(tuple_format_runtime, buf, data);
+	assert(tuple != NULL);
+	tuple_ref(tuple);
+	return tuple;
+}
+
+static void
+test_nullable_case(const struct compare_case *c)
+{
+	struct key_part_def parts[2];
+	parts[0] = key_part_def_default;
+	parts[0].fieldno = 1;
+	parts[0].type = c->types[0];
+	parts[0].is_nullable = true;
+	parts[0].nullable_action = ON_CONFLICT_ACTION_NONE;
+	parts[1] = key_part_def_default;
+	parts[1].fieldno = 0;
+	parts[1].type = c->types[1];
+	struct key_def *def = key_def_new(parts, 2, false);
+	assert(def != NULL);
+	/* As index_def_new() does for a unique index. */
+	def->unique_part_count = 1;
+	struct tuple *tuples[MAX_TUPLES];
+	for (uint32_t i = 0; i < c->tuple_count; i++)
+		tuples[i] = nullable_case_tuple_new(c, i);
+	bool cmp_ok = true, cmp_wk_ok = true;
+	for (uint32_t i = 0; i < c->tuple_count; i++) {
+		for (uint32_t j = 0; j < c->tuple_count; j++) {
+			int expected = sign((int)i - (int)j);
+			if (sign(tuple_compare(tuples[i], HINT_NONE,
+					       tuples[j], HINT_NONE,
+					       def)) != expected)
+				cmp_ok = false;
+			char key[256];
+			encode_key(key, c, j);
+			if (sign(tuple_compare_with_key(tuples[i], HINT_NONE,
+							key, 2, HINT_NONE,
+							def)) != expected)
+				cmp_wk_ok = false;
+		}
+	}
+	ok(cmp_ok, "%s: tuple_compare", c->name);
+	ok(cmp_wk_ok, "%s: tuple_compare_with_key", c->name);
+	for (uint32_t i = 0; i < c->tuple_count; i++)
+		tuple_unref(tuples[i]);
+	key_def_delete(def);
+}
+
+static int
+test_compare(void)
+{
+	plan(4 * lengthof(cases) + 2 * lengthof(nullable_cases));
+	header();
+
+	for (uint32_t i = 0; i < lengthof(cases); i++) {
+		test_case(&cases[i], false);
+		test_case(&cases[i], true);
+	}
+	for (uint32_t i = 0; i < lengthof(nullable_cases); i++)
+		test_nullable_case(&nullable_cases[i]);
+
+	footer();
+	return check_plan();
+}
+
+/* {{{ Benchmark */
+
+/* Number of tuple_compare() calls per measurement. */
+static const int bench_compare_count = 10000000;
+
+/**
+ * Nullable keys with more than one part starting at field 0
+ * have no specialized comparator, so for them the difference
+ * between the two runs shows how much the specialized
+ * comparator for the key shape gains.
+ */
+static double
+bench_case(const struct compare_case *c, bool is_nullable)
+{
+	struct key_def *def = case_key_def_new(c, is_nullable);
+	struct tuple *tuples[MAX_TUPLES];
+	for (uint32_t i = 0; i < c->tuple_count; i++)
+		tuples[i] = case_tuple_new(c, i);
+	int sum = 0;
+	double start = clock_monotonic();
+	for (int k = 0; k < bench_compare_count; k++) {
+		uint32_t i = k % c->tuple_count;
+		uint32_t j = (k / c->tuple_count) % c->tuple_count;
+		sum += tuple_compare(tuples[i], HINT_NONE,
+				     tuples[j], HINT_NONE, def);
+	}
+	double elapsed = clock_monotonic() - start;
+	/* Keep the compiler from throwing the loop away. */
+	if (sum == INT32_MAX)
+		abort();
+	for (uint32_t i = 0; i < c->tuple_count; i++)
+		tuple_unref(tuples[i]);
+	key_def_delete(def);
+	return elapsed * 1e9 / bench_compare_count;
+}
+
+static void
+bench(void)
+{
+	for (uint32_t i = 0; i < lengthof(cases); i++) {
+		double fast = bench_case(&cases[i], false);
+		double nullable = bench_case(&cases[i], true);
+		fprintf(stderr, "%-28s not nullable %6.1f ns, "
+			"nullable %6.1f ns\n", cases[i].name, fast, nullable);
+	}
+}
+
+/* }}} Benchmark */
+
+int
+main(int argc, char **argv)
+{
+	memory_init();
+	fiber_init(fiber_c_invoke);
+	tuple_init(NULL);
+
+	int rc = test_compare();
+	/*
+	 * Benchmark numbers vary from run to run so they are
+	 * only printed on demand and not checked by the test.
+	 */
+	if (argc > 1 && strcmp(argv[1], "--bench") == 0)
+		bench();
+
+	tuple_free();
+	fiber_free();
+	memory_free();
+	return rc;
+}
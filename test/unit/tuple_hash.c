@@ -0,0 +1,224 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "unit.h"              /* plan, header, footer, ok */
+#include "memory.h"            /* memory_init() */
+#include "fiber.h"             /* fiber_init() */
+#include "clock.h"             /* clock_monotonic() */
+#include "msgpuck.h"
+#include "box/tuple.h"         /* tuple_init(), tuple_new() */
+#include "box/key_def.h"       /* key_def_new(), tuple_hash() */
+
+enum { MAX_PARTS = 3 };
+
+/** Key shape and a msgpack format of a matching tuple. */
+struct hash_case {
+	const char *name;
+	uint32_t part_count;
+	enum field_type types[MAX_PARTS];
+	/** mp_format() format of a tuple, takes an int. */
+	const char *format;
+};
+
+static const struct hash_case cases[] = {
+	{"unsigned", 1, {FIELD_TYPE_UNSIGNED}, "[%u]"},
+	{"string", 1, {FIELD_TYPE_STRING}, "[%s]"},
+	{"integer", 1, {FIELD_TYPE_INTEGER}, "[%d]"},
+	{"number", 1, {FIELD_TYPE_NUMBER}, "[%d]"},
+	{"unsigned, string", 2, {FIELD_TYPE_UNSIGNED, FIELD_TYPE_STRING},
+	 "[%u%s]"},
+	{"string, string, unsigned", 3,
+	 {FIELD_TYPE_STRING, FIELD_TYPE_STRING, FIELD_TYPE_UNSIGNED},
+	 "[%s%s%u]"},
+};
+
+static struct key_def *
+case_key_def_new(const struct hash_case *c, enum tuple_hash_func func,
+		 bool is_nullable)
+{
+	struct key_part_def parts[MAX_PARTS];
+	for (uint32_t i = 0; i < c->part_count; i++) {
+		parts[i] = key_part_def_default;
+		parts[i].fieldno = i;
+		parts[i].type = c->types[i];
+		parts[i].is_nullable = is_nullable;
+	}
+	struct key_def *def = key_def_new(parts, c->part_count, false);
+	assert(def != NULL);
+	key_def_use_hash_func(def, func);
+	return def;
+}
+
+/** Encode the i-th tuple of a case, return its end. */
+static char *
+case_encode(const struct hash_case *c, char *buf, size_t size, int i)
+{
+	char str[32];
+	snprintf(str, sizeof(str), "key%d", i);
+	size_t len;
+	switch (c->part_count) {
+	case 1:
+		len = c->types[0] == FIELD_TYPE_STRING ?
+		      mp_format(buf, size, c->format, str) :
+		      mp_format(buf, size, c->format, i);
+		break;
+	case 2:
+		len = mp_format(buf, size, c->format, i, str);
+		break;
+	default:
+		len = mp_format(buf, size, c->format, str, str, i);
+		break;
+	}
+	assert(len <= size);
+	return buf + len;
+}
+
+static struct tuple *
+case_tuple_new(const struct hash_case *c, int i)
+{
+	char buf[128];
+	char *end = case_encode(c, buf, sizeof(buf), i);
+	struct tuple *tuple = tuple_new(tuple_format_runtime, buf, end);
+	assert(tuple != NULL);
+	tuple_ref(tuple);
+	return tuple;
+}
+
+/**
+ * A tuple and its key must hash equally, and the generic
+ * (nullable) hasher must agree with the precompiled one.
+ */
+static void
+test_case(const struct hash_case *c, enum tuple_hash_func func)
+{
+	struct key_def *def = case_key_def_new(c, func, false);
+	struct key_def *slow_def = case_key_def_new(c, func, true);
+	bool key_ok = true, slow_ok = true;
+	for (int i = -3; i < 100; i++) {
+		if (i < 0 && strstr(c->format, "%u") != NULL)
+			continue;
+		struct tuple *tuple = case_tuple_new(c, i);
+		const char *key = tuple_data(tuple);
+		mp_decode_array(&key);
+		uint32_t h = tuple_hash(tuple, def);
+		if (key_hash(key, def) != h)
+			key_ok = false;
+		/*
+		 * PMurHash precompiled hashers use the value
+		 * itself as a hash of a single unsigned field,
+		 * unlike the generic one.
+		 */
+		if (func == TUPLE_HASH_MUM64 &&
+		    (tuple_hash(tuple, slow_def) != h ||
+		     key_hash(key, slow_def) != h))
+			slow_ok = false;
+		tuple_unref(tuple);
+	}
+	const char *name = tuple_hash_func_strs[func];
+	ok(key_ok, "%s, %s: tuple_hash == key_hash", c->name, name);
+	ok(slow_ok, "%s, %s: precompiled == generic", c->name, name);
+	key_def_delete(slow_def);
+	key_def_delete(def);
+}
+
+/** Integral doubles must hash as integers. */
+static void
+test_double(enum tuple_hash_func func)
+{
+	struct key_def *def = case_key_def_new(&cases[3], func, false);
+	bool is_ok = true;
+	for (int i = -100; i < 100; i++) {
+		char int_key[16], double_key[16];
+		if (i < 0)
+			mp_encode_int(int_key, i);
+		else
+			mp_encode_uint(int_key, i);
+		mp_encode_double(double_key, i);
+		if (key_hash(int_key, def) != key_hash(double_key, def))
+			is_ok = false;
+	}
+	ok(is_ok, "%s: integral double", tuple_hash_func_strs[func]);
+	key_def_delete(def);
+}
+
+static int
+test_hash(void)
+{
+	plan(4 * lengthof(cases) + 2);
+	header();
+
+	for (uint32_t i = 0; i < lengthof(cases); i++) {
+		test_case(&cases[i], TUPLE_HASH_MURMUR);
+		test_case(&cases[i], TUPLE_HASH_MUM64);
+	}
+	test_double(TUPLE_HASH_MURMUR);
+	test_double(TUPLE_HASH_MUM64);
+
+	footer();
+	return check_plan();
+}
+
+/* {{{ Benchmark */
+
+/* Number of distinct tuples hashed per measurement. */
+enum { BENCH_TUPLE_COUNT = 1000 };
+
+/* Number of passes over the tuples per measurement. */
+static const int bench_pass_count = 10000;
+
+static double
+bench_case(const struct hash_case *c, enum tuple_hash_func func)
+{
+	struct key_def *def = case_key_def_new(c, func, false);
+	static struct tuple *tuples[BENCH_TUPLE_COUNT];
+	for (int i = 0; i < BENCH_TUPLE_COUNT; i++)
+		tuples[i] = case_tuple_new(c, i);
+	uint32_t sum = 0;
+	double start = clock_monotonic();
+	for (int k = 0; k < bench_pass_count; k++) {
+		for (int i = 0; i < BENCH_TUPLE_COUNT; i++)
+			sum += tuple_hash(tuples[i], def);
+	}
+	double elapsed = clock_monotonic() - start;
+	/* Keep the compiler from throwing the loop away. */
+	if (sum == UINT32_MAX)
+		abort();
+	for (int i = 0; i < BENCH_TUPLE_COUNT; i++)
+		tuple_unref(tuples[i]);
+	key_def_delete(def);
+	return elapsed * 1e9 / bench_pass_count / BENCH_TUPLE_COUNT;
+}
+
+static void
+bench(void)
+{
+	for (uint32_t i = 0; i < lengthof(cases); i++) {
+		double murmur = bench_case(&cases[i], TUPLE_HASH_MURMUR);
+		double mum64 = bench_case(&cases[i], TUPLE_HASH_MUM64);
+		fprintf(stderr, "%-26s murmur %6.1f ns, mum64 %6.1f ns\n",
+			cases[i].name, murmur, mum64);
+	}
+}
+
+/* }}} Benchmark */
+
+int
+main(int argc, char **argv)
+{
+	memory_init();
+	fiber_init(fiber_c_invoke);
+	tuple_init(NULL);
+
+	int rc = test_hash();
+	/*
+	 * Benchmark numbers vary from run to run so they are
+	 * only printed on demand and not checked by the test.
+	 */
+	if (argc > 1 && strcmp(argv[1], "--bench") == 0)
+		bench();
+
+	tuple_free();
+	fiber_free();
+	memory_free();
+	return rc;
+}
@@ -0,0 +1,45 @@
+test_run = require('test_run').new()
+
+--
+-- Bloom filters built with different tuple hash functions.
+--
+-- Disable tuple cache to check bloom hit/miss ratio.
+box.cfg{vinyl_cache = 0}
+
+s = box.schema.space.create('test', {engine = 'vinyl'})
+_ = s:create_index('pk', {parts = {{1, 'unsigned'}, {2, 'string'}}, hash_func = 'mum64', run_count_per_level = 10})
+
+function bloom_hits() return s.index.pk:stat().disk.iterator.bloom.hit end
+function found(from, to) local n = 0 for i = from, to do if s:get{i, tostring(i)} ~= nil then n = n + 1 end end return n end
+function missed(from, to) local h = bloom_hits() for i = from, to do s:get{i, tostring(i)} end return bloom_hits() - h end
+
+for i = 1, 100 do s:replace{i, tostring(i)} end
+box.snapshot()
+
+h = bloom_hits()
+found(1, 100)
+bloom_hits() - h
+missed(101, 200) > 80
+-- Partial keys are checked against the bloom filter as well.
+h = bloom_hits()
+for i = 101, 200 do s:select{i} end
+bloom_hits() - h > 80
+
+-- Runs keep the hash function they were built with.
+s.index.pk:alter({hash_func = 'murmur'})
+for i = 101, 200 do s:replace{i, tostring(i)} end
+box.snapshot()
+h = bloom_hits()
+found(1, 200)
+bloom_hits() - h > 80
+missed(201, 300) > 160
+
+test_run:cmd('restart server default')
+box.cfg{vinyl_cache = 0}
+s = box.space.test
+h = bloom_hits()
+found(1, 200)
+bloom_hits() - h > 80
+missed(201, 300) > 160
+
+s:drop()
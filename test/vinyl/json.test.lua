@@ -51,3 +51,29 @@ s:insert{{a = 1, b = 1, c = 3}}
 s:select{1, 1, 1}
 s:select{1, 1}
 s:drop()
+
+--
+-- Statement field maps stored in run pages.
+--
+s = box.schema.space.create('test', {engine = 'vinyl'})
+pk = s:create_index('pk')
+sk = s:create_index('sk', {parts = {{'[2][1]', 'unsigned'}}})
+for i = 1, 6 do s:replace{i, {i * 10, i}} end
+box.snapshot()
+for i = 1, 6, 2 do s:replace{i, {i * 100, i}} end
+s:delete{2}
+box.snapshot()
+pk:compact()
+test_run:wait_cond(function() return pk:stat().run_count == 1 end)
+pk:select()
+sk:select()
+-- The format changes so the stored field maps can't be used.
+tk = s:create_index('tk', {parts = {{'[2][2]', 'unsigned', is_nullable = true}}})
+s:replace{7, {70, 7}}
+box.snapshot()
+pk:compact()
+test_run:wait_cond(function() return pk:stat().run_count == 1 end)
+pk:select()
+sk:select({50}, {iterator = 'ge'})
+tk:select({5}, {iterator = 'le'})
+s:drop()
@@ -0,0 +1,19 @@
+env = require('test_run').new()
+fio = require('fio')
+
+--
+-- box.cfg.checkpoint_on_shutdown makes a checkpoint on graceful
+-- shutdown, so that nothing is left to replay from the WAL.
+--
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+box.snapshot()
+for i = 1, 100 do s:replace{i} end
+box.cfg{checkpoint_on_shutdown = true}
+env:cmd('restart server default')
+box.cfg.checkpoint_on_shutdown
+snaps = fio.glob(fio.pathjoin(box.cfg.memtx_dir, '*.snap'))
+table.sort(snaps)
+tonumber(fio.basename(snaps[#snaps], '.snap')) == box.info.signature
+box.space.test:count()
+box.space.test:drop()
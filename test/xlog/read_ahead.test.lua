@@ -0,0 +1,23 @@
+env = require('test_run').new()
+
+--
+-- WAL rows are read ahead in a separate thread on recovery.
+-- Check that rows are applied in the right order, in case
+-- there are more rows than fit in one read-ahead batch and
+-- a big compressed row.
+--
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+for i = 1, 5000 do s:replace{i, i} end
+box.begin() for i = 1, 3000 do s:replace{i, i * 2} end box.commit()
+for i = 1, 5000, 3 do s:delete{i} end
+for i = 2, 5000, 3 do s:update(i, {{'+', 2, 1}}) end
+_ = s:replace{5001, string.rep('x', 900 * 1024)}
+env:cmd('restart server default')
+s = box.space.test
+s:count()
+sum = 0
+for _, t in s:pairs({5000}, {iterator = 'le'}) do sum = sum + t[2] end
+sum
+#s:get{5001}[2]
+s:drop()
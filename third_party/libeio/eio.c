@@ -500,6 +500,32 @@ eio_nthreads (void)
   return etp_nthreads (EIO_POOL);
 }
 
+unsigned int
+eio_nqueues (void)
+{
+  return ETP_NUM_QUEUES;
+}
+
+unsigned int
+eio_queue (void)
+{
+  return EIO_POOL_USER->queue;
+}
+
+void
+eio_queue_stat (unsigned int queue, struct eio_queue_stat *stat)
+{
+  etp_queue_stat_t s;
+
+  etp_queue_stat (EIO_POOL, queue, &s);
+  stat->submitted  = s.submitted;
+  stat->executed   = s.executed;
+  stat->stolen     = s.stolen;
+  stat->wait_total = s.wait_total;
+  stat->wait_max   = s.wait_max;
+  stat->pending    = s.pending;
+}
+
 void ecb_cold
 eio_set_max_poll_time (double nseconds)
 {
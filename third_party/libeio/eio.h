@@ -279,6 +279,8 @@ struct eio_req
   void (*destroy)(eio_req *req); /* called when request no longer needed */
   void (*feed)(eio_req *req);    /* only used for group requests */
 
+  eio_tstamp queued; /* private ETP: submission time */
+
   EIO_REQ_MEMBERS
 
   eio_req *grp, *grp_prev, *grp_next, *grp_first; /* private ETP */
@@ -327,6 +329,22 @@ unsigned int eio_nreqs    (void); /* number of requests in-flight */
 unsigned int eio_npending (void); /* number of finished but unhandled requests */
 unsigned int eio_nthreads (void); /* number of worker threads in use currently */
 
+/* requests are submitted to one of several queues, one per thread */
+struct eio_queue_stat
+{
+  unsigned long long submitted; /* requests pushed to the queue */
+  unsigned long long executed;  /* requests taken from the queue */
+  unsigned long long stolen;    /* requests taken by a worker of another queue */
+  double wait_total;            /* seconds requests spent in the queue */
+  double wait_max;              /* max seconds a request spent in the queue */
+  unsigned int pending;         /* requests in the queue now */
+};
+
+/* queue eio_nqueues () is shared by requests above EIO_PRI_DEFAULT */
+unsigned int eio_nqueues (void); /* number of per-thread submission queues */
+unsigned int eio_queue   (void); /* the queue of the calling thread */
+void eio_queue_stat (unsigned int queue, struct eio_queue_stat *stat);
+
 /*****************************************************************************/
 /* convenience wrappers */
 
@@ -37,6 +37,8 @@
  * either the BSD or the GPL.
  */
 
+#include <time.h>
+
 #ifndef ETP_API_DECL
 # define ETP_API_DECL static
 #endif
@@ -67,6 +69,22 @@ typedef void (*ETP_CB) (void *);
 
 #define ETP_NUM_PRI (ETP_PRI_MAX - ETP_PRI_MIN + 1)
 
+/*
+ * number of submission queues: every pool user (thread) submits
+ * to one of them, every worker prefers one of them and steals
+ * from the others when it is empty
+ */
+#ifndef ETP_NUM_QUEUES
+# define ETP_NUM_QUEUES 8
+#endif
+
+/*
+ * requests of a priority above the default are submitted to an
+ * extra queue shared by all users, which every worker serves
+ * before the others, so that priority works across users
+ */
+#define ETP_HIGH_QUEUE ETP_NUM_QUEUES
+
 #define ETP_TICKS ((1000000 + 1023) >> 10)
 
 enum {
@@ -111,6 +129,24 @@ typedef struct
   int size;
 } etp_reqq;
 
+/* submission queue statistics, see etp_queue_stat() */
+typedef struct
+{
+  unsigned long long submitted; /* requests pushed to the queue */
+  unsigned long long executed;  /* requests taken from the queue */
+  unsigned long long stolen;    /* requests taken by a worker of another queue */
+  double wait_total;            /* seconds requests spent in the queue */
+  double wait_max;              /* max seconds a request spent in the queue */
+  unsigned int pending;         /* requests in the queue now */
+} etp_queue_stat_t;
+
+typedef struct
+{
+  xmutex_t lock;
+  etp_reqq reqs;                /* lock */
+  etp_queue_stat_t stat;        /* lock */
+} etp_queue;
+
 typedef struct etp_pool *etp_pool;
 typedef struct etp_pool_user *etp_pool_user;
 
@@ -118,6 +154,10 @@ typedef struct etp_worker
 {
   etp_pool pool;
 
+  unsigned int queue; /* the queue the worker prefers */
+  unsigned int rover; /* the queue to start from next time, see etp_queue_shift */
+  unsigned int nshift; /* requests taken by the worker */
+
   struct etp_tmpbuf tmpbuf;
 
 #ifdef ETP_WORKER_COMMON
@@ -127,11 +167,15 @@ typedef struct etp_worker
 
 struct etp_pool
 {
-   etp_reqq req_queue;
+   etp_queue queues[ETP_NUM_QUEUES + 1]; /* + ETP_HIGH_QUEUE */
+
+   unsigned int npending;     /* atomic, requests in all queues */
+   unsigned int next_queue;   /* atomic, queue of the next worker */
 
-   unsigned int started, idle, wanted;
+   unsigned int started, wanted;
+   unsigned int idle;         /* pool->lock, atomic reads */
 
-   unsigned int nreqs_run;    /* pool->lock */
+   unsigned int nreqs_run;    /* atomic */
    unsigned int max_idle;     /* maximum number of threads that can pool->idle indefinitely */
    unsigned int idle_timeout; /* number of seconds after which an pool->idle threads exit */
 
@@ -153,6 +197,8 @@ struct etp_pool_user
 
    etp_reqq res_queue;
 
+   unsigned int queue; /* the queue requests are submitted to */
+
    unsigned int max_poll_time;
    unsigned int max_poll_reqs;
 
@@ -257,15 +303,113 @@ reqq_shift (etp_reqq *q)
   abort ();
 }
 
+static double
+etp_now (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* take a request of the highest priority from a queue */
+static ETP_REQ *
+etp_queue_take (etp_pool pool, etp_queue *queue, int stolen)
+{
+  ETP_REQ *req;
+
+  /* racy, but a missed request is found on the next round */
+  if (!__atomic_load_n (&queue->reqs.size, __ATOMIC_RELAXED))
+    return 0;
+
+  X_LOCK (queue->lock);
+  req = reqq_shift (&queue->reqs);
+
+  if (req)
+    {
+      double wait = etp_now () - req->queued;
+
+      ++queue->stat.executed;
+      if (stolen)
+        ++queue->stat.stolen;
+      queue->stat.wait_total += wait;
+      if (queue->stat.wait_max < wait)
+        queue->stat.wait_max = wait;
+    }
+
+  X_UNLOCK (queue->lock);
+
+  if (req)
+    __atomic_sub_fetch (&pool->npending, 1, __ATOMIC_SEQ_CST);
+
+  return req;
+}
+
+/*
+ * take a request from the shared high priority queue, then from
+ * the worker's own queue, or steal one from another queue if it
+ * is empty. every ETP_NUM_QUEUES requests the worker starts from
+ * the next queue instead of its own one, so that the queues no
+ * worker prefers don't starve while the others are busy
+ */
+static ETP_REQ *
+etp_queue_shift (etp_pool pool, etp_worker *self)
+{
+  unsigned int i, start;
+  ETP_REQ *req;
+
+  if (!__atomic_load_n (&pool->npending, __ATOMIC_ACQUIRE))
+    return 0;
+
+  req = etp_queue_take (pool, &pool->queues[ETP_HIGH_QUEUE], 0);
+  if (req)
+    return req;
+
+  start = self->queue;
+  if (++self->nshift % ETP_NUM_QUEUES == 0)
+    start = self->rover = (self->rover + 1) % ETP_NUM_QUEUES;
+
+  for (i = 0; i < ETP_NUM_QUEUES; ++i)
+    {
+      unsigned int q = (start + i) % ETP_NUM_QUEUES;
+
+      req = etp_queue_take (pool, &pool->queues[q], q != self->queue);
+      if (req)
+        return req;
+    }
+
+  return 0;
+}
+
+ETP_API_DECL void
+etp_queue_stat (etp_pool pool, unsigned int queue, etp_queue_stat_t *stat)
+{
+  etp_queue *q = &pool->queues[queue % (ETP_NUM_QUEUES + 1)];
+
+  X_LOCK (q->lock);
+  *stat = q->stat;
+  stat->pending = q->reqs.size;
+  X_UNLOCK (q->lock);
+}
+
 ETP_API_DECL int ecb_cold
 etp_init (etp_pool pool)
 {
+  int i;
+
   X_MUTEX_CREATE (pool->lock);
   X_COND_CREATE  (pool->reqwait);
   X_COND_CREATE  (pool->wrkwait);
 
-  reqq_init (&pool->req_queue);
+  for (i = 0; i < ETP_NUM_QUEUES + 1; ++i)
+    {
+      X_MUTEX_CREATE (pool->queues[i].lock);
+      reqq_init (&pool->queues[i].reqs);
+      memset (&pool->queues[i].stat, 0, sizeof (pool->queues[i].stat));
+    }
 
+  pool->npending = 0;
+  pool->next_queue = 0;
   pool->started  = 0;
   pool->idle     = 0;
   pool->wanted   = 4;
@@ -280,7 +424,10 @@ etp_init (etp_pool pool)
 ETP_API_DECL int ecb_cold
 etp_user_init (etp_pool_user user, void *userdata, ETP_CB want_poll, ETP_CB done_poll)
 {
+  static unsigned int next_queue;
+
   user->pool = NULL;
+  user->queue = __atomic_fetch_add (&next_queue, 1, __ATOMIC_RELAXED) % ETP_NUM_QUEUES;
   X_MUTEX_CREATE (user->lock);
 
   reqq_init (&user->res_queue);
@@ -324,6 +471,9 @@ X_THREAD_PROC (etp_proc)
 
   etp_proc_init ();
 
+  self.queue = __atomic_fetch_add (&pool->next_queue, 1, __ATOMIC_RELAXED) % ETP_NUM_QUEUES;
+  self.rover = self.queue;
+
   /* try to distribute timeouts somewhat evenly (nanosecond part) */
   ts.tv_nsec = (unsigned long)random() * (1000000000UL / RAND_MAX);
 
@@ -333,41 +483,52 @@ X_THREAD_PROC (etp_proc)
     if (pool->on_start_cb(pool->on_start_data))
       goto error;
 
+  X_UNLOCK (pool->lock);
+
   for (;;)
     {
       for (;;)
         {
-          req = reqq_shift (&pool->req_queue);
+          req = etp_queue_shift (pool, &self);
 
           if (ecb_expect_true (req))
             break;
 
+          X_LOCK (pool->lock);
+
           if (pool->started > pool->wanted) /* someone is shrinking the pool */
             goto quit;
 
-          ++pool->idle;
+          /*
+           * pairs with etp_submit: either we see the request it
+           * has pushed or it sees us idle and signals
+           */
+          __atomic_add_fetch (&pool->idle, 1, __ATOMIC_SEQ_CST);
 
-          if (pool->idle <= pool->max_idle)
+          if (__atomic_load_n (&pool->npending, __ATOMIC_SEQ_CST))
+            ;
+          else if (pool->idle <= pool->max_idle)
             {
               /* we are allowed to pool->idle, so do so without any timeout */
               X_COND_WAIT (pool->reqwait, pool->lock);
-              --pool->idle;
             }
           else
             {
               ts.tv_sec = time (0) + pool->idle_timeout;
 
-              if (X_COND_TIMEDWAIT (pool->reqwait, pool->lock, ts) != ETIMEDOUT)
-                continue;
-
-              --pool->idle;
-              goto quit;
+              if (X_COND_TIMEDWAIT (pool->reqwait, pool->lock, ts) == ETIMEDOUT
+                  && !__atomic_load_n (&pool->npending, __ATOMIC_SEQ_CST))
+                {
+                  __atomic_sub_fetch (&pool->idle, 1, __ATOMIC_SEQ_CST);
+                  goto quit;
+                }
             }
-        }
 
-      ++pool->nreqs_run;
+          __atomic_sub_fetch (&pool->idle, 1, __ATOMIC_SEQ_CST);
+          X_UNLOCK (pool->lock);
+        }
 
-      X_UNLOCK (pool->lock);
+      __atomic_add_fetch (&pool->nreqs_run, 1, __ATOMIC_RELAXED);
 
       user = req->pool_user;
       ETP_EXECUTE (&self, req);
@@ -379,8 +540,7 @@ X_THREAD_PROC (etp_proc)
 
       X_UNLOCK (user->lock);
 
-      X_LOCK (pool->lock);
-      --pool->nreqs_run;
+      __atomic_sub_fetch (&pool->nreqs_run, 1, __ATOMIC_RELAXED);
     }
 
 quit:
@@ -528,20 +688,46 @@ etp_submit (etp_pool_user user, ETP_REQ *req)
   else
     {
       etp_pool pool = user->pool;
+      etp_queue *queue = &pool->queues[user->queue];
+      unsigned int npending, nreqs_run;
       int need_thread = 0;
 
-      X_LOCK (pool->lock);
+      /* above the default priority, see ETP_HIGH_QUEUE */
+      if (req->pri > -ETP_PRI_MIN)
+        queue = &pool->queues[ETP_HIGH_QUEUE];
+
       req->pool_user = user;
-      reqq_push (&pool->req_queue, req);
-      if (ecb_expect_false(pool->req_queue.size + pool->nreqs_run > pool->started &&
-                           pool->started < pool->wanted))
+      req->queued = etp_now ();
+
+      X_LOCK (queue->lock);
+      reqq_push (&queue->reqs, req);
+      ++queue->stat.submitted;
+      X_UNLOCK (queue->lock);
+
+      /* pairs with the idle check in etp_proc */
+      npending = __atomic_add_fetch (&pool->npending, 1, __ATOMIC_SEQ_CST);
+      nreqs_run = __atomic_load_n (&pool->nreqs_run, __ATOMIC_RELAXED);
+
+      /*
+       * the pool lock is only needed to wake up an idle worker
+       * or to start a new one, busy workers find the request
+       * themselves
+       */
+      if (__atomic_load_n (&pool->idle, __ATOMIC_SEQ_CST)
+          || ecb_expect_false (npending + nreqs_run > __atomic_load_n (&pool->started, __ATOMIC_RELAXED)
+                               && __atomic_load_n (&pool->started, __ATOMIC_RELAXED) < pool->wanted))
         {
-          /* arrange for a thread to start */
-          need_thread = 1;
-          pool->started++;
+          X_LOCK (pool->lock);
+          if (ecb_expect_false(npending + nreqs_run > pool->started &&
+                               pool->started < pool->wanted))
+            {
+              /* arrange for a thread to start */
+              need_thread = 1;
+              pool->started++;
+            }
+          X_COND_SIGNAL (pool->reqwait);
+          X_UNLOCK (pool->lock);
         }
-      X_COND_SIGNAL (pool->reqwait);
-      X_UNLOCK (pool->lock);
       if (ecb_expect_false(need_thread))
         etp_start_thread(pool);
     }
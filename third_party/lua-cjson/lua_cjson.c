@@ -51,6 +51,8 @@
 #include "mp_extension_types.h" /* MP_DECIMAL, MP_UUID */
 #include "tt_static.h"
 #include "uuid/tt_uuid.h" /* tt_uuid_to_string(), UUID_STR_LEN */
+#include "uuid/mp_uuid.h" /* uuid_unpack() */
+#include <msgpuck.h>
 
 #define DEFAULT_ENCODE_KEEP_BUFFER 1
 
@@ -104,8 +106,13 @@ static char escape2char[256];  /* Decoding */
  * encode_keep_buffer is set */
 static strbuf_t encode_buf;
 
+/* MsgPack output of json.decode_to_msgpack(), reused between calls
+ * so that it isn't leaked when a parse error unwinds the stack. */
+static strbuf_t decode_mp_buf;
+
 typedef struct {
     const char *data;
+    const char *end;
     const char *ptr;
     strbuf_t *tmp;    /* Temporary storage for strings */
     struct luaL_serializer *cfg;
@@ -185,6 +192,7 @@ static void json_create_tokens()
 #if DEFAULT_ENCODE_KEEP_BUFFER > 0
     strbuf_init(&encode_buf, 0);
 #endif
+    strbuf_init(&decode_mp_buf, 0);
 
     /* Decoding init */
 
@@ -232,8 +240,39 @@ static void json_create_tokens()
     escape2char['u'] = 'u';          /* Unicode parsing required */
 }
 
+/* Word-at-a-time scanning: check 8 bytes of a string at once for
+ * characters which need special treatment, and only fall back to
+ * the per-character loop for the word that has some. The checks
+ * may give false positives, but never false negatives. */
+#define JSON_ONES 0x0101010101010101ULL
+#define JSON_HIGHS 0x8080808080808080ULL
+/* Nonzero if some byte of x is zero. */
+#define json_has_zero(x) (((x) - JSON_ONES) & ~(x) & JSON_HIGHS)
+/* Nonzero if some byte of x is less than n, n <= 128. */
+#define json_has_less(x, n) (((x) - JSON_ONES * (n)) & ~(x) & JSON_HIGHS)
+/* Nonzero if some byte of x equals c. */
+#define json_has_byte(x, c) json_has_zero((x) ^ (JSON_ONES * (c)))
+
 /* ===== ENCODING ===== */
 
+/* Return the length of the prefix of str which can be copied to
+ * JSON output as is, i.e. has no characters to escape. */
+static size_t json_escape_free_prefix(const char *str, size_t len)
+{
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= len; i += sizeof(uint64_t)) {
+        uint64_t x;
+        memcpy(&x, str + i, sizeof(x));
+        if (json_has_less(x, 0x20) | json_has_byte(x, '"') |
+            json_has_byte(x, '\\') | json_has_byte(x, '/') |
+            json_has_byte(x, 0x7f))
+            break;
+    }
+    while (i < len && char2escape[(unsigned char)str[i]] == NULL)
+        i++;
+    return i;
+}
+
 /* json_append_string args:
  * - lua_State
  * - JSON strbuf
@@ -254,12 +293,17 @@ static void json_append_string(struct luaL_serializer *cfg, strbuf_t *json,
     strbuf_ensure_empty_length(json, len * 6 + 2);
 
     strbuf_append_char_unsafe(json, '\"');
-    for (i = 0; i < len; i++) {
+    i = 0;
+    while (1) {
+        /* Copy a run of characters which need no escaping at once. */
+        size_t run = json_escape_free_prefix(str + i, len - i);
+        strbuf_append_mem_unsafe(json, str + i, run);
+        i += run;
+        if (i == len)
+            break;
         escstr = char2escape[(unsigned char)str[i]];
-        if (escstr)
-            strbuf_append_string(json, escstr);
-        else
-            strbuf_append_char_unsafe(json, str[i]);
+        strbuf_append_mem_unsafe(json, escstr, strlen(escstr));
+        i++;
     }
     strbuf_append_char_unsafe(json, '\"');
 }
@@ -294,14 +338,28 @@ static void json_append_array(lua_State *l, struct luaL_serializer *cfg,
     strbuf_append_char(json, ']');
 }
 
+/* Format an integer without the snprintf() overhead,
+ * return the length of the output. */
+static int json_format_uint(char *buf, uint64_t num)
+{
+    char tmp[20];
+    int len = 0;
+    do {
+        tmp[len++] = '0' + num % 10;
+        num /= 10;
+    } while (num != 0);
+    for (int i = 0; i < len; i++)
+        buf[i] = tmp[len - 1 - i];
+    return len;
+}
+
 static void json_append_uint(struct luaL_serializer *cfg, strbuf_t *json,
                  uint64_t num)
 {
     (void) cfg;
     enum { INT_BUFSIZE = 22 };
     strbuf_ensure_empty_length(json, INT_BUFSIZE);
-    int len = snprintf(strbuf_empty_ptr(json), INT_BUFSIZE, "%llu",
-               (unsigned long long) num);
+    int len = json_format_uint(strbuf_empty_ptr(json), num);
     strbuf_extend_length(json, len);
 }
 
@@ -311,8 +369,15 @@ static void json_append_int(struct luaL_serializer *cfg, strbuf_t *json,
     (void) cfg;
     enum {INT_BUFSIZE = 22 };
     strbuf_ensure_empty_length(json, INT_BUFSIZE);
-    int len = snprintf(strbuf_empty_ptr(json), INT_BUFSIZE, "%lld",
-               (long long) num);
+    char *buf = strbuf_empty_ptr(json);
+    int len = 0;
+    if (num < 0) {
+        buf[len++] = '-';
+        /* Avoid overflow on INT64_MIN. */
+        len += json_format_uint(buf + len, (uint64_t)-(num + 1) + 1);
+    } else {
+        len += json_format_uint(buf + len, num);
+    }
     strbuf_extend_length(json, len);
 }
 
@@ -439,6 +504,136 @@ static void json_append_data(lua_State *l, struct luaL_serializer *cfg,
     }
 }
 
+/* Serialise MsgPack data into JSON string without converting it
+ * to Lua objects first. The data is known to be valid. */
+static void json_append_msgpack(lua_State *l, struct luaL_serializer *cfg,
+                                int current_depth, strbuf_t *json,
+                                const char **data)
+{
+    uint32_t len, i;
+    const char *str;
+    double num;
+    switch (mp_typeof(**data)) {
+    case MP_UINT:
+        return json_append_uint(cfg, json, mp_decode_uint(data));
+    case MP_INT:
+        return json_append_int(cfg, json, mp_decode_int(data));
+    case MP_STR:
+        str = mp_decode_str(data, &len);
+        return json_append_string(cfg, json, str, len);
+    case MP_BIN:
+        str = mp_decode_bin(data, &len);
+        return json_append_string(cfg, json, str, len);
+    case MP_FLOAT:
+    case MP_DOUBLE:
+        num = mp_typeof(**data) == MP_FLOAT ? mp_decode_float(data) :
+              mp_decode_double(data);
+        if (!isfinite(num) && !cfg->encode_invalid_numbers) {
+            if (!cfg->encode_invalid_as_nil)
+                luaL_error(l, "number must not be NaN or Inf");
+            return json_append_nil(cfg, json);
+        }
+        return json_append_number(cfg, json, num);
+    case MP_BOOL:
+        if (mp_decode_bool(data))
+            strbuf_append_mem(json, "true", 4);
+        else
+            strbuf_append_mem(json, "false", 5);
+        return;
+    case MP_NIL:
+        mp_decode_nil(data);
+        return json_append_nil(cfg, json);
+    case MP_ARRAY:
+        if (current_depth >= cfg->encode_max_depth) {
+            if (! cfg->encode_deep_as_nil)
+                luaL_error(l, "Too high nest level");
+            mp_next(data);
+            return json_append_nil(cfg, json); /* Limit nested arrays */
+        }
+        len = mp_decode_array(data);
+        strbuf_append_char(json, '[');
+        for (i = 0; i < len; i++) {
+            if (i > 0)
+                strbuf_append_char(json, ',');
+            json_append_msgpack(l, cfg, current_depth + 1, json, data);
+        }
+        strbuf_append_char(json, ']');
+        return;
+    case MP_MAP:
+        if (current_depth >= cfg->encode_max_depth) {
+            if (! cfg->encode_deep_as_nil)
+                luaL_error(l, "Too high nest level");
+            mp_next(data);
+            return json_append_nil(cfg, json); /* Limit nested maps */
+        }
+        len = mp_decode_map(data);
+        strbuf_append_char(json, '{');
+        for (i = 0; i < len; i++) {
+            if (i > 0)
+                strbuf_append_char(json, ',');
+            switch (mp_typeof(**data)) {
+            case MP_UINT:
+                strbuf_append_char(json, '"');
+                json_append_uint(cfg, json, mp_decode_uint(data));
+                strbuf_append_mem(json, "\":", 2);
+                break;
+            case MP_INT:
+                strbuf_append_char(json, '"');
+                json_append_int(cfg, json, mp_decode_int(data));
+                strbuf_append_mem(json, "\":", 2);
+                break;
+            case MP_STR:
+            {
+                uint32_t key_len;
+                str = mp_decode_str(data, &key_len);
+                json_append_string(cfg, json, str, key_len);
+                strbuf_append_char(json, ':');
+                break;
+            }
+            default:
+                luaL_error(l, "table key must be a number or string");
+            }
+            json_append_msgpack(l, cfg, current_depth + 1, json, data);
+        }
+        strbuf_append_char(json, '}');
+        return;
+    case MP_EXT:
+    {
+        int8_t ext_type;
+        len = mp_decode_extl(data, &ext_type);
+        switch (ext_type) {
+        case MP_DECIMAL:
+        {
+            decimal_t dec;
+            if (decimal_unpack(data, len, &dec) == NULL)
+                luaL_error(l, "invalid MsgPack");
+            str = decimal_to_string(&dec);
+            return json_append_string(cfg, json, str, strlen(str));
+        }
+        case MP_UUID:
+        {
+            struct tt_uuid uuid;
+            if (uuid_unpack(data, len, &uuid) == NULL)
+                luaL_error(l, "invalid MsgPack");
+            return json_append_string(cfg, json, tt_uuid_str(&uuid),
+                                      UUID_STR_LEN);
+        }
+        default:
+            luaL_error(l, "unsupported MsgPack extension type %d", ext_type);
+        }
+    }
+    }
+}
+
+void
+json_encode_msgpack(lua_State *l, const char *data)
+{
+    strbuf_reset(&encode_buf);
+    json_append_msgpack(l, luaL_json_default, 0, &encode_buf, &data);
+    char *json = strbuf_string(&encode_buf, NULL);
+    lua_pushlstring(l, json, strbuf_length(&encode_buf));
+}
+
 static int json_encode(lua_State *l) {
     luaL_argcheck(l, lua_gettop(l) == 2 || lua_gettop(l) == 1, 1,
                   "expected 1 or 2 arguments");
@@ -612,6 +807,24 @@ static void json_set_token_error(json_token_t *token, json_parse_t *json,
     token->value.string = errtype;
 }
 
+/* Return a pointer to the first '"', '\\' or '\0' character
+ * starting from p. The input is known to be null terminated
+ * at end. */
+static const char *json_string_run_end(const char *p, const char *end)
+{
+    while (p + sizeof(uint64_t) <= end) {
+        uint64_t x;
+        memcpy(&x, p, sizeof(x));
+        if (json_has_zero(x) | json_has_byte(x, '"') |
+            json_has_byte(x, '\\'))
+            break;
+        p += sizeof(x);
+    }
+    while (*p != '"' && *p != '\\' && *p != '\0')
+        p++;
+    return p;
+}
+
 static void json_next_string_token(json_parse_t *json, json_token_t *token)
 {
     char ch;
@@ -628,7 +841,14 @@ static void json_next_string_token(json_parse_t *json, json_token_t *token)
      */
     strbuf_reset(json->tmp);
 
-    while ((ch = *json->ptr) != '"') {
+    while (1) {
+        /* Copy a run of normal characters at once */
+        const char *run_end = json_string_run_end(json->ptr, json->end);
+        strbuf_append_mem_unsafe(json->tmp, json->ptr, run_end - json->ptr);
+        json->ptr = run_end;
+
+        if ((ch = *json->ptr) == '"')
+            break;
         if (!ch) {
             /* Premature end of the string */
             json_set_token_error(token, json, "unexpected end of string");
@@ -636,29 +856,28 @@ static void json_next_string_token(json_parse_t *json, json_token_t *token)
         }
 
         /* Handle escapes */
-        if (ch == '\\') {
-            /* Fetch escape character */
-            ch = *(json->ptr + 1);
-
-            /* Translate escape code and append to tmp string */
-            ch = escape2char[(unsigned char)ch];
-            if (ch == 'u') {
-                if (json_append_unicode_escape(json) == 0)
-                    continue;
-
-                json_set_token_error(token, json,
-                                     "invalid unicode escape code");
-                return;
-            }
-            if (!ch) {
-                json_set_token_error(token, json, "invalid escape code");
-                return;
-            }
-
-            /* Skip '\' */
-            json->ptr++;
+        assert(ch == '\\');
+        /* Fetch escape character */
+        ch = *(json->ptr + 1);
+
+        /* Translate escape code and append to tmp string */
+        ch = escape2char[(unsigned char)ch];
+        if (ch == 'u') {
+            if (json_append_unicode_escape(json) == 0)
+                continue;
+
+            json_set_token_error(token, json,
+                                 "invalid unicode escape code");
+            return;
+        }
+        if (!ch) {
+            json_set_token_error(token, json, "invalid escape code");
+            return;
         }
-        /* Append normal character or translated single character
+
+        /* Skip '\' */
+        json->ptr++;
+        /* Append translated single character
          * Unicode escapes are handled above */
         strbuf_append_char_unsafe(json->tmp, ch);
         json->ptr++;
@@ -1001,10 +1220,11 @@ static void json_process_value(lua_State *l, json_parse_t *json,
     }
 }
 
-static int json_decode(lua_State *l)
+/* Set up the parser for the JSON string and options passed
+ * to a decode function. Returns the length of the string. */
+static size_t json_decode_prepare(lua_State *l, json_parse_t *json,
+                                  struct luaL_serializer *user_cfg)
 {
-    json_parse_t json;
-    json_token_t token;
     size_t json_len;
 
     luaL_argcheck(l, lua_gettop(l) == 2 || lua_gettop(l) == 1, 1,
@@ -1018,34 +1238,48 @@ static int json_decode(lua_State *l)
      * :decode() method within a separate argument. In this case
      * it is required to avoid modifying options of the instance.
      * Life span of user_cfg is restricted by the scope of
-     * :decode() so it is enough to allocate it on the stack.
+     * :decode() so the caller allocates it on the stack.
      */
-    struct luaL_serializer user_cfg;
-    json.cfg = cfg;
+    json->cfg = cfg;
     if (lua_gettop(l) == 2) {
         /*
          * on_update triggers are left uninitialized for user_cfg.
          * The decoding code don't (and shouldn't) run them.
          */
-        luaL_serializer_copy_options(&user_cfg, cfg);
-        luaL_serializer_parse_options(l, &user_cfg);
+        luaL_serializer_copy_options(user_cfg, cfg);
+        luaL_serializer_parse_options(l, user_cfg);
         lua_pop(l, 1);
-        json.cfg = &user_cfg;
+        json->cfg = user_cfg;
     }
 
-    json.data = luaL_checklstring(l, 1, &json_len);
-    json.current_depth = 0;
-    json.ptr = json.data;
-    json.line_count = 1;
-    json.cur_line_ptr = json.data;
+    json->data = luaL_checklstring(l, 1, &json_len);
+    json->end = json->data + json_len;
+    json->current_depth = 0;
+    json->ptr = json->data;
+    json->line_count = 1;
+    json->cur_line_ptr = json->data;
 
     /* Detect Unicode other than UTF-8 (see RFC 4627, Sec 3)
      *
      * CJSON can support any simple data type, hence only the first
      * character is guaranteed to be ASCII (at worst: '"'). This is
      * still enough to detect whether the wrong encoding is in use. */
-    if (json_len >= 2 && (!json.data[0] || !json.data[1]))
+    if (json_len >= 2 && (!json->data[0] || !json->data[1]))
         luaL_error(l, "JSON parser does not support UTF-16 or UTF-32");
+    return json_len;
+}
+
+static int json_decode(lua_State *l)
+{
+    json_parse_t json;
+    json_token_t token;
+
+    /*
+     * user_cfg is per-call local version of serializer instance
+     * options, see json_decode_prepare().
+     */
+    struct luaL_serializer user_cfg;
+    size_t json_len = json_decode_prepare(l, &json, &user_cfg);
 
     /* Ensure the temporary buffer can hold the entire string.
      * This means we no longer need to do length checks since the decoded
@@ -1066,6 +1300,193 @@ static int json_decode(lua_State *l)
     return 1;
 }
 
+/* ===== DECODING TO MSGPACK ===== */
+
+/* json.decode_to_msgpack() transcodes JSON straight into MsgPack,
+ * without building Lua tables in between. The container headers
+ * are written when the number of elements becomes known: a
+ * placeholder of the maximal header size is reserved first, and
+ * the contents are shifted back if the real header is shorter. */
+enum { JSON_MP_HEADER_MAX = 5 };
+
+static void json_mp_process_value(lua_State *l, json_parse_t *json,
+                                  json_token_t *token, strbuf_t *mp);
+
+static int json_mp_reserve_header(strbuf_t *mp)
+{
+    int pos = strbuf_length(mp);
+    strbuf_ensure_empty_length(mp, JSON_MP_HEADER_MAX);
+    strbuf_extend_length(mp, JSON_MP_HEADER_MAX);
+    return pos;
+}
+
+static void json_mp_write_header(strbuf_t *mp, int pos, uint32_t count,
+                                 int is_map)
+{
+    char header[JSON_MP_HEADER_MAX];
+    char *end = is_map ? mp_encode_map(header, count) :
+                mp_encode_array(header, count);
+    int header_len = end - header;
+    char *base = mp->buf + pos;
+    int data_len = strbuf_length(mp) - pos - JSON_MP_HEADER_MAX;
+    memmove(base + header_len, base + JSON_MP_HEADER_MAX, data_len);
+    memcpy(base, header, header_len);
+    mp->length -= JSON_MP_HEADER_MAX - header_len;
+}
+
+static void json_mp_append_str(strbuf_t *mp, const char *str, uint32_t len)
+{
+    strbuf_ensure_empty_length(mp, mp_sizeof_str(len));
+    char *end = mp_encode_str(strbuf_empty_ptr(mp), str, len);
+    strbuf_extend_length(mp, end - strbuf_empty_ptr(mp));
+}
+
+static void json_mp_parse_object_context(lua_State *l, json_parse_t *json,
+                                         strbuf_t *mp)
+{
+    json_token_t token;
+    uint32_t count = 0;
+
+    json_decode_descend(l, json, 0);
+    int pos = json_mp_reserve_header(mp);
+
+    json_next_token(json, &token);
+
+    /* Handle empty objects */
+    if (token.type == T_OBJ_END)
+        goto end;
+
+    while (1) {
+        if (token.type != T_STRING)
+            json_throw_parse_error(l, json, "object key string", &token);
+
+        json_mp_append_str(mp, token.value.string, token.string_len);
+
+        json_next_token(json, &token);
+        if (token.type != T_COLON)
+            json_throw_parse_error(l, json, "colon", &token);
+
+        json_next_token(json, &token);
+        json_mp_process_value(l, json, &token, mp);
+        count++;
+
+        json_next_token(json, &token);
+
+        if (token.type == T_OBJ_END)
+            goto end;
+
+        if (token.type != T_COMMA)
+            json_throw_parse_error(l, json, "comma or object end", &token);
+
+        json_next_token(json, &token);
+    }
+end:
+    json_mp_write_header(mp, pos, count, 1);
+    json_decode_ascend(json);
+}
+
+static void json_mp_parse_array_context(lua_State *l, json_parse_t *json,
+                                        strbuf_t *mp)
+{
+    json_token_t token;
+    uint32_t count = 0;
+
+    json_decode_descend(l, json, 0);
+    int pos = json_mp_reserve_header(mp);
+
+    json_next_token(json, &token);
+
+    /* Handle empty arrays */
+    if (token.type == T_ARR_END)
+        goto end;
+
+    while (1) {
+        json_mp_process_value(l, json, &token, mp);
+        count++;
+
+        json_next_token(json, &token);
+
+        if (token.type == T_ARR_END)
+            goto end;
+
+        if (token.type != T_COMMA)
+            json_throw_parse_error(l, json, "comma or array end", &token);
+
+        json_next_token(json, &token);
+    }
+end:
+    json_mp_write_header(mp, pos, count, 0);
+    json_decode_ascend(json);
+}
+
+static void json_mp_process_value(lua_State *l, json_parse_t *json,
+                                  json_token_t *token, strbuf_t *mp)
+{
+    /* Enough for any scalar except strings. */
+    strbuf_ensure_empty_length(mp, 9);
+    char *ptr = strbuf_empty_ptr(mp);
+    switch (token->type) {
+    case T_STRING:
+        return json_mp_append_str(mp, token->value.string,
+                                  token->string_len);
+    case T_UINT:
+        ptr = mp_encode_uint(ptr, token->value.ival);
+        break;
+    case T_INT:
+        if (token->value.ival < 0)
+            ptr = mp_encode_int(ptr, token->value.ival);
+        else
+            ptr = mp_encode_uint(ptr, token->value.ival);
+        break;
+    case T_NUMBER:
+        luaL_checkfinite(l, json->cfg, token->value.number);
+        ptr = mp_encode_double(ptr, token->value.number);
+        break;
+    case T_BOOLEAN:
+        ptr = mp_encode_bool(ptr, token->value.boolean);
+        break;
+    case T_NULL:
+        ptr = mp_encode_nil(ptr);
+        break;
+    case T_OBJ_BEGIN:
+        return json_mp_parse_object_context(l, json, mp);
+    case T_ARR_BEGIN:
+        return json_mp_parse_array_context(l, json, mp);
+    default:
+        json_throw_parse_error(l, json, "value", token);
+    }
+    strbuf_extend_length(mp, ptr - strbuf_empty_ptr(mp));
+}
+
+static int json_decode_to_msgpack(lua_State *l)
+{
+    json_parse_t json;
+    json_token_t token;
+
+    struct luaL_serializer user_cfg;
+    size_t json_len = json_decode_prepare(l, &json, &user_cfg);
+
+    /* See json_decode(). */
+    json.tmp = strbuf_new(json_len);
+
+    /* Reuse existing buffer. */
+    strbuf_reset(&decode_mp_buf);
+
+    json_next_token(&json, &token);
+    json_mp_process_value(l, &json, &token, &decode_mp_buf);
+
+    /* Ensure there is no more input left */
+    json_next_token(&json, &token);
+
+    if (token.type != T_END)
+        json_throw_parse_error(l, &json, "the end", &token);
+
+    strbuf_free(json.tmp);
+
+    lua_pushlstring(l, decode_mp_buf.buf, strbuf_length(&decode_mp_buf));
+    return 1;
+}
+
 /* ===== INITIALISATION ===== */
 
 static int
@@ -1074,6 +1495,7 @@ json_new(lua_State *L);
 static const luaL_Reg jsonlib[] = {
     { "encode", json_encode },
     { "decode", json_decode },
+    { "decode_to_msgpack", json_decode_to_msgpack },
     { "new",    json_new },
     { NULL, NULL}
 };
@@ -10,6 +10,14 @@ extern "C" {
 LUALIB_API  int
 luaopen_json(lua_State *L);
 
+/**
+ * Encode MsgPack data into JSON with the default serializer
+ * options and push the resulting string onto the Lua stack.
+ * Raises a Lua error if the data can't be represented in JSON.
+ */
+void
+json_encode_msgpack(lua_State *L, const char *data);
+
 #if defined(__cplusplus)
 } /* extern "C" */
 #endif